@@ -4,14 +4,29 @@
 #include "hardware/gpio.h"
 #include "pico/time.h"
 
-#define DEBOUNCE_US   5000u  // 5 ms de debounce
+#define DEBOUNCE_US   5000u  // 5 ms de debounce (por defecto; el master lo puede cambiar)
+
+// Ajustables en caliente (button_driver_set_*)
+static uint32_t s_debounce_us = DEBOUNCE_US;
+static uint32_t s_scan_us     = 0;     // 0 = leer en cada llamada
+static uint64_t s_last_scan_us = 0;
 
 typedef struct {
     bool     stable;          // estado estable (debounced)
     bool     last_reading;    // última lectura cruda del pin
     uint64_t last_change_us;  // tiempo de la última variación cruda
+    uint64_t edge_us;         // primera variación cruda desde el estado estable
+    bool     edge_pending;    // edge_us vale: el pin salió de un estado asentado
 } button_state_t;
 
+// Cola de flancos con la marca de tiempo del cambio crudo
+#define EDGE_FIFO_SIZE  16u   // potencia de 2
+
+static button_edge_t s_edges[EDGE_FIFO_SIZE];
+static uint8_t       s_edge_head = 0;
+static uint8_t       s_edge_tail = 0;
+static uint32_t      s_edge_dropped = 0;
+
 // Orden: primero 4 arcade, luego 4 normales
 static const uint8_t s_button_pins[BUTTON_DRIVER_NUM_TOTAL] = {
     BTN_ARCADE_1_PIN,
@@ -26,6 +41,25 @@ static const uint8_t s_button_pins[BUTTON_DRIVER_NUM_TOTAL] = {
 
 static button_state_t s_buttons[BUTTON_DRIVER_NUM_TOTAL];
 
+// ----------------------------
+// Cola de flancos
+// ----------------------------
+
+static void edge_push(uint8_t id, bool pressed, uint64_t t_us)
+{
+    uint8_t next = (uint8_t)((s_edge_head + 1u) & (EDGE_FIFO_SIZE - 1u));
+
+    if (next == s_edge_tail) {
+        // Llena: se pierde el flanco, la máscara sigue siendo la referencia
+        s_edge_dropped++;
+        return;
+    }
+    s_edges[s_edge_head].id      = id;
+    s_edges[s_edge_head].pressed = pressed;
+    s_edges[s_edge_head].t_us    = t_us;
+    s_edge_head = next;
+}
+
 void button_driver_init(void)
 {
     for (int i = 0; i < BUTTON_DRIVER_NUM_TOTAL; i++) {
@@ -41,6 +75,8 @@ void button_driver_init(void)
         s_buttons[i].stable         = raw;
         s_buttons[i].last_reading   = raw;
         s_buttons[i].last_change_us = time_us_64();
+        s_buttons[i].edge_us        = s_buttons[i].last_change_us;
+        s_buttons[i].edge_pending   = false;
     }
 }
 
@@ -48,6 +84,11 @@ void button_driver_update(void)
 {
     uint64_t now = time_us_64();
 
+    if (s_scan_us && (now - s_last_scan_us) < s_scan_us) {
+        return;
+    }
+    s_last_scan_us = now;
+
     for (int i = 0; i < BUTTON_DRIVER_NUM_TOTAL; i++) {
         uint8_t pin = s_button_pins[i];
 
@@ -55,15 +96,22 @@ void button_driver_update(void)
 
         if (raw != s_buttons[i].last_reading) {
             // cambio crudo → reinicia debounce
+            if (!s_buttons[i].edge_pending) {
+                // sale de un estado asentado: aquí empieza el flanco de
+                // verdad. Los rebotes que siguen no mueven la marca.
+                s_buttons[i].edge_us      = now;
+                s_buttons[i].edge_pending = true;
+            }
             s_buttons[i].last_reading   = raw;
             s_buttons[i].last_change_us = now;
-        } else {
-            // si se mantiene estable durante DEBOUNCE_US, actualiza estable
-            if ((now - s_buttons[i].last_change_us) >= DEBOUNCE_US &&
-                s_buttons[i].stable != raw)
-            {
+        } else if ((now - s_buttons[i].last_change_us) >= s_debounce_us) {
+            // se mantuvo DEBOUNCE_US: asentado (en el estado nuevo o de
+            // vuelta en el de antes, que entonces fue sólo ruido)
+            if (s_buttons[i].stable != raw) {
                 s_buttons[i].stable = raw;
+                edge_push((uint8_t)i, raw, s_buttons[i].edge_us);
             }
+            s_buttons[i].edge_pending = false;
         }
     }
 }
@@ -108,3 +156,32 @@ bool button_driver_is_pressed(button_id_t id)
     }
     return s_buttons[id].stable;
 }
+
+uint32_t button_driver_set_debounce_us(uint32_t us)
+{
+    if (us > BUTTON_DRIVER_MAX_DEBOUNCE_US) us = BUTTON_DRIVER_MAX_DEBOUNCE_US;
+    s_debounce_us = us;
+    return us;
+}
+
+uint32_t button_driver_set_scan_us(uint32_t us)
+{
+    if (us > BUTTON_DRIVER_MAX_SCAN_US) us = BUTTON_DRIVER_MAX_SCAN_US;
+    s_scan_us = us;
+    return us;
+}
+
+bool button_driver_take_edge(button_edge_t *out)
+{
+    if (s_edge_tail == s_edge_head) {
+        return false;
+    }
+    *out = s_edges[s_edge_tail];
+    s_edge_tail = (uint8_t)((s_edge_tail + 1u) & (EDGE_FIFO_SIZE - 1u));
+    return true;
+}
+
+uint32_t button_driver_get_edges_dropped(void)
+{
+    return s_edge_dropped;
+}
@@ -73,4 +73,40 @@ uint8_t button_driver_get_all_mask(void);
  */
 bool button_driver_is_pressed(button_id_t id);
 
+// Límites de los ajustes en caliente
+#define BUTTON_DRIVER_MAX_DEBOUNCE_US  50000u
+#define BUTTON_DRIVER_MAX_SCAN_US      20000u
+
+/**
+ * @brief Cambia el tiempo de antirrebote (us). Devuelve el valor aplicado.
+ */
+uint32_t button_driver_set_debounce_us(uint32_t us);
+
+/**
+ * @brief Lee los pines como mucho cada us microsegundos (0 = en cada
+ * button_driver_update()). Devuelve el valor aplicado.
+ */
+uint32_t button_driver_set_scan_us(uint32_t us);
+
+/**
+ * @brief Flanco ya filtrado por el antirrebote. t_us es time_us_64() del
+ * primer cambio crudo del pin (no del momento en que pasó el antirrebote).
+ */
+typedef struct {
+    uint8_t  id;        // button_id_t
+    bool     pressed;   // true = pulsado, false = soltado
+    uint64_t t_us;
+} button_edge_t;
+
+/**
+ * @brief Saca el flanco más antiguo de la cola. false si no hay ninguno.
+ * Si nadie los consume la cola se llena y se descartan los nuevos.
+ */
+bool button_driver_take_edge(button_edge_t *out);
+
+/**
+ * @brief Flancos descartados por cola llena desde el arranque.
+ */
+uint32_t button_driver_get_edges_dropped(void);
+
 #endif // BUTTON_DRIVER_H
@@ -8,3 +8,152 @@ uint8_t ctrl_protocol_calc_checksum(const uint8_t *payload, uint8_t len)
     }
     return (uint8_t)(sum & 0xFF);
 }
+
+// ----------------------------
+// Protocolo v2
+// ----------------------------
+
+// CRC por nibbles: 16 entradas (32 bytes de flash) y dos pasos por byte
+static const uint16_t s_crc16_nibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+uint16_t ctrl_protocol_crc16(uint16_t crc, const uint8_t *data, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++) {
+        crc = (uint16_t)((crc << 4) ^ s_crc16_nibble[(crc >> 12) ^ (data[i] >> 4)]);
+        crc = (uint16_t)((crc << 4) ^ s_crc16_nibble[(crc >> 12) ^ (data[i] & 0x0F)]);
+    }
+    return crc;
+}
+
+uint8_t ctrl_v2_build_frame(uint8_t type, uint8_t seq,
+                            const uint8_t *payload, uint8_t len, uint8_t *out)
+{
+    if (len > CTRL_V2_MAX_PAYLOAD) return 0;
+
+    uint8_t f = 0;
+    out[f++] = CTRL_FRAME_HEADER_1;
+    out[f++] = CTRL_V2_HEADER_2;
+    out[f++] = type;
+    out[f++] = seq;
+    out[f++] = len;
+    for (uint8_t i = 0; i < len; i++) {
+        out[f++] = payload[i];
+    }
+
+    // El CRC no cubre los dos bytes de cabecera
+    uint16_t crc = ctrl_protocol_crc16(CTRL_CRC16_INIT, &out[2], (uint16_t)(f - 2));
+    out[f++] = (uint8_t)(crc >> 8);
+    out[f++] = (uint8_t)(crc & 0xFF);
+    return f;
+}
+
+bool ctrl_v2_check_frame(const uint8_t *frame, uint8_t size)
+{
+    if (size < CTRL_V2_HDR_SIZE + CTRL_V2_CRC_SIZE) return false;
+    if (frame[4] != size - CTRL_V2_HDR_SIZE - CTRL_V2_CRC_SIZE) return false;
+
+    uint16_t crc = ctrl_protocol_crc16(CTRL_CRC16_INIT, &frame[2],
+                                       (uint16_t)(size - 2 - CTRL_V2_CRC_SIZE));
+    return frame[size - 2] == (uint8_t)(crc >> 8) &&
+           frame[size - 1] == (uint8_t)(crc & 0xFF);
+}
+
+uint8_t ctrl_v2_encode_state(const ctrl_payload_t *st, uint8_t flags, uint8_t *out)
+{
+    uint8_t  n       = 0;
+    uint16_t pending = 0;     // pot anterior esperando pareja
+    bool     half    = false;
+
+    flags &= CTRL_V2_F_ALL;
+    out[n++] = flags;
+
+    if (flags & CTRL_V2_F_BUTTONS) {
+        out[n++] = (uint8_t)((st->arcade_mask & 0x0F) | (st->normal_mask << 4));
+    }
+
+    for (int i = 0; i < CTRL_FRAME_NUM_POTS; i++) {
+        if (!(flags & CTRL_V2_F_POT(i))) continue;
+
+        uint16_t v = st->pot[i] & 0x0FFF;
+        if (!half) {
+            pending = v;
+            half    = true;
+        } else {
+            out[n++] = (uint8_t)(pending >> 4);
+            out[n++] = (uint8_t)(((pending & 0x0F) << 4) | (v >> 8));
+            out[n++] = (uint8_t)(v & 0xFF);
+            half     = false;
+        }
+    }
+    if (half) {
+        out[n++] = (uint8_t)(pending >> 4);
+        out[n++] = (uint8_t)((pending & 0x0F) << 4);
+    }
+    return n;
+}
+
+int ctrl_v2_decode_state(const uint8_t *payload, uint8_t len, ctrl_payload_t *st)
+{
+    if (len < 1) return -1;
+
+    uint8_t flags = payload[0];
+    if (flags & (uint8_t)~CTRL_V2_F_ALL) return -1;
+
+    // Longitud exacta que corresponde a los flags
+    uint8_t npots = 0;
+    for (int i = 0; i < CTRL_FRAME_NUM_POTS; i++) {
+        if (flags & CTRL_V2_F_POT(i)) npots++;
+    }
+    uint8_t want = (uint8_t)(1 + ((flags & CTRL_V2_F_BUTTONS) ? 1 : 0) + (npots * 12 + 7) / 8);
+    if (len != want) return -1;
+
+    const uint8_t *p = &payload[1];
+
+    if (flags & CTRL_V2_F_BUTTONS) {
+        st->arcade_mask = *p & 0x0F;
+        st->normal_mask = *p >> 4;
+        p++;
+    }
+
+    bool half = false;
+    for (int i = 0; i < CTRL_FRAME_NUM_POTS; i++) {
+        if (!(flags & CTRL_V2_F_POT(i))) continue;
+
+        if (!half) {
+            st->pot[i] = (uint16_t)((p[0] << 4) | (p[1] >> 4));
+            half = true;
+        } else {
+            st->pot[i] = (uint16_t)(((p[1] & 0x0F) << 8) | p[2]);
+            p   += 3;
+            half = false;
+        }
+    }
+    return flags;
+}
+
+// ----------------------------
+// Velocidad del enlace
+// ----------------------------
+
+static const uint32_t s_baud_rates[CTRL_BAUD_NUM] = {
+    115200, 921600, 1500000, 3000000
+};
+
+uint32_t ctrl_protocol_baud_rate(uint8_t idx)
+{
+    return (idx < CTRL_BAUD_NUM) ? s_baud_rates[idx] : 0;
+}
+
+void ctrl_protocol_baud_pattern(uint8_t idx, uint8_t n, uint8_t *out)
+{
+    static const uint8_t base[4] = { 0x55, 0xAA, 0x00, 0xFF };
+
+    out[0] = idx;
+    out[1] = n;
+    for (uint8_t i = 2; i < CTRL_BAUD_TEST_LEN; i++) {
+        out[i] = (uint8_t)(base[(i + n) & 3] ^ ((i & 4) ? n : 0));
+    }
+}
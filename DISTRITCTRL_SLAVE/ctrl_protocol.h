@@ -2,6 +2,7 @@
 #define CTRL_PROTOCOL_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 // Bytes de cabecera del frame
 #define CTRL_FRAME_HEADER_1  0xAA
@@ -27,4 +28,262 @@ typedef struct {
 // Calcula checksum 8 bits (suma de todos los bytes de payload)
 uint8_t ctrl_protocol_calc_checksum(const uint8_t *payload, uint8_t len);
 
+// =============================
+// Protocolo v2
+// =============================
+//
+// Frames de longitud variable que sólo llevan lo que cambió:
+//
+//   [AA][5A][tipo][seq][len][payload (len bytes)][crc16 MSB][crc16 LSB]
+//
+// - El primer byte de cabecera es el mismo que en v1; el segundo dice la
+//   versión, así que un parser puede aceptar los dos formatos a la vez.
+// - seq: contador de 8 bits por frame del slave, para detectar pérdidas.
+// - CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) sobre tipo..payload.
+//
+// Payload de estado (DELTA y FULL):
+//   [flags][botones si CTRL_V2_F_BUTTONS][pots con flag, 12 bits empaquetados]
+//   botones: bits 0..3 arcade, bits 4..7 normales
+//   pots: en orden de índice, de dos en dos en 3 bytes
+//         (a11..a4 | a3..a0 b11..b8 | b7..b0); si sobra uno van 2 bytes.
+//
+// Negociación: el slave arranca hablando v1 y manda HELLO cada poco; el
+// master contesta ACK con la versión elegida y a partir de ahí todo va en v2.
+// Un master viejo ignora los frames AA 5A; un slave viejo sigue mandando v1.
+
+#define CTRL_PROTOCOL_VERSION    2
+
+#define CTRL_V2_HEADER_2         0x5A
+#define CTRL_V2_HDR_SIZE         5                  // 2 header + tipo + seq + len
+#define CTRL_V2_CRC_SIZE         2
+#define CTRL_V2_MAX_PAYLOAD      32
+#define CTRL_V2_MAX_FRAME        (CTRL_V2_HDR_SIZE + CTRL_V2_MAX_PAYLOAD + CTRL_V2_CRC_SIZE)
+
+// Payload de estado más largo: flags + botones + 4 pots de 12 bits
+#define CTRL_V2_STATE_MAX        (2 + (CTRL_FRAME_NUM_POTS * 12 + 7) / 8)
+
+#define CTRL_CRC16_INIT          0xFFFFu
+
+typedef enum {
+    CTRL_V2_T_DELTA  = 0x01,   // slave → master: sólo los campos que cambiaron
+    CTRL_V2_T_EDGE   = 0x02,   // slave → master: flancos de botón, salen al momento (ver abajo)
+    CTRL_V2_T_FULL   = 0x03,   // slave → master: estado completo (arranque, resync, refresco)
+    CTRL_V2_T_HELLO  = 0x10,   // slave → master: [versión máx][capacidades]
+    CTRL_V2_T_ACK    = 0x11,   // master → slave: [versión elegida]
+    CTRL_V2_T_RESYNC = 0x12,   // master → slave: perdió frames, pide un FULL
+
+    // Cambio de velocidad (ver "Velocidad del enlace" más abajo)
+    CTRL_V2_T_BAUD_TRY     = 0x13,   // master → slave: [índice] probar esta velocidad
+    CTRL_V2_T_BAUD_OK      = 0x14,   // slave → master: [índice] acepto, cambio al vaciar TX
+    CTRL_V2_T_BAUD_TEST    = 0x15,   // slave → master: [índice][n][patrón] ya en la nueva
+    CTRL_V2_T_BAUD_CONFIRM = 0x16,   // master → slave: [índice] patrones buenos, quedarse
+    CTRL_V2_T_PING         = 0x17,   // master → slave: sigo aquí (watchdog del slave)
+
+    // Configuración en caliente (ver "Parámetros del slave" más abajo)
+    CTRL_V2_T_CONFIG       = 0x18,   // master → slave: n x [id][valor MSB][valor LSB]
+    CTRL_V2_T_CONFIG_ACK   = 0x19,   // slave → master: n x [id][aplicado MSB][aplicado LSB]
+    CTRL_V2_T_SNAPSHOT     = 0x1A,   // master → slave: manda un FULL ya (también en modo bajo demanda)
+
+    // Sincronización de reloj (ver "Reloj del slave" más abajo)
+    CTRL_V2_T_SYNC_REQ     = 0x1B,   // master → slave: [t1]
+    CTRL_V2_T_SYNC_RESP    = 0x1C,   // slave → master: [t1][t2][t3]
+
+    // Bus de varios slaves (ver "Bus multi-slave" más abajo)
+    CTRL_V2_T_POLL         = 0x1D,   // master → slave: [flags CTRL_POLL_F_*] te toca hablar
+    CTRL_V2_T_DESC         = 0x1E,   // slave → master: descriptor de capacidades (ctrl_desc_t)
+    CTRL_V2_T_END          = 0x1F    // slave → master: fin de mi turno en el bus
+} ctrl_v2_type_t;
+
+// El byte de tipo lleva también la dirección del slave en los 3 bits altos
+// (0 = enlace punto a punto de siempre, o difusión en el bus). Los tipos
+// caben en 5 bits, así que en punto a punto los frames no cambian.
+#define CTRL_V2_TYPE_MASK        0x1Fu
+#define CTRL_V2_ADDR_SHIFT       5
+#define CTRL_V2_TYPE(b)          ((uint8_t)((b) & CTRL_V2_TYPE_MASK))
+#define CTRL_V2_ADDR(b)          ((uint8_t)((b) >> CTRL_V2_ADDR_SHIFT))
+#define CTRL_V2_MAKE_TYPE(addr, type) \
+    ((uint8_t)(((addr) << CTRL_V2_ADDR_SHIFT) | ((type) & CTRL_V2_TYPE_MASK)))
+
+// Tamaño de un frame v2 entero a partir de su cabecera
+#define CTRL_V2_FRAME_LEN(hdr)   ((uint8_t)(CTRL_V2_HDR_SIZE + (hdr)[4] + CTRL_V2_CRC_SIZE))
+
+// Flags del payload de estado
+#define CTRL_V2_F_POT(i)         (1u << (i))        // bits 0..3: pot i presente
+#define CTRL_V2_F_POTS_ALL       0x0Fu
+#define CTRL_V2_F_BUTTONS        0x80u
+#define CTRL_V2_F_ALL            (CTRL_V2_F_BUTTONS | CTRL_V2_F_POTS_ALL)
+
+// Payload de EDGE:
+//   [botones][t_tx 32 bits][n x ([id | pressed << 7][t 32 bits])]
+//   botones: máscara tras aplicar los flancos (manda sobre los flancos)
+//   t_tx:    time_us_64() del slave al armar el frame (32 bits bajos, MSB primero)
+//   t:       time_us_64() del slave en el cambio crudo del pin
+// Un EDGE de un solo byte ([botones], sin marcas) también es válido.
+#define CTRL_V2_EDGE_HDR_LEN     5
+#define CTRL_V2_EDGE_ENTRY_LEN   5
+#define CTRL_V2_EDGE_MAX         ((CTRL_V2_MAX_PAYLOAD - CTRL_V2_EDGE_HDR_LEN) / CTRL_V2_EDGE_ENTRY_LEN)
+#define CTRL_V2_EDGE_PRESSED     0x80u
+
+// =============================
+// Velocidad del enlace (v2)
+// =============================
+//
+// Siempre se arranca a 115200. Ya en v2, el master propone el siguiente
+// escalón (BAUD_TRY); el slave contesta BAUD_OK, vacía su TX y cambia; el
+// master cambia al recibir el OK. En la velocidad nueva el slave manda
+// CTRL_BAUD_TEST_FRAMES frames de patrón y el master, si llegan todos sin
+// errores de CRC, contesta BAUD_CONFIRM. Sin confirmación en
+// CTRL_BAUD_CONFIRM_US los dos vuelven a la velocidad anterior.
+//
+// Ya en una velocidad alta, si un lado deja de oír al otro (watchdog) vuelve
+// directamente a 115200: el otro hace lo mismo y se reencuentran ahí.
+
+#define CTRL_BAUD_NUM            4                  // 115200, 921600, 1.5M, 3M
+#define CTRL_BAUD_TEST_FRAMES    8
+#define CTRL_BAUD_TEST_LEN       16                 // [índice][n][14 bytes de patrón]
+#define CTRL_BAUD_SETTLE_US      3000u              // slave: espera a que el master cambie
+#define CTRL_BAUD_CONFIRM_US     100000u
+#define CTRL_BAUD_PING_US        250000u            // master → slave a velocidad alta
+#define CTRL_BAUD_WATCHDOG_US    1000000u           // slave: sin nada del master → 115200
+
+// Velocidad del escalón idx (0 = 115200); 0 si idx no existe
+uint32_t ctrl_protocol_baud_rate(uint8_t idx);
+
+// Patrón de prueba del frame n (payload de BAUD_TEST, CTRL_BAUD_TEST_LEN
+// bytes): mezcla 0x55/0xAA/0x00/0xFF, lo peor para un enlace al límite.
+void ctrl_protocol_baud_pattern(uint8_t idx, uint8_t n, uint8_t *out);
+
+// =============================
+// Parámetros del slave (v2)
+// =============================
+//
+// El master los cambia con CONFIG sin reflashear el slave; el slave los
+// recorta a su rango y contesta CONFIG_ACK con el valor que quedó. Se pierden
+// al reiniciar el slave (el master los vuelve a mandar al ver un HELLO).
+
+typedef enum {
+    CTRL_PARAM_BTN_DEBOUNCE_US = 0x01,   // antirrebote de botones (us)
+    CTRL_PARAM_BTN_SCAN_US     = 0x02,   // periodo de lectura de botones (0 = cada vuelta)
+    CTRL_PARAM_POT_DR          = 0x03,   // data rate ADS1115, código DR 0..7 (8..860 SPS)
+    CTRL_PARAM_POT_PGA         = 0x04,   // ganancia ADS1115, código PGA 0..5 (±6.144..±0.256 V)
+    CTRL_PARAM_POT_SCAN_US     = 0x05,   // periodo de un barrido de los 4 pots (0 = continuo)
+    CTRL_PARAM_POT_THRESHOLD   = 0x06,   // cambio mínimo de un pot para mandarlo (cuentas de 12 bits)
+    CTRL_PARAM_POT_GAP_US      = 0x07,   // limitador de deltas de pots (us entre deltas)
+    CTRL_PARAM_KEEPALIVE_MS    = 0x08,   // latido sin tráfico (ms)
+    CTRL_PARAM_REPORT_MODE     = 0x09,   // CTRL_REPORT_*
+    CTRL_PARAM_COUNT
+} ctrl_param_id_t;
+
+#define CTRL_REPORT_EVENTS     0   // flancos y deltas al momento (por defecto)
+#define CTRL_REPORT_ON_DEMAND  1   // sólo latido y SNAPSHOT: mínimo ancho de banda
+
+#define CTRL_PARAM_ENTRY_LEN   3
+#define CTRL_PARAM_MAX_PER_FRAME  (CTRL_V2_MAX_PAYLOAD / CTRL_PARAM_ENTRY_LEN)
+
+// =============================
+// Reloj del slave (v2)
+// =============================
+//
+// Intercambio tipo NTP, siempre iniciado por el master:
+//   t1: master, justo antes de mandar SYNC_REQ (con su TX vacío)
+//   t2: slave, al terminar de recibir SYNC_REQ
+//   t3: slave, justo antes de mandar SYNC_RESP (con su TX vacío)
+//   t4: master, al terminar de recibir SYNC_RESP
+// Todos son time_us_64() de cada lado, 32 bits bajos, MSB primero. El master
+// descuenta lo que tarda cada frame en pasar por el cable a la velocidad
+// actual, así que lo que queda en el RTT es sólo lo que tarda cada lado en
+// atender el UART.
+
+#define CTRL_SYNC_REQ_LEN      4
+#define CTRL_SYNC_RESP_LEN     12
+
+// =============================
+// Bus multi-slave (v2)
+// =============================
+//
+// Varios slaves en el mismo par (RS-485 semidúplex, DE de cada transceptor
+// controlado por su Pico). Sólo habla quien tiene el turno:
+//
+//   master: [comandos de difusión, dirección 0][POLL a la dirección n]
+//   slave n: [lo que tenga pendiente: EDGE / DELTA / FULL / CONFIG_ACK /
+//            DESC][END]
+//
+// El master recorre las direcciones presentes en orden y, en cada vuelta,
+// prueba además una dirección ausente (descubrimiento). Un slave que no
+// contesta varios POLL seguidos se da por desaparecido. Cada slave acumula
+// sus frames entre turnos en su buffer de TX, así que la latencia de un
+// flanco es como mucho una vuelta entera del bus.
+//
+// En el bus no hay HELLO, cambio de velocidad ni sincronización de reloj:
+// todo va a CTRL_BUS_BAUD fijo y en v2 desde el arranque.
+
+#define CTRL_BUS_MAX_SLAVES      7                  // direcciones 1..7
+#define CTRL_BUS_BAUD            921600u
+
+#define CTRL_POLL_F_DESC         0x01u   // manda tu descriptor en este turno
+#define CTRL_POLL_F_FULL         0x02u   // manda un FULL en este turno (RESYNC)
+
+// Descriptor de capacidades. En punto a punto el slave lo manda tras el ACK;
+// en el bus, cuando el POLL lo pide. El payload de estado sigue siendo de
+// 8 botones y 4 pots como máximo por slave: el descriptor dice cuántos hay
+// de verdad.
+typedef struct {
+    uint8_t n_arcade;     // botones arcade (bits 0..3 de la máscara)
+    uint8_t n_normal;     // botones normales (bits 4..7)
+    uint8_t n_pots;
+    uint8_t n_encoders;   // aún sin transporte: 0
+    uint8_t pot_bits;     // resolución útil de los pots
+} ctrl_desc_t;
+
+#define CTRL_DESC_LEN            5
+
+// =============================
+// Transporte SPI (v2)
+// =============================
+//
+// Alternativa al UART, elegida al compilar. El master (controlador) hace una
+// transacción full-duplex de CTRL_SPI_XFER_LEN bytes con el slave
+// (periférico) en cada poll, modo 3, con DMA en los dos lados:
+//
+//   slave → master: [CTRL_SPI_MAGIC][seq][n][t_cs x4][estado x8][CRC-16 x2]
+//                   [n bytes de frames v2][relleno]
+//   master → slave: [frames v2 (CONFIG, SNAPSHOT...)][relleno 0x00]
+//
+// El bloque fijo lleva el estado completo en cada transacción (el payload de
+// un FULL con CTRL_V2_F_ALL), así que por el flujo de frames sólo va lo que no
+// es estado: EDGE con la hora de cada flanco, CONFIG_ACK y DESC. Los frames
+// van siempre enteros, y el master los procesa antes que el bloque fijo.
+//
+// seq sube en cada transacción que el slave preparó: si se repite, el slave no
+// llegó a rearmar y el master la descarta entera. t_cs es la hora del slave
+// en la bajada de CS de la transacción anterior; el master apuntó la suya, así
+// que cada transacción da un par (slave, master) para el reloj sin SYNC_REQ.
+// Sin HELLO ni cambio de velocidad: v2 desde el arranque.
+
+#define CTRL_SPI_MAGIC           0xC3
+#define CTRL_SPI_HDR_LEN         (7 + CTRL_V2_STATE_MAX)      // magic, seq, n, t_cs, estado
+#define CTRL_SPI_BLOCK_LEN       (CTRL_SPI_HDR_LEN + CTRL_V2_CRC_SIZE)
+#define CTRL_SPI_STREAM_MAX      CTRL_V2_MAX_FRAME            // cabe cualquier frame
+#define CTRL_SPI_XFER_LEN        (CTRL_SPI_BLOCK_LEN + CTRL_SPI_STREAM_MAX)
+#define CTRL_SPI_HZ              8000000u   // el PL022 esclavo pide clk_peri >= 12 x SCK
+
+// CRC-16/CCITT-FALSE incremental (empezar con CTRL_CRC16_INIT)
+uint16_t ctrl_protocol_crc16(uint16_t crc, const uint8_t *data, uint16_t len);
+
+// Arma un frame v2 completo en out (CTRL_V2_MAX_FRAME bytes como mínimo).
+// Devuelve el tamaño del frame, o 0 si len > CTRL_V2_MAX_PAYLOAD.
+uint8_t ctrl_v2_build_frame(uint8_t type, uint8_t seq,
+                            const uint8_t *payload, uint8_t len, uint8_t *out);
+
+// Comprueba el CRC de un frame v2 entero (cabecera incluida).
+bool ctrl_v2_check_frame(const uint8_t *frame, uint8_t size);
+
+// Codifica los campos de st marcados en flags (CTRL_V2_F_*) como payload de
+// estado. out necesita CTRL_V2_STATE_MAX bytes. Devuelve la longitud.
+uint8_t ctrl_v2_encode_state(const ctrl_payload_t *st, uint8_t flags, uint8_t *out);
+
+// Aplica un payload de estado sobre st (sólo toca los campos presentes).
+// Devuelve los flags aplicados, o -1 si el payload está mal formado.
+int ctrl_v2_decode_state(const uint8_t *payload, uint8_t len, ctrl_payload_t *st);
+
 #endif // CTRL_PROTOCOL_H
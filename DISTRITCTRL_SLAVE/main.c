@@ -35,7 +35,7 @@ int main(void)
         // Actualizar potenciómetros (ADS1115, lectura no bloqueante)
         pot_driver_update();
 
-        // Seguir mandando frames por UART al master
+        // Mandar al master lo que haya cambiado (v2) o el frame periódico (v1)
         slave_comm_task();
 
         // Leer máscaras actuales de botones
@@ -83,6 +83,17 @@ printf("\r\n");
                    "P0=%4u  P1=%4u  P2=%4u  P3=%4u\r\n",
                    arcade, normal,
                    p[0], p[1], p[2], p[3]);
+
+            // Tráfico hacia el master (v2: por eventos)
+            slave_comm_stats_t cs;
+            slave_comm_get_stats(&cs);
+            printf("Link v%u @%lu  edge=%lu delta=%lu full=%lu held=%lu bytes=%lu "
+                   "drop=%lu build_max=%luus\r\n",
+                   cs.version, (unsigned long)cs.baud,
+                   (unsigned long)cs.frames_edge, (unsigned long)cs.frames_delta,
+                   (unsigned long)cs.frames_full, (unsigned long)cs.pot_deferred,
+                   (unsigned long)cs.bytes, (unsigned long)cs.tx_dropped,
+                   (unsigned long)cs.build_us_max);
         }
 
         tight_loop_contents();
@@ -21,15 +21,23 @@
 #define ADS1115_REG_CONVERSION 0x00
 #define ADS1115_REG_CONFIG     0x01
 
-// Tiempo de conversión aproximado a 860 SPS (~1.16 ms). Añadimos margen.
-#define ADS1115_CONV_TIME_US   3000
+// Tiempo de conversión = 1/SPS más margen (el oscilador interno va a ±10%).
+// A 860 SPS (~1.16 ms) queda en ~3 ms, como siempre.
+#define ADS1115_CONV_MARGIN_US 1800
 
-// Config base (sin OS ni MUX):
-// - PGA = ±4.096V (001 en PGA bits)
+// Config base (sin OS, MUX, PGA ni DR):
 // - Modo single-shot (MODE=1)
-// - Data rate = 860 SPS (DR=111)
 // - Comparator desactivado (COMP_QUE = 11)
-#define ADS1115_CONFIG_BASE    0x03E3
+#define ADS1115_CONFIG_BASE    0x0103
+#define ADS1115_PGA_SHIFT      9
+#define ADS1115_DR_SHIFT       5
+
+// Por defecto: PGA = ±4.096V (001), DR = 860 SPS (111)
+#define ADS1115_PGA_DEFAULT    1
+#define ADS1115_DR_DEFAULT     7
+
+// Muestras por segundo de cada código DR
+static const uint16_t s_ads1115_sps[8] = { 8, 16, 32, 64, 128, 250, 475, 860 };
 
 // Tabla MUX para entradas single-ended AINx vs GND
 // MUX bits [14:12]:
@@ -51,6 +59,13 @@ static uint16_t s_pot_raw[POT_DRIVER_NUM_CHANNELS] = {0};
 static int             s_current_channel = -1;  // -1 = inactivo
 static absolute_time_t s_conv_start_time;
 
+// Ajustables en caliente (pot_driver_set_*)
+static uint8_t         s_pga          = ADS1115_PGA_DEFAULT;
+static uint8_t         s_dr           = ADS1115_DR_DEFAULT;
+static uint32_t        s_conv_time_us = 0;      // según s_dr
+static uint32_t        s_scan_us      = 0;      // 0 = barrido continuo
+static absolute_time_t s_scan_start_time;
+
 
 // ------------------------
 // Funciones internas I2C
@@ -88,6 +103,8 @@ static void ads1115_start_conversion(int channel)
     uint16_t config = 0x8000;
     config |= s_ads1115_mux[channel];
     config |= ADS1115_CONFIG_BASE;
+    config |= (uint16_t)(s_pga << ADS1115_PGA_SHIFT);
+    config |= (uint16_t)(s_dr  << ADS1115_DR_SHIFT);
 
     ads1115_write_reg(ADS1115_REG_CONFIG, config);
 }
@@ -113,6 +130,8 @@ void pot_driver_init(void)
     }
     s_current_channel = -1;
     s_conv_start_time = get_absolute_time();
+    s_scan_start_time = s_conv_start_time;
+    s_conv_time_us    = 1000000u / s_ads1115_sps[s_dr] + ADS1115_CONV_MARGIN_US;
 }
 
 void pot_driver_update(void)
@@ -120,16 +139,22 @@ void pot_driver_update(void)
     absolute_time_t now = get_absolute_time();
 
     if (s_current_channel < 0) {
+        // Con periodo de barrido, esperar a que toque el siguiente
+        if (s_scan_us && absolute_time_diff_us(s_scan_start_time, now) < (int64_t)s_scan_us) {
+            return;
+        }
+
         // No hay conversión en curso → empieza por el canal 0
         s_current_channel = 0;
         s_conv_start_time = now;
+        s_scan_start_time = now;
         ads1115_start_conversion(s_current_channel);
         return;
     }
 
     // Hay una conversión en curso → ¿ya pasó el tiempo mínimo?
     int64_t dt_us = absolute_time_diff_us(s_conv_start_time, now);
-    if (dt_us < ADS1115_CONV_TIME_US) {
+    if (dt_us < (int64_t)s_conv_time_us) {
         // Todavía no, salimos sin bloquear
         return;
     }
@@ -168,3 +193,25 @@ uint16_t pot_driver_get_12bit(int ch)
     uint16_t raw_u = (uint16_t)raw_signed;
     return (raw_u >> 4); // quitamos 4 bits LSB → 0..4095 aprox
 }
+
+uint8_t pot_driver_set_data_rate(uint8_t dr)
+{
+    if (dr > 7) dr = 7;
+    s_dr           = dr;
+    s_conv_time_us = 1000000u / s_ads1115_sps[dr] + ADS1115_CONV_MARGIN_US;
+    return dr;
+}
+
+uint8_t pot_driver_set_pga(uint8_t pga)
+{
+    if (pga > 5) pga = 5;   // 6 y 7 repiten ±0.256 V
+    s_pga = pga;
+    return pga;
+}
+
+uint32_t pot_driver_set_scan_us(uint32_t us)
+{
+    if (us > POT_DRIVER_MAX_SCAN_US) us = POT_DRIVER_MAX_SCAN_US;
+    s_scan_us = us;
+    return us;
+}
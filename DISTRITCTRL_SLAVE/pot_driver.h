@@ -17,4 +17,17 @@ void pot_driver_update(void);
 // index: 0..POT_DRIVER_NUM_CHANNELS-1
 uint16_t pot_driver_get_12bit(int index);
 
+// Límite del periodo de barrido ajustable
+#define POT_DRIVER_MAX_SCAN_US  1000000u
+
+// Ajustes en caliente del ADS1115 (se aplican en la siguiente conversión).
+// Devuelven el valor aplicado tras recortar al rango válido.
+// dr: código DR 0..7 (8, 16, 32, 64, 128, 250, 475, 860 SPS)
+uint8_t pot_driver_set_data_rate(uint8_t dr);
+// pga: código PGA 0..5 (±6.144, ±4.096, ±2.048, ±1.024, ±0.512, ±0.256 V).
+// OJO: la escala a 12 bits no cambia; con otra PGA cambia el recorrido útil.
+uint8_t pot_driver_set_pga(uint8_t pga);
+// Periodo de un barrido de los 4 canales (0 = continuo, como siempre)
+uint32_t pot_driver_set_scan_us(uint32_t us);
+
 #endif // POT_DRIVER_H
\ No newline at end of file
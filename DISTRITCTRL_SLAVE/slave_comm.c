@@ -5,56 +5,311 @@
 
 #include "pico/stdlib.h"
 #include "hardware/uart.h"
+#include "hardware/spi.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
 #include "pico/time.h"
 
+#include <string.h>
+
 // ----------------------------
 // Config UART del SLAVE
 // ----------------------------
 
 // Ajusta estos pines a como cablees el UART entre slave y master
 #define SLAVE_UART_ID        uart0
-#define SLAVE_UART_BAUDRATE  115200
+#define SLAVE_UART_BAUDRATE  115200   // de arranque; en v2 puede subir (ver BAUD_TRY)
 #define SLAVE_UART_TX_PIN    0   // TX del slave → RX del master
-#define SLAVE_UART_RX_PIN    1   // RX del slave (por ahora no lo usamos, pero lo dejamos listo)
+#define SLAVE_UART_RX_PIN    1   // RX del slave ← TX del master (ACK / RESYNC de v2)
+
+// Dirección en el bus multi-slave (ctrl_protocol.h, "Bus multi-slave").
+// 0 = enlace punto a punto con el master, como siempre. Con 1..7 el slave
+// sólo habla cuando el master le da el turno (POLL) y controla el DE del
+// transceptor RS-485 (con /RE unido a DE).
+#ifndef SLAVE_COMM_BUS_ADDR
+#define SLAVE_COMM_BUS_ADDR   0
+#endif
+#define SLAVE_COMM_BUS        (SLAVE_COMM_BUS_ADDR != 0)
+#define SLAVE_COMM_BUS_DE_PIN 10
+
+// Transporte (ctrl_protocol.h, "Transporte SPI"). 0 = UART, como siempre. Con
+// 1 el slave es periférico SPI del master: el estado va entero en cada
+// transacción y por el flujo de frames sólo salen flancos y respuestas.
+#ifndef SLAVE_COMM_SPI
+#define SLAVE_COMM_SPI        0
+#endif
+
+#if SLAVE_COMM_SPI && SLAVE_COMM_BUS
+#error "El transporte SPI es punto a punto: sin SLAVE_COMM_BUS_ADDR"
+#endif
+
+#define SLAVE_SPI_ID          spi0
+#define SLAVE_SPI_RX_PIN      16  // MOSI: master → slave
+#define SLAVE_SPI_CS_PIN      17
+#define SLAVE_SPI_SCK_PIN     18
+#define SLAVE_SPI_TX_PIN      19  // MISO: slave → master
 
-// Periodo de envío de frames (en microsegundos)
+// Periodo de envío de frames v1 (en microsegundos)
 #define SLAVE_COMM_PERIOD_US  (5000)   // 5 ms -> 200 Hz aprox
 
+// ----------------------------
+// Config protocolo v2
+// ----------------------------
+//
+// En v2 no hay periodo: cada llamada a slave_comm_task() mira si algo cambió
+// y lo manda en ese momento. Flancos de botón siempre al momento; pots con un
+// limitador (cubeta de tokens) para que un barrido de los 4 pots no llene el
+// UART; y un FULL de latido cuando no hay nada que contar.
+
+// Mientras no haya ACK se habla v1 y se ofrece v2 con un HELLO cada tanto
+#define SLAVE_COMM_HELLO_US    (250000)
+
+// Latido: estado completo si no se mandó nada en este tiempo. Mantiene vivo
+// slave_link_is_alive() en el master y corrige cualquier delta perdido.
+#define SLAVE_COMM_KEEPALIVE_US  (100000)
+
+// Cambio mínimo de un pot (en cuentas de 12 bits) para mandarlo en un delta
+#define SLAVE_COMM_POT_DELTA_MIN  2
+
+// Limitador de deltas de pots: como mucho uno cada 2 ms en régimen, con
+// ráfagas de hasta 4. Un delta de 4 pots son 15 bytes (~1.3 ms a 115200), así
+// que en el peor barrido se usa ~2/3 del UART y los flancos siguen entrando.
+#define SLAVE_COMM_POT_GAP_US     (2000)
+#define SLAVE_COMM_POT_BURST      4
+
+// Los valores de arriba son los de arranque: el master los puede cambiar con
+// CONFIG (ctrl_protocol.h, CTRL_PARAM_*). El latido no pasa de 150 ms para
+// que slave_link_is_alive(200) en el master no lo dé por muerto.
+#define SLAVE_COMM_KEEPALIVE_MIN_MS  10
+#define SLAVE_COMM_KEEPALIVE_MAX_MS  150
+#define SLAVE_COMM_POT_DELTA_MAX     512
+#define SLAVE_COMM_POT_GAP_MAX_US    50000
+
+static uint16_t s_pot_delta_min = SLAVE_COMM_POT_DELTA_MIN;
+static uint32_t s_pot_gap_us    = SLAVE_COMM_POT_GAP_US;
+static uint32_t s_keepalive_us  = SLAVE_COMM_KEEPALIVE_US;
+static uint8_t  s_report_mode   = CTRL_REPORT_EVENTS;
+
+// ----------------------------
+// Transmisión por DMA
+// ----------------------------
+//
+// Dos buffers: el DMA vacía uno hacia el UART mientras los frames nuevos se
+// acumulan en el otro. Al terminar, la IRQ del DMA cambia de buffer y arranca
+// el siguiente si tiene algo. El loop sólo copia unos bytes y sigue: nunca
+// espera al UART (13 bytes a 115200 eran ~1.1 ms de uart_write_blocking()).
+//
+// 64 bytes por buffer son ~5.5 ms de línea: más que el peor caso del
+// limitador de pots más flancos. Si aun así no cabe, el frame se descarta y
+// el que llama lo reintenta en la siguiente vuelta.
+
+#define SLAVE_TX_BUF_SIZE   64
+
+static uint8_t           s_tx_buf[2][SLAVE_TX_BUF_SIZE];
+static volatile uint8_t  s_tx_len[2];
+static volatile uint8_t  s_tx_fill = 0;      // buffer donde se acumula
+static volatile bool     s_tx_busy = false;  // el DMA está vaciando el otro
+#if !SLAVE_COMM_SPI
+static int               s_tx_dma  = -1;
+#endif
+static volatile uint8_t  s_tx_sent = 0;      // bytes de la última transferencia
+static uint32_t          s_byte_ns = 0;      // duración de un byte en el cable
+
+// Bus: frame END de fin de turno (sin payload), siempre tiene sitio
+#define SLAVE_BUS_END_SIZE  (CTRL_V2_HDR_SIZE + CTRL_V2_CRC_SIZE)
+#define SLAVE_TX_LIMIT      (SLAVE_TX_BUF_SIZE - (SLAVE_COMM_BUS ? SLAVE_BUS_END_SIZE : 0))
+
+// En el bus y en SPI lo acumulado sale cuando el master lo pide, no al encolar
+#define SLAVE_TX_ON_DEMAND  (SLAVE_COMM_BUS || SLAVE_COMM_SPI)
+
 static absolute_time_t s_last_send_time;
 
+static uint8_t        s_version   = 1;       // versión negociada con el master
+static uint8_t        s_seq       = 0;       // seq del próximo frame v2
+static bool           s_need_full = false;   // mandar FULL en cuanto se pueda
+static ctrl_payload_t s_sent;                // lo que el master ya sabe (v2)
+static uint64_t       s_last_frame_us = 0;   // último frame v2 enviado
+static uint64_t       s_last_hello_us = 0;
+static uint64_t       s_last_poll_us  = 0;
+static uint32_t       s_pot_credit_us = 0;   // tokens del limitador, en us
+static bool           s_pot_held      = false; // hay un cambio de pot esperando token
+static button_edge_t  s_edge_pend[CTRL_V2_EDGE_MAX]; // flancos para el próximo EDGE
+static uint8_t        s_edge_count    = 0;
+static slave_comm_stats_t s_stats;
+
+// Sincronización de reloj: SYNC_REQ recibido, SYNC_RESP por mandar
+static bool           s_sync_pending  = false;
+static uint32_t       s_sync_t1       = 0;     // hora del master (eco)
+static uint32_t       s_sync_t2       = 0;     // llegada del SYNC_REQ
+
+static bool           s_desc_pending  = false; // mandar el descriptor de capacidades
+static bool           s_bus_turn      = false; // el master nos dio el turno (bus)
+
+// Parser de lo que manda el master (sólo frames v2 cortos)
+static uint8_t s_rx_buf[CTRL_V2_MAX_FRAME];
+static uint8_t s_rx_pos = 0;
+
+#if SLAVE_COMM_SPI
+// SPI: el bloque de la próxima transacción se arma al terminar la anterior
+// (subida de CS) y el DMA lo deja listo en el FIFO. Lo recibido va a dos
+// buffers alternos que vacía slave_comm_task().
+static uint8_t           s_spi_tx[CTRL_SPI_XFER_LEN];
+static uint8_t           s_spi_rx[2][CTRL_SPI_XFER_LEN];
+static volatile uint8_t  s_spi_rx_w     = 0;     // buffer donde escribe el DMA
+static volatile bool     s_spi_rx_ready = false; // el otro tiene una transacción entera
+static int               s_spi_tx_dma   = -1;
+static int               s_spi_rx_dma   = -1;
+static uint8_t           s_spi_seq      = 0;
+static uint8_t           s_tx_off       = 0;     // bytes ya entregados de s_tx_sent
+static volatile uint32_t s_spi_cs_us    = 0;     // bajada de CS de la última transacción
+static uint8_t           s_spi_mask     = 0;     // botones según el último EDGE entregado
+#endif
+
 // ----------------------------
-// Función interna: enviar un frame
+// Funciones internas: TX por DMA
 // ----------------------------
-static void slave_comm_send_frame(void)
+
+#if !SLAVE_COMM_SPI
+// Arranca el DMA con el buffer que se estaba llenando (IRQ deshabilitadas o
+// desde la propia IRQ)
+static void slave_comm_tx_kick(void)
 {
-    ctrl_payload_t pl;
-    uint8_t frame[CTRL_FRAME_SIZE];
+    uint8_t b = s_tx_fill;
+
+    s_tx_busy = true;
+    s_tx_fill = (uint8_t)(b ^ 1u);
+    s_tx_len[s_tx_fill] = 0;
+    s_tx_sent = s_tx_len[b];
+
+#if SLAVE_COMM_BUS
+    gpio_put(SLAVE_COMM_BUS_DE_PIN, 1);   // tomar el bus
+#endif
+    dma_channel_transfer_from_buffer_now((uint)s_tx_dma, s_tx_buf[b], s_tx_len[b]);
+}
+
+#if SLAVE_COMM_BUS
+// Soltar el bus cuando el último bit haya salido del UART
+static int64_t slave_comm_de_off(alarm_id_t id, void *user_data)
+{
+    (void)id; (void)user_data;
+
+    if (uart_get_hw(SLAVE_UART_ID)->fr & UART_UARTFR_BUSY_BITS) {
+        return -10;   // aún sale algo: mirar otra vez en 10 us
+    }
+    gpio_put(SLAVE_COMM_BUS_DE_PIN, 0);
+    return 0;
+}
+#endif
+
+static void slave_comm_tx_dma_irq(void)
+{
+    dma_channel_acknowledge_irq0((uint)s_tx_dma);
 
-    // 1) Leer entradas
-    pl.arcade_mask = button_driver_get_arcade_mask();  // bits 0..3
-    pl.normal_mask = button_driver_get_normal_mask();  // bits 0..3
+    s_tx_busy = false;
+
+#if SLAVE_COMM_BUS
+    // El DMA terminó de llenar el FIFO (32 bytes): queda vaciarlo. Lo
+    // siguiente espera al próximo turno.
+    uint32_t left = (s_tx_sent < 32u) ? s_tx_sent : 32u;
+    add_alarm_in_us(((left + 1u) * s_byte_ns) / 1000u, slave_comm_de_off, NULL, true);
+#else
+    if (s_tx_len[s_tx_fill] > 0) {
+        slave_comm_tx_kick();
+    }
+#endif
+}
+#endif
+
+// Copia un frame al buffer de llenado; false si no cabe
+static bool slave_comm_tx_enqueue(const uint8_t *frame, uint8_t n)
+{
+    bool     ok    = false;
+    uint32_t irq   = save_and_disable_interrupts();
+    uint8_t  b     = s_tx_fill;
+    uint8_t  used  = s_tx_len[b];
+
+    if ((uint32_t)used + n <= SLAVE_TX_LIMIT) {
+        memcpy(&s_tx_buf[b][used], frame, n);
+        s_tx_len[b] = (uint8_t)(used + n);
+#if !SLAVE_TX_ON_DEMAND
+        if (!s_tx_busy) {
+            slave_comm_tx_kick();   // en el bus se espera al turno, en SPI al master
+        }
+#endif
+        ok = true;
+    }
+
+    restore_interrupts(irq);
+
+    if (!ok) s_stats.tx_dropped++;
+    return ok;
+}
+
+#if !SLAVE_COMM_SPI
+static void slave_comm_tx_init(void)
+{
+    if (s_tx_dma < 0) {
+        s_tx_dma = dma_claim_unused_channel(true);
+    }
+
+    dma_channel_config c = dma_channel_get_default_config((uint)s_tx_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);              // siempre el registro DR
+    channel_config_set_dreq(&c, uart_get_dreq(SLAVE_UART_ID, true));
+
+    dma_channel_configure((uint)s_tx_dma, &c,
+                          &uart_get_hw(SLAVE_UART_ID)->dr,
+                          s_tx_buf[0], 0, false);
+
+    s_tx_len[0] = 0;
+    s_tx_len[1] = 0;
+    s_tx_fill   = 0;
+    s_tx_busy   = false;
+
+    dma_channel_set_irq0_enabled((uint)s_tx_dma, true);
+    irq_set_exclusive_handler(DMA_IRQ_0, slave_comm_tx_dma_irq);
+    irq_set_enabled(DMA_IRQ_0, true);
+}
+#endif
+
+// ----------------------------
+// Funciones internas: entradas y envío
+// ----------------------------
+
+static void slave_comm_read_inputs(ctrl_payload_t *pl)
+{
+    pl->arcade_mask = button_driver_get_arcade_mask();  // bits 0..3
+    pl->normal_mask = button_driver_get_normal_mask();  // bits 0..3
 
     for (int i = 0; i < CTRL_FRAME_NUM_POTS; i++) {
-        pl.pot[i] = pot_driver_get_12bit(i); // 0..4095
+        pl->pot[i] = pot_driver_get_12bit(i); // 0..4095
     }
+}
+
+// Frame v1: [H1][H2][payload fijo][cs]
+static void slave_comm_send_frame_v1(const ctrl_payload_t *pl)
+{
+    uint8_t frame[CTRL_FRAME_SIZE];
 
-    // 2) Construir payload en bytes
+    // 1) Construir payload en bytes
     uint8_t payload[CTRL_FRAME_PAYLOAD_SIZE];
     int idx = 0;
 
-    payload[idx++] = pl.arcade_mask;
-    payload[idx++] = pl.normal_mask;
+    payload[idx++] = pl->arcade_mask;
+    payload[idx++] = pl->normal_mask;
 
     for (int i = 0; i < CTRL_FRAME_NUM_POTS; i++) {
-        uint16_t v = pl.pot[i];
+        uint16_t v = pl->pot[i];
         payload[idx++] = (uint8_t)(v >> 8);      // MSB
         payload[idx++] = (uint8_t)(v & 0xFF);    // LSB
     }
 
-    // 3) Checksum
+    // 2) Checksum
     uint8_t cs = ctrl_protocol_calc_checksum(payload, CTRL_FRAME_PAYLOAD_SIZE);
 
-    // 4) Frame final: [H1][H2][payload...][cs]
+    // 3) Frame final: [H1][H2][payload...][cs]
     int f = 0;
     frame[f++] = CTRL_FRAME_HEADER_1;
     frame[f++] = CTRL_FRAME_HEADER_2;
@@ -63,28 +318,632 @@ static void slave_comm_send_frame(void)
     }
     frame[f++] = cs;
 
-    // 5) Enviar por UART (no bloquea demasiado; son pocos bytes)
-    uart_write_blocking(SLAVE_UART_ID, frame, CTRL_FRAME_SIZE);
+    // 4) A la cola del DMA (si no cabe, el del siguiente periodo lo sustituye)
+    slave_comm_tx_enqueue(frame, CTRL_FRAME_SIZE);
+}
+
+// Arma y encola un frame v2; false si no cabía (no se consume seq)
+static bool slave_comm_send_v2(uint8_t type, const uint8_t *payload, uint8_t len)
+{
+    uint32_t t0 = time_us_32();
+
+    uint8_t frame[CTRL_V2_MAX_FRAME];
+    uint8_t n = ctrl_v2_build_frame(CTRL_V2_MAKE_TYPE(SLAVE_COMM_BUS_ADDR, type), s_seq,
+                                    payload, len, frame);
+    if (n == 0) return false;
+    if (!slave_comm_tx_enqueue(frame, n)) return false;
+
+    uint32_t dt = time_us_32() - t0;
+    if (dt > s_stats.build_us_max) s_stats.build_us_max = dt;
+
+    s_seq++;
+    s_last_frame_us = time_us_64();
+    s_stats.bytes += n;
+
+    switch (type) {
+    case CTRL_V2_T_EDGE:  s_stats.frames_edge++;  break;
+    case CTRL_V2_T_DELTA: s_stats.frames_delta++; break;
+    case CTRL_V2_T_FULL:  s_stats.frames_full++;  break;
+    default: break;
+    }
+    return true;
+}
+
+// Manda los campos de pl marcados en flags y los da por sabidos en el master.
+// Si no cupo, no se da nada por sabido y la siguiente vuelta lo reintenta.
+static bool slave_comm_send_state(uint8_t type, const ctrl_payload_t *pl, uint8_t flags)
+{
+    uint8_t payload[CTRL_V2_STATE_MAX];
+    uint8_t len = ctrl_v2_encode_state(pl, flags, payload);
+
+    if (!slave_comm_send_v2(type, payload, len)) return false;
+
+    if (flags & CTRL_V2_F_BUTTONS) {
+        s_sent.arcade_mask = pl->arcade_mask;
+        s_sent.normal_mask = pl->normal_mask;
+    }
+    for (int i = 0; i < CTRL_FRAME_NUM_POTS; i++) {
+        if (flags & CTRL_V2_F_POT(i)) s_sent.pot[i] = pl->pot[i];
+    }
+    return true;
+}
+
+// Pots que se movieron lo suficiente respecto a lo último enviado
+static uint8_t slave_comm_pot_flags(const ctrl_payload_t *pl)
+{
+    uint8_t flags = 0;
+
+    for (int i = 0; i < CTRL_FRAME_NUM_POTS; i++) {
+        uint16_t a = pl->pot[i];
+        uint16_t b = s_sent.pot[i];
+        uint16_t diff = (a > b) ? (a - b) : (b - a);
+        if (diff >= s_pot_delta_min) flags |= CTRL_V2_F_POT(i);
+    }
+    return flags;
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+// Pasa flancos de la cola del driver a s_edge_pend (lo que cabe en un EDGE).
+// Con discard se tiran: en v1 y en modo bajo demanda nadie los manda.
+static void slave_comm_collect_edges(bool discard)
+{
+    button_edge_t e;
+
+    if (discard) {
+        s_edge_count = 0;
+        while (button_driver_take_edge(&e)) { }
+        return;
+    }
+    while (s_edge_count < CTRL_V2_EDGE_MAX && button_driver_take_edge(&e)) {
+        s_edge_pend[s_edge_count++] = e;
+    }
+}
+
+// EDGE con los flancos pendientes y la máscara actual. La máscara va siempre:
+// si la cola del driver se desbordó, el master se corrige con ella.
+static bool slave_comm_send_edges(const ctrl_payload_t *pl)
+{
+    uint8_t payload[CTRL_V2_MAX_PAYLOAD];
+    uint8_t len = CTRL_V2_EDGE_HDR_LEN;
+
+    payload[0] = (uint8_t)((pl->arcade_mask & 0x0F) | (pl->normal_mask << 4));
+    for (uint8_t i = 0; i < s_edge_count; i++) {
+        payload[len] = (uint8_t)(s_edge_pend[i].id |
+                                 (s_edge_pend[i].pressed ? CTRL_V2_EDGE_PRESSED : 0));
+        put_u32(&payload[len + 1], (uint32_t)s_edge_pend[i].t_us);
+        len += CTRL_V2_EDGE_ENTRY_LEN;
+    }
+    // Lo último, para que la antigüedad de cada flanco sea lo más exacta posible
+    put_u32(&payload[1], time_us_32());
+
+    if (!slave_comm_send_v2(CTRL_V2_T_EDGE, payload, len)) return false;
+
+    s_sent.arcade_mask = pl->arcade_mask;
+    s_sent.normal_mask = pl->normal_mask;
+    s_edge_count = 0;
+    return true;
 }
 
 // ----------------------------
-// API pública
+// Funciones internas: velocidad del enlace
 // ----------------------------
+//
+// El master lleva la negociación (ctrl_protocol.h); aquí sólo se obedece.
+// Mientras se cambia de velocidad no salen frames de estado: al terminar
+// (confirmado o no) se manda un FULL.
 
-void slave_comm_init(void)
+typedef enum {
+    BAUD_IDLE = 0,
+    BAUD_SWITCH,     // BAUD_OK encolado: cambiar en cuanto se vacíe TX
+    BAUD_TESTING,    // ya en la nueva: mandar patrones y esperar CONFIRM
+    BAUD_REVERT      // volver a s_baud_next en cuanto se vacíe TX
+} slave_baud_state_t;
+
+static slave_baud_state_t s_baud_state = BAUD_IDLE;
+static uint8_t  s_baud_idx        = 0;   // escalón actual (0 = 115200)
+static uint8_t  s_baud_prev       = 0;   // al que volver si no hay CONFIRM
+static uint8_t  s_baud_next       = 0;
+static uint8_t  s_baud_tests_sent = 0;
+static uint64_t s_baud_t0_us      = 0;   // momento del último cambio
+static uint64_t s_last_master_us  = 0;   // último frame válido del master
+
+// Nada pendiente en los buffers, ni en el FIFO, ni saliendo por el pin
+static bool slave_comm_tx_idle(void)
 {
-    // Inicializa UART
-    uart_init(SLAVE_UART_ID, SLAVE_UART_BAUDRATE);
-    gpio_set_function(SLAVE_UART_TX_PIN, GPIO_FUNC_UART);
-    gpio_set_function(SLAVE_UART_RX_PIN, GPIO_FUNC_UART);
+#if SLAVE_COMM_SPI
+    return !s_tx_busy && s_tx_len[s_tx_fill] == 0;
+#else
+    return !s_tx_busy && s_tx_len[s_tx_fill] == 0 &&
+           !(uart_get_hw(SLAVE_UART_ID)->fr & UART_UARTFR_BUSY_BITS);
+#endif
+}
 
-    uart_set_format(SLAVE_UART_ID, 8, 1, UART_PARITY_NONE);
-    uart_set_fifo_enabled(SLAVE_UART_ID, true);
+static void slave_comm_set_baud(uint8_t idx)
+{
+    uint32_t rate = ctrl_protocol_baud_rate(idx);
+    if (rate == 0) return;
 
-    s_last_send_time = get_absolute_time();
+    uart_set_baudrate(SLAVE_UART_ID, rate);
+    s_baud_idx   = idx;
+    s_byte_ns    = 10000000000ull / rate;
+    s_stats.baud = rate;
 }
 
-void slave_comm_task(void)
+// Devuelve true mientras hay un cambio en curso (no mandar estado)
+static bool slave_comm_baud_task(uint64_t now_us)
+{
+    switch (s_baud_state) {
+    case BAUD_SWITCH:
+        if (!slave_comm_tx_idle()) return true;
+        s_baud_prev       = s_baud_idx;
+        slave_comm_set_baud(s_baud_next);
+        s_baud_tests_sent = 0;
+        s_baud_t0_us      = now_us;
+        s_baud_state      = BAUD_TESTING;
+        return true;
+
+    case BAUD_TESTING:
+        if (now_us - s_baud_t0_us >= CTRL_BAUD_CONFIRM_US) {
+            // El master no confirmó: volver a la anterior
+            s_baud_next  = s_baud_prev;
+            s_baud_state = BAUD_REVERT;
+            s_stats.baud_fallbacks++;
+            return true;
+        }
+        if (now_us - s_baud_t0_us < CTRL_BAUD_SETTLE_US) return true;
+
+        // Los patrones van saliendo a medida que hay sitio en los buffers
+        while (s_baud_tests_sent < CTRL_BAUD_TEST_FRAMES) {
+            uint8_t pat[CTRL_BAUD_TEST_LEN];
+            ctrl_protocol_baud_pattern(s_baud_idx, s_baud_tests_sent, pat);
+            if (!slave_comm_send_v2(CTRL_V2_T_BAUD_TEST, pat, sizeof(pat))) break;
+            s_baud_tests_sent++;
+        }
+        return true;
+
+    case BAUD_REVERT:
+        if (!slave_comm_tx_idle()) return true;
+        slave_comm_set_baud(s_baud_next);
+        s_baud_state     = BAUD_IDLE;
+        s_need_full      = true;
+        s_last_master_us = now_us;
+        return false;
+
+    case BAUD_IDLE:
+    default:
+        // Watchdog: a velocidad alta y sin oír al master, volver a 115200
+        if (s_baud_idx > 0 && now_us - s_last_master_us >= CTRL_BAUD_WATCHDOG_US) {
+            s_baud_next  = 0;
+            s_baud_state = BAUD_REVERT;
+            s_stats.baud_fallbacks++;
+            return true;
+        }
+        return false;
+    }
+}
+
+// ----------------------------
+// Función interna: parámetros en caliente
+// ----------------------------
+
+static uint32_t slave_comm_clamp(uint32_t v, uint32_t lo, uint32_t hi)
+{
+    return (v < lo) ? lo : (v > hi) ? hi : v;
+}
+
+// Aplica un parámetro y devuelve el valor que quedó (0xFFFF si id no existe)
+static uint16_t slave_comm_apply_param(uint8_t id, uint16_t value)
+{
+    switch (id) {
+    case CTRL_PARAM_BTN_DEBOUNCE_US: return (uint16_t)button_driver_set_debounce_us(value);
+    case CTRL_PARAM_BTN_SCAN_US:     return (uint16_t)button_driver_set_scan_us(value);
+    case CTRL_PARAM_POT_DR:          return pot_driver_set_data_rate((uint8_t)slave_comm_clamp(value, 0, 7));
+    case CTRL_PARAM_POT_PGA:         return pot_driver_set_pga((uint8_t)slave_comm_clamp(value, 0, 5));
+    case CTRL_PARAM_POT_SCAN_US:     return (uint16_t)pot_driver_set_scan_us(value);
+
+    case CTRL_PARAM_POT_THRESHOLD:
+        s_pot_delta_min = (uint16_t)slave_comm_clamp(value, 1, SLAVE_COMM_POT_DELTA_MAX);
+        return s_pot_delta_min;
+
+    case CTRL_PARAM_POT_GAP_US:
+        s_pot_gap_us = slave_comm_clamp(value, 0, SLAVE_COMM_POT_GAP_MAX_US);
+        return (uint16_t)s_pot_gap_us;
+
+    case CTRL_PARAM_KEEPALIVE_MS:
+    {
+        uint32_t ms = slave_comm_clamp(value, SLAVE_COMM_KEEPALIVE_MIN_MS,
+                                       SLAVE_COMM_KEEPALIVE_MAX_MS);
+        s_keepalive_us = ms * 1000u;
+        return (uint16_t)ms;
+    }
+
+    case CTRL_PARAM_REPORT_MODE:
+        s_report_mode = (value == CTRL_REPORT_ON_DEMAND) ? CTRL_REPORT_ON_DEMAND
+                                                         : CTRL_REPORT_EVENTS;
+        return s_report_mode;
+
+    default:
+        return 0xFFFF;
+    }
+}
+
+// CONFIG: n x [id][valor MSB][valor LSB] → CONFIG_ACK con lo aplicado
+static void slave_comm_on_config(const uint8_t *payload, uint8_t len)
+{
+    uint8_t ack[CTRL_V2_MAX_PAYLOAD];
+    uint8_t n = 0;
+
+    for (uint8_t i = 0; i + CTRL_PARAM_ENTRY_LEN <= len; i += CTRL_PARAM_ENTRY_LEN) {
+        uint8_t  id  = payload[i];
+        uint16_t v   = (uint16_t)((payload[i + 1] << 8) | payload[i + 2]);
+        uint16_t got = slave_comm_apply_param(id, v);
+
+        ack[n++] = id;
+        ack[n++] = (uint8_t)(got >> 8);
+        ack[n++] = (uint8_t)(got & 0xFF);
+    }
+    s_stats.configs++;
+
+    // Si no cabe, el master no ve el ACK y lo vuelve a mandar
+    slave_comm_send_v2(CTRL_V2_T_CONFIG_ACK, ack, n);
+}
+
+// ----------------------------
+// Función interna: comandos del master
+// ----------------------------
+
+static void slave_comm_on_master_frame(const uint8_t *frame)
+{
+    uint8_t        type    = CTRL_V2_TYPE(frame[2]);
+    uint8_t        addr    = CTRL_V2_ADDR(frame[2]);
+    uint8_t        len     = frame[4];
+    const uint8_t *payload = &frame[CTRL_V2_HDR_SIZE];
+
+    // En el bus: lo nuestro y la difusión (dirección 0)
+    if (addr != 0 && addr != SLAVE_COMM_BUS_ADDR) return;
+
+    s_last_master_us = time_us_64();
+
+    switch (type) {
+    case CTRL_V2_T_ACK:
+        if (len >= 1) {
+            uint8_t v = payload[0];
+            if (v > CTRL_PROTOCOL_VERSION) v = CTRL_PROTOCOL_VERSION;
+            if (v >= 2 && s_version < 2) {
+                s_need_full    = true;   // el primer frame v2 siempre es completo
+                s_desc_pending = true;
+            }
+            s_version = (v >= 2) ? 2 : 1;
+        }
+        break;
+
+    case CTRL_V2_T_RESYNC:
+        s_need_full = true;
+        break;
+
+    case CTRL_V2_T_BAUD_TRY:
+        // Contestar a la velocidad actual y cambiar cuando haya salido
+        if (len >= 1 && s_version >= 2 && s_baud_state == BAUD_IDLE &&
+            ctrl_protocol_baud_rate(payload[0]) != 0) {
+            if (slave_comm_send_v2(CTRL_V2_T_BAUD_OK, payload, 1)) {
+                s_baud_next  = payload[0];
+                s_baud_state = BAUD_SWITCH;
+            }
+        }
+        break;
+
+    case CTRL_V2_T_BAUD_CONFIRM:
+        if (len >= 1 && s_baud_state == BAUD_TESTING && payload[0] == s_baud_idx) {
+            s_baud_state = BAUD_IDLE;
+            s_need_full  = true;
+        }
+        break;
+
+    case CTRL_V2_T_PING:
+        break;
+
+    case CTRL_V2_T_CONFIG:
+        if (s_version >= 2) slave_comm_on_config(payload, len);
+        break;
+
+    case CTRL_V2_T_SNAPSHOT:
+        s_need_full = true;
+        break;
+
+    case CTRL_V2_T_POLL:
+        // Nuestro turno: lo pendiente + END al final de esta vuelta
+        if (SLAVE_COMM_BUS && addr == SLAVE_COMM_BUS_ADDR) {
+            uint8_t flags = (len >= 1) ? payload[0] : 0;
+            if (flags & CTRL_POLL_F_DESC) s_desc_pending = true;
+            if (flags & CTRL_POLL_F_FULL) s_need_full    = true;
+            s_bus_turn = true;
+        }
+        break;
+
+    case CTRL_V2_T_SYNC_REQ:
+        // Hora de llegada cuanto antes: el frame acaba de completarse
+        if (len == CTRL_SYNC_REQ_LEN && s_version >= 2) {
+            s_sync_t2      = time_us_32();
+            s_sync_t1      = ((uint32_t)payload[0] << 24) | ((uint32_t)payload[1] << 16) |
+                             ((uint32_t)payload[2] << 8)  |  (uint32_t)payload[3];
+            s_sync_pending = true;
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void slave_comm_rx_byte(uint8_t b)
+{
+    if (s_rx_pos == 0 && b != CTRL_FRAME_HEADER_1) return;
+    if (s_rx_pos == 1 && b != CTRL_V2_HEADER_2) {
+        s_rx_pos = (b == CTRL_FRAME_HEADER_1) ? 1 : 0;
+        return;
+    }
+
+    s_rx_buf[s_rx_pos++] = b;
+
+    if (s_rx_pos == CTRL_V2_HDR_SIZE && s_rx_buf[4] > CTRL_V2_MAX_PAYLOAD) {
+        s_rx_pos = 0;     // longitud imposible: buscar la siguiente cabecera
+        return;
+    }
+    if (s_rx_pos > CTRL_V2_HDR_SIZE &&
+        s_rx_pos == CTRL_V2_HDR_SIZE + s_rx_buf[4] + CTRL_V2_CRC_SIZE) {
+        if (ctrl_v2_check_frame(s_rx_buf, s_rx_pos)) {
+            slave_comm_on_master_frame(s_rx_buf);
+        }
+        s_rx_pos = 0;
+    }
+}
+
+static void slave_comm_poll_rx(void)
+{
+#if SLAVE_COMM_SPI
+    // Una transacción entera del master: frames v2 y relleno a 0
+    if (!s_spi_rx_ready) return;
+
+    const uint8_t *p = s_spi_rx[s_spi_rx_w ^ 1u];
+    for (uint32_t i = 0; i < CTRL_SPI_XFER_LEN; i++) {
+        slave_comm_rx_byte(p[i]);
+    }
+    s_rx_pos       = 0;      // un frame nunca queda partido entre transacciones
+    s_spi_rx_ready = false;
+#else
+    while (uart_is_readable(SLAVE_UART_ID)) {
+        slave_comm_rx_byte((uint8_t)uart_getc(SLAVE_UART_ID));
+    }
+#endif
+}
+
+// SYNC_RESP en cuanto el TX esté vacío: t3 tiene que ser la salida del primer
+// byte, no la de un frame que espera detrás de otros. Armar el frame después
+// de tomar t3 cuesta unos pocos us, lo mismo en cada intercambio.
+static void slave_comm_sync_reply(void)
+{
+    if (!s_sync_pending || !slave_comm_tx_idle()) return;
+
+    uint8_t payload[CTRL_SYNC_RESP_LEN];
+    put_u32(&payload[0], s_sync_t1);
+    put_u32(&payload[4], s_sync_t2);
+    put_u32(&payload[8], time_us_32());
+
+    if (slave_comm_send_v2(CTRL_V2_T_SYNC_RESP, payload, sizeof(payload))) {
+        s_sync_pending = false;
+        s_stats.syncs++;
+    }
+}
+
+// Descriptor de capacidades (ctrl_desc_t)
+static void slave_comm_send_desc(void)
+{
+    uint8_t d[CTRL_DESC_LEN] = {
+        BUTTON_DRIVER_NUM_ARCADE,
+        BUTTON_DRIVER_NUM_NORMAL,
+        POT_DRIVER_NUM_CHANNELS,
+        0,                          // encoders
+        12                          // pots de 12 bits
+    };
+
+    if (slave_comm_send_v2(CTRL_V2_T_DESC, d, sizeof(d))) {
+        s_desc_pending = false;
+    }
+}
+
+#if SLAVE_COMM_BUS
+// Cierra el turno: END detrás de lo acumulado y todo al bus de una vez
+static void slave_comm_bus_turn(void)
+{
+    if (!s_bus_turn || s_tx_busy) return;
+
+    uint8_t  frame[SLAVE_BUS_END_SIZE];
+    uint8_t  n   = ctrl_v2_build_frame(CTRL_V2_MAKE_TYPE(SLAVE_COMM_BUS_ADDR, CTRL_V2_T_END),
+                                       s_seq++, NULL, 0, frame);
+    uint32_t irq = save_and_disable_interrupts();
+    uint8_t  b   = s_tx_fill;
+
+    // SLAVE_TX_LIMIT deja siempre sitio para el END
+    memcpy(&s_tx_buf[b][s_tx_len[b]], frame, n);
+    s_tx_len[b] = (uint8_t)(s_tx_len[b] + n);
+    slave_comm_tx_kick();
+
+    restore_interrupts(irq);
+
+    s_bus_turn = false;
+    s_stats.bytes += n;
+}
+#endif
+
+#if SLAVE_COMM_SPI
+// ----------------------------
+// Funciones internas: transporte SPI
+// ----------------------------
+//
+// Todo corre en la IRQ de CS. El flujo sale de los mismos dos buffers que el
+// UART: el que se llenaba pasa a "en envío" y se entrega a frames enteros
+// (CTRL_SPI_STREAM_MAX deja pasar siempre al menos uno) hasta vaciarse.
+
+static uint8_t slave_comm_spi_take(uint8_t *dst, uint8_t max)
+{
+    if (!s_tx_busy) {
+        if (s_tx_len[s_tx_fill] == 0) return 0;
+
+        uint8_t b = s_tx_fill;
+        s_tx_busy = true;
+        s_tx_fill = (uint8_t)(b ^ 1u);
+        s_tx_len[s_tx_fill] = 0;
+        s_tx_sent = s_tx_len[b];
+        s_tx_off  = 0;
+    }
+
+    const uint8_t *src = s_tx_buf[s_tx_fill ^ 1u];
+    uint8_t        n   = 0;
+
+    while (s_tx_off < s_tx_sent) {
+        const uint8_t *f  = &src[s_tx_off];
+        uint8_t        fl = (uint8_t)CTRL_V2_FRAME_LEN(f);
+
+        if ((uint32_t)n + fl > max) break;
+        if (CTRL_V2_TYPE(f[2]) == CTRL_V2_T_EDGE) {
+            s_spi_mask = f[CTRL_V2_HDR_SIZE];   // la máscara va con sus flancos
+        }
+        memcpy(&dst[n], f, fl);
+        n          = (uint8_t)(n + fl);
+        s_tx_off   = (uint8_t)(s_tx_off + fl);
+    }
+
+    if (s_tx_off >= s_tx_sent) s_tx_busy = false;
+    return n;
+}
+
+// Bloque para la próxima transacción (ctrl_protocol.h, "Transporte SPI").
+// Los botones son los del último EDGE entregado, no los vivos: si no, el
+// estado podría adelantarse a los flancos con marca que aún esperan turno.
+static void slave_comm_spi_arm(void)
+{
+    uint8_t       *p = s_spi_tx;
+    ctrl_payload_t pl;
+
+    slave_comm_read_inputs(&pl);
+    uint8_t n = slave_comm_spi_take(&p[CTRL_SPI_BLOCK_LEN], CTRL_SPI_STREAM_MAX);
+    pl.arcade_mask = s_spi_mask & 0x0F;
+    pl.normal_mask = s_spi_mask >> 4;
+
+    p[0] = CTRL_SPI_MAGIC;
+    p[1] = ++s_spi_seq;
+    p[2] = n;
+    put_u32(&p[3], s_spi_cs_us);
+    ctrl_v2_encode_state(&pl, CTRL_V2_F_ALL, &p[7]);
+
+    uint16_t crc = ctrl_protocol_crc16(CTRL_CRC16_INIT, p, CTRL_SPI_HDR_LEN);
+    p[CTRL_SPI_HDR_LEN]     = (uint8_t)(crc >> 8);
+    p[CTRL_SPI_HDR_LEN + 1] = (uint8_t)(crc & 0xFF);
+
+    memset(&p[CTRL_SPI_BLOCK_LEN + n], 0, CTRL_SPI_STREAM_MAX - n);
+
+    dma_channel_transfer_to_buffer_now((uint)s_spi_rx_dma, s_spi_rx[s_spi_rx_w],
+                                       CTRL_SPI_XFER_LEN);
+    dma_channel_transfer_from_buffer_now((uint)s_spi_tx_dma, s_spi_tx, CTRL_SPI_XFER_LEN);
+}
+
+static void slave_comm_spi_hw_init(void)
+{
+    spi_init(SLAVE_SPI_ID, CTRL_SPI_HZ);
+    spi_set_slave(SLAVE_SPI_ID, true);
+    spi_set_format(SLAVE_SPI_ID, 8, SPI_CPOL_1, SPI_CPHA_1, SPI_MSB_FIRST);
+}
+
+static void slave_comm_spi_cs_irq(void)
+{
+    uint32_t ev = gpio_get_irq_event_mask(SLAVE_SPI_CS_PIN);
+    gpio_acknowledge_irq(SLAVE_SPI_CS_PIN, ev);
+
+    // Bajada: la marca de tiempo va en el bloque siguiente (reloj del master)
+    if (ev & GPIO_IRQ_EDGE_FALL) {
+        s_spi_cs_us = time_us_32();
+    }
+    if (!(ev & GPIO_IRQ_EDGE_RISE)) return;
+
+    // Transacción cortada (el master se reinició a medias, ruido en SCK): el
+    // FIFO quedó desalineado, empezar de cero. Lo recibido no vale.
+    if (dma_hw->ch[s_spi_tx_dma].transfer_count != 0 ||
+        dma_hw->ch[s_spi_rx_dma].transfer_count != 0 ||
+        !(spi_get_hw(SLAVE_SPI_ID)->sr & SPI_SSPSR_TFE_BITS)) {
+        dma_channel_abort((uint)s_spi_tx_dma);
+        dma_channel_abort((uint)s_spi_rx_dma);
+        slave_comm_spi_hw_init();
+        s_stats.spi_resets++;
+    } else {
+        s_spi_rx_w     = (uint8_t)(s_spi_rx_w ^ 1u);
+        s_spi_rx_ready = true;
+    }
+
+    s_stats.spi_xfers++;
+    slave_comm_spi_arm();
+}
+
+static void slave_comm_spi_init(void)
+{
+    slave_comm_spi_hw_init();
+    gpio_set_function(SLAVE_SPI_RX_PIN,  GPIO_FUNC_SPI);
+    gpio_set_function(SLAVE_SPI_CS_PIN,  GPIO_FUNC_SPI);
+    gpio_set_function(SLAVE_SPI_SCK_PIN, GPIO_FUNC_SPI);
+    gpio_set_function(SLAVE_SPI_TX_PIN,  GPIO_FUNC_SPI);
+
+    if (s_spi_tx_dma < 0) s_spi_tx_dma = dma_claim_unused_channel(true);
+    if (s_spi_rx_dma < 0) s_spi_rx_dma = dma_claim_unused_channel(true);
+
+    dma_channel_config c = dma_channel_get_default_config((uint)s_spi_tx_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);              // siempre el registro DR
+    channel_config_set_dreq(&c, spi_get_dreq(SLAVE_SPI_ID, true));
+    dma_channel_configure((uint)s_spi_tx_dma, &c, &spi_get_hw(SLAVE_SPI_ID)->dr,
+                          s_spi_tx, 0, false);
+
+    c = dma_channel_get_default_config((uint)s_spi_rx_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, spi_get_dreq(SLAVE_SPI_ID, false));
+    dma_channel_configure((uint)s_spi_rx_dma, &c, s_spi_rx[0],
+                          &spi_get_hw(SLAVE_SPI_ID)->dr, 0, false);
+
+    s_tx_len[0]    = 0;
+    s_tx_len[1]    = 0;
+    s_tx_fill      = 0;
+    s_tx_busy      = false;
+    s_spi_rx_w     = 0;
+    s_spi_rx_ready = false;
+    s_spi_mask     = 0;
+    s_spi_cs_us    = time_us_32();
+
+    // Primer bloque listo antes de que el master pueda bajar CS
+    slave_comm_spi_arm();
+
+    // Handler propio sólo para CS: no pisa el callback global de GPIO. La
+    // función SPI del pin no impide ver sus flancos.
+    gpio_add_raw_irq_handler(SLAVE_SPI_CS_PIN, slave_comm_spi_cs_irq);
+    gpio_set_irq_enabled(SLAVE_SPI_CS_PIN, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+}
+#endif
+
+// ----------------------------
+// Función interna: modo v1 (master sin v2)
+// ----------------------------
+
+// Frame completo cada SLAVE_COMM_PERIOD_US, más un HELLO de vez en cuando por
+// si el master entiende v2
+static void slave_comm_task_v1(const ctrl_payload_t *pl)
 {
     absolute_time_t now = get_absolute_time();
     int64_t dt_us = absolute_time_diff_us(s_last_send_time, now);
@@ -95,9 +954,200 @@ void slave_comm_task(void)
     }
 
     s_last_send_time = now;
+    slave_comm_send_frame_v1(pl);
+
+    uint64_t now_us = time_us_64();
+    if (now_us - s_last_hello_us >= SLAVE_COMM_HELLO_US) {
+        uint8_t hello[2] = { CTRL_PROTOCOL_VERSION, 0 };
+        s_last_hello_us = now_us;
+        slave_comm_send_v2(CTRL_V2_T_HELLO, hello, sizeof(hello));
+    }
+}
 
+// ----------------------------
+// API pública
+// ----------------------------
+
+void slave_comm_init(void)
+{
+#if SLAVE_COMM_SPI
+    uint32_t baud = CTRL_SPI_HZ;
+#else
+    // Inicializa UART (en el bus, a la velocidad fija del bus)
+    uint32_t baud = SLAVE_COMM_BUS ? CTRL_BUS_BAUD : SLAVE_UART_BAUDRATE;
+    uart_init(SLAVE_UART_ID, baud);
+    s_byte_ns = 10000000000ull / baud;
+    gpio_set_function(SLAVE_UART_TX_PIN, GPIO_FUNC_UART);
+    gpio_set_function(SLAVE_UART_RX_PIN, GPIO_FUNC_UART);
+
+    uart_set_format(SLAVE_UART_ID, 8, 1, UART_PARITY_NONE);
+    uart_set_fifo_enabled(SLAVE_UART_ID, true);
+
+    // TX por DMA (el RX de comandos del master sigue por polling: son pocos bytes)
+    slave_comm_tx_init();
+#endif
+
+    s_last_send_time = get_absolute_time();
+
+    s_version       = 1;
+    s_seq           = 0;
+    s_need_full     = false;
+    s_rx_pos        = 0;
+    s_last_frame_us = 0;
+    s_last_hello_us = 0;
+    s_last_poll_us  = time_us_64();
+    s_pot_credit_us = SLAVE_COMM_POT_BURST * SLAVE_COMM_POT_GAP_US;
+    s_pot_held      = false;
+    s_edge_count    = 0;
+    s_sync_pending  = false;
+    memset(&s_sent, 0, sizeof(s_sent));
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    s_pot_delta_min = SLAVE_COMM_POT_DELTA_MIN;
+    s_pot_gap_us    = SLAVE_COMM_POT_GAP_US;
+    s_keepalive_us  = SLAVE_COMM_KEEPALIVE_US;
+    s_report_mode   = CTRL_REPORT_EVENTS;
+
+    s_baud_state     = BAUD_IDLE;
+    s_baud_idx       = 0;
+    s_last_master_us = 0;
+    s_stats.baud     = baud;
+
+    s_desc_pending   = false;
+    s_bus_turn       = false;
+
+#if SLAVE_COMM_BUS
+    // Transceptor en recepción hasta el primer turno
+    gpio_init(SLAVE_COMM_BUS_DE_PIN);
+    gpio_set_dir(SLAVE_COMM_BUS_DE_PIN, GPIO_OUT);
+    gpio_put(SLAVE_COMM_BUS_DE_PIN, 0);
+
+    // En el bus no hay negociación: v2 desde el arranque, empezando por un
+    // FULL (el descriptor lo pide el master en el POLL)
+    s_version      = 2;
+    s_need_full    = true;
+#endif
+
+#if SLAVE_COMM_SPI
+    // Tampoco hay negociación por SPI: el estado va entero en cada
+    // transacción, así que basta con el descriptor
+    s_version      = 2;
+    s_desc_pending = true;
+    slave_comm_spi_init();
+#endif
+}
+
+// Una vuelta: comandos del master y lo que toque mandar (v1 o v2)
+static void slave_comm_run(void)
+{
     // Importante: asumimos que en el main ya se llamaron:
     // button_driver_update();
     // pot_driver_update();
-    slave_comm_send_frame();
+    slave_comm_poll_rx();
+
+    ctrl_payload_t pl;
+    slave_comm_read_inputs(&pl);
+
+    if (s_version < 2) {
+        slave_comm_collect_edges(true);
+        slave_comm_task_v1(&pl);
+        return;
+    }
+
+    slave_comm_collect_edges(!SLAVE_COMM_SPI && s_report_mode == CTRL_REPORT_ON_DEMAND);
+
+    uint64_t now_us = time_us_64();
+
+    // Cambio de velocidad en curso: no mandar estado hasta terminar
+    if (slave_comm_baud_task(now_us)) {
+        s_sync_pending = false;
+        return;
+    }
+
+    // Respuesta de reloj antes que nada: cuanto menos espere, menos RTT
+    slave_comm_sync_reply();
+
+    if (s_desc_pending) {
+        slave_comm_send_desc();
+    }
+
+#if SLAVE_COMM_SPI
+    // El estado entero va en cada transacción: por el flujo sólo los flancos
+    // con su marca (sin limitador ni latido; el modo de envío no aplica)
+    s_need_full = false;
+    if (s_edge_count ||
+        pl.arcade_mask != s_sent.arcade_mask || pl.normal_mask != s_sent.normal_mask) {
+        slave_comm_send_edges(&pl);
+    }
+    return;
+#endif
+
+    // Recargar el limitador de pots con el tiempo transcurrido
+    uint64_t dt_us  = now_us - s_last_poll_us;
+    uint32_t cap_us = SLAVE_COMM_POT_BURST * s_pot_gap_us;
+    s_last_poll_us  = now_us;
+    if (s_pot_credit_us > cap_us) s_pot_credit_us = cap_us;   // gap recién bajado
+    s_pot_credit_us = (dt_us >= cap_us - s_pot_credit_us) ? cap_us
+                                                          : s_pot_credit_us + (uint32_t)dt_us;
+
+    // Estado completo pendiente (ACK, RESYNC o SNAPSHOT del master)
+    if (s_need_full) {
+        // Los flancos pendientes antes: si no, el FULL los taparía sin marca
+        if (s_edge_count && !slave_comm_send_edges(&pl)) return;
+        if (slave_comm_send_state(CTRL_V2_T_FULL, &pl, CTRL_V2_F_ALL)) {
+            s_need_full = false;
+        }
+        return;
+    }
+
+    // Modo bajo demanda: sólo latido y SNAPSHOT (s_need_full)
+    if (s_report_mode == CTRL_REPORT_ON_DEMAND) {
+        if (now_us - s_last_frame_us >= s_keepalive_us) {
+            slave_comm_send_state(CTRL_V2_T_FULL, &pl, CTRL_V2_F_ALL);
+        }
+        return;
+    }
+
+    // Flancos de botón: salen ya, sin limitador, con su marca de tiempo
+    if (s_edge_count ||
+        pl.arcade_mask != s_sent.arcade_mask || pl.normal_mask != s_sent.normal_mask) {
+        slave_comm_send_edges(&pl);
+    }
+
+    // Pots: en cuanto cambian, si el limitador deja. Si no, el cambio espera
+    // y sale con el valor más reciente cuando haya token.
+    uint8_t flags = slave_comm_pot_flags(&pl);
+    if (flags) {
+        if (s_pot_credit_us >= s_pot_gap_us) {
+            if (slave_comm_send_state(CTRL_V2_T_DELTA, &pl, flags)) {
+                s_pot_credit_us -= s_pot_gap_us;
+                s_pot_held       = false;
+            }
+        } else if (!s_pot_held) {
+            s_pot_held = true;
+            s_stats.pot_deferred++;
+        }
+    }
+
+    // Latido si no se mandó nada en un rato
+    if (now_us - s_last_frame_us >= s_keepalive_us) {
+        slave_comm_send_state(CTRL_V2_T_FULL, &pl, CTRL_V2_F_ALL);
+    }
+}
+
+void slave_comm_task(void)
+{
+    slave_comm_run();
+
+#if SLAVE_COMM_BUS
+    // Si el master nos dio el turno, ahora sale todo lo acumulado
+    slave_comm_bus_turn();
+#endif
+}
+
+void slave_comm_get_stats(slave_comm_stats_t *out)
+{
+    if (!out) return;
+    *out = s_stats;
+    out->version = s_version;
 }
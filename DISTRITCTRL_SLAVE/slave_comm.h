@@ -3,11 +3,36 @@
 
 #include <stdint.h>
 
-// Inicializa UART y estado interno de envío
+// Contadores de envío (sólo frames v2)
+typedef struct {
+    uint32_t frames_edge;    // flancos de botón
+    uint32_t frames_delta;   // deltas de pots
+    uint32_t frames_full;    // estados completos (ACK, RESYNC o latido)
+    uint32_t pot_deferred;   // veces que el limitador retuvo un cambio de pot
+    uint32_t bytes;          // bytes v2 enviados
+    uint32_t tx_dropped;     // frames que no cupieron en el buffer de DMA (se reintentan)
+    uint32_t build_us_max;   // peor armado + encolado de un frame v2
+    uint32_t baud;           // velocidad actual del enlace
+    uint32_t baud_fallbacks; // vueltas atrás (sin CONFIRM o watchdog)
+    uint32_t configs;        // frames CONFIG del master aplicados
+    uint32_t syncs;          // SYNC_RESP enviados (sincronización de reloj)
+    uint32_t spi_xfers;      // transacciones SPI con el master (transporte SPI)
+    uint32_t spi_resets;     // de ellas, cortadas a medias (SPI reiniciado)
+    uint8_t  version;        // protocolo negociado (1 o 2)
+} slave_comm_stats_t;
+
+// Inicializa UART (o SPI) y estado interno de envío
 void slave_comm_init(void);
 
-// Llamar periódicamente en el loop principal
-// Se encarga de, cada cierto tiempo, leer botones + pots y enviar un frame.
+// Llamar en cada vuelta del loop principal (sin esperas)
+// Lee botones + pots y los manda al master. Arranca en protocolo v1 (un frame
+// completo cada 5 ms) y, si el master acepta v2, pasa a mandar por eventos:
+// flancos de botón al momento (con la marca de tiempo del cambio crudo),
+// deltas de pots en cuanto cambian (con limitador de ritmo) y un estado
+// completo de latido cada 100 ms sin tráfico.
 void slave_comm_task(void);
 
+// Copia los contadores de envío
+void slave_comm_get_stats(slave_comm_stats_t *out);
+
 #endif // SLAVE_COMM_H
@@ -0,0 +1,384 @@
+// cc_sched.c - Coalescado "último valor gana" de controles continuos
+//
+// Cada control (canal + CC, parámetro NRPN o pitch bend) tiene un slot con su
+// valor pendiente y el último valor enviado. Los CC y el pitch bend se
+// localizan en O(1) con mapas directos; los NRPN (pocos) con búsqueda lineal.
+// Una máscara de bits marca qué slots esperan salida. Si el bus está
+// congestionado, un fader que se mueve sólo actualiza su slot: nunca se
+// acumulan valores viejos.
+//
+// Alta resolución sin duplicar tráfico:
+//  - CC 14 bits: el MSB (CC n) sólo se manda si cambió; el LSB (CC n+32) siempre.
+//  - NRPN: la selección de parámetro (CC 99/98) sólo si el canal tenía otro
+//    parámetro seleccionado; el MSB de dato (CC 6) sólo si cambió.
+// Si un control sale a medias (FIFO lleno), el slot recuerda lo ya enviado y
+// la siguiente vez completa sólo lo que falta.
+//
+// Latencia: cada slot guarda la marca (latency_hist) del valor más antiguo
+// que sigue esperando, así el histograma refleja cuánto tiempo estuvo el
+// receptor con un valor viejo, no sólo el último movimiento.
+//
+// No es reentrante: usar sólo desde el contexto del main loop.
+
+#include "cc_sched.h"
+#include "latency_hist.h"
+
+#include <string.h>
+
+#define CC_SCHED_NO_SLOT   0xFF
+#define CC_SCHED_NO_VALUE  0xFFFF
+
+typedef struct {
+    uint8_t  kind;       // cc_sched_kind_t
+    uint8_t  channel;
+    uint16_t number;     // CC, parámetro NRPN o 0 (pitch bend)
+    uint16_t pending;    // valor a enviar (7 o 14 bits)
+    uint16_t last_sent;  // último valor que el receptor tiene (CC_SCHED_NO_VALUE = ninguno)
+    lat_tag_t tag;       // marca de latencia del valor pendiente más antiguo
+} cc_slot_t;
+
+static uint8_t   s_slot_of_cc[16 * 128];       // (canal << 7 | cc) -> slot (CC7 y CC14, también su LSB)
+static uint8_t   s_slot_of_pb[16];             // canal -> slot de pitch bend
+static uint16_t  s_nrpn_sel[16];               // parámetro NRPN seleccionado por canal
+static cc_slot_t s_slots[CC_SCHED_MAX_SLOTS];
+static uint8_t   s_num_slots    = 0;
+static uint32_t  s_pending_mask = 0;
+static uint8_t   s_rr_next      = 0;           // próximo slot para round-robin
+static lat_tag_t s_tag          = { .src = LAT_SRC_NONE };   // marca de los próximos valores
+static cc_sched_stats_t s_stats;
+
+// ----------------------------
+// Funciones internas
+// ----------------------------
+
+static uint8_t cc_sched_new_slot(cc_sched_kind_t kind, uint8_t channel, uint16_t number)
+{
+    if (s_num_slots >= CC_SCHED_MAX_SLOTS) {
+        s_stats.no_slot++;
+        return CC_SCHED_NO_SLOT;
+    }
+
+    uint8_t slot = s_num_slots++;
+    s_slots[slot].kind      = (uint8_t)kind;
+    s_slots[slot].channel   = channel;
+    s_slots[slot].number    = number;
+    s_slots[slot].last_sent = CC_SCHED_NO_VALUE;
+    s_slots[slot].tag.src   = LAT_SRC_NONE;
+    return slot;
+}
+
+// CC7 y CC14 comparten el mapa por canal y número: un CC14 n ocupa también
+// n+32 (su LSB). Un número ya ocupado por el otro tipo se rechaza; si no, un
+// CC7 en n+32 o en n se mezclaría con el par de 14 bits en el receptor.
+static uint8_t cc_sched_find_cc_slot(cc_sched_kind_t kind, uint8_t channel, uint8_t cc)
+{
+    uint8_t *map = &s_slot_of_cc[(channel << 7) | (cc & 0x7F)];
+
+    if (*map != CC_SCHED_NO_SLOT) {
+        const cc_slot_t *s = &s_slots[*map];
+        if (s->kind != kind || s->number != cc) {
+            s_stats.kind_conflict++;
+            return CC_SCHED_NO_SLOT;
+        }
+        return *map;
+    }
+
+    if (kind == CC_KIND_CC14) {
+        uint8_t *lsb = &s_slot_of_cc[(channel << 7) | (cc + 32u)];
+        if (*lsb != CC_SCHED_NO_SLOT) {
+            s_stats.kind_conflict++;
+            return CC_SCHED_NO_SLOT;
+        }
+        *map = cc_sched_new_slot(kind, channel, cc);
+        *lsb = *map;
+        return *map;
+    }
+
+    *map = cc_sched_new_slot(kind, channel, cc);
+    return *map;
+}
+
+static uint8_t cc_sched_find_slot(cc_sched_kind_t kind, uint8_t channel, uint16_t number)
+{
+    uint8_t *map = NULL;
+
+    switch (kind) {
+    case CC_KIND_CC7:
+    case CC_KIND_CC14:
+        return cc_sched_find_cc_slot(kind, channel, (uint8_t)number);
+
+    case CC_KIND_PITCH_BEND:
+        map = &s_slot_of_pb[channel];
+        break;
+
+    case CC_KIND_NRPN:
+        for (uint8_t i = 0; i < s_num_slots; i++) {
+            if (s_slots[i].kind == CC_KIND_NRPN &&
+                s_slots[i].channel == channel &&
+                s_slots[i].number == number) {
+                return i;
+            }
+        }
+        return cc_sched_new_slot(kind, channel, number);
+    }
+
+    if (*map == CC_SCHED_NO_SLOT) {
+        *map = cc_sched_new_slot(kind, channel, number);
+    }
+    return *map;
+}
+
+static bool cc_sched_put(cc_sched_kind_t kind, uint8_t channel, uint16_t number, uint16_t value)
+{
+    uint8_t slot = cc_sched_find_slot(kind, channel & 0x0F, number);
+
+    s_stats.updates++;
+
+    if (slot == CC_SCHED_NO_SLOT) return false;
+
+    cc_slot_t *s   = &s_slots[slot];
+    uint32_t   bit = 1u << slot;
+
+    bool was_pending = (s_pending_mask & bit) != 0;
+
+    if (was_pending) {
+        s_stats.coalesced++;
+    }
+
+    if (value == s->last_sent) {
+        // Volvió al valor que el host ya tiene: nada que mandar
+        s_pending_mask &= ~bit;
+        s->tag.src      = LAT_SRC_NONE;
+        return true;
+    }
+
+    if (s_tag.src != LAT_SRC_NONE) {
+        lat_tag_t t = s_tag;
+        latency_hist_mark_queued(&t);
+        if (!was_pending || s->tag.src == LAT_SRC_NONE) {
+            s->tag = t;
+        }
+    }
+
+    s->pending      = value;
+    s_pending_mask |= bit;
+    return true;
+}
+
+// Emite lo que falte del slot. Devuelve false si emit() se quedó sin sitio.
+static bool cc_sched_emit_slot(cc_slot_t *s, cc_sched_emit_fn emit)
+{
+    uint8_t  cc_status = (uint8_t)(0xB0 | s->channel);
+    uint8_t  msb       = (uint8_t)((s->pending >> 7) & 0x7F);
+    uint8_t  lsb       = (uint8_t)(s->pending & 0x7F);
+    bool     have_last = (s->last_sent != CC_SCHED_NO_VALUE);
+    uint8_t  last_msb  = (uint8_t)((s->last_sent >> 7) & 0x7F);
+
+    switch (s->kind) {
+    case CC_KIND_CC7:
+        if (!emit(cc_status, (uint8_t)s->number, lsb)) return false;
+        s_stats.emitted++;
+        break;
+
+    case CC_KIND_PITCH_BEND:
+        if (!emit((uint8_t)(0xE0 | s->channel), lsb, msb)) return false;
+        s_stats.emitted++;
+        break;
+
+    case CC_KIND_CC14:
+        if (!have_last || last_msb != msb) {
+            if (!emit(cc_status, (uint8_t)s->number, msb)) return false;
+            s_stats.emitted++;
+            // El receptor pone el LSB a 0 al recibir un MSB nuevo
+            s->last_sent = (uint16_t)(msb << 7);
+            if (s->last_sent == s->pending) break;
+        } else {
+            s_stats.msb_skipped++;
+        }
+        if (!emit(cc_status, (uint8_t)(s->number + 32), lsb)) return false;
+        s_stats.emitted++;
+        break;
+
+    case CC_KIND_NRPN:
+    {
+        bool reselect = (s_nrpn_sel[s->channel] != s->number);
+
+        if (reselect) {
+            if (!emit(cc_status, 99, (uint8_t)((s->number >> 7) & 0x7F))) return false;
+            s_stats.emitted++;
+            // Hasta que salga el CC 98 la selección queda indefinida
+            s_nrpn_sel[s->channel] = CC_SCHED_NO_VALUE;
+            if (!emit(cc_status, 98, (uint8_t)(s->number & 0x7F))) return false;
+            s_stats.emitted++;
+            s_nrpn_sel[s->channel] = s->number;
+            // Parámetro recién seleccionado: el dato va completo
+            s->last_sent = CC_SCHED_NO_VALUE;
+            have_last    = false;
+        } else {
+            s_stats.msb_skipped++;
+        }
+
+        if (!have_last || last_msb != msb) {
+            if (!emit(cc_status, 6, msb)) return false;
+            s_stats.emitted++;
+            s->last_sent = (uint16_t)(msb << 7);
+            if (s->last_sent == s->pending) break;
+        } else {
+            s_stats.msb_skipped++;
+        }
+        if (!emit(cc_status, 38, lsb)) return false;
+        s_stats.emitted++;
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    s->last_sent = s->pending;
+    return true;
+}
+
+// ----------------------------
+// API pública
+// ----------------------------
+
+void cc_sched_init(void)
+{
+    memset(s_slot_of_cc, CC_SCHED_NO_SLOT, sizeof(s_slot_of_cc));
+    memset(s_slot_of_pb, CC_SCHED_NO_SLOT, sizeof(s_slot_of_pb));
+    for (int i = 0; i < 16; i++) {
+        s_nrpn_sel[i] = CC_SCHED_NO_VALUE;
+    }
+    s_num_slots    = 0;
+    s_pending_mask = 0;
+    s_rr_next      = 0;
+    s_tag.src      = LAT_SRC_NONE;
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+void cc_sched_set_tag(const lat_tag_t *tag)
+{
+    if (tag) {
+        s_tag = *tag;
+    } else {
+        s_tag.src = LAT_SRC_NONE;
+    }
+}
+
+bool cc_sched_set(uint8_t channel, uint8_t cc, uint8_t value)
+{
+    return cc_sched_put(CC_KIND_CC7, channel, cc & 0x7F, value & 0x7F);
+}
+
+bool cc_sched_set_cc14(uint8_t channel, uint8_t cc_msb, uint16_t value14)
+{
+    if (cc_msb >= 32) return false;
+    return cc_sched_put(CC_KIND_CC14, channel, cc_msb, value14 & 0x3FFF);
+}
+
+bool cc_sched_set_nrpn(uint8_t channel, uint16_t param, uint16_t value14)
+{
+    return cc_sched_put(CC_KIND_NRPN, channel, param & 0x3FFF, value14 & 0x3FFF);
+}
+
+bool cc_sched_set_pitch_bend(uint8_t channel, uint16_t value14)
+{
+    return cc_sched_put(CC_KIND_PITCH_BEND, channel, 0, value14 & 0x3FFF);
+}
+
+// Recorre los slots pendientes en round-robin. emit_slot() devuelve false si
+// la salida se quedó sin sitio; ese slot queda pendiente y se retoma desde él.
+typedef bool (*cc_slot_emitter_t)(cc_slot_t *s);
+
+// Callback del flush en curso
+static cc_sched_emit_fn  s_emit_midi1 = NULL;
+static cc_sched_value_fn s_emit_value = NULL;
+
+static uint8_t cc_sched_flush_slots(cc_slot_emitter_t emit_slot)
+{
+    uint8_t done = 0;
+    uint8_t next = s_rr_next;
+
+    for (uint8_t n = 0; n < s_num_slots && s_pending_mask; n++) {
+        uint8_t  slot = (uint8_t)((s_rr_next + n) % s_num_slots);
+        uint32_t bit  = 1u << slot;
+
+        if (!(s_pending_mask & bit)) continue;
+
+        if (!emit_slot(&s_slots[slot])) {
+            // Sin sitio: seguimos desde aquí la próxima vez
+            next = slot;
+            break;
+        }
+
+        s_pending_mask &= ~bit;
+        latency_hist_mark_sent(&s_slots[slot].tag);
+        s_slots[slot].tag.src = LAT_SRC_NONE;
+        done++;
+
+        // La próxima vuelta empieza detrás del último que salió: con el USB
+        // a medias, los slots altos no esperan siempre a los bajos
+        next = (uint8_t)((slot + 1u) % s_num_slots);
+    }
+
+    s_rr_next = next;
+    return done;
+}
+
+static bool cc_sched_emit_midi1(cc_slot_t *s)
+{
+    return cc_sched_emit_slot(s, s_emit_midi1);
+}
+
+static bool cc_sched_emit_value(cc_slot_t *s)
+{
+    if (!s_emit_value((cc_sched_kind_t)s->kind, s->channel, s->number, s->pending)) return false;
+
+    s->last_sent = s->pending;
+    s_stats.emitted++;
+    return true;
+}
+
+uint8_t cc_sched_flush(cc_sched_emit_fn emit)
+{
+    uint8_t before = (uint8_t)s_stats.emitted;
+
+    if (!emit || s_pending_mask == 0) return 0;
+
+    s_emit_midi1 = emit;
+    cc_sched_flush_slots(cc_sched_emit_midi1);
+
+    return (uint8_t)((uint8_t)s_stats.emitted - before);
+}
+
+uint8_t cc_sched_flush_values(cc_sched_value_fn emit)
+{
+    if (!emit || s_pending_mask == 0) return 0;
+
+    s_emit_value = emit;
+    return cc_sched_flush_slots(cc_sched_emit_value);
+}
+
+bool cc_sched_has_pending(void)
+{
+    return s_pending_mask != 0;
+}
+
+void cc_sched_reset(void)
+{
+    s_pending_mask = 0;
+    for (uint8_t i = 0; i < s_num_slots; i++) {
+        s_slots[i].last_sent = CC_SCHED_NO_VALUE;
+        s_slots[i].tag.src   = LAT_SRC_NONE;
+    }
+    for (int i = 0; i < 16; i++) {
+        s_nrpn_sel[i] = CC_SCHED_NO_VALUE;
+    }
+}
+
+void cc_sched_get_stats(cc_sched_stats_t *out)
+{
+    if (!out) return;
+    *out = s_stats;
+}
@@ -0,0 +1,73 @@
+// cc_sched.h - Coalescado "último valor gana" de controles continuos
+// (CC de 7 bits, CC de 14 bits, NRPN y pitch bend)
+#ifndef CC_SCHED_H
+#define CC_SCHED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "latency_hist.h"
+
+// Número máximo de controles distintos con valor pendiente
+#define CC_SCHED_MAX_SLOTS  32
+
+// Tipo de control guardado en cada slot
+typedef enum {
+    CC_KIND_CC7 = 0,      // CC 0..127, valor 7 bits
+    CC_KIND_CC14,         // CC n / n+32, valor 14 bits
+    CC_KIND_NRPN,         // parámetro NRPN, valor 14 bits
+    CC_KIND_PITCH_BEND    // pitch bend del canal, valor 14 bits
+} cc_sched_kind_t;
+
+// Callback de salida: un mensaje MIDI de 3 bytes (status incluye el canal).
+// Devuelve false si no hay sitio y hay que parar.
+typedef bool (*cc_sched_emit_fn)(uint8_t status, uint8_t d1, uint8_t d2);
+
+// Callback de salida alternativo: el control completo (para codificarlo, p. ej.,
+// como un único UMP de MIDI 2.0). Devuelve false si no hay sitio.
+typedef bool (*cc_sched_value_fn)(cc_sched_kind_t kind, uint8_t channel,
+                                  uint16_t number, uint16_t value);
+
+typedef struct {
+    uint32_t updates;     // valores recibidos
+    uint32_t coalesced;   // valores pendientes sobrescritos antes de salir
+    uint32_t emitted;     // mensajes MIDI entregados por cc_sched_flush()
+    uint32_t msb_skipped; // MSB (o selección NRPN) omitidos porque no cambiaron
+    uint32_t no_slot;     // controles que no cupieron en la tabla
+    uint32_t kind_conflict; // CC7 / CC14 rechazados: el número (o su LSB n+32) ya es del otro tipo
+} cc_sched_stats_t;
+
+// Limpia la tabla de controles
+void cc_sched_init(void);
+
+// Guardan el valor más reciente del control. Si ya había uno pendiente, se
+// reemplaza. Devuelven false si la tabla está llena (el llamador decide) o si
+// el CC ya lo usa un control de otro tipo en ese canal: un CC14 n ocupa n y
+// n+32, así que ahí no cabe un CC de 7 bits, ni al revés.
+bool cc_sched_set(uint8_t channel, uint8_t cc, uint8_t value);                 // CC 0..127
+bool cc_sched_set_cc14(uint8_t channel, uint8_t cc_msb, uint16_t value14);     // CC n / n+32, n = 0..31
+bool cc_sched_set_nrpn(uint8_t channel, uint16_t param, uint16_t value14);     // NRPN 0..16383
+bool cc_sched_set_pitch_bend(uint8_t channel, uint16_t value14);               // 8192 = centro
+
+// Marca de latencia que se asociará a los próximos cc_sched_set*() (NULL = ninguna).
+// Si un control ya tenía valor pendiente, conserva la marca más antigua.
+void cc_sched_set_tag(const lat_tag_t *tag);
+
+// Entrega los mensajes pendientes a emit() en orden round-robin hasta que
+// emit() devuelva false. Lo que no sale sigue pendiente. Devuelve cuántos
+// mensajes MIDI salieron.
+uint8_t cc_sched_flush(cc_sched_emit_fn emit);
+
+// Igual que cc_sched_flush(), pero entrega cada control completo en una sola
+// llamada a emit(). Devuelve cuántos controles salieron.
+uint8_t cc_sched_flush_values(cc_sched_value_fn emit);
+
+// true si hay algún valor pendiente
+bool cc_sched_has_pending(void);
+
+// Descarta todo lo pendiente y olvida los últimos valores enviados
+void cc_sched_reset(void);
+
+void cc_sched_get_stats(cc_sched_stats_t *out);
+
+#endif // CC_SCHED_H
@@ -0,0 +1,436 @@
+// clock_gen.c - Generador interno de MIDI Clock con alarma hardware
+//
+// Los ticks los dispara una alarma del timer del RP2040, no el main loop:
+// el instante de cada tick se calcula en absoluto (periodo en Q24.8 us, sin
+// acumular error) y la IRQ sólo marca el tick, lo manda al host si toca y
+// programa el siguiente. El secuenciador (que dibuja el anillo, operación
+// bloqueante) consume los ticks desde clock_gen_task() en el main loop.
+//
+// Arbitraje (modo AUTO): mientras el DAW manda clock, manda el DAW. Si el
+// secuenciador está corriendo y un tick externo no llega medio periodo después
+// de lo que predice clock_tracker, el generador interno continúa con el tempo
+// y la fase estimados. Cuando el DAW vuelve a mandar clock, se le devuelve el
+// control. Un Stop explícito del DAW se respeta (no hay relevo).
+//
+// Sin DAW, el clock interno sólo arranca solo si se pidió (autostart); si no,
+// con un Start. Modo, tempo, autostart y eco al host se ajustan por SysEx
+// (clock_gen_parse_sysex), que también devuelve las estadísticas.
+
+#include "clock_gen.h"
+#include "clock_tracker.h"
+#include "step_sequencer.h"
+#include "midi_core.h"
+
+#include "pico/stdlib.h"
+#include "hardware/timer.h"
+#include "hardware/sync.h"
+
+// Con autostart: sin clock externo en este tiempo desde el arranque ->
+// arranca el interno. Desactivado salvo que la build defina
+// CLOCK_GEN_AUTOSTART=1 o se active por SysEx.
+#ifndef CLOCK_GEN_AUTOSTART
+#define CLOCK_GEN_AUTOSTART      0
+#endif
+#define CLOCK_GEN_AUTOSTART_US   2000000u
+// Límites de tempo del generador
+#define CLOCK_GEN_MIN_BPM_X100   3000u
+#define CLOCK_GEN_MAX_BPM_X100   30000u
+
+static int                    s_alarm = -1;
+static volatile bool          s_running       = false;
+static volatile uint32_t      s_period_q8     = 0;     // periodo por tick (us Q24.8)
+static uint64_t               s_next_q8       = 0;     // instante ideal del próximo tick (us Q8)
+static uint64_t               s_last_fire_us  = 0;
+static volatile uint32_t      s_pending_ticks = 0;     // ticks de la IRQ aún no entregados
+static volatile bool          s_send_to_host  = false;
+
+static clock_src_mode_t       s_mode   = CLOCK_SRC_AUTO;
+static clock_active_t         s_active = CLOCK_ACTIVE_NONE;
+static uint32_t               s_bpm_x100 = CLOCK_GEN_DEFAULT_BPM_X100;
+static bool                   s_external_seen = false;
+static bool                   s_autostart     = (CLOCK_GEN_AUTOSTART != 0);
+static uint64_t               s_boot_us = 0;
+
+static clock_gen_stats_t      s_stats;
+static uint64_t               s_late_sum_us = 0;
+
+// ----------------------------
+// Funciones internas
+// ----------------------------
+
+static uint32_t clock_gen_period_q8_from_bpm(uint32_t bpm_x100)
+{
+    // periodo_us = 60e6 / (bpm * 24); en Q8 y con bpm*100
+    return (uint32_t)((60000000ull * 100ull * 256ull / CLOCK_TRACKER_PPQN) / bpm_x100);
+}
+
+// Un tick interno (contexto IRQ o llamada con IRQ enmascaradas)
+static void clock_gen_emit_tick(void)
+{
+    s_pending_ticks++;
+    s_stats.ticks++;
+    if (s_send_to_host) {
+        midi_send_realtime(0xF8);
+    }
+}
+
+// Programa la alarma para el siguiente tick. Si el instante ya pasó, el tick
+// se emite aquí mismo y se prueba con el siguiente.
+static void clock_gen_arm_next(void)
+{
+    while (s_running) {
+        s_next_q8 += s_period_q8;
+        if (!hardware_alarm_set_target((uint)s_alarm, from_us_since_boot(s_next_q8 >> 8))) {
+            return;
+        }
+        s_stats.missed++;
+        clock_gen_emit_tick();
+    }
+}
+
+static void clock_gen_alarm_cb(uint alarm_num)
+{
+    (void)alarm_num;
+
+    if (!s_running) return;
+
+    uint64_t now    = time_us_64();
+    uint64_t target = s_next_q8 >> 8;
+    uint32_t late   = (now > target) ? (uint32_t)(now - target) : 0;
+
+    // Jitter de salida: retraso de la IRQ y desviación del intervalo
+    if (late < s_stats.late_min_us) s_stats.late_min_us = late;
+    if (late > s_stats.late_max_us) s_stats.late_max_us = late;
+    s_late_sum_us += late;
+
+    if (s_last_fire_us != 0) {
+        int32_t dev = (int32_t)(now - s_last_fire_us) - (int32_t)(s_period_q8 >> 8);
+        uint32_t adev = (uint32_t)(dev < 0 ? -dev : dev);
+        if (adev > s_stats.period_dev_max_us) s_stats.period_dev_max_us = adev;
+    }
+    s_last_fire_us = now;
+
+    clock_gen_emit_tick();
+    clock_gen_arm_next();
+}
+
+// Arranca el generador con el primer tick en first_tick_us. Si ese instante
+// ya pasó (relevo: el primer tick es el que faltó), los ticks vencidos se
+// emiten aquí como recuperación y la alarma va al siguiente: no son alarmas
+// perdidas.
+static void clock_gen_run_from(uint64_t first_tick_us, uint32_t period_q8)
+{
+    if (s_alarm < 0) return;
+
+    uint32_t irq = save_and_disable_interrupts();
+    s_period_q8    = period_q8;
+    s_next_q8      = (first_tick_us << 8) - period_q8;   // arm_next suma un periodo
+    s_last_fire_us = 0;
+    s_running      = true;
+
+    uint64_t now_q8 = time_us_64() << 8;
+    while (s_next_q8 + period_q8 <= now_q8) {
+        s_next_q8 += period_q8;
+        s_stats.catchup++;
+        clock_gen_emit_tick();
+    }
+    clock_gen_arm_next();
+    restore_interrupts(irq);
+
+    s_active = CLOCK_ACTIVE_INTERNAL;
+}
+
+static void clock_gen_halt(void)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    s_running       = false;
+    s_pending_ticks = 0;
+    restore_interrupts(irq);
+
+    if (s_alarm >= 0) {
+        hardware_alarm_cancel((uint)s_alarm);
+    }
+}
+
+// Relevo externo -> interno manteniendo tempo y fase de clock_tracker
+static void clock_gen_take_over(void)
+{
+    clock_tracker_stats_t ct;
+    clock_tracker_get_stats(&ct);
+
+    if (ct.bpm_x100 >= CLOCK_GEN_MIN_BPM_X100 && ct.bpm_x100 <= CLOCK_GEN_MAX_BPM_X100) {
+        s_bpm_x100 = ct.bpm_x100;
+    }
+
+    // El primer tick interno es el que faltó
+    clock_gen_run_from(clock_tracker_next_tick_us(), clock_gen_period_q8_from_bpm(s_bpm_x100));
+    s_stats.handovers++;
+}
+
+// ----------------------------
+// API pública
+// ----------------------------
+
+void clock_gen_init(void)
+{
+    s_alarm = hardware_alarm_claim_unused(true);
+    hardware_alarm_set_callback((uint)s_alarm, clock_gen_alarm_cb);
+
+    s_running       = false;
+    s_pending_ticks = 0;
+    s_active        = CLOCK_ACTIVE_NONE;
+    s_external_seen = false;
+    s_boot_us       = time_us_64();
+    s_period_q8     = clock_gen_period_q8_from_bpm(s_bpm_x100);
+    clock_gen_reset_stats();
+}
+
+void clock_gen_task(void)
+{
+    // 1) Ticks internos pendientes -> secuenciador
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t n   = s_pending_ticks;
+    s_pending_ticks = 0;
+    restore_interrupts(irq);
+
+    while (n--) {
+        stepseq_on_clock_tick();
+    }
+
+    if (s_mode != CLOCK_SRC_AUTO) return;
+
+    uint64_t now = time_us_64();
+
+    // 2) Relevo: el DAW dejó de mandar clock con el secuenciador corriendo
+    if (s_active == CLOCK_ACTIVE_EXTERNAL && stepseq_is_running()) {
+        uint64_t pred = clock_tracker_next_tick_us();
+        clock_tracker_stats_t ct;
+        clock_tracker_get_stats(&ct);
+
+        if (ct.locked && pred != 0 && now > pred + ((ct.period_q8 >> 8) / 2u)) {
+            clock_gen_take_over();
+        }
+        return;
+    }
+
+    // 3) Sin DAW desde el arranque: el clock interno arranca solo, si se pidió
+    if (s_autostart && s_active == CLOCK_ACTIVE_NONE && !s_external_seen &&
+        (now - s_boot_us) > CLOCK_GEN_AUTOSTART_US) {
+        clock_gen_start();
+    }
+}
+
+void clock_gen_set_mode(clock_src_mode_t mode)
+{
+    s_mode = mode;
+
+    if (mode == CLOCK_SRC_EXTERNAL && s_active == CLOCK_ACTIVE_INTERNAL) {
+        clock_gen_stop();
+    }
+}
+
+clock_src_mode_t clock_gen_get_mode(void)
+{
+    return s_mode;
+}
+
+clock_active_t clock_gen_get_active(void)
+{
+    return s_active;
+}
+
+void clock_gen_set_bpm_x100(uint32_t bpm_x100)
+{
+    if (bpm_x100 < CLOCK_GEN_MIN_BPM_X100) bpm_x100 = CLOCK_GEN_MIN_BPM_X100;
+    if (bpm_x100 > CLOCK_GEN_MAX_BPM_X100) bpm_x100 = CLOCK_GEN_MAX_BPM_X100;
+
+    s_bpm_x100  = bpm_x100;
+    s_period_q8 = clock_gen_period_q8_from_bpm(bpm_x100);   // escritura atómica de 32 bits
+}
+
+uint32_t clock_gen_get_bpm_x100(void)
+{
+    return s_bpm_x100;
+}
+
+void clock_gen_set_send_to_host(bool enable)
+{
+    s_send_to_host = enable;
+}
+
+void clock_gen_set_autostart(bool enable)
+{
+    s_autostart = enable;
+}
+
+void clock_gen_start(void)
+{
+    if (s_mode == CLOCK_SRC_EXTERNAL) return;
+
+    if (s_send_to_host) midi_send_realtime(0xFA);
+    stepseq_on_start();
+
+    // Primer tick un periodo después del Start
+    uint32_t period = clock_gen_period_q8_from_bpm(s_bpm_x100);
+    clock_gen_run_from(time_us_64() + (period >> 8), period);
+}
+
+void clock_gen_stop(void)
+{
+    if (s_active != CLOCK_ACTIVE_INTERNAL) return;
+
+    clock_gen_halt();
+    if (s_send_to_host) midi_send_realtime(0xFC);
+    stepseq_on_stop();
+    s_active = CLOCK_ACTIVE_NONE;
+}
+
+bool clock_gen_on_external_tick(void)
+{
+    if (s_mode == CLOCK_SRC_INTERNAL) return false;
+
+    s_external_seen = true;
+
+    if (s_active == CLOCK_ACTIVE_INTERNAL) {
+        // El DAW vuelve: devolverle el control sin duplicar ticks
+        clock_gen_halt();
+        s_stats.handbacks++;
+    }
+    s_active = CLOCK_ACTIVE_EXTERNAL;
+    return true;
+}
+
+bool clock_gen_on_external_transport(uint8_t status)
+{
+    if (s_mode == CLOCK_SRC_INTERNAL) return false;
+
+    s_external_seen = true;
+
+    if (s_active == CLOCK_ACTIVE_INTERNAL) {
+        if (status == 0xFC) {
+            // Stop del DAW mientras manda el interno: no nos afecta
+            return false;
+        }
+        clock_gen_halt();
+        s_stats.handbacks++;
+    }
+    s_active = CLOCK_ACTIVE_EXTERNAL;
+    return true;
+}
+
+void clock_gen_get_stats(clock_gen_stats_t *out)
+{
+    if (!out) return;
+
+    uint32_t irq = save_and_disable_interrupts();
+    // El retraso sólo se mide en los ticks de la IRQ
+    uint32_t fired = s_stats.ticks - s_stats.missed - s_stats.catchup;
+
+    *out = s_stats;
+    out->late_avg_us = fired ? (uint32_t)(s_late_sum_us / fired) : 0;
+    if (fired == 0) out->late_min_us = 0;
+    restore_interrupts(irq);
+}
+
+void clock_gen_reset_stats(void)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    s_stats = (clock_gen_stats_t){0};
+    s_stats.late_min_us = UINT32_MAX;
+    s_late_sum_us = 0;
+    restore_interrupts(irq);
+}
+
+// ----------------------------
+// SysEx
+// ----------------------------
+
+static void clock_gen_put_u28(uint8_t *p, uint32_t v)
+{
+    if (v > 0x0FFFFFFFu) v = 0x0FFFFFFFu;
+    p[0] = (uint8_t)((v >> 21) & 0x7F);
+    p[1] = (uint8_t)((v >> 14) & 0x7F);
+    p[2] = (uint8_t)((v >> 7)  & 0x7F);
+    p[3] = (uint8_t)(v & 0x7F);
+}
+
+static void clock_gen_apply_param(uint8_t id, uint32_t v)
+{
+    switch (id) {
+    case CLOCK_GEN_PARAM_MODE:
+        if (v <= CLOCK_SRC_EXTERNAL) clock_gen_set_mode((clock_src_mode_t)v);
+        break;
+    case CLOCK_GEN_PARAM_BPM_X100:
+        clock_gen_set_bpm_x100(v);
+        break;
+    case CLOCK_GEN_PARAM_SEND_TO_HOST:
+        clock_gen_set_send_to_host(v != 0);
+        break;
+    case CLOCK_GEN_PARAM_AUTOSTART:
+        clock_gen_set_autostart(v != 0);
+        break;
+    case CLOCK_GEN_PARAM_RUN:
+        if (v) {
+            if (s_active != CLOCK_ACTIVE_INTERNAL) clock_gen_start();
+        } else {
+            clock_gen_stop();
+        }
+        break;
+    case CLOCK_GEN_PARAM_RESET_STATS:
+        clock_gen_reset_stats();
+        break;
+    default:
+        break;
+    }
+}
+
+bool clock_gen_parse_sysex(const uint8_t *data, uint16_t len)
+{
+    if (!data || len < 5 ||
+        data[0] != 0xF0 || data[1] != LAT_SYSEX_MANUF || data[2] != LAT_SYSEX_DEVICE ||
+        data[3] != CLOCK_GEN_SYSEX_CMD || data[len - 1] != 0xF7) {
+        return false;
+    }
+
+    if (len == 5) return true;   // consulta
+
+    if (len == 9) {
+        uint32_t v = ((uint32_t)data[5] << 14) | ((uint32_t)data[6] << 7) | data[7];
+        clock_gen_apply_param(data[4], v);
+        return true;
+    }
+
+    return false;
+}
+
+size_t clock_gen_build_sysex(uint8_t *buf, size_t cap)
+{
+    clock_gen_stats_t st;
+
+    if (!buf || cap < CLOCK_GEN_SYSEX_REPLY_LEN) return 0;
+
+    clock_gen_get_stats(&st);
+
+    size_t n = 0;
+    buf[n++] = 0xF0;
+    buf[n++] = LAT_SYSEX_MANUF;
+    buf[n++] = LAT_SYSEX_DEVICE;
+    buf[n++] = CLOCK_GEN_SYSEX_CMD_REPLY;
+    buf[n++] = (uint8_t)s_mode;
+    buf[n++] = (uint8_t)s_active;
+    buf[n++] = (uint8_t)((s_send_to_host ? 0x01 : 0) | (s_autostart ? 0x02 : 0));
+
+    clock_gen_put_u28(&buf[n], s_bpm_x100);           n += 4;
+    clock_gen_put_u28(&buf[n], st.ticks);             n += 4;
+    clock_gen_put_u28(&buf[n], st.missed);            n += 4;
+    clock_gen_put_u28(&buf[n], st.catchup);           n += 4;
+    clock_gen_put_u28(&buf[n], st.handovers);         n += 4;
+    clock_gen_put_u28(&buf[n], st.handbacks);         n += 4;
+    clock_gen_put_u28(&buf[n], st.late_min_us);       n += 4;
+    clock_gen_put_u28(&buf[n], st.late_max_us);       n += 4;
+    clock_gen_put_u28(&buf[n], st.late_avg_us);       n += 4;
+    clock_gen_put_u28(&buf[n], st.period_dev_max_us); n += 4;
+
+    buf[n++] = 0xF7;
+    return n;
+}
@@ -0,0 +1,106 @@
+// clock_gen.h - Generador interno de MIDI Clock (24 PPQN) con alarma hardware
+// y arbitraje entre clock externo (DAW) e interno
+#ifndef CLOCK_GEN_H
+#define CLOCK_GEN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "latency_hist.h"
+
+// Tempo por defecto del clock interno (BPM * 100)
+#define CLOCK_GEN_DEFAULT_BPM_X100  12000u
+
+// Política de selección de fuente de clock
+typedef enum {
+    CLOCK_SRC_AUTO = 0,   // externo si el DAW manda clock; si desaparece, sigue el interno
+    CLOCK_SRC_INTERNAL,   // sólo interno (se ignora el clock del DAW)
+    CLOCK_SRC_EXTERNAL    // sólo externo (comportamiento original)
+} clock_src_mode_t;
+
+// Fuente que está moviendo el secuenciador ahora mismo
+typedef enum {
+    CLOCK_ACTIVE_NONE = 0,
+    CLOCK_ACTIVE_EXTERNAL,
+    CLOCK_ACTIVE_INTERNAL
+} clock_active_t;
+
+typedef struct {
+    uint32_t ticks;           // ticks internos generados
+    uint32_t missed;          // alarmas que no se pudieron programar a tiempo
+    uint32_t catchup;         // ticks ya vencidos al arrancar (el que faltó en un relevo)
+    uint32_t handovers;       // pasos externo -> interno
+    uint32_t handbacks;       // pasos interno -> externo
+    uint32_t late_min_us;     // retraso mínimo de la IRQ respecto al instante ideal
+    uint32_t late_max_us;     // retraso máximo
+    uint32_t late_avg_us;     // retraso medio
+    uint32_t period_dev_max_us; // máxima desviación del intervalo entre ticks respecto al nominal
+} clock_gen_stats_t;
+
+// Reserva la alarma hardware. No arranca el clock.
+void clock_gen_init(void);
+
+// Llamar en el main loop: entrega al secuenciador los ticks generados por la
+// IRQ y decide la fuente de clock.
+void clock_gen_task(void);
+
+void             clock_gen_set_mode(clock_src_mode_t mode);
+clock_src_mode_t clock_gen_get_mode(void);
+clock_active_t   clock_gen_get_active(void);
+
+// Tempo del clock interno
+void     clock_gen_set_bpm_x100(uint32_t bpm_x100);
+uint32_t clock_gen_get_bpm_x100(void);
+
+// Si true, mientras el clock interno es la fuente se manda 0xF8/0xFA/0xFC al host
+void clock_gen_set_send_to_host(bool enable);
+
+// Si true (modo AUTO), el clock interno arranca solo cuando no llegó clock del
+// DAW en CLOCK_GEN_AUTOSTART_US desde el arranque. Por defecto no: el
+// secuenciador espera al DAW o a un Start. Valor inicial: CLOCK_GEN_AUTOSTART.
+void clock_gen_set_autostart(bool enable);
+
+// Arranque / parada manual del clock interno (también arranca/para el secuenciador)
+void clock_gen_start(void);
+void clock_gen_stop(void);
+
+// Hooks desde la entrada MIDI. Devuelven true si el mensaje del DAW debe
+// llegar al secuenciador (false si la fuente activa es la interna).
+bool clock_gen_on_external_tick(void);
+bool clock_gen_on_external_transport(uint8_t status);   // 0xFA, 0xFB, 0xFC
+
+void clock_gen_get_stats(clock_gen_stats_t *out);
+void clock_gen_reset_stats(void);
+
+// ---- Configuración y estadísticas por SysEx (mismo fabricante que latency_hist) ----
+//  Consulta : F0 7D 01 0A F7
+//  Ajuste   : F0 7D 01 0A <param> <v20..14> <v13..7> <v6..0> F7  (contesta igual)
+//  Respuesta: F0 7D 01 0B <modo> <activa> <flags> <bpm_x100> <ticks> <missed>
+//             <catchup> <handovers> <handbacks> <late_min> <late_max>
+//             <late_avg> <period_dev_max> F7
+//             flags: bit 0 manda al host, bit 1 autostart; cada número en
+//             4 bytes de 7 bits (MSB primero, satura a 2^28-1)
+#define CLOCK_GEN_SYSEX_CMD        LAT_SYSEX_CMD_CLOCK
+#define CLOCK_GEN_SYSEX_CMD_REPLY  LAT_SYSEX_CMD_CLOCK_REPLY
+#define CLOCK_GEN_SYSEX_REPLY_LEN  (8u + 10u * 4u)
+
+// Parámetros del ajuste
+typedef enum {
+    CLOCK_GEN_PARAM_MODE = 0,      // clock_src_mode_t
+    CLOCK_GEN_PARAM_BPM_X100,      // tempo del clock interno
+    CLOCK_GEN_PARAM_SEND_TO_HOST,  // 0 / 1
+    CLOCK_GEN_PARAM_AUTOSTART,     // 0 / 1
+    CLOCK_GEN_PARAM_RUN,           // 1 = clock_gen_start, 0 = clock_gen_stop
+    CLOCK_GEN_PARAM_RESET_STATS,   // valor ignorado
+    CLOCK_GEN_PARAM_COUNT
+} clock_gen_param_t;
+
+// true si el SysEx era para clock_gen (consulta o ajuste, ya aplicado); el
+// llamador manda entonces la respuesta de clock_gen_build_sysex()
+bool clock_gen_parse_sysex(const uint8_t *data, uint16_t len);
+
+// Construye la respuesta. Devuelve la longitud (0 si no cabe).
+size_t clock_gen_build_sysex(uint8_t *buf, size_t cap);
+
+#endif // CLOCK_GEN_H
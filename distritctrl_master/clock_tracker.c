@@ -0,0 +1,178 @@
+// clock_tracker.c - Seguimiento de tempo y fase del MIDI Clock (24 PPQN)
+//
+// Lazo de seguimiento de segundo orden (filtro alfa-beta, equivalente a un PLL
+// digital) sobre los timestamps de llegada de cada 0xF8:
+//
+//   err       = t_llegada - t_previsto
+//   t_tick    = t_previsto + alfa * err      (fase filtrada de este tick)
+//   periodo  += beta * err                   (tempo)
+//   t_previsto = t_tick + periodo            (predicción del siguiente)
+//
+// Con alfa = 1/4 y beta = 1/32 el lazo queda casi críticamente amortiguado
+// (beta ≈ alfa² / (2 - alfa)). Durante los primeros ticks tras enganchar se
+// usan ganancias mayores para converger rápido. Todo en enteros: el periodo
+// va en Q24.8 us y las ganancias son desplazamientos.
+
+#include "clock_tracker.h"
+
+// Límites de tempo aceptados: 30..300 BPM
+#define CT_PERIOD_MIN_US   (60000000u / (300u * CLOCK_TRACKER_PPQN))  //  8333 us
+#define CT_PERIOD_MAX_US   (60000000u / ( 30u * CLOCK_TRACKER_PPQN))  // 83333 us
+
+// Ganancias como desplazamientos (alfa = 2^-shift)
+#define CT_ALPHA_SHIFT          2   // 1/4
+#define CT_BETA_SHIFT           5   // 1/32
+#define CT_ALPHA_SHIFT_ACQ      1   // 1/2  durante adquisición
+#define CT_BETA_SHIFT_ACQ       3   // 1/8
+#define CT_ACQUIRE_TICKS        12  // medio beat con ganancias altas
+
+// Media móvil del jitter: 1/16 por tick
+#define CT_JITTER_SHIFT         4
+
+typedef enum {
+    CT_IDLE = 0,     // sin ticks
+    CT_FIRST,        // un tick, sin periodo todavía
+    CT_TRACKING      // lazo cerrado
+} ct_state_t;
+
+static ct_state_t s_state;
+static uint64_t   s_last_arrival_us;   // llegada real del último tick
+static uint64_t   s_last_tick_q8;      // fase filtrada del último tick (us Q8)
+static uint32_t   s_period_q8;         // periodo estimado (us Q8)
+static uint32_t   s_track_ticks;       // ticks desde el último enganche
+static int32_t    s_jitter_avg_q4;     // media de |err| en us Q4
+static clock_tracker_stats_t s_stats;
+
+static void ct_relock(uint64_t t_us, uint32_t interval_us)
+{
+    s_period_q8    = interval_us << 8;
+    s_last_tick_q8 = t_us << 8;
+    s_track_ticks  = 0;
+    s_jitter_avg_q4       = 0;
+    s_stats.jitter_max_us = 0;
+    s_state = CT_TRACKING;
+}
+
+void clock_tracker_init(void)
+{
+    s_state           = CT_IDLE;
+    s_last_arrival_us = 0;
+    s_last_tick_q8    = 0;
+    s_period_q8       = 0;
+    s_track_ticks     = 0;
+    s_jitter_avg_q4   = 0;
+    s_stats = (clock_tracker_stats_t){0};
+}
+
+void clock_tracker_on_tick(uint64_t t_us)
+{
+    uint64_t interval = t_us - s_last_arrival_us;
+
+    s_stats.ticks++;
+
+    switch (s_state) {
+    case CT_IDLE:
+        s_state = CT_FIRST;
+        break;
+
+    case CT_FIRST:
+        if (interval >= CT_PERIOD_MIN_US && interval <= CT_PERIOD_MAX_US) {
+            ct_relock(t_us, (uint32_t)interval);
+        }
+        break;
+
+    case CT_TRACKING:
+    {
+        if (interval > 2u * CT_PERIOD_MAX_US) {
+            // Hueco largo (stop/pausa del host): volvemos a medir desde cero
+            s_state = CT_FIRST;
+            s_stats.relocks++;
+            break;
+        }
+
+        int64_t pred_q8 = (int64_t)(s_last_tick_q8 + s_period_q8);
+        int64_t err_q8  = (int64_t)(t_us << 8) - pred_q8;
+        int64_t half_q8 = (int64_t)(s_period_q8 >> 1);
+
+        if (err_q8 > half_q8 || err_q8 < -half_q8) {
+            // Salto de tempo o tick perdido: re-enganchar con el intervalo real
+            if (interval >= CT_PERIOD_MIN_US && interval <= CT_PERIOD_MAX_US) {
+                ct_relock(t_us, (uint32_t)interval);
+            } else {
+                s_state = CT_FIRST;
+            }
+            s_stats.relocks++;
+            break;
+        }
+
+        bool acquiring = (s_track_ticks < CT_ACQUIRE_TICKS);
+        int  a_shift   = acquiring ? CT_ALPHA_SHIFT_ACQ : CT_ALPHA_SHIFT;
+        int  b_shift   = acquiring ? CT_BETA_SHIFT_ACQ  : CT_BETA_SHIFT;
+
+        s_last_tick_q8 = (uint64_t)(pred_q8 + (err_q8 >> a_shift));
+
+        int64_t period = (int64_t)s_period_q8 + (err_q8 >> b_shift);
+        if (period < (int64_t)(CT_PERIOD_MIN_US << 8)) period = CT_PERIOD_MIN_US << 8;
+        if (period > (int64_t)(CT_PERIOD_MAX_US << 8)) period = CT_PERIOD_MAX_US << 8;
+        s_period_q8 = (uint32_t)period;
+
+        s_track_ticks++;
+
+        // Estadísticas de jitter (en us)
+        int32_t  err_us = (int32_t)(err_q8 >> 8);
+        uint32_t abs_us = (uint32_t)(err_us < 0 ? -err_us : err_us);
+
+        s_stats.last_err_us = err_us;
+        if (abs_us > s_stats.jitter_max_us) s_stats.jitter_max_us = abs_us;
+        s_jitter_avg_q4 += ((int32_t)(abs_us << 4) - s_jitter_avg_q4) >> CT_JITTER_SHIFT;
+    }
+    break;
+
+    default:
+        s_state = CT_IDLE;
+        break;
+    }
+
+    s_last_arrival_us = t_us;
+}
+
+bool clock_tracker_is_locked(uint64_t now_us, uint32_t timeout_us)
+{
+    if (s_state != CT_TRACKING) return false;
+    return (now_us - s_last_arrival_us) < timeout_us;
+}
+
+uint64_t clock_tracker_predict_tick_us(uint32_t n)
+{
+    if (s_state != CT_TRACKING) return 0;
+    return (s_last_tick_q8 + (uint64_t)s_period_q8 * n) >> 8;
+}
+
+uint64_t clock_tracker_next_tick_us(void)
+{
+    return clock_tracker_predict_tick_us(1);
+}
+
+uint32_t clock_tracker_get_bpm_x100(void)
+{
+    if (s_state != CT_TRACKING || s_period_q8 == 0) return 0;
+
+    // BPM*100 = 60e6 * 100 / (periodo_us * 24); periodo en Q8 -> * 256
+    return (uint32_t)((60000000ull * 100ull * 256ull / CLOCK_TRACKER_PPQN) / s_period_q8);
+}
+
+uint64_t clock_tracker_last_tick_us(void)
+{
+    return s_last_arrival_us;
+}
+
+void clock_tracker_get_stats(clock_tracker_stats_t *out)
+{
+    if (!out) return;
+
+    *out = s_stats;
+    out->period_q8     = s_period_q8;
+    out->bpm_x100      = clock_tracker_get_bpm_x100();
+    out->jitter_avg_us = (uint32_t)s_jitter_avg_q4 >> 4;
+    out->locked        = (s_state == CT_TRACKING);
+}
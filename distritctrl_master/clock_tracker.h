@@ -0,0 +1,45 @@
+// clock_tracker.h - Seguimiento de tempo y fase del MIDI Clock (24 PPQN)
+#ifndef CLOCK_TRACKER_H
+#define CLOCK_TRACKER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Ticks de MIDI Clock por negra
+#define CLOCK_TRACKER_PPQN  24
+
+typedef struct {
+    uint32_t ticks;          // ticks procesados desde init
+    uint32_t relocks;        // veces que se perdió el enganche y se re-adquirió
+    uint32_t period_q8;      // periodo estimado por tick (us, Q24.8)
+    uint32_t bpm_x100;       // tempo estimado (BPM * 100)
+    int32_t  last_err_us;    // error de fase del último tick (llegada - predicción)
+    uint32_t jitter_avg_us;  // media móvil de |error de fase|
+    uint32_t jitter_max_us;  // máximo |error de fase| desde el último enganche
+    bool     locked;         // true si el lazo está enganchado
+} clock_tracker_stats_t;
+
+// Reinicia el estimador (sin tempo ni fase)
+void clock_tracker_init(void);
+
+// Alimenta un tick 0xF8 con su timestamp de llegada (time_us_64())
+void clock_tracker_on_tick(uint64_t t_us);
+
+// true si hay tempo y fase estimados y el último tick es más reciente que timeout_us
+bool clock_tracker_is_locked(uint64_t now_us, uint32_t timeout_us);
+
+// Instante previsto del tick n posiciones después del último recibido (n >= 1)
+uint64_t clock_tracker_predict_tick_us(uint32_t n);
+
+// Instante previsto del próximo tick (equivale a predict_tick_us(1))
+uint64_t clock_tracker_next_tick_us(void);
+
+// Tempo estimado en BPM * 100 (0 si no hay estimación)
+uint32_t clock_tracker_get_bpm_x100(void);
+
+// Timestamp del último tick recibido (0 = nunca)
+uint64_t clock_tracker_last_tick_us(void);
+
+void clock_tracker_get_stats(clock_tracker_stats_t *out);
+
+#endif // CLOCK_TRACKER_H
@@ -0,0 +1,151 @@
+// ctrl_queue.c - Cola SPSC de eventos de control entre núcleos
+//
+// Un solo productor (core1) y un solo consumidor (core0): cada índice lo
+// escribe un único núcleo, así que no hacen falta spinlocks ni deshabilitar
+// IRQ. Las barreras (DMB) garantizan que el otro núcleo vea el evento
+// completo antes que el índice que lo publica.
+
+#include "ctrl_queue.h"
+#include "latency_hist.h"
+
+#include "hardware/sync.h"
+
+#define CTRL_QUEUE_MASK  (CTRL_QUEUE_SIZE - 1u)
+
+static ctrl_event_t      s_queue[CTRL_QUEUE_SIZE];
+static volatile uint32_t s_head = 0;   // lo escribe sólo el productor
+static volatile uint32_t s_tail = 0;   // lo escribe sólo el consumidor
+
+// Estado del productor
+static uint8_t  s_src   = LAT_SRC_NONE;
+static uint32_t s_t0_us = 0;
+
+// Contadores del productor / consumidor (cada uno escribe los suyos)
+static volatile uint32_t s_posted     = 0;
+static volatile uint32_t s_dropped    = 0;
+static volatile uint16_t s_high_water = 0;
+static volatile uint32_t s_dispatched = 0;
+
+// ----------------------------
+// Funciones internas
+// ----------------------------
+
+static bool ctrl_queue_post(uint8_t type, uint8_t channel, uint8_t mode,
+                            uint16_t number, uint16_t value)
+{
+    uint32_t head = s_head;
+    uint32_t used = head - s_tail;
+
+    if (used >= CTRL_QUEUE_SIZE) {
+        s_dropped++;
+        return false;
+    }
+
+    ctrl_event_t *ev = &s_queue[head & CTRL_QUEUE_MASK];
+    ev->type    = type;
+    ev->channel = channel;
+    ev->mode    = mode;
+    ev->lat_src = s_src;
+    ev->number  = number;
+    ev->value   = value;
+    ev->t0_us   = s_t0_us;
+
+    // El evento tiene que estar en memoria antes de publicar el índice
+    __dmb();
+    s_head = head + 1u;
+
+    // Despertar a core0 si está en WFE
+    __sev();
+
+    s_posted++;
+    if (used + 1u > s_high_water) {
+        s_high_water = (uint16_t)(used + 1u);
+    }
+    return true;
+}
+
+// ----------------------------
+// API pública
+// ----------------------------
+
+void ctrl_queue_init(void)
+{
+    s_head       = 0;
+    s_tail       = 0;
+    s_src        = LAT_SRC_NONE;
+    s_t0_us      = 0;
+    s_posted     = 0;
+    s_dropped    = 0;
+    s_high_water = 0;
+    s_dispatched = 0;
+}
+
+void ctrl_queue_set_source(uint8_t lat_src, uint32_t t0_us)
+{
+    s_src   = lat_src;
+    s_t0_us = t0_us;
+}
+
+bool ctrl_queue_note_on(uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    return ctrl_queue_post(CTRL_EV_NOTE_ON, channel, 0, note, velocity);
+}
+
+bool ctrl_queue_note_off(uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    return ctrl_queue_post(CTRL_EV_NOTE_OFF, channel, 0, note, velocity);
+}
+
+bool ctrl_queue_control(uint8_t channel, midi_res_mode_t mode, uint16_t number, uint16_t value14)
+{
+    return ctrl_queue_post(CTRL_EV_CONTROL, channel, (uint8_t)mode, number, value14);
+}
+
+uint32_t ctrl_queue_dispatch(uint32_t max)
+{
+    uint32_t tail = s_tail;
+    uint32_t n    = 0;
+
+    while (n < max && tail != s_head) {
+        // Leer el evento después de ver el índice publicado
+        __dmb();
+        ctrl_event_t ev = s_queue[tail & CTRL_QUEUE_MASK];
+
+        // Liberar el hueco sólo cuando ya lo copiamos
+        __dmb();
+        s_tail = ++tail;
+
+        midi_core_set_event_source(ev.lat_src, ev.t0_us);
+
+        switch (ev.type) {
+        case CTRL_EV_NOTE_ON:
+            midi_send_note_on(ev.channel, (uint8_t)ev.number, (uint8_t)ev.value);
+            break;
+        case CTRL_EV_NOTE_OFF:
+            midi_send_note_off(ev.channel, (uint8_t)ev.number, (uint8_t)ev.value);
+            break;
+        case CTRL_EV_CONTROL:
+            midi_send_control(ev.channel, (midi_res_mode_t)ev.mode, ev.number, ev.value);
+            break;
+        default:
+            break;
+        }
+        n++;
+    }
+
+    if (n > 0) {
+        midi_core_set_event_source(LAT_SRC_NONE, 0);
+        s_dispatched += n;
+    }
+    return n;
+}
+
+void ctrl_queue_get_stats(ctrl_queue_stats_t *out)
+{
+    if (!out) return;
+
+    out->posted     = s_posted;
+    out->dropped    = s_dropped;
+    out->dispatched = s_dispatched;
+    out->high_water = s_high_water;
+}
@@ -0,0 +1,57 @@
+// ctrl_queue.h - Cola SPSC de eventos de control entre núcleos
+// (core1 = sensores, productor; core0 = USB/MIDI, consumidor)
+#ifndef CTRL_QUEUE_H
+#define CTRL_QUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "midi_core.h"
+
+// Capacidad de la cola (eventos, potencia de 2)
+#define CTRL_QUEUE_SIZE  128u
+
+typedef enum {
+    CTRL_EV_NOTE_ON = 0,
+    CTRL_EV_NOTE_OFF,
+    CTRL_EV_CONTROL        // control continuo (midi_send_control)
+} ctrl_ev_type_t;
+
+// Evento listo para enviar
+typedef struct {
+    uint8_t  type;      // ctrl_ev_type_t
+    uint8_t  channel;
+    uint8_t  mode;      // midi_res_mode_t (sólo CTRL_EV_CONTROL)
+    uint8_t  lat_src;   // fuente para latency_hist (LAT_SRC_NONE = ninguna)
+    uint16_t number;    // nota, CC o parámetro NRPN
+    uint16_t value;     // velocidad (7 bits) o valor de 14 bits
+    uint32_t t0_us;     // instante de adquisición (time_us_32)
+} ctrl_event_t;
+
+typedef struct {
+    uint32_t posted;      // eventos encolados
+    uint32_t dropped;     // eventos descartados con la cola llena
+    uint32_t dispatched;  // eventos entregados a midi_core
+    uint16_t high_water;  // máxima ocupación observada
+} ctrl_queue_stats_t;
+
+void ctrl_queue_init(void);
+
+// ---- Lado productor (sólo core1) ----
+
+// Fuente y marca de tiempo de los eventos que se encolen a continuación
+void ctrl_queue_set_source(uint8_t lat_src, uint32_t t0_us);
+
+// Devuelven false si la cola está llena (el evento se descarta)
+bool ctrl_queue_note_on(uint8_t channel, uint8_t note, uint8_t velocity);
+bool ctrl_queue_note_off(uint8_t channel, uint8_t note, uint8_t velocity);
+bool ctrl_queue_control(uint8_t channel, midi_res_mode_t mode, uint16_t number, uint16_t value14);
+
+// ---- Lado consumidor (sólo core0) ----
+
+// Envía por midi_core como mucho max eventos. Devuelve cuántos salieron.
+uint32_t ctrl_queue_dispatch(uint32_t max);
+
+void ctrl_queue_get_stats(ctrl_queue_stats_t *out);
+
+#endif // CTRL_QUEUE_H
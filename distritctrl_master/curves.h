@@ -0,0 +1,42 @@
+// curves.h - Curvas de respuesta de los controles (tablas en flash)
+//
+// Las tablas las genera gen_curves.py al compilar (curve_lut.c / .h en el
+// directorio de build). Cada lectura es una sola entrada de tabla: el valor
+// crudo de cada control ya es el índice, sin cuentas en el bucle.
+//
+// El precio es flash: cada curva lleva su tabla en los tres dominios, unos
+// 17.6 KB con los rangos por defecto (CURVE_LUT_BYTES da el total). Por eso
+// sólo se generan las curvas de CURVE_NAMES en CMakeLists.txt (por defecto
+// LINEAR, la de todos los controles); con las seis serían ~106 KB.
+#ifndef CURVES_H
+#define CURVES_H
+
+#include <stdint.h>
+
+#include "curve_lut.h"
+
+// Fader (lectura del ADC, 0..4095) -> 14 bits
+static inline uint16_t curve_adc(curve_t c, uint16_t raw)
+{
+    return curve_adc_lut[c][raw & (CURVE_ADC_SIZE - 1u)];
+}
+
+// Pot del SLAVE (0..CURVE_POT_MAX_RAW, más arriba se satura) -> 14 bits
+static inline uint16_t curve_pot(curve_t c, uint16_t raw)
+{
+    if (raw > CURVE_POT_MAX_RAW) raw = CURVE_POT_MAX_RAW;
+    return curve_pot_lut[c][raw];
+}
+
+// Distancia (cm Q16.16) -> 14 bits: CURVE_DIST_MIN_CM o menos = 16383,
+// CURVE_DIST_MAX_CM o más = 0
+static inline uint16_t curve_dist(curve_t c, int32_t d_q16)
+{
+    int32_t i = (d_q16 - (CURVE_DIST_MIN_CM << 16)) >> CURVE_DIST_SHIFT;
+
+    if (i < 0) i = 0;
+    if (i > (int32_t)CURVE_DIST_SIZE - 1) i = (int32_t)CURVE_DIST_SIZE - 1;
+    return curve_dist_lut[c][i];
+}
+
+#endif // CURVES_H
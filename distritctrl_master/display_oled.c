@@ -46,7 +46,7 @@ static const glyph_t font_glyphs[] = {
     // :
     { ':', { 0x00, 0x04, 0x04, 0x00, 0x04, 0x04, 0x00 } },
 
-    // letras que necesitamos: A,B,C,D,K,L,M,O,P,R,S,T,Y
+    // letras que necesitamos: A,B,C,D,I,K,L,M,N,O,P,R,S,T,Y
     { 'A', { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
     { 'B', { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E } },
     { 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } },
@@ -55,6 +55,7 @@ static const glyph_t font_glyphs[] = {
     { 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } },
     { 'L', { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F } },
     { 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+    { 'N', { 0x11, 0x19, 0x15, 0x13, 0x11, 0x11, 0x11 } },
     { 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
     { 'P', { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
     { 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
@@ -250,6 +251,20 @@ void display_task(void) {
     draw_text(4, 32, "CLK");
     draw_clock_icon(g_status.has_clock);
 
+    // Feedback del DAW: último CC y última nota recibidos
+    if (g_status.fb_has_cc) {
+        char fb_text[12];
+        snprintf(fb_text, sizeof(fb_text), "CC%3u:%3u",
+                 (unsigned)g_status.fb_cc, (unsigned)g_status.fb_cc_value);
+        draw_text(64, 18, fb_text);
+    }
+    if (g_status.fb_has_note) {
+        char fb_text[12];
+        snprintf(fb_text, sizeof(fb_text), "NT%3u:%3u",
+                 (unsigned)g_status.fb_note, (unsigned)g_status.fb_velocity);
+        draw_text(64, 32, fb_text);
+    }
+
     // Barra de pasos abajo
     draw_steps_bar(g_status.step, g_status.total_steps);
 
@@ -11,6 +11,14 @@ typedef struct {
     bool     playing;    // ¿Reproduciendo (PLAY) o detenido (STOP)?
     uint8_t  step;       // Paso actual (1..total_steps)
     uint8_t  total_steps; // Total de pasos (típicamente 16)
+
+    // Último feedback recibido del DAW
+    bool     fb_has_cc;   // ¿Llegó algún CC?
+    uint8_t  fb_cc;       // Número de CC
+    uint8_t  fb_cc_value; // Valor del CC
+    bool     fb_has_note; // ¿Llegó alguna nota?
+    uint8_t  fb_note;     // Número de nota
+    uint8_t  fb_velocity; // Velocidad (0 = apagada)
 } controller_status_t;
 
 // Inicializa la OLED (I2C + SH1106)
@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+# gen_curves.py - Genera las tablas de curvas de respuesta (curve_lut.c / .h)
+#
+# Lo llama CMake al compilar: las tablas quedan en flash (const) y cada control
+# pasa de su valor crudo a 14 bits con una sola lectura, sin cuentas en el
+# bucle. Hay una tabla por curva y por dominio de entrada, indexada tal cual
+# llega el dato:
+#
+#   adc   lectura del ADC del RP2040 (faders), 0..4095
+#   pot   pot del SLAVE, 0..POT_MAX (más arriba se satura)
+#   dist  distancia del seguidor de ultrasónicos, en 1/64 cm desde DIST_MIN;
+#         cerca = máximo, lejos = 0
+#
+# Para añadir una curva: una función de [0,1] -> [0,1] en CURVES (el orden es
+# el del enum curve_t). Los tramos de CURVE_BREAKPOINT están en BREAKPOINTS.
+#
+# Cada curva cuesta una tabla por dominio: unos 17.6 KB de flash con los
+# rangos por defecto (adc 8 KB + pot 3.2 KB + dist 6.4 KB). Con --curves sólo
+# se generan las pedidas; curve_t sólo tiene esas, así que usar otra en main.c
+# no compila.
+
+import argparse
+import math
+import os
+
+OUT_MAX = 16383          # 14 bits
+ADC_SIZE = 4096
+DIST_SUBSTEPS = 64       # entradas por cm (índice = d_q16 >> 10)
+
+# Tramos de la curva "breakpoint" (x, y): zona muerta en cada extremo y un
+# centro más suave para ajustar fino
+BREAKPOINTS = [
+    (0.00, 0.00),
+    (0.03, 0.00),
+    (0.50, 0.35),
+    (0.97, 1.00),
+    (1.00, 1.00),
+]
+
+
+def curve_linear(x, args):
+    return x
+
+
+def curve_log(x, args):
+    # Sube rápido al principio (volúmenes, envíos)
+    k = 20.0
+    return math.log1p(k * x) / math.log1p(k)
+
+
+def curve_exp(x, args):
+    # Lenta al principio, rápida al final (cutoff, frecuencias)
+    k = 3.0
+    return math.expm1(k * x) / math.expm1(k)
+
+
+def curve_scurve(x, args):
+    # Plana en los extremos y rápida en el centro (crossfaders)
+    a = 6.0
+    return 0.5 + 0.5 * math.tanh(a * (x - 0.5)) / math.tanh(a / 2.0)
+
+
+def curve_breakpoint(x, args):
+    for (x0, y0), (x1, y1) in zip(BREAKPOINTS, BREAKPOINTS[1:]):
+        if x <= x1:
+            if x1 == x0:
+                return y1
+            return y0 + (y1 - y0) * (x - x0) / (x1 - x0)
+    return BREAKPOINTS[-1][1]
+
+
+def curve_pitch(x, args):
+    # Distancia -> tono: recorre 2 * bend_semis semitonos (todo el pitch bend
+    # con el sinte a ±bend_semis) y se "pega" a cada semitono: plano cerca de
+    # la nota y rápido entre notas, para poder afinar con la mano
+    span = 2.0 * args.bend_semis
+    s = x * span
+    n = math.floor(s + 0.5)
+    f = s - n                                  # -0.5..0.5
+    snapped = n + 0.5 * math.copysign(abs(2.0 * f) ** 3, f)
+    return snapped / span
+
+
+CURVES = [
+    ("LINEAR", curve_linear),
+    ("LOG", curve_log),
+    ("EXP", curve_exp),
+    ("SCURVE", curve_scurve),
+    ("BREAKPOINT", curve_breakpoint),
+    ("PITCH", curve_pitch),
+]
+
+
+def to14(y):
+    v = int(round(min(max(y, 0.0), 1.0) * OUT_MAX))
+    return min(max(v, 0), OUT_MAX)
+
+
+def domain_adc(fn, args):
+    return [to14(fn(i / (ADC_SIZE - 1), args)) for i in range(ADC_SIZE)]
+
+
+def domain_pot(fn, args):
+    return [to14(fn(i / args.pot_max, args)) for i in range(args.pot_max + 1)]
+
+
+def domain_dist(fn, args):
+    n = (args.dist_max_cm - args.dist_min_cm) * DIST_SUBSTEPS
+    # índice 0 = DIST_MIN (lo más cerca) = máximo
+    return [to14(fn(1.0 - i / n, args)) for i in range(n + 1)]
+
+
+DOMAINS = [
+    ("adc", "CURVE_ADC_SIZE", domain_adc),
+    ("pot", "CURVE_POT_SIZE", domain_pot),
+    ("dist", "CURVE_DIST_SIZE", domain_dist),
+]
+
+
+def write_table(f, name, size_macro, rows):
+    f.write("const uint16_t curve_%s_lut[CURVE_COUNT][%s] = {\n" % (name, size_macro))
+    for cname, values in rows:
+        f.write("    [CURVE_%s] = {\n" % cname)
+        for i in range(0, len(values), 16):
+            f.write("        " + ", ".join("%5d" % v for v in values[i:i + 16]) + ",\n")
+        f.write("    },\n")
+    f.write("};\n\n")
+
+
+def main():
+    p = argparse.ArgumentParser(description="Genera curve_lut.c / curve_lut.h")
+    p.add_argument("--out", required=True, help="directorio de salida")
+    p.add_argument("--pot-max", type=int, default=1600)
+    p.add_argument("--dist-min-cm", type=int, default=10)
+    p.add_argument("--dist-max-cm", type=int, default=60)
+    p.add_argument("--bend-semis", type=int, default=12)
+    p.add_argument("--curves", default=",".join(c for c, _ in CURVES),
+                   help="curvas a generar, separadas por comas (por defecto todas)")
+    args = p.parse_args()
+
+    if args.pot_max <= 0 or args.dist_max_cm <= args.dist_min_cm or args.bend_semis <= 0:
+        p.error("rangos inválidos")
+
+    wanted = {c.strip().upper() for c in args.curves.split(",") if c.strip()}
+    unknown = wanted - {c for c, _ in CURVES}
+    if not wanted or unknown:
+        p.error("curvas desconocidas o ninguna: %s" % ", ".join(sorted(unknown)))
+    curves = [(c, fn) for c, fn in CURVES if c in wanted]
+
+    sizes = {
+        "CURVE_ADC_SIZE": ADC_SIZE,
+        "CURVE_POT_SIZE": args.pot_max + 1,
+        "CURVE_DIST_SIZE": (args.dist_max_cm - args.dist_min_cm) * DIST_SUBSTEPS + 1,
+    }
+
+    os.makedirs(args.out, exist_ok=True)
+
+    with open(os.path.join(args.out, "curve_lut.h"), "w", newline="\n") as f:
+        f.write("// curve_lut.h - GENERADO por gen_curves.py, no editar\n")
+        f.write("#ifndef CURVE_LUT_H\n#define CURVE_LUT_H\n\n")
+        f.write("#include <stdint.h>\n\n")
+        f.write("typedef enum {\n")
+        for cname, _ in curves:
+            f.write("    CURVE_%s,\n" % cname)
+        f.write("    CURVE_COUNT\n} curve_t;\n\n")
+        f.write("#define CURVE_POT_MAX_RAW      %du\n" % args.pot_max)
+        f.write("#define CURVE_DIST_MIN_CM      %d\n" % args.dist_min_cm)
+        f.write("#define CURVE_DIST_MAX_CM      %d\n" % args.dist_max_cm)
+        f.write("#define CURVE_DIST_SHIFT       10   // cm Q16.16 -> 1/%d cm\n" % DIST_SUBSTEPS)
+        f.write("#define CURVE_PITCH_BEND_SEMIS %d\n\n" % args.bend_semis)
+        for macro, size in sizes.items():
+            f.write("#define %-22s %du\n" % (macro, size))
+        f.write("\n// Flash de todas las tablas (%d curvas)\n" % len(curves))
+        f.write("#define %-22s %du\n\n" % ("CURVE_LUT_BYTES", len(curves) * 2 * sum(sizes.values())))
+        for name, size_macro, _ in DOMAINS:
+            f.write("extern const uint16_t curve_%s_lut[CURVE_COUNT][%s];\n" % (name, size_macro))
+        f.write("\n#endif // CURVE_LUT_H\n")
+
+    with open(os.path.join(args.out, "curve_lut.c"), "w", newline="\n") as f:
+        f.write("// curve_lut.c - GENERADO por gen_curves.py, no editar\n")
+        f.write("#include \"curve_lut.h\"\n\n")
+        for name, size_macro, fn in DOMAINS:
+            rows = [(cname, fn(cfn, args)) for cname, cfn in curves]
+            for cname, values in rows:
+                assert len(values) == sizes[size_macro], (name, cname)
+            write_table(f, name, size_macro, rows)
+
+
+if __name__ == "__main__":
+    main()
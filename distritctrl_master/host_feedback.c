@@ -0,0 +1,76 @@
+// host_feedback.c - Feedback del DAW (notas/CC entrantes) hacia anillo LED y OLED
+//
+// Las notas HOST_FEEDBACK_NOTE_BASE..+15 en HOST_FEEDBACK_CHANNEL encienden el
+// LED correspondiente (brillo según velocidad), típico para estado de clips.
+// El último CC/nota recibidos se guardan para mostrarlos en la OLED.
+
+#include "host_feedback.h"
+#include "led_ring.h"
+
+#include <string.h>
+
+// Brillo máximo del fondo: por debajo del cursor del secuenciador (60)
+#define HOST_FEEDBACK_MAX_LEVEL  40u
+
+static uint8_t               s_led_level[LED_RING_NUM_LEDS];
+static volatile bool         s_dirty = false;
+static host_feedback_state_t s_state;
+
+void host_feedback_init(void)
+{
+    memset(s_led_level, 0, sizeof(s_led_level));
+    memset(&s_state, 0, sizeof(s_state));
+    s_dirty = true;
+}
+
+void host_feedback_on_note(uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    if (channel != HOST_FEEDBACK_CHANNEL) return;
+
+    s_state.has_note = true;
+    s_state.note     = note;
+    s_state.velocity = velocity;
+
+    if (note < HOST_FEEDBACK_NOTE_BASE ||
+        note >= HOST_FEEDBACK_NOTE_BASE + LED_RING_NUM_LEDS) {
+        return;
+    }
+
+    uint8_t level = (uint8_t)(((uint16_t)velocity * HOST_FEEDBACK_MAX_LEVEL) / 127u);
+    uint8_t idx   = (uint8_t)(note - HOST_FEEDBACK_NOTE_BASE);
+
+    if (s_led_level[idx] != level) {
+        s_led_level[idx] = level;
+        s_dirty = true;
+    }
+}
+
+void host_feedback_on_cc(uint8_t channel, uint8_t cc, uint8_t value)
+{
+    if (channel != HOST_FEEDBACK_CHANNEL) return;
+
+    s_state.has_cc    = true;
+    s_state.cc_number = cc;
+    s_state.cc_value  = value;
+}
+
+void host_feedback_paint_ring(void)
+{
+    for (uint i = 0; i < LED_RING_NUM_LEDS; i++) {
+        // Feedback en azul para distinguirlo del cursor verde del secuenciador
+        led_ring_set_pixel(i, 0, 0, s_led_level[i]);
+    }
+}
+
+bool host_feedback_take_dirty(void)
+{
+    bool d  = s_dirty;
+    s_dirty = false;
+    return d;
+}
+
+void host_feedback_get_state(host_feedback_state_t *out)
+{
+    if (!out) return;
+    *out = s_state;
+}
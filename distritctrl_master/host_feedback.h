@@ -0,0 +1,42 @@
+// host_feedback.h - Feedback del DAW (notas/CC entrantes) hacia anillo LED y OLED
+#ifndef HOST_FEEDBACK_H
+#define HOST_FEEDBACK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Canal MIDI (0..15) en el que el DAW manda el feedback. Va aparte de los
+// que usa el propio controlador (botones y pots: un canal por slave desde
+// el 0), para que el eco de nuestras notas no se pinte como feedback. Se
+// puede cambiar con -DHOST_FEEDBACK_CHANNEL=n; main.c comprueba que no pise.
+#ifndef HOST_FEEDBACK_CHANNEL
+#define HOST_FEEDBACK_CHANNEL    15
+#endif
+// Nota que corresponde al LED 0 del anillo (16 notas seguidas -> 16 LEDs)
+#define HOST_FEEDBACK_NOTE_BASE  60
+
+// Último feedback recibido, para la OLED
+typedef struct {
+    bool    has_cc;
+    uint8_t cc_number;
+    uint8_t cc_value;
+    bool    has_note;
+    uint8_t note;
+    uint8_t velocity;   // 0 = nota apagada
+} host_feedback_state_t;
+
+void host_feedback_init(void);
+
+// Entradas desde el parser MIDI (contexto del main loop)
+void host_feedback_on_note(uint8_t channel, uint8_t note, uint8_t velocity);
+void host_feedback_on_cc(uint8_t channel, uint8_t cc, uint8_t value);
+
+// Pinta en el buffer del anillo el fondo de feedback (no llama a led_ring_show)
+void host_feedback_paint_ring(void);
+
+// true si el fondo cambió desde la última llamada (y limpia la marca)
+bool host_feedback_take_dirty(void);
+
+void host_feedback_get_state(host_feedback_state_t *out);
+
+#endif // HOST_FEEDBACK_H
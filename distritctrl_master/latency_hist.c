@@ -0,0 +1,144 @@
+// latency_hist.c - Histogramas de latencia entrada -> USB por fuente de control
+//
+// Tablas fijas (sin memoria dinámica): fuente x tramo x bucket log2. Registrar
+// una muestra es un clz y un incremento. El tramo previo al master (debounce
+// y periodo de 5 ms del slave, transmisión UART) no se puede medir aquí porque
+// el slave no tiene la misma base de tiempos; para botones y pots el origen es
+// la llegada del frame al master.
+
+#include "latency_hist.h"
+
+#include "pico/time.h"
+#include "hardware/sync.h"
+
+#include <string.h>
+
+static uint32_t s_hist[LAT_SRC_COUNT][LAT_STAGE_COUNT][LAT_HIST_BUCKETS];
+
+// ----------------------------
+// Funciones internas
+// ----------------------------
+
+static inline uint8_t latency_hist_bucket(uint32_t dt_us)
+{
+    // floor(log2(dt)), con 0 y 1 en el bucket 0
+    uint8_t b = (uint8_t)(31 - __builtin_clz(dt_us | 1u));
+    return (b < LAT_HIST_BUCKETS) ? b : (LAT_HIST_BUCKETS - 1);
+}
+
+// ----------------------------
+// API pública
+// ----------------------------
+
+void latency_hist_init(void)
+{
+    latency_hist_reset();
+}
+
+void latency_hist_reset(void)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    memset(s_hist, 0, sizeof(s_hist));
+    restore_interrupts(irq);
+}
+
+void latency_hist_record(uint8_t src, uint8_t stage, uint32_t dt_us)
+{
+    if (src >= LAT_SRC_COUNT || stage >= LAT_STAGE_COUNT) return;
+
+    uint32_t *b = &s_hist[src][stage][latency_hist_bucket(dt_us)];
+
+    // El incremento es leer-sumar-escribir: una IRQ que registre en medio se
+    // perdería. Con las IRQ enmascaradas son tres instrucciones
+    uint32_t irq = save_and_disable_interrupts();
+    (*b)++;
+    restore_interrupts(irq);
+}
+
+void latency_hist_mark_queued(lat_tag_t *tag)
+{
+    if (tag->src == LAT_SRC_NONE) return;
+
+    tag->tq_us = time_us_32();
+    latency_hist_record(tag->src, LAT_STAGE_INPUT, tag->tq_us - tag->t0_us);
+}
+
+void latency_hist_mark_sent(const lat_tag_t *tag)
+{
+    if (tag->src == LAT_SRC_NONE) return;
+
+    uint32_t now = time_us_32();
+    latency_hist_record(tag->src, LAT_STAGE_OUTPUT, now - tag->tq_us);
+    latency_hist_record(tag->src, LAT_STAGE_TOTAL,  now - tag->t0_us);
+}
+
+void latency_hist_get(uint8_t src, uint8_t stage, uint32_t out[LAT_HIST_BUCKETS])
+{
+    if (!out) return;
+
+    if (src >= LAT_SRC_COUNT || stage >= LAT_STAGE_COUNT) {
+        memset(out, 0, LAT_HIST_BUCKETS * sizeof(uint32_t));
+        return;
+    }
+
+    uint32_t irq = save_and_disable_interrupts();
+    memcpy(out, s_hist[src][stage], LAT_HIST_BUCKETS * sizeof(uint32_t));
+    restore_interrupts(irq);
+}
+
+bool latency_hist_parse_sysex(const uint8_t *data, uint16_t len, uint8_t *dump_mask)
+{
+    if (!data || len < 5) return false;
+    if (data[0] != 0xF0 || data[1] != LAT_SYSEX_MANUF || data[2] != LAT_SYSEX_DEVICE) return false;
+    if (data[len - 1] != 0xF7) return false;
+
+    switch (data[3]) {
+    case LAT_SYSEX_CMD_DUMP:
+        if (len < 6) return false;
+        if (data[4] == LAT_SYSEX_ALL) {
+            *dump_mask = (uint8_t)((1u << LAT_SRC_COUNT) - 1u);
+        } else if (data[4] < LAT_SRC_COUNT) {
+            *dump_mask = (uint8_t)(1u << data[4]);
+        } else {
+            return false;
+        }
+        return true;
+
+    case LAT_SYSEX_CMD_RESET:
+        latency_hist_reset();
+        *dump_mask = 0;
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+size_t latency_hist_build_sysex(uint8_t src, uint8_t *buf, size_t cap)
+{
+    if (!buf || src >= LAT_SRC_COUNT || cap < LAT_SYSEX_REPLY_LEN) return 0;
+
+    size_t n = 0;
+    buf[n++] = 0xF0;
+    buf[n++] = LAT_SYSEX_MANUF;
+    buf[n++] = LAT_SYSEX_DEVICE;
+    buf[n++] = LAT_SYSEX_CMD_REPLY;
+    buf[n++] = src;
+    buf[n++] = LAT_STAGE_COUNT;
+    buf[n++] = LAT_HIST_BUCKETS;
+
+    uint32_t counts[LAT_HIST_BUCKETS];
+    for (uint8_t st = 0; st < LAT_STAGE_COUNT; st++) {
+        latency_hist_get(src, st, counts);
+        for (uint8_t b = 0; b < LAT_HIST_BUCKETS; b++) {
+            uint32_t c = (counts[b] > 0x0FFFFFFFu) ? 0x0FFFFFFFu : counts[b];
+            buf[n++] = (uint8_t)((c >> 21) & 0x7F);
+            buf[n++] = (uint8_t)((c >> 14) & 0x7F);
+            buf[n++] = (uint8_t)((c >> 7)  & 0x7F);
+            buf[n++] = (uint8_t)(c & 0x7F);
+        }
+    }
+
+    buf[n++] = 0xF7;
+    return n;
+}
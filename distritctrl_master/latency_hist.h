@@ -0,0 +1,89 @@
+// latency_hist.h - Histogramas de latencia entrada -> USB por fuente de control
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Fuentes de control medidas
+typedef enum {
+    LAT_SRC_BUTTON = 0,   // botones del slave (desde la llegada del frame UART)
+    LAT_SRC_POT,          // pots del slave (desde la llegada del frame UART)
+    LAT_SRC_FADER,        // faders del master (desde la lectura del ADC)
+    LAT_SRC_ULTRA,        // ultrasonidos (desde el flanco de bajada del eco)
+    LAT_SRC_COUNT
+} lat_src_t;
+
+#define LAT_SRC_NONE  0xFF
+
+// Tramos medidos
+typedef enum {
+    LAT_STAGE_INPUT = 0,  // adquisición -> evento MIDI encolado
+    LAT_STAGE_OUTPUT,     // evento encolado -> paquete en el FIFO de TinyUSB
+    LAT_STAGE_TOTAL,      // adquisición -> paquete en el FIFO de TinyUSB
+    LAT_STAGE_COUNT
+} lat_stage_t;
+
+// Buckets log2 en us: el bucket b cuenta [2^b, 2^(b+1)); el 0 incluye 0 us
+// y el último todo lo que pase de 2^(LAT_HIST_BUCKETS-1) us (~32 ms)
+#define LAT_HIST_BUCKETS  16
+
+// Marca que viaja con cada evento hasta que sale por USB
+typedef struct {
+    uint8_t  src;     // lat_src_t o LAT_SRC_NONE
+    uint32_t t0_us;   // instante de adquisición (time_us_32)
+    uint32_t tq_us;   // instante en que se encoló el evento MIDI
+} lat_tag_t;
+
+// ---- SysEx de consulta (fabricante 0x7D = uso no comercial) ----
+//  Petición : F0 7D 01 01 <fuente | 7F = todas> F7
+//  Reset    : F0 7D 01 03 F7
+//  Respuesta: F0 7D 01 02 <fuente> <tramos> <buckets> <contadores> F7
+//             cada contador en 4 bytes de 7 bits (MSB primero, satura a 2^28-1),
+//             por tramo y luego por bucket
+#define LAT_SYSEX_MANUF      0x7D
+#define LAT_SYSEX_DEVICE     0x01
+#define LAT_SYSEX_ALL        0x7F
+
+// Tabla única de comandos bajo F0 7D 01: cada módulo usa los suyos desde
+// aquí, para que no se pisen (una respuesta tampoco puede ser una petición)
+#define LAT_SYSEX_CMD_DUMP          0x01   // latency_hist
+#define LAT_SYSEX_CMD_REPLY         0x02
+#define LAT_SYSEX_CMD_RESET         0x03
+#define LAT_SYSEX_CMD_SCHED_REPORT  0x04   // task_sched
+#define LAT_SYSEX_CMD_SCHED_REPLY   0x05
+#define LAT_SYSEX_CMD_SLAVE_PARAM   0x06   // slave_link
+#define LAT_SYSEX_CMD_SLAVE_SNAP    0x07
+#define LAT_SYSEX_CMD_SCHED_CYCLES  0x08   // task_sched
+#define LAT_SYSEX_CMD_SCHED_CYC_REP 0x09
+#define LAT_SYSEX_CMD_CLOCK         0x0A   // clock_gen
+#define LAT_SYSEX_CMD_CLOCK_REPLY   0x0B
+
+// Tamaño de una respuesta SysEx (una fuente)
+#define LAT_SYSEX_REPLY_LEN  (8u + LAT_STAGE_COUNT * LAT_HIST_BUCKETS * 4u)
+
+void latency_hist_init(void);
+void latency_hist_reset(void);
+
+// Suma una muestra al histograma (unos pocos ciclos). Seguro desde IRQ de
+// core0; como la cola TX de midi_core, sólo se registra en core0
+void latency_hist_record(uint8_t src, uint8_t stage, uint32_t dt_us);
+
+// El evento marcado se encola ahora: guarda tq y registra LAT_STAGE_INPUT
+void latency_hist_mark_queued(lat_tag_t *tag);
+
+// El evento marcado entra en el FIFO USB ahora: registra OUTPUT y TOTAL
+void latency_hist_mark_sent(const lat_tag_t *tag);
+
+// Copia un histograma
+void latency_hist_get(uint8_t src, uint8_t stage, uint32_t out[LAT_HIST_BUCKETS]);
+
+// Interpreta un SysEx recibido (F0..F7). Devuelve true si era para nosotros;
+// en *dump_mask deja los bits (1 << fuente) a volcar (0 si era un reset).
+bool latency_hist_parse_sysex(const uint8_t *data, uint16_t len, uint8_t *dump_mask);
+
+// Construye la respuesta SysEx de una fuente. Devuelve su longitud (0 si no cabe).
+size_t latency_hist_build_sysex(uint8_t src, uint8_t *buf, size_t cap);
+
+#endif // LATENCY_HIST_H
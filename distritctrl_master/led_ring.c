@@ -78,6 +78,15 @@ static uint led_offset   = 0;
 // Guardamos los colores en formato R,G,B por LED
 static uint8_t led_buffer[LED_RING_NUM_LEDS * 3];
 
+// Latch del WS2812: la línea tiene que quedarse a 0 unos 300 us después del
+// último bit. En vez de dormir tras cada envío, apuntamos cuándo termina y
+// sólo esperamos si el siguiente envío llega antes.
+#define LED_RING_LATCH_US    300u
+#define LED_RING_PIXEL_US    30u     // 24 bits a 800 kHz
+#define LED_RING_FIFO_DEPTH  8u      // píxeles que pueden quedar en el FIFO TX del PIO (unido, 8 palabras)
+
+static uint64_t led_latch_until_us = 0;
+
 static inline void put_pixel(uint32_t pixel_grb) {
     // El programa PIO espera 24 bits alineados en los 24 MSB.
     // Enviamos 32 bits pero desplazando 8: GRB << 8.
@@ -126,6 +135,12 @@ void led_ring_clear(void)
 // Envía el buffer completo al anillo
 void led_ring_show(void)
 {
+    // Latch del envío anterior todavía en curso
+    uint64_t now = time_us_64();
+    if (now < led_latch_until_us) {
+        busy_wait_us_32((uint32_t)(led_latch_until_us - now));
+    }
+
     for (uint i = 0; i < LED_RING_NUM_LEDS; i++) {
         uint idx = i * 3;
         uint8_t r = led_buffer[idx + 0];
@@ -140,6 +155,7 @@ void led_ring_show(void)
         put_pixel(grb);
     }
 
-    // Tiempo de latch mínimo ~300 µs
-    sleep_us(300);
+    // Lo que queda en el FIFO más el píxel en curso, y luego el latch
+    led_latch_until_us = time_us_64() +
+                         (LED_RING_FIFO_DEPTH + 1u) * LED_RING_PIXEL_US + LED_RING_LATCH_US;
 }
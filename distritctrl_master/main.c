@@ -8,9 +8,13 @@
  * - Leer 2 sensores ultrasónicos HC-SR04 (alimentados a 3.3 V) y mapearlos a CC MIDI tipo "theremin".
  * - Enviar mensajes MIDI (notas + CC) hacia el computador vía USB (TinyUSB).
  * - Actualizar la pantalla OLED con el estado del step sequencer y BPM.
+ *
+ * Reparto entre núcleos: core1 adquiere sensores (SLAVE, faders, ultrasónicos)
+ * y genera eventos; core0 atiende USB/MIDI, secuenciador, clock y UI.
  */
 
 #include "pico/stdlib.h"
+#include "pico/multicore.h"
 #include "hardware/timer.h"
 #include "hardware/adc.h"
 
@@ -20,6 +24,13 @@
 #include "display_oled.h"
 #include "slave_link.h"
 #include "ultra_driver.h"   ///< Driver para los sensores ultrasónicos
+#include "ultra_track.h"    ///< Seguimiento alfa-beta de cada ultrasónico
+#include "curves.h"         ///< Curvas de respuesta (tablas generadas al compilar)
+#include "host_feedback.h"  ///< Feedback de notas/CC que manda el DAW
+#include "clock_gen.h"      ///< Clock interno (alarma hardware) y arbitraje de fuente
+#include "latency_hist.h"   ///< Fuentes para los histogramas de latencia
+#include "ctrl_queue.h"     ///< Eventos de sensores core1 -> core0
+#include "task_sched.h"     ///< Planificador por deadlines (uno por núcleo)
 
 // -----------------------------------------------------------------------------
 //  Configuración general y mapeos MIDI
@@ -34,6 +45,9 @@
 /** @brief LED de debug en el MASTER (Pico W no tiene PICO_DEFAULT_LED_PIN "normal"). */
 #define DEBUG_LED_PIN 15   // pin GPIO con LED + resistencia a GND
 
+/** @brief Marca de "todavía no se envió nada" para los valores previos de 14 bits. */
+#define CTRL_NO_VALUE  0xFFFFu
+
 // ---------------- FADERS EN EL MASTER (ADC interno) ----------------
 
 /** @brief Número de faders analógicos conectados al MASTER. */
@@ -44,16 +58,38 @@ static const uint8_t fader_gpio[NUM_FADERS]      = {26, 27, 28};
 /** @brief Canal ADC correspondiente a cada GPIO de fader (ADC0, ADC1, ADC2). */
 static const uint8_t fader_adc_input[NUM_FADERS] = {0,  1,  2};
 
-/** @brief Números de CC MIDI asignados a cada fader del MASTER. */
+/** @brief Números de CC MIDI asignados a cada fader del MASTER (en 14 bits: CC n / n+32). */
 static const uint8_t fader_cc[NUM_FADERS]        = {10, 11, 12};
 
 /**
- * @brief Último valor de CC enviado para cada fader.
+ * @brief Resolución de salida de cada fader (ver midi_res_mode_t).
+ *
+ * Por defecto CC de 7 bits, lo que entiende cualquier DAW. MIDI_RES_CC14 usa
+ * además el CC n+32 como LSB: sólo si el destino lo mapea como 14 bits.
+ */
+static const midi_res_mode_t fader_mode[NUM_FADERS] = {
+    MIDI_RES_7BIT, MIDI_RES_7BIT, MIDI_RES_7BIT
+};
+
+/**
+ * @brief Curva de respuesta de cada fader (ver curve_t y gen_curves.py).
+ *
+ * CURVE_LINEAR, CURVE_LOG (volúmenes), CURVE_EXP (cutoff), CURVE_SCURVE
+ * (crossfader), CURVE_BREAKPOINT (tramos de gen_curves.py) o CURVE_PITCH.
+ * Sólo existen las de CURVE_NAMES (CMakeLists.txt): cada curva son ~17.6 KB
+ * de tablas en flash, así que para usar otra hay que añadirla allí.
+ */
+static const curve_t fader_curve[NUM_FADERS] = {
+    CURVE_LINEAR, CURVE_LINEAR, CURVE_LINEAR
+};
+
+/**
+ * @brief Último valor (14 bits) enviado para cada fader.
  *
  * Se usa para evitar enviar mensajes de control cuando el cambio es muy pequeño
  * (reduce ruido y tráfico MIDI).
  */
-static uint8_t prev_fader_cc[NUM_FADERS]         = {0xFF, 0xFF, 0xFF};
+static uint16_t prev_fader_v14[NUM_FADERS]       = {CTRL_NO_VALUE, CTRL_NO_VALUE, CTRL_NO_VALUE};
 
 /**
  * @brief Umbral mínimo de cambio (en pasos de CC) para reenviar un mensaje MIDI.
@@ -63,11 +99,27 @@ static uint8_t prev_fader_cc[NUM_FADERS]         = {0xFF, 0xFF, 0xFF};
  */
 #define FADER_CC_THRESHOLD  2u   // sube a 3 si sigue muy sensible
 
+/**
+ * @brief Umbral de cambio en modos de 14 bits (pasos de 14 bits).
+ *
+ * 16 pasos de 14 bits = 4 LSB del ADC de 12 bits: filtra el ruido del ADC interno.
+ */
+#define FADER_HIRES_THRESHOLD  16u
+
 // ---------------- ULTRASONIDOS (THEREMIN) ----------------
 
 /** @brief Canal MIDI usado para los CC de los sensores ultrasónicos. */
 #define ULTRA_MIDI_CHANNEL  0
 
+/**
+ * @brief Rango de juego de los ultrasónicos (cm): cerca = máximo, lejos = 0.
+ *
+ * ULTRA_D_MAX_CM también acota el timeout del eco (ultra_driver_set_range_cm):
+ * más allá la mano está "fuera" y el sensor pasa al siguiente disparo.
+ */
+#define ULTRA_D_MIN_CM  10
+#define ULTRA_D_MAX_CM  60
+
 /**
  * @brief Números de CC MIDI asignados a cada sensor ultrasónico.
  *
@@ -76,8 +128,40 @@ static uint8_t prev_fader_cc[NUM_FADERS]         = {0xFF, 0xFF, 0xFF};
  */
 static const uint8_t ultra_cc[ULTRA_NUM_SENSORS] = {30, 31};
 
-/** @brief Último valor de CC enviado por cada sensor ultrasónico. */
-static uint8_t prev_ultra_cc[ULTRA_NUM_SENSORS]  = {0xFF, 0xFF};
+/**
+ * @brief Resolución de salida de cada sensor ultrasónico.
+ *
+ * Por defecto CC de 7 bits (ultra_cc). Para un theremin, MIDI_RES_PITCH_BEND
+ * (14 bits, ignora ultra_cc; mejor con CURVE_PITCH) o MIDI_RES_CC14 (CC n /
+ * n+32). Para dos theremins a la vez, ambos en pitch bend con canales
+ * distintos.
+ */
+static const midi_res_mode_t ultra_mode[ULTRA_NUM_SENSORS] = {
+    MIDI_RES_7BIT, MIDI_RES_7BIT
+};
+
+/** @brief Último valor (14 bits) enviado por cada sensor ultrasónico. */
+static uint16_t prev_ultra_v14[ULTRA_NUM_SENSORS] = {CTRL_NO_VALUE, CTRL_NO_VALUE};
+
+/**
+ * @brief Curva de respuesta de cada sensor ultrasónico sobre ULTRA_D_MIN_CM..
+ * ULTRA_D_MAX_CM (cerca = máximo).
+ *
+ * CURVE_PITCH recorre ±CURVE_PITCH_BEND_SEMIS semitonos pegándose a cada
+ * nota: pensada para el pitch bend con el sinte a ese rango.
+ */
+static const curve_t ultra_curve[ULTRA_NUM_SENSORS] = {
+    CURVE_LINEAR, CURVE_LINEAR
+};
+
+/** @brief Umbral de cambio de los ultrasónicos en modos de 14 bits. */
+#define ULTRA_HIRES_THRESHOLD  8u
+
+/** @brief Periodo de salida de los ultrasónicos (remuestreo del seguidor). */
+#define ULTRA_OUT_PERIOD_US    1000u
+
+/** @brief Hora (sample_us) de la última medida de cada sensor pasada al seguidor. */
+static uint32_t ultra_fed_us[ULTRA_NUM_SENSORS];
 
 // -----------------------------------------------------------------------------
 //  Estado de UI y mapeos de botones / pots del SLAVE
@@ -91,20 +175,109 @@ static const uint8_t arcade_notes[4] = {60, 61, 62, 63}; // C4, C#4, D4, D#4
 /** @brief Notas MIDI asociadas a los 4 botones "normales" del SLAVE. */
 static const uint8_t normal_notes[4] = {64, 65, 66, 67}; // E4, F4, F#4, G4
 
-/** @brief Máscara anterior de los botones arcade (para detectar flancos). */
-static uint8_t prev_arcade_mask = 0;
-/** @brief Máscara anterior de los botones normales (para detectar flancos). */
-static uint8_t prev_normal_mask = 0;
+/**
+ * @brief Retardo de reproducción de los flancos con hora del SLAVE.
+ *
+ * Cada flanco se toca en su hora original (cambio crudo del pin en el slave)
+ * más este retardo, así dos golpes separados 3 ms salen separados 3 ms por
+ * USB aunque el antirrebote, el UART y el periodo de task_slave los junten o
+ * separen. El retardo se adapta a lo tarde que llegan los flancos (lo domina
+ * el antirrebote del slave, 5 ms por defecto): sube al momento si uno llega
+ * más tarde y baja despacio. Con SLAVE_EDGE_DELAY_MAX_US = 0 los flancos
+ * salen en cuanto llegan (mínima latencia, sin respetar el ritmo original).
+ */
+#define SLAVE_EDGE_DELAY_MAX_US    20000u
+#define SLAVE_EDGE_DELAY_MARGIN_US 500u
+#define SLAVE_EDGE_DELAY_DECAY     16u    // baja 1/16 de la diferencia por flanco
+
+/** @brief Flanco esperando su hora de salida. */
+typedef struct {
+    uint8_t  slave;      // índice del slave = canal MIDI de sus notas
+    uint8_t  button;     // 0..3 arcade, 4..7 normales
+    bool     pressed;
+    uint64_t t_us;       // hora del flanco (base de tiempo del master)
+    uint64_t due_us;     // cuándo sale
+} btn_pending_t;
+
+#define BTN_PENDING_SIZE 16u   // potencia de 2
+#define BTN_RETRY_US     250u  // ctrl_queue llena: reintentar el mismo flanco
+
+static btn_pending_t btn_pending[BTN_PENDING_SIZE];
+static uint8_t  btn_pending_head = 0;
+static uint8_t  btn_pending_tail = 0;
+static uint32_t btn_delay_us     = 0;
 
 /** @brief Números de CC MIDI para los 4 pots conectados al SLAVE (via ADS1115). */
 static const uint8_t pot_cc[4]      = {20, 21, 22, 23};
-/** @brief Último valor de CC enviado para cada pot del SLAVE. */
-static uint8_t       prev_pot_cc[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+/** @brief Resolución de salida de cada pot del SLAVE (ver fader_mode). */
+static const midi_res_mode_t pot_mode[4] = {
+    MIDI_RES_7BIT, MIDI_RES_7BIT, MIDI_RES_7BIT, MIDI_RES_7BIT
+};
+/** @brief Curva de respuesta de cada pot del SLAVE (ver fader_curve). */
+static const curve_t pot_curve[4] = {
+    CURVE_LINEAR, CURVE_LINEAR, CURVE_LINEAR, CURVE_LINEAR
+};
+
+// Las tablas se generan con los rangos de CMakeLists.txt: tienen que ser estos
+_Static_assert(CURVE_POT_MAX_RAW == SLAVE_POT_MAX_RAW12,
+               "CURVE_POT_MAX_RAW (CMakeLists.txt) != SLAVE_POT_MAX_RAW12");
+_Static_assert(CURVE_DIST_MIN_CM == ULTRA_D_MIN_CM && CURVE_DIST_MAX_CM == ULTRA_D_MAX_CM,
+               "CURVE_DIST_*_CM (CMakeLists.txt) != ULTRA_D_*_CM");
+// El feedback del DAW no puede compartir canal con lo que mandamos nosotros:
+// botones y pots van por SLAVE_POTS_MIDI_CHANNEL + slave, faders por el 0
+_Static_assert(HOST_FEEDBACK_CHANNEL <= 15 &&
+               HOST_FEEDBACK_CHANNEL != ULTRA_MIDI_CHANNEL &&
+               HOST_FEEDBACK_CHANNEL >= SLAVE_LINK_MAX_SLAVES &&
+               HOST_FEEDBACK_CHANNEL >= SLAVE_POTS_MIDI_CHANNEL + SLAVE_LINK_MAX_SLAVES,
+               "HOST_FEEDBACK_CHANNEL pisa un canal de salida del controlador");
+/**
+ * @brief Último valor (14 bits) enviado para cada pot de cada SLAVE. Se pone
+ * a CTRL_NO_VALUE mientras el slave no está vivo (también al arrancar).
+ */
+static uint16_t      prev_pot_v14[SLAVE_LINK_MAX_SLAVES][4];
+
+/** @brief Umbral de cambio de los pots en modos de 14 bits. */
+#define POT_HIRES_THRESHOLD  16u
 
 // -----------------------------------------------------------------------------
 //  Callbacks y funciones internas
 // -----------------------------------------------------------------------------
 
+/**
+ * @brief Encola (hacia core0) un control continuo si cambió lo suficiente.
+ *
+ * El umbral se aplica en la resolución real de salida: en 7 bits se comparan
+ * pasos de CC (thr7) y en los modos de 14 bits pasos de 14 bits (thr14).
+ *
+ * @param ch      Canal MIDI (0..15).
+ * @param mode    Resolución de salida.
+ * @param number  CC (o parámetro NRPN).
+ * @param v14     Valor actual en 14 bits (0..16383).
+ * @param prev    Último valor enviado (CTRL_NO_VALUE = ninguno); se actualiza.
+ * @param thr7    Umbral en pasos de 7 bits.
+ * @param thr14   Umbral en pasos de 14 bits.
+ */
+static void send_control_if_changed(uint8_t ch, midi_res_mode_t mode, uint16_t number,
+                                    uint16_t v14, uint16_t *prev,
+                                    uint16_t thr7, uint16_t thr14)
+{
+    if (*prev != CTRL_NO_VALUE) {
+        uint16_t a, b, thr;
+        if (mode == MIDI_RES_7BIT) {
+            a = v14 >> 7;  b = *prev >> 7;  thr = thr7;
+        } else {
+            a = v14;       b = *prev;       thr = thr14;
+        }
+        uint16_t diff = (a > b) ? (a - b) : (b - a);
+        if (diff < thr) return;
+    }
+
+    // Si la cola hacia core0 está llena, no damos el valor por enviado
+    if (ctrl_queue_control(ch, mode, number, v14)) {
+        *prev = v14;
+    }
+}
+
 /**
  * @brief Callback periódico para actualizar la UI (OLED).
  *
@@ -137,6 +310,16 @@ static bool ui_timer_cb(repeating_timer_t *t)
     ui_status.step        = (uint8_t)(cur_step + 1); // 1..16 para la pantalla
     ui_status.total_steps = 16;
 
+    // Último feedback del DAW (notas / CC entrantes)
+    host_feedback_state_t fb;
+    host_feedback_get_state(&fb);
+    ui_status.fb_has_cc   = fb.has_cc;
+    ui_status.fb_cc       = fb.cc_number;
+    ui_status.fb_cc_value = fb.cc_value;
+    ui_status.fb_has_note = fb.has_note;
+    ui_status.fb_note     = fb.note;
+    ui_status.fb_velocity = fb.velocity;
+
     // Actualizar lo que la OLED debe mostrar
     display_set_status(&ui_status);
     display_task();   // redibuja el frame en el SH1106
@@ -144,6 +327,334 @@ static bool ui_timer_cb(repeating_timer_t *t)
     return true; // seguir repitiendo el timer
 }
 
+// -----------------------------------------------------------------------------
+//  Tareas del planificador
+// -----------------------------------------------------------------------------
+
+/** @brief Planificador de cada núcleo. */
+static sched_t sched_core0;
+static sched_t sched_core1;
+
+/** @brief USB + MIDI (TinyUSB, entrada, cola TX). Corre en cada despertar. */
+static uint32_t task_usb(sched_task_t *t, uint64_t now_us)
+{
+    (void)t; (void)now_us;
+    midi_core_task();
+    return 1000;   // al menos una vez por frame USB
+}
+
+/** @brief Eventos de sensores generados en core1 → midi_core. */
+static uint32_t task_ctrl_queue(sched_task_t *t, uint64_t now_us)
+{
+    (void)t; (void)now_us;
+    ctrl_queue_dispatch(CTRL_QUEUE_SIZE);
+    return 5000;   // core1 hace SEV al encolar
+}
+
+/** @brief Ticks del clock interno + arbitraje externo/interno. */
+static uint32_t task_clock(sched_task_t *t, uint64_t now_us)
+{
+    (void)t; (void)now_us;
+    clock_gen_task();
+    return 1000;   // el relevo externo -> interno se decide con ~1 ms de margen
+}
+
+/** @brief Avance del step sequencer en el beat previsto: duerme hasta ese instante. */
+static uint32_t task_step(sched_task_t *t, uint64_t now_us)
+{
+    (void)t;
+    stepseq_task();
+
+    uint64_t due = stepseq_next_due_us();
+    if (due == 0)      return 5000;
+    if (due <= now_us) return 0;
+    return (due - now_us < 5000) ? (uint32_t)(due - now_us) : 5000;
+}
+
+/** @brief Si el DAW cambió el feedback de LEDs, redibujar el anillo. */
+static uint32_t task_ring(sched_task_t *t, uint64_t now_us)
+{
+    (void)t; (void)now_us;
+    // Como mucho cada 5 ms: cada envío al anillo ocupa ~0.5 ms
+    if (host_feedback_take_dirty()) {
+        stepseq_redraw_ring();
+    }
+    return 5000;
+}
+
+/** @brief Tarea de los botones del SLAVE (la despierta task_slave en cada flanco). */
+static sched_task_t *s_btn_task = NULL;
+
+/**
+ * @brief Frames del SLAVE: parsea lo que el DMA dejó en el anillo de RX.
+ *
+ * A 115200 el anillo aguanta ~89 ms de datos, pero a 3 Mbaud sólo ~3.4 ms
+ * con la línea llena: cada 1 ms deja margen en cualquier velocidad. Si llegó
+ * un flanco de botón, task_buttons corre ya en vez de esperar a su ciclo.
+ */
+static uint32_t task_slave(sched_task_t *t, uint64_t now_us)
+{
+    (void)t; (void)now_us;
+    slave_link_task();
+    if (slave_link_take_button_change() && s_btn_task) {
+        sched_notify(s_btn_task);
+    }
+    return slave_link_next_poll_us();   // más a menudo esperando una sincronización
+}
+
+/**
+ * @brief Flancos de botón del SLAVE → notas MIDI, cada uno en su hora.
+ *
+ * Saca los flancos de slave_link, les pone hora de salida (su hora original
+ * + btn_delay_us) y duerme hasta el siguiente. Los que llegan sin hora (v1 o
+ * deducidos de una máscara) salen en cuanto les toca en la cola, sin
+ * adelantar a los anteriores. Con varios slaves en el bus, cada uno toca en
+ * su canal (índice del slave). Si ctrl_queue está llena (barrido de pots), el
+ * flanco se queda en la cola y se reintenta en BTN_RETRY_US: un Note Off
+ * perdido dejaría la nota colgada en el host.
+ */
+static uint32_t task_buttons(sched_task_t *t, uint64_t now_us)
+{
+    (void)t;
+
+    slave_edge_t e;
+    while (((btn_pending_head + 1u) & (BTN_PENDING_SIZE - 1u)) != btn_pending_tail &&
+           slave_link_take_edge(&e)) {
+        btn_pending_t *p = &btn_pending[btn_pending_head];
+
+        p->slave   = e.slave;
+        p->button  = e.button;
+        p->pressed = e.pressed;
+        p->t_us    = e.t_us;
+        p->due_us  = now_us;
+
+        if (e.timed) {
+            uint32_t late = (now_us > e.t_us) ? (uint32_t)(now_us - e.t_us) : 0;
+
+            if (late + SLAVE_EDGE_DELAY_MARGIN_US > btn_delay_us) {
+                btn_delay_us = late + SLAVE_EDGE_DELAY_MARGIN_US;
+            } else {
+                btn_delay_us -= (btn_delay_us - late - SLAVE_EDGE_DELAY_MARGIN_US) /
+                                SLAVE_EDGE_DELAY_DECAY;
+            }
+            if (btn_delay_us > SLAVE_EDGE_DELAY_MAX_US) {
+                btn_delay_us = SLAVE_EDGE_DELAY_MAX_US;
+            }
+            p->due_us = e.t_us + btn_delay_us;
+        }
+        btn_pending_head = (uint8_t)((btn_pending_head + 1u) & (BTN_PENDING_SIZE - 1u));
+    }
+
+    while (btn_pending_tail != btn_pending_head) {
+        const btn_pending_t *p = &btn_pending[btn_pending_tail];
+
+        if (p->due_us > now_us) {
+            uint64_t wait = p->due_us - now_us;
+            return (wait < 5000) ? (uint32_t)wait : 5000;
+        }
+
+        const uint8_t *notes = (p->button < 4) ? arcade_notes : normal_notes;
+        uint8_t        note  = notes[p->button & 3u];
+
+        // Latencia de botones: desde el cambio del pin en el slave
+        ctrl_queue_set_source(LAT_SRC_BUTTON, (uint32_t)p->t_us);
+        bool queued = p->pressed ? ctrl_queue_note_on(p->slave, note, 100)
+                                 : ctrl_queue_note_off(p->slave, note, 0);
+        if (!queued) {
+            ctrl_queue_set_source(LAT_SRC_NONE, 0);
+            return BTN_RETRY_US;
+        }
+        btn_pending_tail = (uint8_t)((btn_pending_tail + 1u) & (BTN_PENDING_SIZE - 1u));
+    }
+
+    ctrl_queue_set_source(LAT_SRC_NONE, 0);
+    return 5000;
+}
+
+/**
+ * @brief Ultrasónicos → pitch bend / CC MIDI (theremin), a 1 kHz (core1).
+ *
+ * Cada medida nueva del driver entra en el seguidor alfa-beta (ultra_track),
+ * que descarta ecos raros y estima la velocidad de la mano. La salida se
+ * remuestrea cada ULTRA_OUT_PERIOD_US extrapolando entre medidas, así que un
+ * barrido sale continuo y no a escalones de 10..20 ms; send_control_if_changed
+ * sólo encola cuando el valor cruza un paso de salida.
+ */
+static uint32_t task_ultra(sched_task_t *t, uint64_t now_us)
+{
+    (void)t; (void)now_us;
+
+    uint32_t now = time_us_32();
+
+    for (int i = 0; i < ULTRA_NUM_SENSORS; i++) {
+        uint32_t sample_us = ultra_driver_get_sample_us(i);
+
+        if (ultra_driver_is_valid(i) && sample_us != ultra_fed_us[i]) {
+            ultra_track_update(i, ultra_driver_get_distance_q16(i), sample_us);
+            ultra_fed_us[i] = sample_us;
+        }
+
+        int32_t d_q16;
+        if (!ultra_track_get(i, now, &d_q16)) {
+            continue;   // sin medidas buenas (o hace demasiado)
+        }
+
+        // Rango útil de distancia para "tocar" con la mano.
+        // Ejemplo: 10 cm (muy cerca) -> valor alto, 60 cm -> valor bajo,
+        // con la curva del sensor (la tabla ya satura fuera del rango)
+        uint16_t v14 = curve_dist(ultra_curve[i], d_q16);
+
+        ctrl_queue_set_source(LAT_SRC_ULTRA, ultra_fed_us[i]);
+
+        // midi_core (en core0) coalesce los controles: si el host no da
+        // abasto, sólo sale el valor más reciente de cada sensor.
+        send_control_if_changed(ULTRA_MIDI_CHANNEL, ultra_mode[i], ultra_cc[i], v14,
+                                &prev_ultra_v14[i],
+                                1u, ULTRA_HIRES_THRESHOLD);
+    }
+
+    ctrl_queue_set_source(LAT_SRC_NONE, 0);
+    return ULTRA_OUT_PERIOD_US;
+}
+
+/**
+ * @brief Lógica de pots + faders → eventos MIDI (cada 5 ms, core1).
+ */
+static uint32_t task_controls(sched_task_t *t, uint64_t now_us)
+{
+    (void)t; (void)now_us;
+
+    // --------- FADERS DEL MASTER → CC MIDI (SIEMPRE) ----------
+    for (int f = 0; f < NUM_FADERS; f++) {
+        // Igual que en tu ejemplo "hello": seleccionar canal ADC y leer
+        adc_select_input(fader_adc_input[f]);
+        sleep_us(5);                      // pequeño settle time
+        uint32_t t_adc = time_us_32();
+        uint16_t raw = adc_read();        // 0..4095
+
+        ctrl_queue_set_source(LAT_SRC_FADER, t_adc);
+
+        // 12 -> 14 bits (4095 -> 16383) por la curva del fader
+        uint16_t v14 = curve_adc(fader_curve[f], raw);
+
+        send_control_if_changed(0, fader_mode[f], fader_cc[f], v14,  // canal 1
+                                &prev_fader_v14[f],
+                                FADER_CC_THRESHOLD, FADER_HIRES_THRESHOLD);
+    }
+    // --------- FIN FADERS MASTER -----------------------------
+
+    // --------- POTS DE CADA SLAVE → CC MIDI ---------------
+    // Un canal por slave (SLAVE_POTS_MIDI_CHANNEL + índice); en punto a
+    // punto sólo está el 0
+    bool any_pressed = false;
+
+    for (uint8_t n = 0; n < SLAVE_LINK_MAX_SLAVES; n++) {
+        slave_state_t st;
+        slave_link_get_state_at(n, &st);
+
+        if (!slave_link_is_alive_at(n, 200) || !st.valid) {  // datos en los últimos 200 ms
+            // Reset de los pots para que al volver el slave mandemos
+            // de nuevo los valores correctos (las notas de los botones
+            // las cierra task_buttons cuando vuelva el estado del slave)
+            for (int i = 0; i < 4; i++) {
+                prev_pot_v14[n][i] = CTRL_NO_VALUE;
+            }
+            continue;
+        }
+
+        if ((st.arcade_mask | st.normal_mask) != 0) {
+            any_pressed = true;
+        }
+
+        // Sin descriptor (slave viejo) se asume la placa de siempre: 4 pots
+        ctrl_desc_t desc;
+        int n_pots = 4;
+        if (slave_link_get_desc(n, &desc) && desc.n_pots < n_pots) {
+            n_pots = desc.n_pots;
+        }
+
+        ctrl_queue_set_source(LAT_SRC_POT, (uint32_t)st.last_update_us);
+        for (int i = 0; i < n_pots; i++) {
+            uint16_t v12 = st.pot[i];   // valor que viene del slave (0..~1600)
+
+            // 0..SLAVE_POT_MAX_RAW12 -> 0..16383 por la curva del pot; la
+            // tabla satura arriba para que dé "toda la vuelta"
+            uint16_t v14 = curve_pot(pot_curve[i], v12);
+
+            // Enviar solo si cambió (simple filtro)
+            send_control_if_changed((uint8_t)(SLAVE_POTS_MIDI_CHANNEL + n), pot_mode[i],
+                                    pot_cc[i], v14, &prev_pot_v14[n][i],
+                                    1u, POT_HIRES_THRESHOLD);
+        }
+    }
+
+    // LED de debug encendido si hay algún botón pulsado en algún slave
+    // (apagado si no hay ninguno vivo)
+    gpio_put(DEBUG_LED_PIN, any_pressed ? 1 : 0);
+    // --------- FIN POTS SLAVES -----------------------------
+
+    ctrl_queue_set_source(LAT_SRC_NONE, 0);
+
+    return 5000;
+}
+
+/** @brief Tareas de core0 (nombre, función, presupuesto en us, flags). */
+static sched_task_t core0_tasks[] = {
+    { .name = "usb",   .fn = task_usb,        .budget_us = 500,  .flags = SCHED_F_EVERY_PASS },
+    { .name = "ctrlq", .fn = task_ctrl_queue, .budget_us = 500,  .flags = SCHED_F_EVERY_PASS },
+    { .name = "clock", .fn = task_clock,      .budget_us = 200,  .flags = SCHED_F_EVERY_PASS },
+    { .name = "step",  .fn = task_step,       .budget_us = 1000, .flags = SCHED_F_EVERY_PASS },
+    { .name = "ring",  .fn = task_ring,       .budget_us = 1000 },
+};
+
+/** @brief Tareas de core1. */
+static sched_task_t core1_tasks[] = {
+    { .name = "slave", .fn = task_slave,        .budget_us = 200 },
+    { .name = "btn",   .fn = task_buttons,      .budget_us = 100 },
+    { .name = "ctrl",  .fn = task_controls,     .budget_us = 500 },
+    { .name = "us",    .fn = ultra_driver_task, .budget_us = 50 },
+    { .name = "ustk",  .fn = task_ultra,        .budget_us = 100 },
+};
+
+// -----------------------------------------------------------------------------
+//  Core1: adquisición de sensores
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Arranque de core1 (sensores).
+ *
+ * Es dueño del enlace UART con el SLAVE, de los ultrasónicos y del ADC de los
+ * faders. Filtra, detecta flancos y genera los eventos MIDI listos para enviar,
+ * que pasan a core0 por la cola SPSC de ctrl_queue. Nada de aquí toca TinyUSB,
+ * así que el muestreo (sleep_us del ADC, parseo UART...) nunca retrasa tud_task().
+ */
+static void core1_main(void)
+{
+    // Inicializar enlace UART con el SLAVE (uart0 GP0/GP1)
+    slave_link_init();
+
+    // --- Inicializar ADC para los FADERS (misma lógica que en "hello") ---
+    adc_init();
+    for (int i = 0; i < NUM_FADERS; i++) {
+        adc_gpio_init(fader_gpio[i]);   // GP26, GP27, GP28 como entradas ADC
+    }
+
+    // --- Inicializar sensores ultrasónicos (HC-SR04 a 3.3 V) ---
+    // (la IRQ de los ECHO queda en este núcleo)
+    ultra_driver_init();
+    ultra_driver_set_range_cm(ULTRA_D_MAX_CM);
+    ultra_track_init();
+
+    sched_init(&sched_core1, 5000);
+    for (size_t i = 0; i < sizeof(core1_tasks) / sizeof(core1_tasks[0]); i++) {
+        sched_add(&sched_core1, &core1_tasks[i], 0);
+    }
+    s_btn_task = &core1_tasks[1];   // "btn"
+
+    // Cada tarea corre en su deadline; entre medias, WFE
+    sched_loop(&sched_core1);
+}
+
 // -----------------------------------------------------------------------------
 //  main()
 // -----------------------------------------------------------------------------
@@ -152,21 +663,19 @@ static bool ui_timer_cb(repeating_timer_t *t)
  * @brief Punto de entrada principal del firmware del MASTER.
  *
  * Flujo general:
- *  - Inicializa periféricos locales (LED ring, step sequencer, OLED, ADC, ultrasónicos).
- *  - Inicializa MIDI USB y enlace UART con el SLAVE.
- *  - En el bucle principal:
- *      - Atiende la pila MIDI/USB.
- *      - Atiende el enlace UART con el SLAVE.
- *      - Actualiza máquina de estados de sensores ultrasónicos.
- *      - Cada ~5 ms:
- *          - Lee faders del MASTER y envía CC.
- *          - Lee estado del SLAVE (botones + pots) y envia notas/CC.
+ *  - Inicializa periféricos locales (LED ring, step sequencer, OLED).
+ *  - Inicializa MIDI USB y arranca core1 con la adquisición de sensores.
+ *  - Cada núcleo ejecuta su planificador por deadlines (task_sched):
+ *      - core0: USB/MIDI, eventos de core1, clock interno, step sequencer, anillo.
+ *      - core1: enlace con el SLAVE, ultrasónicos (salida a 1 kHz) y lógica de
+ *        controles cada 5 ms.
+ *  - Entre deadlines los núcleos duermen con WFE; las IRQ los despiertan.
  */
 int main(void)
 {
     stdio_init_all(); // aunque tengas stdio USB apagado en CMake, no estorba
 
-    // LED de debug en GPIO normal
+    // LED de debug en GPIO normal (lo maneja core1)
     const uint LED_PIN = DEBUG_LED_PIN;
     gpio_init(LED_PIN);
     gpio_set_dir(LED_PIN, GPIO_OUT);
@@ -180,179 +689,22 @@ int main(void)
     // Inicializar MIDI + TinyUSB (device MIDI hacia el PC)
     midi_core_init();
 
-    // Inicializar enlace UART con el SLAVE (uart0 GP0/GP1)
-    slave_link_init();
-
-    // --- Inicializar ADC para los FADERS (misma lógica que en "hello") ---
-    adc_init();
-    for (int i = 0; i < NUM_FADERS; i++) {
-        adc_gpio_init(fader_gpio[i]);   // GP26, GP27, GP28 como entradas ADC
+    // Tareas de core0 (antes de lanzar core1: el registro de tareas no tiene lock)
+    sched_init(&sched_core0, 5000);
+    for (size_t i = 0; i < sizeof(core0_tasks) / sizeof(core0_tasks[0]); i++) {
+        sched_add(&sched_core0, &core0_tasks[i], 0);
     }
 
-    // --- Inicializar sensores ultrasónicos (HC-SR04 a 3.3 V) ---
-    ultra_driver_init();
+    // Cola core1 -> core0 y arranque de la adquisición en core1
+    ctrl_queue_init();
+    multicore_launch_core1(core1_main);
 
     // --- Timer periódico para la OLED (solo UI, nada de USB aquí) ---
     struct repeating_timer ui_timer;
     add_repeating_timer_ms(-33, ui_timer_cb, NULL, &ui_timer); // ~30 FPS
 
-    // Para comprobar "aliveness" del slave cada cierto rato
-    absolute_time_t last_check = get_absolute_time();
-
     // --- Bucle principal ---
-    while (true) {
-        // Procesar USB + MIDI (TinyUSB + clock, etc.)
-        midi_core_task();
-
-        // Procesar bytes/frames que lleguen del SLAVE por UART
-        slave_link_task();
-
-        // Actualizar máquina de estados de los ultrasonidos (no bloquea)
-        ultra_driver_update();
-
-        // Cada ~5 ms hacemos la lógica de botones + pots + faders + ultrasónicos → MIDI
-        absolute_time_t now = get_absolute_time();
-        if (absolute_time_diff_us(last_check, now) >= 5000) { // 5 ms
-            last_check = now;
-
-            slave_state_t st;
-            slave_link_get_state(&st);
-
-            bool alive = slave_link_is_alive(200); // datos en los últimos 200 ms
-
-            // --------- FADERS DEL MASTER → CC MIDI (SIEMPRE) ----------
-            for (int f = 0; f < NUM_FADERS; f++) {
-                // Igual que en tu ejemplo "hello": seleccionar canal ADC y leer
-                adc_select_input(fader_adc_input[f]);
-                sleep_us(5);                      // pequeño settle time
-                uint16_t raw = adc_read();        // 0..4095
-
-                // Escalar a 0..127
-                uint8_t cc = (uint8_t)(((uint32_t)raw * 127u) / 4095u);
-
-                uint8_t prev = prev_fader_cc[f];
-                uint8_t diff = (cc > prev) ? (cc - prev) : (prev - cc);
-
-                if (prev == 0xFF || diff >= FADER_CC_THRESHOLD) {
-                    midi_send_cc(0, fader_cc[f], cc);  // canal 1
-                    prev_fader_cc[f] = cc;
-                }
-            }
-            // --------- FIN FADERS MASTER -----------------------------
-
-            // --------- ULTRASONIDOS → CC MIDI (THEREMIN) -------------
-            for (int i = 0; i < ULTRA_NUM_SENSORS; i++) {
-                if (!ultra_driver_is_valid(i)) {
-                    continue;   // no hay medida buena todavía
-                }
-
-                float d_cm = ultra_driver_get_distance_cm(i);
-                if (d_cm <= 0.0f) {
-                    continue;
-                }
-
-                // Rango útil de distancia para "tocar" con la mano.
-                // Ejemplo: 10 cm (muy cerca) -> valor alto, 60 cm -> valor bajo.
-                const float D_MIN = 10.0f;
-                const float D_MAX = 60.0f;
-
-                if (d_cm < D_MIN) d_cm = D_MIN;
-                if (d_cm > D_MAX) d_cm = D_MAX;
-
-                // Normalizamos para que cerca = 127, lejos = 0
-                float norm = (D_MAX - d_cm) / (D_MAX - D_MIN);  // 0..1
-                if (norm < 0.0f) norm = 0.0f;
-                if (norm > 1.0f) norm = 1.0f;
-
-                uint8_t ccval = (uint8_t)(norm * 127.0f + 0.5f);
-
-                uint8_t prev_cc = prev_ultra_cc[i];
-                uint8_t diff    = (ccval > prev_cc) ? (ccval - prev_cc)
-                                                    : (prev_cc - ccval);
-
-                if (prev_cc == 0xFF || diff >= 1) {
-                    midi_send_cc(ULTRA_MIDI_CHANNEL, ultra_cc[i], ccval);
-                    prev_ultra_cc[i] = ccval;
-                }
-            }
-            // --------- FIN ULTRASONIDOS ------------------------------
-
-            if (alive && st.valid) {
-                // --------- EDGE DETECTION: ARCADE ---------------------
-                for (int i = 0; i < 4; i++) {
-                    uint8_t mask = (1u << i);
-
-                    bool prev = (prev_arcade_mask & mask) != 0;
-                    bool curr = (st.arcade_mask    & mask) != 0;
-
-                    if (curr && !prev) {
-                        // Flanco de subida → NOTE ON
-                        midi_send_note_on(0, arcade_notes[i], 100);
-                    } else if (!curr && prev) {
-                        // Flanco de bajada → NOTE OFF
-                        midi_send_note_off(0, arcade_notes[i], 0);
-                    }
-                }
-
-                // --------- EDGE DETECTION: NORMALES -------------------
-                for (int i = 0; i < 4; i++) {
-                    uint8_t mask = (1u << i);
-
-                    bool prev = (prev_normal_mask & mask) != 0;
-                    bool curr = (st.normal_mask    & mask) != 0;
-
-                    if (curr && !prev) {
-                        midi_send_note_on(0, normal_notes[i], 100);
-                    } else if (!curr && prev) {
-                        midi_send_note_off(0, normal_notes[i], 0);
-                    }
-                }
-
-                // Actualizar estados previos de botones
-                prev_arcade_mask = st.arcade_mask;
-                prev_normal_mask = st.normal_mask;
-
-                // LED de debug encendido si hay algún botón pulsado
-                bool any_pressed = ((st.arcade_mask | st.normal_mask) != 0);
-                gpio_put(LED_PIN, any_pressed ? 1 : 0);
-
-                // --------- POTS DEL SLAVE → CC MIDI -------------------
-                for (int i = 0; i < 4; i++) {
-                    uint16_t v12 = st.pot[i];   // valor que viene del slave (0..~1600)
-
-                    // Limitar a un máximo esperado para que dé "toda la vuelta"
-                    if (v12 > SLAVE_POT_MAX_RAW12) {
-                        v12 = SLAVE_POT_MAX_RAW12;
-                    }
-
-                    // Escalar 0..SLAVE_POT_MAX_RAW12 -> 0..127
-                    uint8_t cc = (uint8_t)(((uint32_t)v12 * 127u) / SLAVE_POT_MAX_RAW12);
-
-                    // Enviar solo si cambió (simple filtro)
-                    if (prev_pot_cc[i] == 0xFF || cc != prev_pot_cc[i]) {
-                        midi_send_cc(SLAVE_POTS_MIDI_CHANNEL, pot_cc[i], cc);
-                        prev_pot_cc[i] = cc;
-                    }
-                }
-            } else {
-                // Si el slave no está vivo, apagamos LED y reseteamos máscaras
-                gpio_put(LED_PIN, 0);
-                prev_arcade_mask = 0;
-                prev_normal_mask = 0;
-
-                // Reset de los pots para que al volver el slave mandemos
-                // de nuevo los valores correctos
-                for (int i = 0; i < 4; i++) {
-                    prev_pot_cc[i] = 0xFF;
-                }
-
-                // Los faders y ultrasónicos son del MASTER, se siguen actualizando
-                // normalmente; no hace falta resetearlos aquí.
-            }
-        }
-
-        tight_loop_contents();
-    }
+    sched_loop(&sched_core0);
 
     return 0;
 }
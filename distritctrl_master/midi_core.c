@@ -2,26 +2,111 @@
 
 #include "midi_core.h"
 #include "step_sequencer.h" 
+#include "cc_sched.h"
+#include "clock_tracker.h"
+#include "clock_gen.h"
+#include "midi_in.h"
+#include "host_feedback.h"
+#include "ump.h"
+#include "latency_hist.h"
+#include "task_sched.h"
+#include "slave_link.h"
 #include "bsp/board.h"
 #include "tusb.h"
 
 #include "pico/time.h"
+#include "hardware/sync.h"
+#include "pico/platform.h"
+#include <assert.h>
 #include <stdbool.h>
 #include <stdint.h>
 
 // ---------------- Estado BPM / Clock ----------------
+//
+// El tempo y la fase los estima clock_tracker a partir de los timestamps de
+// cada 0xF8. Aquí sólo decidimos cuándo consideramos que "hay clock".
+
+#define MIDI_CLOCK_BPM_TIMEOUT_US    1000000u  // sin ticks en 1 s -> BPM = 0
+#define MIDI_CLOCK_ALIVE_TIMEOUT_US   500000u  // sin ticks en 500 ms -> no hay clock
+
+// ---------------- Cola TX de paquetes USB-MIDI ----------------
+//
+// Cada mensaje se codifica una sola vez como paquete USB-MIDI de 4 bytes
+// (cable/CIN + 3 bytes MIDI) y se guarda en un anillo de tamaño fijo.
+// El consumidor (midi_core_task) es el único que avanza s_tx_tail y no
+// necesita bloquear nada. Los productores sólo pueden estar en core0 (tareas,
+// timers o IRQ de core0): el Cortex-M0+ no tiene LDREX/STREX, así que la
+// reserva del hueco se hace con las IRQ enmascaradas solo unas instrucciones,
+// y eso no excluye al otro core. core1 manda sus mensajes por ctrl_queue, que
+// los saca en core0 (ctrl_queue_dispatch). En debug, un productor en core1
+// salta en el assert de midi_tx_push_entries.
+
+#define MIDI_TX_QUEUE_SIZE   128u                       // paquetes, potencia de 2
+#define MIDI_TX_QUEUE_MASK   (MIDI_TX_QUEUE_SIZE - 1u)
+#define MIDI_USB_EP_PACKETS  (CFG_TUD_MIDI_TX_BUFSIZE / 4) // 64 bytes -> 16 paquetes
+
+static uint8_t           s_tx_ring[MIDI_TX_QUEUE_SIZE][4];
+static lat_tag_t         s_tx_tag[MIDI_TX_QUEUE_SIZE];   // marca de latencia de cada entrada
+static volatile uint32_t s_tx_head = 0;   // siguiente hueco libre (productores)
+static volatile uint32_t s_tx_tail = 0;   // siguiente paquete a enviar (consumidor)
+static midi_tx_stats_t   s_tx_stats;
+
+// Los CC no pasan por el anillo: van a cc_sched (último valor gana) y salen
+// detrás de notas/transporte, como mucho una vez por frame USB (1 ms).
+#define MIDI_USB_FRAME_US    1000u
+
+static uint64_t s_last_cc_flush_us = 0;
+
+// ---------------- Salida MIDI 2.0 (UMP) ----------------
+//
+// En modo UMP cada entrada del anillo es una palabra UMP de 32 bits (little
+// endian, como viaja por USB en el alt setting MIDI 2.0) en vez de un paquete
+// USB-MIDI 1.0. Un mensaje de 64 bits ocupa dos entradas consecutivas.
+// El descriptor USB (usb_descriptors.c) y la clase MIDI de TinyUSB de este
+// proyecto sólo exponen MIDI 1.0: sin un alt setting MIDI 2.0 el host no
+// sabría leer palabras UMP, así que MIDI_CORE_UMP_TRANSPORT=1 no compila
+// hasta que exista. Mientras tanto todo se traduce a MIDI 1.0, los caminos
+// UMP de este fichero no se compilan y el codificador (ump.c) se prueba en el
+// host (tests/test_ump.c).
+
+#if MIDI_CORE_UMP_TRANSPORT
+#error "MIDI_CORE_UMP_TRANSPORT=1 necesita un alt setting MIDI 2.0 en usb_descriptors.c"
+
+#define MIDI_UMP_GROUP  0
+
+static bool s_ump_mode = false;
+#endif
+
+// ---------------- Latencia entrada -> USB ----------------
+//
+// El main loop indica de qué fuente (y de qué instante) son los eventos que va
+// a mandar; la marca viaja con el paquete en el anillo (o en el slot de
+// cc_sched) y se cierra al entrar en el FIFO de TinyUSB.
+// Los mensajes de tiempo real no llevan marca (pueden salir desde una IRQ).
+
+#define MIDI_SYSEX_TX_MAX_PACKETS  96u   // paquetes por SysEx saliente
+
+static lat_tag_t s_cur_tag = { .src = LAT_SRC_NONE };
+static uint8_t   s_lat_dump_mask = 0;     // fuentes con volcado SysEx pendiente
+static bool      s_sched_report  = false; // informe del planificador pendiente
+static bool      s_sched_cycles  = false; // informe de ciclos pendiente
+static bool      s_clock_report  = false; // estado de clock_gen pendiente
+
+static void midi_core_send_latency_dumps(void);
+
+// ---------------- Entrada MIDI ----------------
+
+// Paquetes de entrada procesados como mucho por midi_core_task():
+// un buffer RX completo (64 bytes) sin bloquear el muestreo de sensores.
+#define MIDI_RX_MAX_PACKETS  (CFG_TUD_MIDI_RX_BUFSIZE / 4)
 
-static uint16_t g_bpm = 0;              // BPM filtrado actual (entero)
-static float    g_bpm_lp = 0.0f;        // filtro exponencial para suavizar
-static uint64_t g_last_tick_us = 0;     // tiempo del último tick 0xF8 (us)
-static uint64_t g_last_clock_seen_us = 0; // último momento en que vimos clock
-static uint32_t g_tick_count = 0;
-static uint64_t g_window_start_us = 0;
+static void midi_core_process_input(void);
+static void midi_core_on_clock_tick(void);
+static void midi_tx_drain(void);
+static const midi_in_handlers_t s_rx_handlers;
 
 // ---------------- Parpadeo de LED según estado USB ----------------
 
-static void midi_core_process_input(void);
-
 enum {
     BLINK_NOT_MOUNTED = 250,
     BLINK_MOUNTED     = 1000,
@@ -56,12 +141,21 @@ void midi_core_init(void)
     tud_init(BOARD_TUD_RHPORT);
 
     blink_interval_ms    = BLINK_NOT_MOUNTED;
-    g_bpm                = 0;
-    g_bpm_lp             = 0.0f;
-    g_last_tick_us       = 0;
-    g_last_clock_seen_us = 0;
-    g_tick_count         = 0;
-    g_window_start_us    = 0;;
+    clock_tracker_init();
+    clock_gen_init();
+    host_feedback_init();
+    midi_in_init(&s_rx_handlers);
+
+    s_tx_head = 0;
+    s_tx_tail = 0;
+    s_last_cc_flush_us = 0;
+    midi_core_reset_tx_stats();
+    cc_sched_init();
+    latency_hist_init();
+    midi_core_set_event_source(LAT_SRC_NONE, 0);
+    s_lat_dump_mask = 0;
+    s_sched_report  = false;
+    s_sched_cycles  = false;
 }
 
 void midi_core_task(void)
@@ -72,6 +166,12 @@ void midi_core_task(void)
     // Procesa mensajes MIDI
     midi_core_process_input();
 
+    // Vacía la cola TX hacia el FIFO de TinyUSB
+    midi_tx_drain();
+
+    // Volcados de histogramas de latencia pedidos por SysEx
+    midi_core_send_latency_dumps();
+
     // LED de estado USB
     led_blinking_task();
 }
@@ -81,150 +181,577 @@ bool midi_core_is_mounted(void)
     return tud_midi_mounted();
 }
 
+// ---------------- Cola TX ----------------
+
+// Encola n entradas de 4 bytes de una vez (o ninguna si no caben todas).
+// tag (puede ser NULL) marca el mensaje para medir su latencia; va en la
+// última entrada, que es la que completa el mensaje en el host.
+// Sólo core0 (IRQ incluidas).
+static bool midi_tx_push_entries(const uint8_t (*entries)[4], uint32_t n, const lat_tag_t *tag)
+{
+    assert(get_core_num() == 0);
+
+    uint32_t irq  = save_and_disable_interrupts();
+    uint32_t head = s_tx_head;
+    uint32_t used = head - s_tx_tail;
+
+    if (used + n > MIDI_TX_QUEUE_SIZE) {
+        s_tx_stats.overflows += n;
+        restore_interrupts(irq);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint8_t *p = s_tx_ring[(head + i) & MIDI_TX_QUEUE_MASK];
+        p[0] = entries[i][0];
+        p[1] = entries[i][1];
+        p[2] = entries[i][2];
+        p[3] = entries[i][3];
+        s_tx_tag[(head + i) & MIDI_TX_QUEUE_MASK].src = LAT_SRC_NONE;
+    }
+
+    if (tag && tag->src != LAT_SRC_NONE && n > 0) {
+        lat_tag_t *t = &s_tx_tag[(head + n - 1u) & MIDI_TX_QUEUE_MASK];
+        *t = *tag;
+        latency_hist_mark_queued(t);
+    }
+
+    s_tx_head = head + n;
+    s_tx_stats.queued += n;
+    if (used + n > s_tx_stats.high_water) {
+        s_tx_stats.high_water = (uint16_t)(used + n);
+    }
+    restore_interrupts(irq);
+
+    return true;
+}
+
+// Encola un paquete USB-MIDI ya codificado (cable 0). Sólo core0 (IRQ incluidas).
+static bool midi_tx_push(uint8_t cin, uint8_t b0, uint8_t b1, uint8_t b2, const lat_tag_t *tag)
+{
+    const uint8_t packet[1][4] = { { (uint8_t)(cin & 0x0F), b0, b1, b2 } };
+
+    return midi_tx_push_entries(packet, 1, tag);
+}
+
+#if MIDI_CORE_UMP_TRANSPORT
+// Encola un UMP completo (1 o 2 palabras) sin que otro productor se intercale
+static bool midi_tx_push_ump(const uint32_t *words, uint8_t n, const lat_tag_t *tag)
+{
+    uint8_t entries[2][4];
+
+    for (uint8_t i = 0; i < n && i < 2; i++) {
+        entries[i][0] = (uint8_t)(words[i]);
+        entries[i][1] = (uint8_t)(words[i] >> 8);
+        entries[i][2] = (uint8_t)(words[i] >> 16);
+        entries[i][3] = (uint8_t)(words[i] >> 24);
+    }
+    return midi_tx_push_entries((const uint8_t (*)[4])entries, n, tag);
+}
+
+// Salida de cc_sched en modo UMP: un único mensaje MIDI 2.0 por control,
+// con el valor de 14 bits escalado a 32 (min-center-max)
+static bool midi_cc_emit_ump(cc_sched_kind_t kind, uint8_t channel, uint16_t number, uint16_t value)
+{
+    uint32_t w[2];
+
+    switch (kind) {
+    case CC_KIND_CC7:
+        ump_cc(MIDI_UMP_GROUP, channel, (uint8_t)number, ump_scale_up(value, 7, 32), w);
+        break;
+    case CC_KIND_CC14:
+        ump_cc(MIDI_UMP_GROUP, channel, (uint8_t)number, ump_scale_up(value, 14, 32), w);
+        break;
+    case CC_KIND_NRPN:
+        ump_nrpn(MIDI_UMP_GROUP, channel, number, ump_scale_up(value, 14, 32), w);
+        break;
+    case CC_KIND_PITCH_BEND:
+    default:
+        ump_pitch_bend(MIDI_UMP_GROUP, channel, ump_scale_up(value, 14, 32), w);
+        break;
+    }
+
+    return midi_tx_push_ump(w, 2, NULL);
+}
+#endif
+
+// Salida de cc_sched: escribe directo al FIFO de TinyUSB
+static bool midi_cc_emit(uint8_t status, uint8_t d1, uint8_t d2)
+{
+    uint8_t packet[4] = { (uint8_t)(status >> 4), status, d1, d2 };
+
+    if (!tud_midi_packet_write(packet)) {
+        s_tx_stats.usb_busy++;
+        return false;
+    }
+    s_tx_stats.sent++;
+    return true;
+}
+
+// Pasa paquetes de la cola al FIFO de TinyUSB. Como mucho un endpoint completo
+// (64 bytes) por llamada: mientras el endpoint está ocupado, los paquetes se
+// acumulan en el FIFO y salen juntos en la siguiente transferencia bulk.
+// Prioridad: primero notas/transporte (anillo), luego CC coalescidos.
+static void midi_tx_drain(void)
+{
+    uint32_t tail = s_tx_tail;
+    uint32_t head = s_tx_head;
+
+    if (!tud_midi_mounted()) {
+        // Sin host: lo pendiente ya no tiene sentido (notas viejas, etc.)
+        s_tx_tail = head;
+        cc_sched_reset();
+        return;
+    }
+
+    for (uint32_t n = 0; n < MIDI_USB_EP_PACKETS && tail != head; n++) {
+        uint32_t idx = tail & MIDI_TX_QUEUE_MASK;
+
+        if (!tud_midi_packet_write(s_tx_ring[idx])) {
+            // FIFO de TinyUSB lleno: reintentamos en la próxima vuelta
+            s_tx_stats.usb_busy++;
+            break;
+        }
+        latency_hist_mark_sent(&s_tx_tag[idx]);
+        tail++;
+        s_tx_stats.sent++;
+    }
+
+    s_tx_tail = tail;
+
+    if (tail != head || !cc_sched_has_pending()) return;
+
+    uint64_t now = time_us_64();
+    if (now - s_last_cc_flush_us < MIDI_USB_FRAME_US) return;
+    s_last_cc_flush_us = now;
+
+#if MIDI_CORE_UMP_TRANSPORT
+    if (s_ump_mode) {
+        // Los UMP de 64 bits pasan por el anillo para no partirse en el FIFO;
+        // salen en la siguiente llamada
+        cc_sched_flush_values(midi_cc_emit_ump);
+        return;
+    }
+#endif
+    cc_sched_flush(midi_cc_emit);
+}
+
+#if MIDI_CORE_UMP_TRANSPORT
+bool midi_core_set_ump_mode(bool enable)
+{
+    if (enable != s_ump_mode) {
+        // El receptor no comparte estado entre formatos: reenviar todo completo
+        cc_sched_reset();
+        s_ump_mode = enable;
+    }
+    return s_ump_mode;
+}
+
+bool midi_core_is_ump_mode(void)
+{
+    return s_ump_mode;
+}
+#endif
+
+void midi_core_get_tx_stats(midi_tx_stats_t *out)
+{
+    if (!out) return;
+
+    uint32_t irq = save_and_disable_interrupts();
+    *out       = s_tx_stats;
+    out->depth = (uint16_t)(s_tx_head - s_tx_tail);
+    restore_interrupts(irq);
+}
+
+void midi_core_reset_tx_stats(void)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    s_tx_stats = (midi_tx_stats_t){0};
+    restore_interrupts(irq);
+}
+
 // ---------------- Envío de mensajes MIDI ----------------
 
 void midi_send_note_on(uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    midi_send_note_on_hires(channel, note, (uint16_t)ump_scale_up(velocity & 0x7F, 7, 16));
+}
+
+void midi_send_note_off(uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    midi_send_note_off_hires(channel, note, (uint16_t)ump_scale_up(velocity & 0x7F, 7, 16));
+}
+
+void midi_send_note_on_hires(uint8_t channel, uint8_t note, uint16_t velocity16)
 {
     if (!tud_midi_mounted()) return;
 
-    uint8_t msg[3];
-    msg[0] = 0x90 | (channel & 0x0F);
-    msg[1] = note;
-    msg[2] = velocity;
+#if MIDI_CORE_UMP_TRANSPORT
+    if (s_ump_mode) {
+        uint32_t w[2];
+        ump_note_on(MIDI_UMP_GROUP, channel, note, velocity16, w);
+        midi_tx_push_ump(w, 2, &s_cur_tag);
+        return;
+    }
+#endif
+
+    // MIDI 1.0: velocidad 7 bits, nunca 0 (sería Note Off)
+    uint8_t vel7 = (uint8_t)ump_scale_down(velocity16, 16, 7);
+    if (vel7 == 0) vel7 = 1;
 
-    tud_midi_stream_write(0, msg, 3);
+    midi_tx_push(0x9, 0x90 | (channel & 0x0F), note & 0x7F, vel7, &s_cur_tag);
 }
 
-void midi_send_note_off(uint8_t channel, uint8_t note, uint8_t velocity)
+void midi_send_note_off_hires(uint8_t channel, uint8_t note, uint16_t velocity16)
 {
     if (!tud_midi_mounted()) return;
 
-    uint8_t msg[3];
-    msg[0] = 0x80 | (channel & 0x0F);
-    msg[1] = note;
-    msg[2] = velocity;
+#if MIDI_CORE_UMP_TRANSPORT
+    if (s_ump_mode) {
+        uint32_t w[2];
+        ump_note_off(MIDI_UMP_GROUP, channel, note, velocity16, w);
+        midi_tx_push_ump(w, 2, &s_cur_tag);
+        return;
+    }
+#endif
 
-    tud_midi_stream_write(0, msg, 3);
+    midi_tx_push(0x8, 0x80 | (channel & 0x0F), note & 0x7F,
+                 (uint8_t)ump_scale_down(velocity16, 16, 7), &s_cur_tag);
 }
 
 void midi_send_cc(uint8_t channel, uint8_t cc, uint8_t value)
 {
     if (!tud_midi_mounted()) return;
 
-    uint8_t msg[3];
-    msg[0] = 0xB0 | (channel & 0x0F);
-    msg[1] = cc;
-    msg[2] = value;
+    // Si la tabla de coalescado está llena, o el CC ya es de un control de
+    // otro tipo (p. ej. el LSB de un CC14), el CC va por el anillo normal
+    if (!cc_sched_set(channel, cc, value)) {
+        midi_tx_push(0xB, 0xB0 | (channel & 0x0F), cc & 0x7F, value & 0x7F, &s_cur_tag);
+    }
+}
 
-    tud_midi_stream_write(0, msg, 3);
+void midi_send_cc14(uint8_t channel, uint8_t cc, uint16_t value14)
+{
+    if (!tud_midi_mounted()) return;
+
+    if (!cc_sched_set_cc14(channel, cc, value14)) {
+        uint8_t st = 0xB0 | (channel & 0x0F);
+        midi_tx_push(0xB, st, cc & 0x1F, (value14 >> 7) & 0x7F, NULL);
+        midi_tx_push(0xB, st, (cc & 0x1F) + 32, value14 & 0x7F, &s_cur_tag);
+    }
 }
 
-// ---------------- Cálculo de BPM ----------------
+void midi_send_nrpn(uint8_t channel, uint16_t param, uint16_t value14)
+{
+    if (!tud_midi_mounted()) return;
 
-// Llamar en cada 0xF8 (MIDI Clock)
-static void midi_core_on_clock_tick(void)
+    if (!cc_sched_set_nrpn(channel, param, value14)) {
+        uint8_t st = 0xB0 | (channel & 0x0F);
+        midi_tx_push(0xB, st, 99, (param >> 7) & 0x7F, NULL);
+        midi_tx_push(0xB, st, 98, param & 0x7F, NULL);
+        midi_tx_push(0xB, st, 6,  (value14 >> 7) & 0x7F, NULL);
+        midi_tx_push(0xB, st, 38, value14 & 0x7F, &s_cur_tag);
+    }
+}
+
+void midi_send_pitch_bend(uint8_t channel, uint16_t value14)
 {
-    uint64_t now = time_us_64();
+    if (!tud_midi_mounted()) return;
 
-    // Marcamos actividad de clock
-    g_last_clock_seen_us = now;
+    if (!cc_sched_set_pitch_bend(channel, value14)) {
+        midi_tx_push(0xE, 0xE0 | (channel & 0x0F), value14 & 0x7F, (value14 >> 7) & 0x7F, &s_cur_tag);
+    }
+}
 
-    // Primera vez: arrancamos ventana
-    if (g_window_start_us == 0) {
-        g_window_start_us = now;
-        g_tick_count      = 0;
-        return;
+void midi_send_control(uint8_t channel, midi_res_mode_t mode, uint16_t number, uint16_t value14)
+{
+    switch (mode) {
+    case MIDI_RES_CC14:
+        midi_send_cc14(channel, (uint8_t)number, value14);
+        break;
+
+    case MIDI_RES_NRPN:
+        midi_send_nrpn(channel, number, value14);
+        break;
+
+    case MIDI_RES_PITCH_BEND:
+        midi_send_pitch_bend(channel, value14);
+        break;
+
+    case MIDI_RES_7BIT:
+    default:
+        midi_send_cc(channel, (uint8_t)number, (uint8_t)(value14 >> 7));
+        break;
     }
+}
 
-    g_tick_count++;
+void midi_send_realtime(uint8_t status)
+{
+    if (!tud_midi_mounted()) return;
 
-    // Usamos 24 ticks = 1 negra para estimar BPM
-    if (g_tick_count >= 24) {
-        uint64_t elapsed_us = now - g_window_start_us;
+#if MIDI_CORE_UMP_TRANSPORT
+    if (s_ump_mode) {
+        uint32_t w;
+        ump_system(MIDI_UMP_GROUP, status, 0, 0, &w);
+        midi_tx_push_ump(&w, 1, NULL);
+        return;
+    }
+#endif
 
-        // Seguridad: descartar cosas absurdas
-        //  30 BPM  -> ~2.000.000 us por beat
-        //  300 BPM ->   200.000 us por beat
-        if (elapsed_us > 200000 && elapsed_us < 2000000) {
-            float inst_bpm = 60.0f * 1000000.0f / (float)elapsed_us;
+    // CIN 0xF: mensaje de un solo byte (clock, start, stop...)
+    midi_tx_push(0xF, status, 0, 0, NULL);
+}
 
-            if (g_bpm_lp == 0.0f) {
-                g_bpm_lp = inst_bpm;
-            } else {
-                // filtro exponencial un poco más lento
-                g_bpm_lp = g_bpm_lp * 0.7f + inst_bpm * 0.3f;
+bool midi_send_sysex(const uint8_t *msg, uint16_t len)
+{
+    uint8_t  entries[MIDI_SYSEX_TX_MAX_PACKETS][4];
+    uint32_t n = 0;
+
+    if (!tud_midi_mounted()) return false;
+    if (!msg || len < 2 || msg[0] != 0xF0 || msg[len - 1] != 0xF7) return false;
+
+#if MIDI_CORE_UMP_TRANSPORT
+    if (s_ump_mode) {
+        // MT 3: hasta 6 bytes de datos por paquete, sin F0/F7
+        const uint8_t *data   = msg + 1;
+        uint16_t       remain = (uint16_t)(len - 2);
+        bool           first  = true;
+
+        do {
+            uint8_t  chunk = (remain > 6) ? 6 : (uint8_t)remain;
+            bool     last  = (remain == chunk);
+            uint8_t  st    = first ? (last ? UMP_SYSEX7_COMPLETE : UMP_SYSEX7_START)
+                                   : (last ? UMP_SYSEX7_END : UMP_SYSEX7_CONTINUE);
+            uint32_t w[2];
+
+            if (n + 2 > MIDI_SYSEX_TX_MAX_PACKETS) return false;
+
+            ump_sysex7(MIDI_UMP_GROUP, st, data, chunk, w);
+            for (uint8_t k = 0; k < 2; k++, n++) {
+                entries[n][0] = (uint8_t)(w[k]);
+                entries[n][1] = (uint8_t)(w[k] >> 8);
+                entries[n][2] = (uint8_t)(w[k] >> 16);
+                entries[n][3] = (uint8_t)(w[k] >> 24);
             }
 
-            if (g_bpm_lp < 40.0f)  g_bpm_lp = 40.0f;
-            if (g_bpm_lp > 300.0f) g_bpm_lp = 300.0f;
+            data   += chunk;
+            remain  = (uint16_t)(remain - chunk);
+            first   = false;
+        } while (remain > 0);
+
+        return midi_tx_push_entries((const uint8_t (*)[4])entries, n, NULL);
+    }
+#endif
+
+    // USB-MIDI: CIN 4 para cada bloque de 3 bytes intermedio, y 5/6/7 para
+    // el bloque final de 1/2/3 bytes que contiene el F7
+    for (uint16_t i = 0; i < len; i += 3) {
+        uint16_t chunk = (uint16_t)((len - i) > 3 ? 3 : (len - i));
+        uint8_t  cin   = (i + chunk >= len) ? (uint8_t)(0x4 + chunk) : 0x4;
+
+        if (n >= MIDI_SYSEX_TX_MAX_PACKETS) return false;
+
+        entries[n][0] = cin;
+        entries[n][1] = msg[i];
+        entries[n][2] = (chunk > 1) ? msg[i + 1] : 0;
+        entries[n][3] = (chunk > 2) ? msg[i + 2] : 0;
+        n++;
+    }
+
+    return midi_tx_push_entries((const uint8_t (*)[4])entries, n, NULL);
+}
+
+// ---------------- Latencia ----------------
+
+void midi_core_set_event_source(uint8_t src, uint32_t t0_us)
+{
+    s_cur_tag.src   = src;
+    s_cur_tag.t0_us = t0_us;
+    s_cur_tag.tq_us = 0;
+    cc_sched_set_tag((src == LAT_SRC_NONE) ? NULL : &s_cur_tag);
+}
+
+// Un volcado (una fuente, un informe del planificador o el estado del clock)
+// por llamada: los más grandes ocupan ~70-80 paquetes del anillo
+static void midi_core_send_latency_dumps(void)
+{
+    static uint8_t buf[3u * MIDI_SYSEX_TX_MAX_PACKETS];
 
-            g_bpm = (uint16_t)(g_bpm_lp + 0.5f);
+    if (s_lat_dump_mask == 0 && !s_sched_report && !s_sched_cycles && !s_clock_report) return;
+
+    if (!tud_midi_mounted()) {
+        s_lat_dump_mask = 0;
+        s_sched_report  = false;
+        s_sched_cycles  = false;
+        s_clock_report  = false;
+        return;
+    }
+
+    if (s_clock_report) {
+        size_t len = clock_gen_build_sysex(buf, sizeof(buf));
+        if (len == 0 || midi_send_sysex(buf, (uint16_t)len)) {
+            s_clock_report = false;
         }
+        return;
+    }
 
-        // Reiniciamos ventana para el siguiente beat
-        g_tick_count      = 0;
-        g_window_start_us = now;
+    if (s_sched_report) {
+        size_t len = sched_build_report_sysex(buf, sizeof(buf));
+        if (len == 0 || midi_send_sysex(buf, (uint16_t)len)) {
+            s_sched_report = false;
+        }
+        return;
+    }
+
+    if (s_sched_cycles) {
+        size_t len = sched_build_cycles_sysex(buf, sizeof(buf));
+        if (len == 0 || midi_send_sysex(buf, (uint16_t)len)) {
+            s_sched_cycles = false;
+        }
+        return;
+    }
+
+    for (uint8_t src = 0; src < LAT_SRC_COUNT; src++) {
+        if (!(s_lat_dump_mask & (1u << src))) continue;
+
+        size_t len = latency_hist_build_sysex(src, buf, sizeof(buf));
+        if (len == 0 || midi_send_sysex(buf, (uint16_t)len)) {
+            s_lat_dump_mask &= (uint8_t)~(1u << src);
+        }
+        // Si no cupo en el anillo, se reintenta en la próxima vuelta
+        break;
     }
 }
 
+// ---------------- Cálculo de BPM ----------------
+
+// Llamar en cada 0xF8 (MIDI Clock)
+static void midi_core_on_clock_tick(void)
+{
+    clock_tracker_on_tick(time_us_64());
+}
 
 uint16_t midi_core_get_bpm(void)
 {
-    uint64_t now = time_us_64();
+    return (uint16_t)((midi_core_get_bpm_x100() + 50u) / 100u);
+}
+
+uint32_t midi_core_get_bpm_x100(void)
+{
+    // Con el clock interno como fuente, el tempo es el suyo
+    if (clock_gen_get_active() == CLOCK_ACTIVE_INTERNAL) {
+        return clock_gen_get_bpm_x100();
+    }
 
     // Si hace más de 1 s que no vemos clock, asumimos que no hay
-    if (g_last_clock_seen_us == 0 || (now - g_last_clock_seen_us) > 1000000) {
+    if (!clock_tracker_is_locked(time_us_64(), MIDI_CLOCK_BPM_TIMEOUT_US)) {
         return 0;
     }
 
-    return g_bpm;
+    return clock_tracker_get_bpm_x100();
 }
 
 bool midi_core_has_clock(void)
 {
-    uint64_t now = time_us_64();
+    uint64_t last = clock_tracker_last_tick_us();
 
-    if (g_last_clock_seen_us == 0) {
+    if (last == 0) {
         return false;
     }
 
     // Consideramos "hay clock" si el último tick fue hace menos de 500 ms
-    return (now - g_last_clock_seen_us) < 500000;
+    return (time_us_64() - last) < MIDI_CLOCK_ALIVE_TIMEOUT_US;
 }
 
 // ---------------- Lectura y manejo de mensajes MIDI ----------------
 
-static void midi_core_process_input(void)
+static void midi_rx_realtime(uint8_t cable, uint8_t status)
 {
-    uint8_t packet[4];
-
-    while (tud_midi_available()) {
-        tud_midi_packet_read(packet);
-
-        uint8_t cin    = packet[0] & 0x0F;
-        (void)cin; // por ahora no lo usamos
-        uint8_t status = packet[1];
-
-        // Mensajes de tiempo real MIDI (pueden venir intercalados)
-        switch (status) {
-            case 0xF8: // MIDI Clock
-                midi_core_on_clock_tick();
+    (void)cable;
+
+    // Mensajes de tiempo real MIDI (pueden venir intercalados)
+    switch (status) {
+        case 0xF8: // MIDI Clock
+            midi_core_on_clock_tick();
+            // Si manda el clock interno, el tick del DAW sólo alimenta el tracker
+            if (clock_gen_on_external_tick()) {
                 stepseq_on_clock_tick();
-                break;
+            }
+            break;
 
-            case 0xFA: // Start
-            case 0xFB: // Continue -> lo tratamos igual que Start
+        case 0xFA: // Start
+        case 0xFB: // Continue -> lo tratamos igual que Start
+            if (clock_gen_on_external_transport(status)) {
                 stepseq_on_start();
-                break;
+            }
+            break;
 
-            case 0xFC: // Stop
+        case 0xFC: // Stop
+            if (clock_gen_on_external_transport(status)) {
                 stepseq_on_stop();
-                break;
+            }
+            break;
 
-            default:
-                // Aquí podrías procesar Note On/Off, CC, etc. si lo necesitas
-                break;
-        }
+        default:
+            break;
+    }
+}
+
+static void midi_rx_note_on(uint8_t cable, uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    (void)cable;
+    host_feedback_on_note(channel, note, velocity);
+}
+
+static void midi_rx_note_off(uint8_t cable, uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    (void)cable; (void)velocity;
+    host_feedback_on_note(channel, note, 0);
+}
+
+static void midi_rx_cc(uint8_t cable, uint8_t channel, uint8_t cc, uint8_t value)
+{
+    (void)cable;
+    host_feedback_on_cc(channel, cc, value);
+}
+
+static void midi_rx_sysex(uint8_t cable, const uint8_t *data, uint16_t len, bool truncated)
+{
+    uint8_t mask = 0;
+
+    (void)cable;
+    if (truncated) return;
+
+    if (latency_hist_parse_sysex(data, len, &mask)) {
+        s_lat_dump_mask |= mask;
+    } else if (sched_is_report_request(data, len)) {
+        s_sched_report = true;
+    } else if (sched_is_cycles_request(data, len)) {
+        s_sched_cycles = true;
+    } else if (clock_gen_parse_sysex(data, len)) {
+        // Consulta o ajuste del clock interno: contesta con el estado
+        s_clock_report = true;
+    } else {
+        // Configuración del slave: se manda desde core1 (slave_link_task)
+        slave_link_parse_sysex(data, len);
+    }
+}
+
+static const midi_in_handlers_t s_rx_handlers = {
+    .note_on        = midi_rx_note_on,
+    .note_off       = midi_rx_note_off,
+    .control_change = midi_rx_cc,
+    .realtime       = midi_rx_realtime,
+    .sysex          = midi_rx_sysex,
+};
+
+static void midi_core_process_input(void)
+{
+    uint8_t packet[4];
+
+    for (uint32_t n = 0; n < MIDI_RX_MAX_PACKETS && tud_midi_available(); n++) {
+        if (!tud_midi_packet_read(packet)) break;
+        midi_in_parse_packet(packet);
     }
 }
 
@@ -5,6 +5,11 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+// Salida MIDI 2.0 (UMP). Hoy no hay alt setting MIDI 2.0 en el descriptor y
+// midi_core.c no compila con 1: sin ella, los caminos UMP no existen.
+#ifndef MIDI_CORE_UMP_TRANSPORT
+#define MIDI_CORE_UMP_TRANSPORT  0
+#endif
 
 /**
  * Inicializa la pila USB MIDI (TinyUSB) para el RP2040.
@@ -25,9 +30,52 @@ void midi_core_task(void);
  */
 bool midi_core_is_mounted(void);
 
+/**
+ * BPM estimado a partir del MIDI Clock entrante (entero, 0 si no hay clock).
+ */
 uint16_t midi_core_get_bpm(void); 
+
+/**
+ * BPM estimado con dos decimales (BPM * 100), 0 si no hay clock.
+ */
+uint32_t midi_core_get_bpm_x100(void);
+
+/**
+ * true si llegó algún tick de MIDI Clock en los últimos 500 ms.
+ */
+bool midi_core_has_clock(void);
+
+/**
+ * Estadísticas de la cola TX de paquetes USB-MIDI.
+ * Todos los mensajes salientes pasan por esta cola antes de ir a TinyUSB.
+ */
+typedef struct {
+    uint32_t queued;      // paquetes aceptados en la cola
+    uint32_t sent;        // paquetes entregados al FIFO de TinyUSB
+    uint32_t overflows;   // paquetes descartados porque la cola estaba llena
+    uint32_t usb_busy;    // veces que el FIFO de TinyUSB no tenía sitio
+    uint16_t high_water;  // máxima ocupación observada (paquetes)
+    uint16_t depth;       // ocupación actual (paquetes)
+} midi_tx_stats_t;
+
+/**
+ * Copia las estadísticas actuales de la cola TX.
+ */
+void midi_core_get_tx_stats(midi_tx_stats_t *out);
+
+/**
+ * Pone a cero contadores y high-water mark de la cola TX.
+ */
+void midi_core_reset_tx_stats(void);
+
+/*
+ * Las midi_send_* encolan en la cola TX de midi_core: sólo desde core0 (tareas
+ * o IRQ de core0). Desde core1, por ctrl_queue.
+ */
+
 /**
  * Envia un mensaje Note On por MIDI.
+ * El mensaje se encola y sale en el siguiente midi_core_task().
  * channel: 0–15 (0 = canal 1)
  * note: número de nota (0–127)
  * velocity: 0–127
@@ -39,11 +87,93 @@ void midi_send_note_on(uint8_t channel, uint8_t note, uint8_t velocity);
  */
 void midi_send_note_off(uint8_t channel, uint8_t note, uint8_t velocity);
 
+/**
+ * Note On / Note Off con velocidad de 16 bits.
+ * En MIDI 1.0 la velocidad se reduce a 7 bits; con transporte UMP, en modo
+ * UMP salen como un único mensaje MIDI 2.0.
+ */
+void midi_send_note_on_hires(uint8_t channel, uint8_t note, uint16_t velocity16);
+void midi_send_note_off_hires(uint8_t channel, uint8_t note, uint16_t velocity16);
+
 /**
  * Envia un mensaje Control Change (CC).
  * cc: número de controlador (0–127)
  * value: valor del controlador (0–127)
+ *
+ * Los CC se coalescen por (canal, cc): si llega un valor nuevo antes de que
+ * salga el anterior, sólo se envía el más reciente. Salen detrás de las notas
+ * y como mucho una vez por frame USB (1 ms).
  */
 void midi_send_cc(uint8_t channel, uint8_t cc, uint8_t value);
 
+/**
+ * Resolución con la que se envía un control continuo.
+ */
+typedef enum {
+    MIDI_RES_7BIT = 0,    // CC normal (0..127)
+    MIDI_RES_CC14,        // par MSB/LSB: CC n (0..31) + CC n+32
+    MIDI_RES_NRPN,        // NRPN: number = parámetro (0..16383)
+    MIDI_RES_PITCH_BEND   // pitch bend del canal (number se ignora)
+} midi_res_mode_t;
+
+/**
+ * Envia un CC de 14 bits como par MSB (CC cc) / LSB (CC cc+32).
+ * cc: 0–31, value14: 0–16383
+ * El MSB sólo se repite si cambió, así que un movimiento fino cuesta un mensaje.
+ */
+void midi_send_cc14(uint8_t channel, uint8_t cc, uint16_t value14);
+
+/**
+ * Envia un NRPN de 14 bits (CC 99/98 selección, CC 6/38 dato).
+ * La selección de parámetro y el MSB del dato sólo se repiten si cambian.
+ */
+void midi_send_nrpn(uint8_t channel, uint16_t param, uint16_t value14);
+
+/**
+ * Envia pitch bend de 14 bits (8192 = centro).
+ */
+void midi_send_pitch_bend(uint8_t channel, uint16_t value14);
+
+/**
+ * Envia un control continuo con la resolución indicada.
+ * value14 siempre va en 14 bits (0–16383); en MIDI_RES_7BIT se usan los 7 altos.
+ */
+void midi_send_control(uint8_t channel, midi_res_mode_t mode, uint16_t number, uint16_t value14);
+
+#if MIDI_CORE_UMP_TRANSPORT
+/**
+ * Activa la salida MIDI 2.0 (Universal MIDI Packet).
+ * En modo UMP cada nota / control sale como un único mensaje MIDI 2.0 de 64 bits
+ * (velocidad de 16 bits, controladores de 32 bits) en vez de pares MSB/LSB.
+ * Sólo existe en builds con transporte UMP (MIDI_CORE_UMP_TRANSPORT).
+ * Devuelve el modo efectivo.
+ */
+bool midi_core_set_ump_mode(bool enable);
+
+/**
+ * true si la salida está en modo UMP (MIDI 2.0).
+ */
+bool midi_core_is_ump_mode(void);
+#endif
+
+/**
+ * Envia un mensaje de tiempo real de un byte (0xF8 clock, 0xFA start, 0xFC stop...).
+ * Va por la cola prioritaria junto con las notas.
+ */
+void midi_send_realtime(uint8_t status);
+
+/**
+ * Envia un SysEx completo (msg incluye F0 ... F7).
+ * Se encola entero o nada; devuelve false si no cabe o no hay host.
+ */
+bool midi_send_sysex(const uint8_t *msg, uint16_t len);
+
+/**
+ * Marca los eventos que se envíen a continuación como procedentes de la
+ * fuente src (lat_src_t de latency_hist.h) adquirida en t0_us (time_us_32()),
+ * para los histogramas de latencia entrada -> USB.
+ * LAT_SRC_NONE deja de marcar. Sólo desde el main loop.
+ */
+void midi_core_set_event_source(uint8_t src, uint32_t t0_us);
+
 #endif // MIDI_CORE_H_
@@ -0,0 +1,239 @@
+// midi_in.c - Parser de paquetes USB-MIDI entrantes
+//
+// Cada paquete USB-MIDI trae en el primer byte el cable (nibble alto) y el
+// CIN (Code Index Number, nibble bajo), que ya dice cuántos bytes MIDI son
+// válidos y de qué tipo. Despachamos con una tabla indexada por CIN, así que
+// el coste por paquete es constante.
+//
+// Los SysEx se reensamblan en un único buffer fijo: sólo un cable puede estar
+// reensamblando a la vez y lo que no cabe se cuenta pero no se guarda.
+
+#include "midi_in.h"
+
+#include <stddef.h>
+#include <string.h>
+
+typedef void (*cin_handler_t)(uint8_t cable, const uint8_t *msg);
+
+static midi_in_handlers_t s_h;
+static midi_in_stats_t    s_stats;
+
+// Estado del reensamblado SysEx
+static uint8_t  s_sx_buf[MIDI_IN_SYSEX_MAX];
+static uint16_t s_sx_len    = 0;      // bytes recibidos (puede superar el buffer)
+static uint8_t  s_sx_cable  = 0;
+static bool     s_sx_active = false;
+
+// ----------------------------
+// SysEx
+// ----------------------------
+
+static void sysex_append(uint8_t cable, const uint8_t *bytes, uint8_t n, bool last)
+{
+    if (!s_sx_active) {
+        // Un SysEx sólo puede empezar con F0
+        if (bytes[0] != 0xF0) {
+            s_stats.sysex_dropped++;
+            return;
+        }
+        s_sx_active = true;
+        s_sx_cable  = cable;
+        s_sx_len    = 0;
+    } else if (cable != s_sx_cable) {
+        // Otro cable intercalando un SysEx: no tenemos buffer para dos. Se
+        // cuenta cada paquete perdido (también las continuaciones sin F0) y
+        // el mensaje una vez, en su F0
+        s_stats.sysex_interleaved++;
+        if (bytes[0] == 0xF0) s_stats.sysex_dropped++;
+        return;
+    } else if (bytes[0] == 0xF0) {
+        // F0 nuevo sin F7 del anterior: se abandona el incompleto
+        s_stats.sysex_dropped++;
+        s_sx_len = 0;
+    }
+
+    for (uint8_t i = 0; i < n; i++) {
+        if (s_sx_len < MIDI_IN_SYSEX_MAX) {
+            s_sx_buf[s_sx_len] = bytes[i];
+        }
+        if (s_sx_len < UINT16_MAX) s_sx_len++;
+    }
+
+    if (last) {
+        bool     truncated = (s_sx_len > MIDI_IN_SYSEX_MAX);
+        uint16_t len       = truncated ? MIDI_IN_SYSEX_MAX : s_sx_len;
+
+        if (truncated) s_stats.sysex_truncated++;
+        else           s_stats.sysex_complete++;
+
+        if (s_h.sysex) s_h.sysex(cable, s_sx_buf, len, truncated);
+        s_sx_active = false;
+        s_sx_len    = 0;
+    }
+}
+
+// ----------------------------
+// Handlers por CIN
+// ----------------------------
+
+static void cin_ignore(uint8_t cable, const uint8_t *msg)
+{
+    (void)cable; (void)msg;
+    s_stats.ignored++;
+}
+
+// 0x2: system common de 2 bytes (F1 MTC, F3 song select)
+// 0x3: system common de 3 bytes (F2 song position)
+static void cin_sys_common(uint8_t cable, const uint8_t *msg)
+{
+    if (msg[0] < 0xF1 || msg[0] > 0xF6) {
+        s_stats.ignored++;
+        return;
+    }
+    if (s_h.system_common) s_h.system_common(cable, msg[0], msg[1], msg[2]);
+}
+
+// 0x4: SysEx empieza o continúa (3 bytes)
+static void cin_sysex_cont(uint8_t cable, const uint8_t *msg)
+{
+    sysex_append(cable, msg, 3, false);
+}
+
+// 0x5: un byte de system common (F6) o fin de SysEx con 1 byte (F7)
+static void cin_single_common(uint8_t cable, const uint8_t *msg)
+{
+    if (msg[0] == 0xF7) {
+        sysex_append(cable, msg, 1, true);
+    } else if (msg[0] == 0xF6) {
+        if (s_h.system_common) s_h.system_common(cable, msg[0], 0, 0);
+    } else {
+        s_stats.ignored++;
+    }
+}
+
+// 0x6 / 0x7: fin de SysEx con 2 / 3 bytes
+static void cin_sysex_end2(uint8_t cable, const uint8_t *msg)
+{
+    sysex_append(cable, msg, 2, true);
+}
+
+static void cin_sysex_end3(uint8_t cable, const uint8_t *msg)
+{
+    sysex_append(cable, msg, 3, true);
+}
+
+static void cin_note_off(uint8_t cable, const uint8_t *msg)
+{
+    s_stats.channel_msgs++;
+    if (s_h.note_off) s_h.note_off(cable, msg[0] & 0x0F, msg[1] & 0x7F, msg[2] & 0x7F);
+}
+
+static void cin_note_on(uint8_t cable, const uint8_t *msg)
+{
+    uint8_t ch  = msg[0] & 0x0F;
+    uint8_t vel = msg[2] & 0x7F;
+
+    s_stats.channel_msgs++;
+
+    // Note On con velocidad 0 es Note Off por convención MIDI
+    if (vel == 0) {
+        if (s_h.note_off) s_h.note_off(cable, ch, msg[1] & 0x7F, 0);
+    } else {
+        if (s_h.note_on) s_h.note_on(cable, ch, msg[1] & 0x7F, vel);
+    }
+}
+
+static void cin_poly_pressure(uint8_t cable, const uint8_t *msg)
+{
+    s_stats.channel_msgs++;
+    if (s_h.poly_pressure) s_h.poly_pressure(cable, msg[0] & 0x0F, msg[1] & 0x7F, msg[2] & 0x7F);
+}
+
+static void cin_control_change(uint8_t cable, const uint8_t *msg)
+{
+    s_stats.channel_msgs++;
+    if (s_h.control_change) s_h.control_change(cable, msg[0] & 0x0F, msg[1] & 0x7F, msg[2] & 0x7F);
+}
+
+static void cin_program_change(uint8_t cable, const uint8_t *msg)
+{
+    s_stats.channel_msgs++;
+    if (s_h.program_change) s_h.program_change(cable, msg[0] & 0x0F, msg[1] & 0x7F);
+}
+
+static void cin_channel_pressure(uint8_t cable, const uint8_t *msg)
+{
+    s_stats.channel_msgs++;
+    if (s_h.channel_pressure) s_h.channel_pressure(cable, msg[0] & 0x0F, msg[1] & 0x7F);
+}
+
+static void cin_pitch_bend(uint8_t cable, const uint8_t *msg)
+{
+    s_stats.channel_msgs++;
+    if (s_h.pitch_bend) {
+        uint16_t v = (uint16_t)((msg[2] & 0x7F) << 7) | (msg[1] & 0x7F);
+        s_h.pitch_bend(cable, msg[0] & 0x0F, v);
+    }
+}
+
+// 0xF: un byte suelto. En la práctica: mensajes de tiempo real.
+static void cin_single_byte(uint8_t cable, const uint8_t *msg)
+{
+    if (msg[0] >= 0xF8) {
+        s_stats.realtime_msgs++;
+        if (s_h.realtime) s_h.realtime(cable, msg[0]);
+    } else {
+        s_stats.ignored++;
+    }
+}
+
+static const cin_handler_t s_cin_table[16] = {
+    [0x0] = cin_ignore,            // misc (reservado)
+    [0x1] = cin_ignore,            // cable events (reservado)
+    [0x2] = cin_sys_common,
+    [0x3] = cin_sys_common,
+    [0x4] = cin_sysex_cont,
+    [0x5] = cin_single_common,
+    [0x6] = cin_sysex_end2,
+    [0x7] = cin_sysex_end3,
+    [0x8] = cin_note_off,
+    [0x9] = cin_note_on,
+    [0xA] = cin_poly_pressure,
+    [0xB] = cin_control_change,
+    [0xC] = cin_program_change,
+    [0xD] = cin_channel_pressure,
+    [0xE] = cin_pitch_bend,
+    [0xF] = cin_single_byte,
+};
+
+// ----------------------------
+// API pública
+// ----------------------------
+
+void midi_in_init(const midi_in_handlers_t *handlers)
+{
+    if (handlers) {
+        s_h = *handlers;
+    } else {
+        memset(&s_h, 0, sizeof(s_h));
+    }
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    s_sx_active = false;
+    s_sx_len    = 0;
+}
+
+void midi_in_parse_packet(const uint8_t packet[4])
+{
+    uint8_t cable = packet[0] >> 4;
+    uint8_t cin   = packet[0] & 0x0F;
+
+    s_stats.packets++;
+    s_cin_table[cin](cable, &packet[1]);
+}
+
+void midi_in_get_stats(midi_in_stats_t *out)
+{
+    if (!out) return;
+    *out = s_stats;
+}
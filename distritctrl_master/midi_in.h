@@ -0,0 +1,47 @@
+// midi_in.h - Parser de paquetes USB-MIDI entrantes (todos los CIN, multi-cable)
+#ifndef MIDI_IN_H
+#define MIDI_IN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Tamaño máximo de un SysEx reensamblado (incluye F0 y F7).
+// Si llega uno más largo se entrega truncado.
+#define MIDI_IN_SYSEX_MAX  64
+
+// Callbacks de aplicación. Cualquiera puede ser NULL.
+// cable: número de cable virtual (0..15) del paquete USB-MIDI
+// channel: 0..15
+typedef struct {
+    void (*note_on)(uint8_t cable, uint8_t channel, uint8_t note, uint8_t velocity);
+    void (*note_off)(uint8_t cable, uint8_t channel, uint8_t note, uint8_t velocity);
+    void (*poly_pressure)(uint8_t cable, uint8_t channel, uint8_t note, uint8_t pressure);
+    void (*control_change)(uint8_t cable, uint8_t channel, uint8_t cc, uint8_t value);
+    void (*program_change)(uint8_t cable, uint8_t channel, uint8_t program);
+    void (*channel_pressure)(uint8_t cable, uint8_t channel, uint8_t pressure);
+    void (*pitch_bend)(uint8_t cable, uint8_t channel, uint16_t value14);   // 0..16383, 8192 = centro
+    void (*realtime)(uint8_t cable, uint8_t status);                         // 0xF8..0xFF
+    void (*system_common)(uint8_t cable, uint8_t status, uint8_t d1, uint8_t d2); // F1, F2, F3, F6
+    void (*sysex)(uint8_t cable, const uint8_t *data, uint16_t len, bool truncated);
+} midi_in_handlers_t;
+
+typedef struct {
+    uint32_t packets;          // paquetes procesados
+    uint32_t channel_msgs;     // mensajes de canal (CIN 0x8..0xE)
+    uint32_t realtime_msgs;    // mensajes de tiempo real
+    uint32_t sysex_complete;   // SysEx entregados completos
+    uint32_t sysex_truncated;  // SysEx entregados truncados (más largos que el buffer)
+    uint32_t sysex_dropped;    // SysEx descartados (otro cable ya estaba reensamblando, o fragmentos sueltos)
+    uint32_t sysex_interleaved; // paquetes SysEx de otro cable tirados mientras se reensamblaba uno
+    uint32_t ignored;          // CIN reservados o paquetes incoherentes
+} midi_in_stats_t;
+
+// Registra los callbacks y reinicia el parser
+void midi_in_init(const midi_in_handlers_t *handlers);
+
+// Procesa un paquete USB-MIDI de 4 bytes. O(1) salvo la copia de <= 3 bytes de SysEx.
+void midi_in_parse_packet(const uint8_t packet[4]);
+
+void midi_in_get_stats(midi_in_stats_t *out);
+
+#endif // MIDI_IN_H
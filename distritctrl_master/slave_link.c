@@ -1,10 +1,16 @@
 #include "slave_link.h"
 #include "ctrl_protocol.h"
+#include "latency_hist.h"
 
 #include "pico/stdlib.h"
 #include "hardware/uart.h"
+#include "hardware/spi.h"
+#include "hardware/dma.h"
+#include "hardware/sync.h"
 #include "pico/time.h"
 
+#include <string.h>
+
 // ----------------------------
 // Config UART del MASTER
 // ----------------------------
@@ -12,23 +18,509 @@
 // Deben coincidir baudrate y formato con el slave.
 // OJO: Pin de RX del master debe ir al TX del slave.
 #define MASTER_UART_ID        uart0
-#define MASTER_UART_BAUDRATE  115200
-#define MASTER_UART_TX_PIN    0   // opcional, por si luego queremos enviar algo al slave
+#define MASTER_UART_BAUDRATE  115200   // de arranque; en v2 se negocia hacia arriba
+#define MASTER_UART_TX_PIN    0   // TX del master → RX del slave (ACK / RESYNC de v2)
 #define MASTER_UART_RX_PIN    1   // RX del master ← TX del slave
+#define MASTER_UART_DE_PIN    3   // bus: DE (y /RE) del transceptor RS-485
+
+// ----------------------------
+// Transporte SPI (SLAVE_LINK_SPI)
+// ----------------------------
+//
+// El master es el controlador: cada SLAVE_SPI_PERIOD_US baja CS y dos canales
+// DMA mueven CTRL_SPI_XFER_LEN bytes en cada sentido (ctrl_protocol.h,
+// "Transporte SPI"). El CS va a mano para que sea una sola bajada por
+// transacción (el PL022 lo subiría entre bytes). 56 bytes a 8 MHz son ~60 us
+// con CS bajo; el estado que llega se armó al final de la transacción
+// anterior, así que tiene como mucho un periodo de antigüedad.
+
+#define MASTER_SPI_ID         spi1
+#define MASTER_SPI_RX_PIN     8    // MISO ← TX del slave
+#define MASTER_SPI_CS_PIN     9
+#define MASTER_SPI_SCK_PIN    10
+#define MASTER_SPI_TX_PIN     11   // MOSI → RX del slave
+
+#define SLAVE_SPI_PERIOD_US   250u   // una transacción cada 250 us (4 kHz)
+#define SLAVE_SPI_POLL_US     10u    // periodo de slave_link_task() con una en vuelo
+#define SLAVE_SPI_CS_LAT_US   2u     // de la bajada de CS a la marca del slave (su IRQ)
+#define SLAVE_SPI_OUT_SIZE    (2u * CTRL_SPI_XFER_LEN)
+
+#if SLAVE_LINK_SPI
+static uint8_t  s_spi_tx[CTRL_SPI_XFER_LEN];
+static uint8_t  s_spi_rx[CTRL_SPI_XFER_LEN];
+static uint8_t  s_spi_out[SLAVE_SPI_OUT_SIZE];    // frames master → slave esperando
+static uint8_t  s_spi_out_len  = 0;
+static int      s_spi_tx_dma   = -1;
+static int      s_spi_rx_dma   = -1;
+static bool     s_spi_busy     = false;   // transacción en vuelo
+static uint32_t s_spi_t0_us    = 0;       // inicio de la última
+static uint64_t s_spi_cs_us    = 0;       // bajada de CS de la última (64 bits)
+static uint64_t s_spi_prev_us  = 0;       // y de la anterior
+static uint8_t  s_spi_seq      = 0;       // seq del último bloque bueno
+static bool     s_spi_have_seq = false;
+#endif
+
+// ----------------------------
+// Recepción por DMA
+// ----------------------------
+//
+// Un canal DMA copia cada byte del UART (DREQ de RX) a un anillo de 1 KB
+// alineado, usando el modo "ring" del DMA para la dirección de escritura. La
+// CPU no toca el UART: aunque el bucle se quede parado en una transferencia
+// I2C de la OLED o en el latch del anillo, los bytes se siguen guardando
+// (1 KB = ~89 ms a 115200 baudios, ~3.4 ms a 3 Mbaud con la línea llena).
+//
+// Cuántos bytes llevamos escritos sale del contador de transferencias del
+// canal, así que la cabeza es un contador monotónico de 32 bits y se puede
+// detectar si el parser se quedó más de un anillo atrás.
+
+#define SLAVE_RX_RING_BITS   10u
+#define SLAVE_RX_RING_SIZE   (1u << SLAVE_RX_RING_BITS)
+#define SLAVE_RX_RING_MASK   (SLAVE_RX_RING_SIZE - 1u)
+
+// El canal se rearma antes de agotar el contador de transferencias
+#define SLAVE_RX_DMA_COUNT   0xFFFFFFFFu
+#define SLAVE_RX_REARM_BELOW 0x80000000u
 
-// Máquina de estados del parser
+#if !SLAVE_LINK_SPI
+static uint8_t  s_rx_ring[SLAVE_RX_RING_SIZE] __attribute__((aligned(SLAVE_RX_RING_SIZE)));
+static int      s_rx_dma      = -1;
+static uint32_t s_rx_base     = 0;   // bytes escritos por armados anteriores del canal
+static uint32_t s_rx_tail     = 0;   // bytes ya consumidos por el parser
+#endif
+
+// Máquina de estados del parser (acepta frames v1 y v2 a la vez)
 typedef enum {
     RX_STATE_WAIT_H1 = 0,
     RX_STATE_WAIT_H2,
-    RX_STATE_PAYLOAD,
-    RX_STATE_CHECKSUM
+    RX_STATE_PAYLOAD,     // v1: payload fijo
+    RX_STATE_CHECKSUM,    // v1: checksum 8 bits
+    RX_STATE_V2_FRAME     // v2: cabecera, payload y CRC
 } rx_state_t;
 
 static rx_state_t s_rx_state = RX_STATE_WAIT_H1;
 static uint8_t    s_payload_buf[CTRL_FRAME_PAYLOAD_SIZE];
 static uint8_t    s_payload_pos = 0;
 
-static slave_state_t s_slave_state = {0};
+// Frame v2 en curso (cabecera incluida, para comprobar el CRC de una vez)
+static uint8_t    s_v2_buf[CTRL_V2_MAX_FRAME];
+static uint8_t    s_v2_pos  = 0;
+static uint8_t    s_v2_want = 0;
+
+// Estado del protocolo v2
+#define SLAVE_V2_RESYNC_MIN_US  20000u   // no pedir FULL más de una vez cada 20 ms
+
+static uint8_t    s_tx_seq         = 0;      // seq de los frames master → slave
+static bool       s_button_change  = false;
+
+// ----------------------------
+// Tabla de slaves
+// ----------------------------
+//
+// Un hueco por slave: en punto a punto sólo el 0; en el bus, dirección - 1.
+// Cada slave lleva su propia secuencia, así que el control de pérdidas y el
+// RESYNC van por hueco.
+
+typedef struct {
+    slave_state_t st;
+    bool        synced;          // hubo un FULL desde el último hueco
+    uint8_t     expect_seq;
+    bool        need_resync;
+    uint32_t    last_resync_us;
+    ctrl_desc_t desc;
+    bool        has_desc;
+    bool        present;         // bus: contesta a los POLL
+    uint8_t     misses;          // bus: POLL seguidos sin END
+} slave_slot_t;
+
+static slave_slot_t s_slot[SLAVE_LINK_MAX_SLAVES];
+
+// ----------------------------
+// Bus multi-slave
+// ----------------------------
+//
+// El master es el único que habla sin turno: manda los comandos de difusión
+// y un POLL, suelta el bus y espera al END del slave (o a que el bus lleve
+// SLAVE_BUS_SLOT_TIMEOUT_US callado). Cada vuelta pasa por todos los slaves
+// presentes y prueba una dirección ausente, así que con n slaves la vuelta
+// dura n turnos (unos 0.2 ms cada uno a 921600 con poco que contar) más un
+// timeout, y ése es el retraso máximo de un flanco por esperar el turno.
+
+#define SLAVE_BUS_SLOT_TIMEOUT_US  1000u   // bus callado esperando al slave
+#define SLAVE_BUS_GUARD_US         30u     // tras un turno: que el slave suelte el DE
+#define SLAVE_BUS_CYCLE_MIN_US     500u    // no empezar vueltas más a menudo
+#define SLAVE_BUS_POLL_US          20u     // periodo de slave_link_task() con el bus ocupado
+#define SLAVE_BUS_MISS_MAX         3u      // POLL sin END seguidos: slave ausente
+
+typedef enum {
+    LINK_BUS_IDLE = 0,
+    LINK_BUS_WAIT         // POLL enviado, esperando el END
+} link_bus_state_t;
+
+static link_bus_state_t s_bus_state  = LINK_BUS_IDLE;
+static uint8_t  s_bus_addr      = 0;      // dirección con el turno
+static bool     s_bus_end       = false;  // llegó su END
+#if SLAVE_LINK_BUS
+static uint32_t s_bus_rx_us     = 0;      // último POLL o último byte recibido
+static uint32_t s_bus_idle_us   = 0;      // fin del último turno
+static uint8_t  s_bus_next      = 0;      // siguiente hueco de la vuelta
+static uint8_t  s_bus_probe     = 0;      // siguiente hueco a probar
+static uint32_t s_bus_cycle_t0  = 0;
+static uint32_t s_bus_rx_head   = 0;
+#endif
+
+// ----------------------------
+// Flancos de botón con hora
+// ----------------------------
+//
+// Cada flanco lleva la hora del cambio crudo en el slave. Con el reloj del
+// slave sincronizado (ver "Reloj del slave") se pasa a la base de tiempo del
+// master con slave_time_to_master_us(). Hasta entonces se resta su antigüedad
+// (t_tx - t del EDGE) a la hora en que terminó de llegar el frame: el error
+// es lo que tardó el frame en salir del slave y en ser parseado, igual para
+// todos los flancos de un mismo frame.
+// Los cambios que llegan sin marca (v1, DELTA / FULL, o un flanco que el
+// slave no pudo encolar) salen con la hora de llegada y timed = false.
+
+#define SLAVE_EDGE_QUEUE_SIZE   16u      // potencia de 2
+#define SLAVE_EDGE_MAX_AGE_US   1000000u // más viejo que esto: marca no creíble
+
+static slave_edge_t s_edge_q[SLAVE_EDGE_QUEUE_SIZE];
+static uint8_t      s_edge_head = 0;
+static uint8_t      s_edge_tail = 0;
+
+// ----------------------------
+// Velocidad del enlace (v2)
+// ----------------------------
+//
+// El master lleva la negociación (ver ctrl_protocol.h): sube un escalón cada
+// SLAVE_BAUD_STEP_US mientras los patrones lleguen perfectos, y no pasa nunca
+// de s_baud_ceiling. Cualquier fallo baja el techo, así que con un cable largo
+// se queda en el último escalón bueno y no vuelve a intentar los de arriba.
+
+// Escalón más alto a intentar (0 = quedarse siempre en 115200)
+#define MASTER_UART_BAUD_MAX_IDX   (CTRL_BAUD_NUM - 1)
+
+#define SLAVE_BAUD_OK_TIMEOUT_US   20000u    // TRY sin BAUD_OK
+#define SLAVE_BAUD_TEST_WINDOW_US  50000u    // tiempo para recibir los patrones
+#define SLAVE_BAUD_STEP_US         200000u   // entre subidas
+#define SLAVE_BAUD_DEAD_US         500000u   // a velocidad alta sin frames buenos → 115200
+#define SLAVE_BAUD_ERR_WINDOW_US   1000000u
+#define SLAVE_BAUD_ERR_MAX         4u        // errores de CRC por ventana antes de bajar
+
+typedef enum {
+    LINK_BAUD_IDLE = 0,
+    LINK_BAUD_WAIT_OK,    // TRY enviado
+    LINK_BAUD_TESTING     // ya en la nueva, contando patrones
+} link_baud_state_t;
+
+static link_baud_state_t s_baud_state   = LINK_BAUD_IDLE;
+static uint8_t    s_baud_idx      = 0;    // escalón actual
+static uint8_t    s_baud_prev     = 0;    // al que volver si la prueba falla
+static uint8_t    s_baud_try      = 0;
+static bool       s_baud_down     = false; // la prueba en curso es una bajada por errores
+static uint8_t    s_baud_ceiling  = MASTER_UART_BAUD_MAX_IDX;
+static uint8_t    s_baud_tests_ok = 0;
+static uint32_t   s_baud_t0_us    = 0;
+static uint32_t   s_baud_next_us  = 0;    // no subir antes de esto
+static uint32_t   s_baud_err_base = 0;    // checksum_errors al empezar la prueba / ventana
+static uint32_t   s_baud_fail_us  = 0;    // última prueba fallida (el slave tarda en volver)
+#if !SLAVE_LINK_BUS && !SLAVE_LINK_SPI
+static uint32_t   s_baud_win_us   = 0;
+static uint32_t   s_last_ping_us  = 0;
+#endif
+static uint32_t   s_last_valid_us = 0;    // último frame con CRC / checksum bueno
+
+// ----------------------------
+// Reloj del slave (v2)
+// ----------------------------
+//
+// Intercambio SYNC_REQ / SYNC_RESP tipo NTP (ctrl_protocol.h). Cada
+// intercambio da un par (hora del slave, hora del master) con un error de
+// como mucho RTT / 2; sólo se usan los de RTT cercano al mínimo reciente (los
+// demás pillaron a algún lado ocupado). El modelo es una recta:
+//
+//   master = ref_m + ds + ds * drift / 1e9,   ds = slave - ref_s
+//
+// y se corrige con un lazo de fase + frecuencia: cada muestra mueve la fase
+// la mitad del residuo y la deriva 1/16 del residuo dividido por el tiempo
+// desde la anterior. Entre intercambios la deriva estimada mantiene el
+// modelo; con los cristales del RP2040 (±30 ppm) sin corregir serían hasta
+// 15 us cada 250 ms.
+//
+// Mientras se espera la respuesta, task_slave llama a slave_link_task() cada
+// pocos us (slave_link_next_poll_us()) para que t4 no arrastre el periodo
+// normal de 1 ms; lo que aún quede se descuenta por los bytes que llegaron
+// detrás del frame.
+
+#define SLAVE_SYNC_FAST_US        50000u    // periodo hasta tener SLAVE_SYNC_FAST_SAMPLES
+#define SLAVE_SYNC_FAST_SAMPLES   8u
+#define SLAVE_SYNC_PERIOD_US      250000u   // 4 intercambios por segundo en régimen
+#define SLAVE_SYNC_TIMEOUT_US     20000u    // sin respuesta: darla por perdida
+#define SLAVE_SYNC_POLL_US        20u       // periodo de slave_link_task() esperando respuesta
+#define SLAVE_SYNC_RTT_SLACK_US   40u       // aceptar muestras de RTT <= mínimo + esto
+#define SLAVE_SYNC_RTT_AGE_US     4u        // el mínimo sube esto por muestra (se readapta)
+#define SLAVE_SYNC_STEP_US        2000      // residuo mayor: rehacer el modelo de cero
+#define SLAVE_SYNC_FREQ_SHIFT     4         // ganancia del lazo de frecuencia (1/16)
+#define SLAVE_SYNC_DRIFT_MAX_PPB  500000    // ±500 ppm: más es un error, no un cristal
+#define SLAVE_SYNC_LOST_US        3000000u  // sin muestras buenas: modelo no válido
+#define SLAVE_SYNC_SETTLED        16u       // muestras hasta fiarse de la deriva
+#define SLAVE_SYNC_FREQ_ERR_PPM   50u       // error de deriva supuesto antes de asentarse
+#define SLAVE_SYNC_FREQ_ERR_SETTLED_PPM 3u  // y después
+
+static bool     s_sync_pending    = false;
+static uint64_t s_sync_t1_us      = 0;      // t1 del intercambio en curso
+static uint32_t s_sync_sent_us    = 0;
+static uint32_t s_sync_last_ok_us = 0;
+static uint32_t s_sync_rtt_min_us = UINT32_MAX;
+static uint32_t s_sync_count      = 0;      // muestras aceptadas desde el último reinicio
+
+static bool     s_sync_valid      = false;
+static uint64_t s_sync_ref_s      = 0;      // hora del slave (desenrollada a 64 bits)
+static uint64_t s_sync_ref_m      = 0;      // hora del master que le corresponde
+static int32_t  s_sync_drift_ppb  = 0;      // (ritmo master / ritmo slave - 1) en ppb
+static uint32_t s_sync_jitter_us  = 0;      // media del |residuo|
+static uint32_t s_sync_err_us     = 0;      // error en ref (RTT / 2 + jitter)
+
+// Hora (master) a la que terminó de llegar el último frame v2, descontando
+// los bytes que ya habían llegado detrás
+static uint64_t s_rx_head_us      = 0;      // cuándo se leyó la cabeza del DMA
+static uint32_t s_rx_rest         = 0;      // bytes detrás del tramo que se parsea
+static uint32_t s_byte_ns         = 0;      // duración de un byte en el cable
+static uint64_t s_v2_rx_end_us    = 0;
+
+// ----------------------------
+// Parámetros del slave (v2)
+// ----------------------------
+//
+// Quien pide un cambio (cualquier núcleo) escribe el valor y después suma
+// uno a s_param_req; core1 lo ve distinto de s_param_sent y lo manda en un
+// CONFIG. Sin CONFIG_ACK en SLAVE_PARAM_RETRY_US se vuelve a mandar.
+
+#define SLAVE_PARAM_RETRY_US  50000u
+
+static volatile uint16_t s_param_want[CTRL_PARAM_COUNT];
+static volatile uint8_t  s_param_req[CTRL_PARAM_COUNT];    // 0 = nunca pedido
+static uint8_t           s_param_sent[CTRL_PARAM_COUNT];
+static bool              s_param_acked[CTRL_PARAM_COUNT];
+static uint16_t          s_param_applied[CTRL_PARAM_COUNT];
+static bool              s_param_known[CTRL_PARAM_COUNT];
+static uint32_t          s_param_sent_us = 0;
+
+static volatile uint8_t  s_snapshot_req  = 0;
+static uint8_t           s_snapshot_sent = 0;
+
+static slave_link_stats_t s_stats;
+
+// ----------------------------
+// Funciones internas: cola de flancos
+// ----------------------------
+
+static void slave_link_push_edge(uint8_t slave, uint8_t button, bool pressed,
+                                 bool timed, uint64_t t_us)
+{
+    uint8_t next = (uint8_t)((s_edge_head + 1u) & (SLAVE_EDGE_QUEUE_SIZE - 1u));
+
+    if (next == s_edge_tail) {
+        // Nadie consume: se pierde el más viejo, el estado sigue bien
+        s_edge_tail = (uint8_t)((s_edge_tail + 1u) & (SLAVE_EDGE_QUEUE_SIZE - 1u));
+        s_stats.edges_dropped++;
+    }
+    s_edge_q[s_edge_head].slave   = slave;
+    s_edge_q[s_edge_head].button  = button;
+    s_edge_q[s_edge_head].pressed = pressed;
+    s_edge_q[s_edge_head].timed   = timed;
+    s_edge_q[s_edge_head].t_us    = t_us;
+    s_edge_head = next;
+
+    if (timed) s_stats.edges_timed++;
+    else       s_stats.edges_untimed++;
+}
+
+// Flancos sin marca para cada bit distinto entre dos máscaras de 8 botones
+static void slave_link_mask_edges(uint8_t slave, uint8_t from, uint8_t to, uint64_t t_us)
+{
+    uint8_t diff = from ^ to;
+
+    for (uint8_t b = 0; diff; b++, diff >>= 1) {
+        if (diff & 1u) slave_link_push_edge(slave, b, (to >> b) & 1u, false, t_us);
+    }
+}
+
+static inline uint8_t slave_link_all_mask(uint8_t arcade, uint8_t normal)
+{
+    return (uint8_t)((arcade & 0x0F) | (normal << 4));
+}
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8)  |  (uint32_t)p[3];
+}
+
+// ----------------------------
+// Funciones internas: reloj del slave
+// ----------------------------
+
+// Tiempo que ocupa un frame de n bytes en el cable (8N1) a la velocidad actual
+static inline uint32_t slave_link_wire_us(uint32_t n)
+{
+    return (n * s_byte_ns + 500u) / 1000u;
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static void slave_link_sync_reset(void)
+{
+    s_sync_valid      = false;
+    s_sync_pending    = false;
+    s_sync_count      = 0;
+    s_sync_drift_ppb  = 0;
+    s_sync_jitter_us  = 0;
+    s_sync_rtt_min_us = UINT32_MAX;
+}
+
+// Hora del master que el modelo da para ds us del slave desde ref
+static inline uint64_t slave_link_sync_eval(int64_t ds)
+{
+    return s_sync_ref_m + (uint64_t)(ds + ds * s_sync_drift_ppb / 1000000000);
+}
+
+static void slave_link_sync_sample(uint32_t t3, uint64_t m3, uint32_t rtt);
+
+// SYNC_RESP: [t1][t2][t3]
+static void slave_link_on_sync(const uint8_t *payload, uint8_t len)
+{
+    if (!s_sync_pending || len != CTRL_SYNC_RESP_LEN) return;
+    if (get_u32(&payload[0]) != (uint32_t)s_sync_t1_us) return;   // de un intercambio viejo
+    s_sync_pending = false;
+
+    // Llevar t2 y t4 al principio de cada frame: así los dos sentidos son
+    // simétricos aunque SYNC_REQ y SYNC_RESP tengan tamaños distintos
+    uint32_t t2 = get_u32(&payload[4]) -
+                  slave_link_wire_us(CTRL_V2_HDR_SIZE + CTRL_SYNC_REQ_LEN + CTRL_V2_CRC_SIZE);
+    uint32_t t3 = get_u32(&payload[8]);
+    uint64_t t4 = s_v2_rx_end_us -
+                  slave_link_wire_us(CTRL_V2_HDR_SIZE + CTRL_SYNC_RESP_LEN + CTRL_V2_CRC_SIZE);
+
+    int32_t hold = (int32_t)(t3 - t2);                      // dentro del slave
+    int32_t rtt  = (int32_t)(t4 - s_sync_t1_us) - hold;     // ida + vuelta
+    if (hold < 0 || rtt < 0) {
+        s_stats.sync_rejected++;
+        return;
+    }
+
+    // Par (slave t3, master m3): m3 = t3 + offset NTP = t4 - RTT / 2
+    slave_link_sync_sample(t3, t4 - (uint32_t)rtt / 2u, (uint32_t)rtt);
+}
+
+// Un par (hora del slave t3, hora del master m3) medido con ese RTT: filtro
+// de RTT y corrección del modelo
+static void slave_link_sync_sample(uint32_t t3, uint64_t m3, uint32_t rtt)
+{
+    // Sólo muestras con RTT cerca del mínimo reciente. El mínimo envejece para
+    // readaptarse si el enlace se vuelve más lento (p. ej. otra velocidad).
+    if (rtt < s_sync_rtt_min_us) s_sync_rtt_min_us = rtt;
+    bool accept = rtt <= s_sync_rtt_min_us + SLAVE_SYNC_RTT_SLACK_US;
+    s_sync_rtt_min_us += SLAVE_SYNC_RTT_AGE_US;
+    if (!accept) {
+        s_stats.sync_rejected++;
+        return;
+    }
+
+    if (!s_sync_valid) {
+        s_sync_ref_s     = t3;
+        s_sync_ref_m     = m3;
+        s_sync_drift_ppb = 0;
+        s_sync_jitter_us = 0;
+        s_sync_count     = 0;
+        s_sync_valid     = true;
+    } else {
+        uint64_t s3 = s_sync_ref_s + (uint64_t)(int64_t)(int32_t)(t3 - (uint32_t)s_sync_ref_s);
+
+        int64_t ds    = (int64_t)(s3 - s_sync_ref_s);
+        uint64_t pred = slave_link_sync_eval(ds);
+        int64_t resid = (int64_t)(m3 - pred);
+
+        if (resid > SLAVE_SYNC_STEP_US || resid < -SLAVE_SYNC_STEP_US) {
+            // Salto (el slave se reinició, o el modelo se fue): empezar de nuevo
+            s_stats.sync_steps++;
+            s_sync_ref_s     = t3;
+            s_sync_ref_m     = m3;
+            s_sync_drift_ppb = 0;
+            s_sync_jitter_us = 0;
+            s_sync_count     = 0;
+        } else {
+            s_sync_ref_s = s3;
+            s_sync_ref_m = pred + (uint64_t)(resid / 2);
+
+            if (ds > 0) {
+                int64_t drift = s_sync_drift_ppb +
+                                (resid * 1000000000 / ds) / (1 << SLAVE_SYNC_FREQ_SHIFT);
+                if (drift >  SLAVE_SYNC_DRIFT_MAX_PPB) drift =  SLAVE_SYNC_DRIFT_MAX_PPB;
+                if (drift < -SLAVE_SYNC_DRIFT_MAX_PPB) drift = -SLAVE_SYNC_DRIFT_MAX_PPB;
+                s_sync_drift_ppb = (int32_t)drift;
+            }
+
+            uint32_t a = (uint32_t)(resid < 0 ? -resid : resid);
+            s_sync_jitter_us = (a > s_sync_jitter_us)
+                             ? s_sync_jitter_us + (a - s_sync_jitter_us + 7u) / 8u
+                             : s_sync_jitter_us - (s_sync_jitter_us - a) / 8u;
+        }
+    }
+
+    s_sync_count++;
+    s_sync_err_us     = rtt / 2u + s_sync_jitter_us;
+    s_sync_last_ok_us = (uint32_t)m3;
+
+    s_stats.sync_samples++;
+    s_stats.sync_rtt_us    = rtt;
+    s_stats.sync_offset_us = (int32_t)(s_sync_ref_m - s_sync_ref_s);
+    s_stats.sync_drift_ppb = s_sync_drift_ppb;
+    s_stats.sync_err_us    = s_sync_err_us;
+}
+
+// EDGE con marcas: encola los flancos y devuelve la máscara final (-1 si está
+// mal formado). Flancos que no cambian nada respecto a lo que ya se sabe
+// (repetidos tras un FULL) se ignoran.
+static int slave_link_on_edges(uint8_t slave, const uint8_t *payload, uint8_t len,
+                               uint8_t mask, uint64_t now_us)
+{
+    if (len < CTRL_V2_EDGE_HDR_LEN ||
+        (len - CTRL_V2_EDGE_HDR_LEN) % CTRL_V2_EDGE_ENTRY_LEN != 0) {
+        return -1;
+    }
+
+    uint32_t t_tx = get_u32(&payload[1]);
+
+    for (uint8_t i = CTRL_V2_EDGE_HDR_LEN; i < len; i += CTRL_V2_EDGE_ENTRY_LEN) {
+        uint8_t id      = payload[i] & (uint8_t)~CTRL_V2_EDGE_PRESSED;
+        bool    pressed = (payload[i] & CTRL_V2_EDGE_PRESSED) != 0;
+
+        if (id >= 8) return -1;
+        if ((((mask >> id) & 1u) != 0) == pressed) continue;
+
+        uint32_t t_edge = get_u32(&payload[i + 1]);
+        uint32_t age    = t_tx - t_edge;
+        uint64_t t_m;
+
+        if (slave_time_to_master_us(t_edge, &t_m, NULL)) {
+            slave_link_push_edge(slave, id, pressed, true, t_m);
+        } else if (age < SLAVE_EDGE_MAX_AGE_US && age < now_us) {
+            slave_link_push_edge(slave, id, pressed, true, now_us - age);
+        } else {
+            slave_link_push_edge(slave, id, pressed, false, now_us);
+        }
+        mask ^= (uint8_t)(1u << id);
+    }
+    return mask;
+}
 
 // ----------------------------
 // Función interna: procesar un payload completo
@@ -37,8 +529,9 @@ static void slave_link_on_payload_complete(const uint8_t *payload)
 {
     // Verificar checksum se hace afuera, aquí lo asumimos válido.
 
-    // Decodificar en la estructura
-    slave_state_t st = s_slave_state; // empezamos de la actual
+    // Decodificar en la estructura (v1 es siempre punto a punto: hueco 0)
+    slave_state_t *cur = &s_slot[0].st;
+    slave_state_t  st  = *cur; // empezamos de la actual
 
     int idx = 0;
     st.arcade_mask = payload[idx++];
@@ -50,97 +543,1169 @@ static void slave_link_on_payload_complete(const uint8_t *payload)
         st.pot[i] = (uint16_t)((hi << 8) | lo);
     }
 
-    st.valid          = true;
     st.last_update_us = time_us_64();
 
-    s_slave_state = st;
+    if (st.arcade_mask != cur->arcade_mask ||
+        st.normal_mask != cur->normal_mask) {
+        slave_link_mask_edges(0, slave_link_all_mask(cur->arcade_mask, cur->normal_mask),
+                              slave_link_all_mask(st.arcade_mask, st.normal_mask),
+                              st.last_update_us);
+        s_button_change = true;
+    }
+
+    st.valid = true;
+
+    *cur = st;
+    s_stats.version = 1;
 }
 
 // ----------------------------
-// API pública
+// Funciones internas: protocolo v2
 // ----------------------------
 
-void slave_link_init(void)
+// false si el frame no salió (por SPI, cola llena): quien lo manda decide si
+// reintentarlo en la siguiente vuelta
+static bool slave_link_send_v2(uint8_t type, const uint8_t *payload, uint8_t len)
 {
-    uart_init(MASTER_UART_ID, MASTER_UART_BAUDRATE);
+    uint8_t frame[CTRL_V2_MAX_FRAME];
+    uint8_t n = ctrl_v2_build_frame(type, s_tx_seq, payload, len, frame);
 
-    gpio_set_function(MASTER_UART_TX_PIN, GPIO_FUNC_UART);
-    gpio_set_function(MASTER_UART_RX_PIN, GPIO_FUNC_UART);
+    if (!n) return false;
 
-    uart_set_format(MASTER_UART_ID, 8, 1, UART_PARITY_NONE);
-    uart_set_fifo_enabled(MASTER_UART_ID, true);
+#if SLAVE_LINK_SPI
+    // Sale en la próxima transacción
+    if (s_spi_out_len + n > SLAVE_SPI_OUT_SIZE) {
+        s_stats.spi_out_drops++;
+        return false;
+    }
+    memcpy(&s_spi_out[s_spi_out_len], frame, n);
+    s_spi_out_len = (uint8_t)(s_spi_out_len + n);
+#else
+    // Son pocos bytes y el FIFO de TX está vacío casi siempre: no espera
+    uart_write_blocking(MASTER_UART_ID, frame, n);
+#endif
+    s_tx_seq++;
+    return true;
+}
 
-    s_rx_state   = RX_STATE_WAIT_H1;
-    s_payload_pos = 0;
+#if SLAVE_LINK_BUS
+// Tomar el bus para mandar y soltarlo con el último bit fuera (como mucho
+// los comandos de una vuelta y un POLL: unos 0.4 ms a 921600)
+static inline void slave_link_bus_drive(bool on)
+{
+    if (!on) uart_tx_wait_blocking(MASTER_UART_ID);
+    gpio_put(MASTER_UART_DE_PIN, on ? 1 : 0);
+}
+#endif
 
-    s_slave_state.valid = false;
-    s_slave_state.last_update_us = 0;
+// El slave perdió los parámetros (reinicio, o volvió al bus): mandarlos otra vez
+static void slave_link_params_resend(void)
+{
+    for (uint8_t id = 1; id < CTRL_PARAM_COUNT; id++) {
+        s_param_acked[id] = false;
+    }
+    s_param_sent_us = time_us_32() - SLAVE_PARAM_RETRY_US;
 }
 
-void slave_link_task(void)
+// DELTA / EDGE / FULL: aplicar sobre el estado actual
+static void slave_link_on_v2_state(uint8_t idx, uint8_t type, const uint8_t *payload, uint8_t len)
 {
-    while (uart_is_readable(MASTER_UART_ID)) {
-        uint8_t b = (uint8_t)uart_getc(MASTER_UART_ID);
+    slave_slot_t *sl = &s_slot[idx];
+
+    ctrl_payload_t pl;
+    pl.arcade_mask = sl->st.arcade_mask;
+    pl.normal_mask = sl->st.normal_mask;
+    for (int i = 0; i < CTRL_FRAME_NUM_POTS; i++) {
+        pl.pot[i] = sl->st.pot[i];
+    }
+
+    uint64_t now_us = s_v2_rx_end_us;
+    uint8_t  known  = slave_link_all_mask(pl.arcade_mask, pl.normal_mask);
+
+    if (type == CTRL_V2_T_EDGE) {
+        if (len == 0) {
+            s_stats.format_errors++;
+            return;
+        }
+        if (len > 1) {
+            int m = slave_link_on_edges(idx, payload, len, known, now_us);
+            if (m < 0) {
+                s_stats.format_errors++;
+                return;
+            }
+            known = (uint8_t)m;
+        }
+        pl.arcade_mask = payload[0] & 0x0F;
+        pl.normal_mask = payload[0] >> 4;
+    } else if (ctrl_v2_decode_state(payload, len, &pl) < 0) {
+        s_stats.format_errors++;
+        return;
+    }
+
+    if (type == CTRL_V2_T_FULL) {
+        sl->synced      = true;
+        sl->need_resync = false;
+    } else if (!sl->synced) {
+        // Los campos que trae son buenos, pero el resto puede estar viejo
+        sl->need_resync = true;
+    }
+
+    slave_state_t st = sl->st;
+
+    // Lo que la máscara dice y los flancos con marca no explicaron
+    slave_link_mask_edges(idx, known, slave_link_all_mask(pl.arcade_mask, pl.normal_mask), now_us);
+
+    if (pl.arcade_mask != st.arcade_mask || pl.normal_mask != st.normal_mask) {
+        s_button_change = true;
+    }
+
+    st.arcade_mask = pl.arcade_mask;
+    st.normal_mask = pl.normal_mask;
+    for (int i = 0; i < CTRL_FRAME_NUM_POTS; i++) {
+        st.pot[i] = pl.pot[i];
+    }
+
+    // Hasta el primer FULL no se da el estado por bueno
+    if (sl->synced) st.valid = true;
+    st.last_update_us = now_us;
+
+    sl->st          = st;
+    s_stats.version = 2;
+}
+
+static void slave_link_set_baud(uint8_t idx)
+{
+    uint32_t rate = ctrl_protocol_baud_rate(idx);
+    if (rate == 0) return;
+
+    uart_tx_wait_blocking(MASTER_UART_ID);   // no cortar lo último que salió
+    uart_set_baudrate(MASTER_UART_ID, rate);
+    s_baud_idx   = idx;
+    s_byte_ns    = 10000000000ull / rate;
+    s_stats.baud = rate;
+
+    // El RTT mínimo de antes ya no vale de referencia
+    s_sync_pending    = false;
+    s_sync_rtt_min_us = UINT32_MAX;
+
+    // Lo que se cruce durante el cambio no cuenta como pérdida
+    s_slot[0].synced = false;
+}
+
+static void slave_link_on_baud_frame(uint8_t type, const uint8_t *payload, uint8_t len)
+{
+    if (type == CTRL_V2_T_BAUD_OK) {
+        if (s_baud_state != LINK_BAUD_WAIT_OK || len < 1 || payload[0] != s_baud_try) return;
+
+        // El slave cambia en cuanto vacía su TX: cambiar ya
+        s_baud_prev     = s_baud_idx;
+        slave_link_set_baud(s_baud_try);
+        s_baud_state    = LINK_BAUD_TESTING;
+        s_baud_tests_ok = 0;
+        s_baud_t0_us    = time_us_32();
+        s_baud_err_base = s_stats.checksum_errors;
+        return;
+    }
+
+    // BAUD_TEST: el patrón tiene que llegar exacto
+    if (s_baud_state != LINK_BAUD_TESTING || len != CTRL_BAUD_TEST_LEN) return;
+
+    uint8_t pat[CTRL_BAUD_TEST_LEN];
+    ctrl_protocol_baud_pattern(s_baud_idx, payload[1], pat);
+    if (memcmp(pat, payload, CTRL_BAUD_TEST_LEN) == 0) {
+        s_baud_tests_ok++;
+    }
+}
+
+static void slave_link_on_v2_frame(const uint8_t *frame)
+{
+    uint8_t        type    = CTRL_V2_TYPE(frame[2]);
+    uint8_t        addr    = CTRL_V2_ADDR(frame[2]);
+    uint8_t        seq     = frame[3];
+    uint8_t        len     = frame[4];
+    const uint8_t *payload = &frame[CTRL_V2_HDR_SIZE];
+
+    // Punto a punto: dirección 0, hueco 0. Bus: dirección 1..7, hueco addr - 1
+    if (SLAVE_LINK_BUS ? (addr == 0) : (addr != 0)) {
+        s_stats.format_errors++;
+        return;
+    }
+    uint8_t       idx = SLAVE_LINK_BUS ? (uint8_t)(addr - 1) : 0;
+    slave_slot_t *sl  = &s_slot[idx];
+
+    // Pérdidas: todos los frames del slave llevan seq. El FULL y el HELLO no
+    // cuentan (el slave pudo reiniciarse y empezar de 0); el siguiente frame
+    // de estado tras un hueco pide RESYNC.
+    if (type != CTRL_V2_T_FULL && type != CTRL_V2_T_HELLO &&
+        sl->synced && seq != sl->expect_seq) {
+        s_stats.seq_lost += (uint8_t)(seq - sl->expect_seq);
+        sl->synced = false;
+    }
+    sl->expect_seq = (uint8_t)(seq + 1);
 
+    switch (type) {
+    case CTRL_V2_T_DELTA:
+    case CTRL_V2_T_EDGE:
+    case CTRL_V2_T_FULL:
+        slave_link_on_v2_state(idx, type, payload, len);
+        break;
+
+    case CTRL_V2_T_DESC:
+        if (len < CTRL_DESC_LEN) {
+            s_stats.format_errors++;
+            break;
+        }
+        sl->desc.n_arcade   = payload[0];
+        sl->desc.n_normal   = payload[1];
+        sl->desc.n_pots     = payload[2];
+        sl->desc.n_encoders = payload[3];
+        sl->desc.pot_bits   = payload[4];
+        sl->has_desc        = true;
+        s_stats.descs++;
+
+        // Por SPI no hay HELLO: el descriptor es lo primero que manda al arrancar
+        if (SLAVE_LINK_SPI) slave_link_params_resend();
+        break;
+
+    case CTRL_V2_T_END:
+        if (SLAVE_LINK_BUS && s_bus_state == LINK_BUS_WAIT && addr == s_bus_addr) {
+            s_bus_end = true;
+        }
+        break;
+
+    case CTRL_V2_T_SYNC_RESP:
+        slave_link_on_sync(payload, len);
+        break;
+
+    case CTRL_V2_T_HELLO:
+    {
+        // En el bus no hay negociación (y no se puede hablar sin turno)
+        if (SLAVE_LINK_BUS) break;
+
+        // Contestar con la versión más alta que hablamos los dos
+        uint8_t v = (len >= 1) ? payload[0] : 1;
+        if (v > CTRL_PROTOCOL_VERSION) v = CTRL_PROTOCOL_VERSION;
+        slave_link_send_v2(CTRL_V2_T_ACK, &v, 1);
+
+        // El slave arrancó de nuevo: perdió los parámetros, volver a mandarlos
+        slave_link_params_resend();
+        sl->has_desc = false;
+        break;
+    }
+
+    case CTRL_V2_T_CONFIG_ACK:
+        for (uint8_t i = 0; i + CTRL_PARAM_ENTRY_LEN <= len; i += CTRL_PARAM_ENTRY_LEN) {
+            uint8_t id = payload[i];
+            if (id == 0 || id >= CTRL_PARAM_COUNT) continue;
+
+            s_param_applied[id] = (uint16_t)((payload[i + 1] << 8) | payload[i + 2]);
+            s_param_known[id]   = true;
+            s_param_acked[id]   = (s_param_sent[id] == s_param_req[id]);
+        }
+        s_stats.config_acks++;
+        break;
+
+    case CTRL_V2_T_BAUD_OK:
+    case CTRL_V2_T_BAUD_TEST:
+        slave_link_on_baud_frame(type, payload, len);
+        break;
+
+    default:
+        s_stats.format_errors++;
+        break;
+    }
+}
+
+// ----------------------------
+// Funciones internas: DMA
+// ----------------------------
+
+#if !SLAVE_LINK_SPI
+static void slave_link_dma_start(uint32_t count)
+{
+    dma_channel_config c = dma_channel_get_default_config((uint)s_rx_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);                 // siempre el registro DR
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, SLAVE_RX_RING_BITS);        // escritura da la vuelta en el anillo
+    channel_config_set_dreq(&c, uart_get_dreq(MASTER_UART_ID, false));
+
+    dma_channel_configure((uint)s_rx_dma, &c,
+                          &s_rx_ring[(s_rx_base) & SLAVE_RX_RING_MASK],
+                          &uart_get_hw(MASTER_UART_ID)->dr,
+                          count, true);
+}
+
+// Total de bytes que el DMA ha escrito desde el arranque (monotónico)
+static inline uint32_t slave_link_rx_head(void)
+{
+    return s_rx_base + (SLAVE_RX_DMA_COUNT - dma_hw->ch[s_rx_dma].transfer_count);
+}
+
+// El contador del canal baja con cada byte: antes de que llegue a 0 se para el
+// canal (los bytes que lleguen mientras tanto esperan en el FIFO del UART) y
+// se vuelve a armar en la misma posición del anillo.
+static void slave_link_dma_rearm_if_needed(void)
+{
+    if (dma_hw->ch[s_rx_dma].transfer_count >= SLAVE_RX_REARM_BELOW) return;
+
+    dma_channel_abort((uint)s_rx_dma);
+    s_rx_base += SLAVE_RX_DMA_COUNT - dma_hw->ch[s_rx_dma].transfer_count;
+    slave_link_dma_start(SLAVE_RX_DMA_COUNT);
+}
+#endif
+
+// ----------------------------
+// Función interna: parser sobre un tramo contiguo del anillo
+// ----------------------------
+//
+// Los bytes de payload se copian en bloque y la cabecera se busca con memchr,
+// así que el coste por byte es mucho menor que llamar a uart_getc() por byte.
+static void slave_link_parse_span(const uint8_t *p, uint32_t n)
+{
+    while (n > 0) {
         switch (s_rx_state) {
         case RX_STATE_WAIT_H1:
-            if (b == CTRL_FRAME_HEADER_1) {
-                s_rx_state   = RX_STATE_WAIT_H2;
+        {
+            const uint8_t *h = memchr(p, CTRL_FRAME_HEADER_1, n);
+            if (!h) {
+                s_stats.skipped_bytes += n;
+                return;
             }
+            s_stats.skipped_bytes += (uint32_t)(h - p);
+            n -= (uint32_t)(h - p) + 1u;
+            p  = h + 1;
+            s_rx_state = RX_STATE_WAIT_H2;
             break;
+        }
 
         case RX_STATE_WAIT_H2:
-            if (b == CTRL_FRAME_HEADER_2) {
-                s_rx_state   = RX_STATE_PAYLOAD;
+            if (*p == CTRL_FRAME_HEADER_2) {
+                s_rx_state    = RX_STATE_PAYLOAD;
                 s_payload_pos = 0;
+                p++; n--;
+            } else if (*p == CTRL_V2_HEADER_2) {
+                s_rx_state  = RX_STATE_V2_FRAME;
+                s_v2_buf[0] = CTRL_FRAME_HEADER_1;
+                s_v2_buf[1] = CTRL_V2_HEADER_2;
+                s_v2_pos    = 2;
+                s_v2_want   = CTRL_V2_HDR_SIZE;
+                p++; n--;
             } else {
-                // No era el segundo header → volver a buscar H1
+                // No era el segundo header → volver a buscar H1 (sin consumir:
+                // este byte puede ser el H1 de la siguiente trama)
                 s_rx_state = RX_STATE_WAIT_H1;
             }
             break;
 
         case RX_STATE_PAYLOAD:
-            s_payload_buf[s_payload_pos++] = b;
+        {
+            uint32_t want = CTRL_FRAME_PAYLOAD_SIZE - s_payload_pos;
+            uint32_t take = (n < want) ? n : want;
+
+            memcpy(&s_payload_buf[s_payload_pos], p, take);
+            s_payload_pos = (uint8_t)(s_payload_pos + take);
+            p += take; n -= take;
+
             if (s_payload_pos >= CTRL_FRAME_PAYLOAD_SIZE) {
                 s_rx_state = RX_STATE_CHECKSUM;
             }
             break;
+        }
 
         case RX_STATE_CHECKSUM:
         {
-            uint8_t cs_rx = b;
+            uint8_t cs_rx = *p++;
             uint8_t cs_ok = ctrl_protocol_calc_checksum(s_payload_buf,
                                                        CTRL_FRAME_PAYLOAD_SIZE);
+            n--;
+
             if (cs_rx == cs_ok) {
                 // Frame válido
                 slave_link_on_payload_complete(s_payload_buf);
+                s_last_valid_us = time_us_32();
+                s_stats.frames_ok++;
+                s_stats.frames_v1++;
+            } else {
+                s_stats.checksum_errors++;
             }
             // En cualquier caso, reiniciar parser
-            s_rx_state   = RX_STATE_WAIT_H1;
+            s_rx_state    = RX_STATE_WAIT_H1;
             s_payload_pos = 0;
+            break;
+        }
+
+        case RX_STATE_V2_FRAME:
+        {
+            uint32_t want = (uint32_t)(s_v2_want - s_v2_pos);
+            uint32_t take = (n < want) ? n : want;
+
+            memcpy(&s_v2_buf[s_v2_pos], p, take);
+            s_v2_pos = (uint8_t)(s_v2_pos + take);
+            p += take; n -= take;
+
+            if (s_v2_pos < s_v2_want) break;
+
+            if (s_v2_want == CTRL_V2_HDR_SIZE) {
+                // Cabecera completa: ya sabemos cuánto falta
+                uint8_t len = s_v2_buf[4];
+                if (len > CTRL_V2_MAX_PAYLOAD) {
+                    s_stats.format_errors++;
+                    s_rx_state = RX_STATE_WAIT_H1;
+                    break;
+                }
+                s_v2_want = (uint8_t)(CTRL_V2_HDR_SIZE + len + CTRL_V2_CRC_SIZE);
+                break;
+            }
+
+            if (ctrl_v2_check_frame(s_v2_buf, s_v2_pos)) {
+                // Lo que llegó detrás de este frame tardó su tiempo en llegar
+                s_v2_rx_end_us = s_rx_head_us - slave_link_wire_us(n + s_rx_rest);
+                slave_link_on_v2_frame(s_v2_buf);
+                s_last_valid_us = time_us_32();
+                s_stats.frames_ok++;
+                s_stats.frames_v2++;
+            } else {
+                s_stats.checksum_errors++;
+            }
+            s_rx_state = RX_STATE_WAIT_H1;
+            break;
         }
-        break;
 
         default:
-            s_rx_state   = RX_STATE_WAIT_H1;
+            s_rx_state    = RX_STATE_WAIT_H1;
             s_payload_pos = 0;
             break;
         }
     }
 }
 
+// ----------------------------
+// Función interna: comandos master → slave
+// ----------------------------
+
+static void slave_link_command_task(uint32_t now)
+{
+    // Sólo con v2 y sin cambio de velocidad a medias
+    if (s_stats.version != 2 || s_baud_state != LINK_BAUD_IDLE) return;
+
+    uint8_t snap = s_snapshot_req;
+    if (snap != s_snapshot_sent && slave_link_send_v2(CTRL_V2_T_SNAPSHOT, NULL, 0)) {
+        s_snapshot_sent = snap;
+    }
+
+    bool    retry = (now - s_param_sent_us) >= SLAVE_PARAM_RETRY_US;
+    uint8_t buf[CTRL_PARAM_MAX_PER_FRAME * CTRL_PARAM_ENTRY_LEN];
+    uint8_t n = 0;
+
+    for (uint8_t id = 1; id < CTRL_PARAM_COUNT && n < sizeof(buf); id++) {
+        uint8_t req = s_param_req[id];
+        if (req == 0) continue;                                  // nunca pedido
+        if (req == s_param_sent[id] && (s_param_acked[id] || !retry)) continue;
+
+        __dmb();   // el valor se escribió antes que req
+        uint16_t v = s_param_want[id];
+
+        s_param_sent[id]  = req;
+        s_param_acked[id] = false;
+        buf[n++] = id;
+        buf[n++] = (uint8_t)(v >> 8);
+        buf[n++] = (uint8_t)(v & 0xFF);
+    }
+
+    // Si no sale, s_param_sent_us queda viejo y se reintenta en la siguiente vuelta
+    if (n > 0 && slave_link_send_v2(CTRL_V2_T_CONFIG, buf, n)) {
+        s_param_sent_us = now;
+        s_stats.configs_sent++;
+    }
+}
+
+// ----------------------------
+// Funciones internas: bus multi-slave
+// ----------------------------
+
+#if SLAVE_LINK_BUS
+// Siguiente dirección con turno: las presentes en orden y, al acabar cada
+// vuelta, una ausente (descubrimiento). 0 = esperar a la vuelta siguiente.
+static uint8_t slave_link_bus_next(uint32_t now)
+{
+    while (s_bus_next < SLAVE_LINK_MAX_SLAVES) {
+        uint8_t i = s_bus_next++;
+        if (s_slot[i].present) return (uint8_t)(i + 1);
+    }
+
+    // Fin de vuelta: una ausente, y la siguiente vuelta no antes de su hora
+    if (s_bus_next == SLAVE_LINK_MAX_SLAVES) {
+        s_bus_next++;
+        for (uint8_t k = 0; k < SLAVE_LINK_MAX_SLAVES; k++) {
+            uint8_t i = s_bus_probe;
+            s_bus_probe = (uint8_t)((s_bus_probe + 1u) % SLAVE_LINK_MAX_SLAVES);
+            if (!s_slot[i].present) return (uint8_t)(i + 1);
+        }
+    }
+
+    if (now - s_bus_cycle_t0 < SLAVE_BUS_CYCLE_MIN_US) return 0;
+
+    uint32_t dt = now - s_bus_cycle_t0;
+    s_stats.bus_cycle_us = dt;
+    if (dt > s_stats.bus_cycle_us_max) s_stats.bus_cycle_us_max = dt;
+    s_bus_cycle_t0 = now;
+    s_bus_next     = 0;
+    return slave_link_bus_next(now);
+}
+
+// Cierra el turno de s_bus_addr: contestó (END) o se le acabó el tiempo
+static void slave_link_bus_turn_done(uint32_t now)
+{
+    slave_slot_t *sl = &s_slot[s_bus_addr - 1];
+
+    if (s_bus_end) {
+        sl->misses = 0;
+        if (!sl->present) {
+            // Slave nuevo (o que vuelve): no sabemos qué parámetros tiene
+            sl->present = true;
+            s_stats.slaves_present++;
+            slave_link_params_resend();
+        }
+    } else {
+        s_stats.bus_timeouts++;
+        if (sl->present && ++sl->misses >= SLAVE_BUS_MISS_MAX) {
+            sl->present  = false;
+            sl->synced   = false;
+            sl->has_desc = false;
+            sl->st.valid = false;
+            s_stats.slaves_present--;
+        }
+    }
+
+    s_bus_state   = LINK_BUS_IDLE;
+    s_bus_idle_us = now;
+}
+
+static void slave_link_bus_task(uint32_t now)
+{
+    if (s_bus_state == LINK_BUS_WAIT) {
+        // El slave puede tardar en contestar y en vaciar lo que acumuló: sólo
+        // se le quita el turno cuando el bus lleva un rato callado
+        if (!s_bus_end && now - s_bus_rx_us < SLAVE_BUS_SLOT_TIMEOUT_US) return;
+        slave_link_bus_turn_done(now);
+    }
+
+    if (now - s_bus_idle_us < SLAVE_BUS_GUARD_US) return;
+
+    uint8_t addr = slave_link_bus_next(now);
+    if (addr == 0) return;
+
+    slave_slot_t *sl    = &s_slot[addr - 1];
+    uint8_t       flags = 0;
+
+    if (!sl->has_desc) flags |= CTRL_POLL_F_DESC;
+    if (!sl->synced || sl->need_resync) {
+        // El RESYNC de punto a punto, aquí dentro del POLL
+        if (sl->need_resync && now - sl->last_resync_us >= SLAVE_V2_RESYNC_MIN_US) {
+            sl->last_resync_us = now;
+            s_stats.resync_requests++;
+        }
+        flags |= CTRL_POLL_F_FULL;
+    }
+
+    slave_link_bus_drive(true);
+    slave_link_command_task(now);   // difusión: CONFIG / SNAPSHOT a todos
+    slave_link_send_v2(CTRL_V2_MAKE_TYPE(addr, CTRL_V2_T_POLL), &flags, 1);
+    slave_link_bus_drive(false);
+
+    s_bus_state = LINK_BUS_WAIT;
+    s_bus_addr  = addr;
+    s_bus_end   = false;
+    s_bus_rx_us = time_us_32();
+    s_stats.bus_polls++;
+}
+#endif
+
+#if SLAVE_LINK_SPI
+// ----------------------------
+// Funciones internas: transporte SPI
+// ----------------------------
+
+static void slave_link_spi_start(uint32_t now)
+{
+    // Frames enteros de la cola, los que quepan
+    uint8_t n = 0;
+    while (n < s_spi_out_len) {
+        uint8_t fl = (uint8_t)CTRL_V2_FRAME_LEN(&s_spi_out[n]);
+        if ((uint32_t)n + fl > CTRL_SPI_XFER_LEN) break;
+        n = (uint8_t)(n + fl);
+    }
+    memcpy(s_spi_tx, s_spi_out, n);
+    memset(&s_spi_tx[n], 0, CTRL_SPI_XFER_LEN - n);
+    memmove(s_spi_out, &s_spi_out[n], s_spi_out_len - n);
+    s_spi_out_len = (uint8_t)(s_spi_out_len - n);
+
+    s_spi_busy  = true;
+    s_spi_t0_us = now;
+    s_spi_cs_us = time_us_64();
+    gpio_put(MASTER_SPI_CS_PIN, 0);
+
+    // RX primero: que no se pierda el primer byte que entra
+    dma_channel_transfer_to_buffer_now((uint)s_spi_rx_dma, s_spi_rx, CTRL_SPI_XFER_LEN);
+    dma_channel_transfer_from_buffer_now((uint)s_spi_tx_dma, s_spi_tx, CTRL_SPI_XFER_LEN);
+}
+
+// Par de horas de una bajada de CS para el modelo de reloj. Al ritmo de los
+// SYNC_REQ del UART: con una muestra cada 250 us el lazo de frecuencia vería
+// sobre todo el redondeo a 1 us.
+static void slave_link_spi_sync(uint32_t t_s, uint64_t t_m, uint32_t now)
+{
+    uint32_t period = (s_sync_count < SLAVE_SYNC_FAST_SAMPLES) ? SLAVE_SYNC_FAST_US
+                                                               : SLAVE_SYNC_PERIOD_US;
+    if (now - s_sync_sent_us < period) return;
+
+    s_sync_sent_us = now;
+    slave_link_sync_sample(t_s, t_m + SLAVE_SPI_CS_LAT_US, 2u * SLAVE_SPI_CS_LAT_US);
+}
+
+static void slave_link_spi_finish(uint32_t now)
+{
+    gpio_put(MASTER_SPI_CS_PIN, 1);
+
+    uint64_t t_end = time_us_64();
+    uint32_t dt    = (uint32_t)(t_end - s_spi_cs_us);
+    s_spi_busy = false;
+
+    s_stats.spi_xfers++;
+    s_stats.spi_xfer_us = dt;
+    if (dt > s_stats.spi_xfer_us_max) s_stats.spi_xfer_us_max = dt;
+    s_stats.bytes += CTRL_SPI_XFER_LEN;
+
+    const uint8_t *p   = s_spi_rx;
+    uint16_t       crc = ctrl_protocol_crc16(CTRL_CRC16_INIT, p, CTRL_SPI_HDR_LEN);
+    uint64_t       prev_us = s_spi_prev_us;
+    s_spi_prev_us = s_spi_cs_us;
+
+    if (p[0] != CTRL_SPI_MAGIC || p[2] > CTRL_SPI_STREAM_MAX ||
+        p[CTRL_SPI_HDR_LEN] != (uint8_t)(crc >> 8) ||
+        p[CTRL_SPI_HDR_LEN + 1] != (uint8_t)(crc & 0xFF)) {
+        // Sin slave (MISO al aire) o ruido: como cualquier CRC malo
+        s_stats.checksum_errors++;
+        s_spi_have_seq = false;
+        return;
+    }
+
+    // El slave no rearmó (su IRQ de CS no llegó a tiempo): es el bloque de
+    // antes otra vez y sus frames ya se procesaron
+    uint8_t seq = p[1];
+    if (s_spi_have_seq && seq == s_spi_seq) {
+        s_stats.spi_stale++;
+        return;
+    }
+
+    // t_cs es la bajada de CS de la transacción anterior, si el slave armó
+    // este bloque justo al terminar aquella
+    if (s_spi_have_seq && seq == (uint8_t)(s_spi_seq + 1u)) {
+        slave_link_spi_sync(get_u32(&p[3]), prev_us, now);
+    }
+    s_spi_seq      = seq;
+    s_spi_have_seq = true;
+
+    // Flujo de frames v2: flancos con marca, DESC, CONFIG_ACK. Nunca queda
+    // un frame partido, así que el parser empieza de cero en cada bloque.
+    uint32_t t0 = time_us_32();
+    s_rx_state   = RX_STATE_WAIT_H1;
+    s_rx_head_us = t_end;
+    s_rx_rest    = 0;
+    slave_link_parse_span(&p[CTRL_SPI_BLOCK_LEN], p[2]);
+
+    // Estado entero: sus botones son los del último EDGE de arriba
+    s_v2_rx_end_us  = t_end;
+    s_last_valid_us = (uint32_t)t_end;
+    slave_link_on_v2_state(0, CTRL_V2_T_FULL, &p[7], CTRL_V2_STATE_MAX);
+
+    uint32_t pt = time_us_32() - t0;
+    s_stats.parse_us_total += pt;
+    if (pt > s_stats.parse_us_max) s_stats.parse_us_max = pt;
+}
+
+static void slave_link_spi_task(uint32_t now)
+{
+    if (s_spi_busy) {
+        // Lo mueve el propio master: termina siempre, en ~60 us
+        if (dma_channel_is_busy((uint)s_spi_rx_dma) || spi_is_busy(MASTER_SPI_ID)) return;
+        slave_link_spi_finish(now);
+    }
+
+    if (now - s_spi_t0_us >= SLAVE_SPI_PERIOD_US) {
+        slave_link_spi_start(now);
+    }
+}
+
+static void slave_link_spi_init(void)
+{
+    spi_init(MASTER_SPI_ID, CTRL_SPI_HZ);
+    spi_set_format(MASTER_SPI_ID, 8, SPI_CPOL_1, SPI_CPHA_1, SPI_MSB_FIRST);
+    gpio_set_function(MASTER_SPI_RX_PIN,  GPIO_FUNC_SPI);
+    gpio_set_function(MASTER_SPI_SCK_PIN, GPIO_FUNC_SPI);
+    gpio_set_function(MASTER_SPI_TX_PIN,  GPIO_FUNC_SPI);
+
+    gpio_init(MASTER_SPI_CS_PIN);
+    gpio_set_dir(MASTER_SPI_CS_PIN, GPIO_OUT);
+    gpio_put(MASTER_SPI_CS_PIN, 1);
+
+    if (s_spi_tx_dma < 0) s_spi_tx_dma = dma_claim_unused_channel(true);
+    if (s_spi_rx_dma < 0) s_spi_rx_dma = dma_claim_unused_channel(true);
+
+    dma_channel_config c = dma_channel_get_default_config((uint)s_spi_tx_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);                // siempre el registro DR
+    channel_config_set_dreq(&c, spi_get_dreq(MASTER_SPI_ID, true));
+    dma_channel_configure((uint)s_spi_tx_dma, &c, &spi_get_hw(MASTER_SPI_ID)->dr,
+                          s_spi_tx, 0, false);
+
+    c = dma_channel_get_default_config((uint)s_spi_rx_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, spi_get_dreq(MASTER_SPI_ID, false));
+    dma_channel_configure((uint)s_spi_rx_dma, &c, s_spi_rx,
+                          &spi_get_hw(MASTER_SPI_ID)->dr, 0, false);
+
+    s_spi_out_len  = 0;
+    s_spi_busy     = false;
+    s_spi_have_seq = false;
+    s_spi_t0_us    = time_us_32();
+}
+#endif
+
+// ----------------------------
+// Función interna: sincronización del reloj
+// ----------------------------
+
+#if !SLAVE_LINK_BUS && !SLAVE_LINK_SPI
+static void slave_link_sync_task(uint32_t now)
+{
+    // Sólo con v2 y sin cambio de velocidad a medias
+    if (s_stats.version != 2 || s_baud_state != LINK_BAUD_IDLE) {
+        s_sync_pending = false;
+        return;
+    }
+
+    if (s_sync_pending) {
+        if (now - (uint32_t)s_sync_t1_us < SLAVE_SYNC_TIMEOUT_US) return;
+        s_sync_pending = false;
+        s_stats.sync_timeouts++;
+    }
+
+    if (s_sync_valid && now - s_sync_last_ok_us >= SLAVE_SYNC_LOST_US) {
+        slave_link_sync_reset();
+    }
+
+    uint32_t period = (s_sync_count < SLAVE_SYNC_FAST_SAMPLES) ? SLAVE_SYNC_FAST_US
+                                                               : SLAVE_SYNC_PERIOD_US;
+    if (now - s_sync_sent_us < period) return;
+
+    // t1 tiene que ser cuando sale el primer byte: con algo en el TX, otra vuelta
+    if (uart_get_hw(MASTER_UART_ID)->fr & UART_UARTFR_BUSY_BITS) return;
+
+    uint8_t t1[CTRL_SYNC_REQ_LEN];
+    s_sync_t1_us = time_us_64();
+    put_u32(t1, (uint32_t)s_sync_t1_us);
+    if (!slave_link_send_v2(CTRL_V2_T_SYNC_REQ, t1, sizeof(t1))) return;
+    s_sync_sent_us = now;
+    s_sync_pending = true;
+}
+
+// ----------------------------
+// Función interna: negociación y vigilancia de la velocidad
+// ----------------------------
+
+// El techo sólo baja: un escalón que falló no se vuelve a intentar
+static void slave_link_baud_cap(uint8_t idx)
+{
+    if (s_baud_ceiling > idx) s_baud_ceiling = idx;
+}
+
+static void slave_link_baud_try(uint8_t idx, bool down, uint32_t now)
+{
+    s_baud_try   = idx;
+    s_baud_down  = down;
+    s_baud_state = LINK_BAUD_WAIT_OK;
+    s_baud_t0_us = now;
+    slave_link_send_v2(CTRL_V2_T_BAUD_TRY, &idx, 1);
+}
+
+static void slave_link_baud_task(uint32_t now)
+{
+    switch (s_baud_state) {
+    case LINK_BAUD_WAIT_OK:
+        if (now - s_baud_t0_us >= SLAVE_BAUD_OK_TIMEOUT_US) {
+            // Slave sin soporte (o no nos oye): no insistir hacia arriba
+            s_baud_state = LINK_BAUD_IDLE;
+            slave_link_baud_cap(s_baud_idx);
+        }
+        return;
+
+    case LINK_BAUD_TESTING:
+        if (s_baud_tests_ok >= CTRL_BAUD_TEST_FRAMES &&
+            s_stats.checksum_errors == s_baud_err_base) {
+            // Perfecto: quedarse
+            uint8_t idx = s_baud_idx;
+            slave_link_send_v2(CTRL_V2_T_BAUD_CONFIRM, &idx, 1);
+            s_baud_state    = LINK_BAUD_IDLE;
+            s_baud_next_us  = now + SLAVE_BAUD_STEP_US;
+            s_baud_win_us   = now;
+            s_baud_err_base = s_stats.checksum_errors;
+            s_last_ping_us  = now;
+        } else if (now - s_baud_t0_us >= SLAVE_BAUD_TEST_WINDOW_US) {
+            // Faltan patrones o llegaron con errores: volver (el slave vuelve
+            // solo al no recibir CONFIRM) y no intentar más este escalón. Si
+            // era una bajada, s_baud_prev es el escalón que ya fallaba: a
+            // 115200, donde el slave acaba también por su watchdog
+            uint8_t back = s_baud_down ? 0 : s_baud_prev;
+            slave_link_set_baud(back);
+            s_baud_state   = LINK_BAUD_IDLE;
+            slave_link_baud_cap(s_baud_try > 0 ? (uint8_t)(s_baud_try - 1) : 0);
+            s_baud_fail_us = now;
+            s_stats.baud_fallbacks++;
+        }
+        return;
+
+    case LINK_BAUD_IDLE:
+    default:
+        break;
+    }
+
+    if (s_baud_idx > 0) {
+        // Sin nada bueno del slave: los dos vuelven a 115200 por su cuenta
+        if (now - s_last_valid_us >= SLAVE_BAUD_DEAD_US) {
+            slave_link_baud_cap((uint8_t)(s_baud_idx - 1));
+            slave_link_set_baud(0);
+            s_stats.baud_fallbacks++;
+            return;
+        }
+
+        // Tras una prueba fallida el slave sigue en la velocidad probada hasta
+        // CTRL_BAUD_CONFIRM_US: esa basura no cuenta como errores del enlace
+        if (now - s_baud_fail_us < CTRL_BAUD_CONFIRM_US + SLAVE_BAUD_TEST_WINDOW_US) {
+            s_baud_win_us   = now;
+            s_baud_err_base = s_stats.checksum_errors;
+        }
+
+        // Demasiados errores de CRC: bajar un escalón con el handshake normal
+        if (now - s_baud_win_us >= SLAVE_BAUD_ERR_WINDOW_US) {
+            uint32_t errs   = s_stats.checksum_errors - s_baud_err_base;
+            s_baud_win_us   = now;
+            s_baud_err_base = s_stats.checksum_errors;
+            if (errs >= SLAVE_BAUD_ERR_MAX) {
+                slave_link_baud_cap((uint8_t)(s_baud_idx - 1));
+                s_stats.baud_fallbacks++;
+                slave_link_baud_try((uint8_t)(s_baud_idx - 1), true, now);
+                return;
+            }
+        }
+
+        // Ping para el watchdog del slave (el tráfico normal es sólo de subida)
+        if (now - s_last_ping_us >= CTRL_BAUD_PING_US) {
+            s_last_ping_us = now;
+            slave_link_send_v2(CTRL_V2_T_PING, NULL, 0);
+        }
+    }
+
+    // Subir un escalón cuando el enlace v2 está estable
+    if (s_stats.version == 2 && s_slot[0].synced && s_baud_idx < s_baud_ceiling &&
+        (int32_t)(now - s_baud_next_us) >= 0) {
+        slave_link_baud_try((uint8_t)(s_baud_idx + 1), false, now);
+    }
+}
+#endif
+
+// ----------------------------
+// API pública
+// ----------------------------
+
+void slave_link_init(void)
+{
+#if !SLAVE_LINK_SPI
+    uart_init(MASTER_UART_ID, MASTER_UART_BAUDRATE);
+
+    gpio_set_function(MASTER_UART_TX_PIN, GPIO_FUNC_UART);
+    gpio_set_function(MASTER_UART_RX_PIN, GPIO_FUNC_UART);
+
+    uart_set_format(MASTER_UART_ID, 8, 1, UART_PARITY_NONE);
+    uart_set_fifo_enabled(MASTER_UART_ID, true);
+#endif
+
+    s_rx_state   = RX_STATE_WAIT_H1;
+    s_payload_pos = 0;
+
+    memset(s_slot, 0, sizeof(s_slot));
+    s_tx_seq         = 0;
+    s_button_change  = false;
+
+    s_baud_state     = LINK_BAUD_IDLE;
+    s_baud_idx       = 0;
+    s_baud_down      = false;
+    s_baud_ceiling   = MASTER_UART_BAUD_MAX_IDX;
+    s_baud_next_us   = time_us_32() + SLAVE_BAUD_STEP_US;
+    s_baud_fail_us   = time_us_32() - (CTRL_BAUD_CONFIRM_US + SLAVE_BAUD_TEST_WINDOW_US);
+
+    s_snapshot_sent  = s_snapshot_req;
+
+    s_byte_ns        = 10000000000ull / MASTER_UART_BAUDRATE;
+    s_sync_sent_us   = time_us_32();
+    slave_link_sync_reset();
+
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats.baud = MASTER_UART_BAUDRATE;
+
+#if SLAVE_LINK_BUS
+    // Bus: velocidad fija, transceptor escuchando hasta el primer POLL
+    uart_set_baudrate(MASTER_UART_ID, CTRL_BUS_BAUD);
+    s_byte_ns    = 10000000000ull / CTRL_BUS_BAUD;
+    s_stats.baud = CTRL_BUS_BAUD;
+
+    gpio_init(MASTER_UART_DE_PIN);
+    gpio_set_dir(MASTER_UART_DE_PIN, GPIO_OUT);
+    gpio_put(MASTER_UART_DE_PIN, 0);
+
+    s_bus_state    = LINK_BUS_IDLE;
+    s_bus_next     = 0;
+    s_bus_probe    = 0;
+    s_bus_cycle_t0 = time_us_32();
+    s_bus_idle_us  = s_bus_cycle_t0;
+    s_bus_rx_head  = 0;
+#endif
+
+#if SLAVE_LINK_SPI
+    // SPI: reloj fijo, sin negociación (el slave empieza en v2)
+    s_byte_ns    = 8000000000ull / CTRL_SPI_HZ;
+    s_stats.baud = CTRL_SPI_HZ;
+    slave_link_spi_init();
+#else
+    // RX por DMA hacia el anillo
+    s_rx_base = 0;
+    s_rx_tail = 0;
+    if (s_rx_dma < 0) {
+        s_rx_dma = dma_claim_unused_channel(true);
+    }
+    slave_link_dma_start(SLAVE_RX_DMA_COUNT);
+#endif
+}
+
+void slave_link_task(void)
+{
+#if SLAVE_LINK_SPI
+    // SPI: una transacción por periodo (estado entero + flujo) y los comandos,
+    // que salen en la siguiente. Sin anillo, velocidad, RESYNC ni SYNC_REQ.
+    uint32_t now = time_us_32();
+    slave_link_spi_task(now);
+    slave_link_command_task(now);
+#else
+    uint32_t head = slave_link_rx_head();
+    uint32_t avail = head - s_rx_tail;
+
+    s_rx_head_us = time_us_64();
+
+#if SLAVE_LINK_BUS
+    if (head != s_bus_rx_head) {
+        // Alguien está hablando: el turno sigue vivo
+        s_bus_rx_head = head;
+        s_bus_rx_us   = (uint32_t)s_rx_head_us;
+    }
+#endif
+
+    if (avail > SLAVE_RX_RING_SIZE) {
+        // El DMA dio más de una vuelta: lo más viejo ya se pisó
+        s_stats.overrun_bytes += avail - SLAVE_RX_RING_SIZE;
+        s_rx_tail  = head - SLAVE_RX_RING_SIZE;
+        avail      = SLAVE_RX_RING_SIZE;
+        s_rx_state = RX_STATE_WAIT_H1;   // resincronizar con la próxima cabecera
+    }
+
+    uint32_t t0 = time_us_32();
+
+    if (avail > 0) {
+        // Como mucho dos tramos contiguos (antes y después de dar la vuelta)
+        while (avail > 0) {
+            uint32_t idx  = s_rx_tail & SLAVE_RX_RING_MASK;
+            uint32_t span = SLAVE_RX_RING_SIZE - idx;
+            if (span > avail) span = avail;
+
+            s_rx_rest = avail - span;
+            slave_link_parse_span(&s_rx_ring[idx], span);
+
+            s_rx_tail += span;
+            avail     -= span;
+            s_stats.bytes += span;
+            s_stats.spans++;
+        }
+
+        uint32_t dt = time_us_32() - t0;
+        s_stats.parse_us_total += dt;
+        if (dt > s_stats.parse_us_max) s_stats.parse_us_max = dt;
+    }
+
+#if SLAVE_LINK_BUS
+    // Bus: turnos, comandos y RESYNC van juntos; sin velocidad ni reloj
+    slave_link_bus_task(t0);
+#else
+    // v2: si se perdió algún frame, pedir un estado completo
+    slave_slot_t *sl = &s_slot[0];
+    if (sl->need_resync && (t0 - sl->last_resync_us) >= SLAVE_V2_RESYNC_MIN_US) {
+        if (slave_link_send_v2(CTRL_V2_T_RESYNC, NULL, 0)) {
+            sl->last_resync_us = t0;
+            s_stats.resync_requests++;
+        }
+    }
+
+    // v2: negociación / vigilancia de la velocidad (corre aunque no llegue nada)
+    slave_link_baud_task(t0);
+
+    // v2: reloj del slave (antes que los comandos: necesita el TX vacío)
+    slave_link_sync_task(t0);
+
+    // v2: parámetros y snapshots pedidos desde cualquier núcleo
+    slave_link_command_task(t0);
+#endif
+
+    slave_link_dma_rearm_if_needed();
+#endif
+}
+
 void slave_link_get_state(slave_state_t *out)
 {
-    if (!out) return;
-    *out = s_slave_state;
+    slave_link_get_state_at(0, out);
 }
 
 bool slave_link_is_alive(uint32_t timeout_ms)
 {
-    if (!s_slave_state.valid) return false;
+    return slave_link_is_alive_at(0, timeout_ms);
+}
+
+void slave_link_get_state_at(uint8_t idx, slave_state_t *out)
+{
+    if (!out) return;
+    if (idx >= SLAVE_LINK_MAX_SLAVES) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    *out = s_slot[idx].st;
+}
+
+bool slave_link_is_alive_at(uint8_t idx, uint32_t timeout_ms)
+{
+    if (idx >= SLAVE_LINK_MAX_SLAVES || !s_slot[idx].st.valid) return false;
 
     uint64_t now = time_us_64();
-    uint64_t dt  = now - s_slave_state.last_update_us;
+    uint64_t dt  = now - s_slot[idx].st.last_update_us;
 
     return (dt <= (uint64_t)timeout_ms * 1000ULL);
 }
+
+bool slave_link_get_desc(uint8_t idx, ctrl_desc_t *out)
+{
+    if (idx >= SLAVE_LINK_MAX_SLAVES || !s_slot[idx].has_desc) return false;
+    if (out) *out = s_slot[idx].desc;
+    return true;
+}
+
+void slave_link_get_stats(slave_link_stats_t *out)
+{
+    if (!out) return;
+    *out = s_stats;
+#if !SLAVE_LINK_BUS
+    out->slaves_present = slave_link_is_alive(1000) ? 1 : 0;
+#endif
+}
+
+bool slave_link_take_button_change(void)
+{
+    bool changed = s_button_change;
+    s_button_change = false;
+    return changed;
+}
+
+bool slave_link_take_edge(slave_edge_t *out)
+{
+    if (s_edge_tail == s_edge_head) {
+        return false;
+    }
+    *out = s_edge_q[s_edge_tail];
+    s_edge_tail = (uint8_t)((s_edge_tail + 1u) & (SLAVE_EDGE_QUEUE_SIZE - 1u));
+    return true;
+}
+
+uint32_t slave_link_next_poll_us(void)
+{
+#if SLAVE_LINK_BUS
+    // El bus no avanza si nadie cierra los turnos
+    return (s_bus_state == LINK_BUS_WAIT) ? SLAVE_BUS_POLL_US : 100u;
+#elif SLAVE_LINK_SPI
+    // Con una en vuelo, a por ella en cuanto acabe; si no, a la hora de la siguiente
+    if (s_spi_busy) return SLAVE_SPI_POLL_US;
+    uint32_t dt = time_us_32() - s_spi_t0_us;
+    return (dt >= SLAVE_SPI_PERIOD_US) ? SLAVE_SPI_POLL_US : SLAVE_SPI_PERIOD_US - dt;
+#else
+    return s_sync_pending ? SLAVE_SYNC_POLL_US : 1000u;
+#endif
+}
+
+bool slave_time_to_master_us(uint32_t slave_us, uint64_t *master_us, uint32_t *err_us)
+{
+    if (!s_sync_valid) return false;
+
+    int64_t ds = (int32_t)(slave_us - (uint32_t)s_sync_ref_s);
+
+    if (master_us) *master_us = slave_link_sync_eval(ds);
+    if (err_us) {
+        uint32_t ppm  = (s_sync_count >= SLAVE_SYNC_SETTLED) ? SLAVE_SYNC_FREQ_ERR_SETTLED_PPM
+                                                             : SLAVE_SYNC_FREQ_ERR_PPM;
+        uint64_t span = (uint64_t)(ds < 0 ? -ds : ds);
+        *err_us = s_sync_err_us + (uint32_t)((span * ppm + 999999u) / 1000000u);
+    }
+    return true;
+}
+
+bool slave_link_set_param(uint8_t id, uint16_t value)
+{
+    if (id == 0 || id >= CTRL_PARAM_COUNT) return false;
+
+    s_param_want[id] = value;
+    __dmb();
+    uint8_t req = (uint8_t)(s_param_req[id] + 1);
+    s_param_req[id] = req ? req : 1;   // 0 queda para "nunca pedido"
+    return true;
+}
+
+bool slave_link_get_param(uint8_t id, uint16_t *applied)
+{
+    if (id == 0 || id >= CTRL_PARAM_COUNT || !s_param_known[id]) return false;
+    if (applied) *applied = s_param_applied[id];
+    return true;
+}
+
+void slave_link_request_snapshot(void)
+{
+    s_snapshot_req++;
+}
+
+bool slave_link_parse_sysex(const uint8_t *data, uint16_t len)
+{
+    if (!data || len < 5 ||
+        data[0] != 0xF0 || data[1] != LAT_SYSEX_MANUF || data[2] != LAT_SYSEX_DEVICE ||
+        data[len - 1] != 0xF7) {
+        return false;
+    }
+
+    if (data[3] == SLAVE_SYSEX_CMD_SNAPSHOT && len == 5) {
+        slave_link_request_snapshot();
+        return true;
+    }
+
+    if (data[3] == SLAVE_SYSEX_CMD_PARAM && len == 9) {
+        uint16_t v = (uint16_t)(((uint32_t)data[5] << 14) | ((uint32_t)data[6] << 7) | data[7]);
+        slave_link_set_param(data[4], v);
+        return true;
+    }
+
+    return false;
+}
@@ -4,6 +4,32 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "ctrl_protocol.h"
+#include "latency_hist.h"   // fabricante y tabla de comandos SysEx
+
+// Bus multi-slave (ctrl_protocol.h, "Bus multi-slave"). 0 = un solo slave
+// punto a punto, como siempre. Con 1 el master sondea los slaves 1..7 por un
+// transceptor RS-485 (DE en MASTER_UART_DE_PIN) y cada uno ocupa su índice
+// (dirección - 1) en las funciones *_at().
+#ifndef SLAVE_LINK_BUS
+#define SLAVE_LINK_BUS        0
+#endif
+
+// Transporte (ctrl_protocol.h, "Transporte SPI"). 0 = UART, como siempre. Con
+// 1 el master es controlador SPI del slave: cada 250 us una transacción
+// full-duplex por DMA trae el estado entero. El resto de la API no cambia.
+#ifndef SLAVE_LINK_SPI
+#define SLAVE_LINK_SPI        0
+#endif
+
+#if SLAVE_LINK_SPI && SLAVE_LINK_BUS
+#error "El transporte SPI es punto a punto: SLAVE_LINK_BUS a 0"
+#endif
+
+#if SLAVE_LINK_BUS
+#define SLAVE_LINK_MAX_SLAVES CTRL_BUS_MAX_SLAVES
+#else
+#define SLAVE_LINK_MAX_SLAVES 1
+#endif
 
 // Estado decodificado del slave
 typedef struct {
@@ -15,16 +41,130 @@ typedef struct {
     uint64_t last_update_us;  // timestamp del último frame válido
 } slave_state_t;
 
-// Inicializa UART para hablar con el slave
+// Flanco de un botón del slave, con la hora pasada a la base de tiempo del
+// master (time_us_64())
+typedef struct {
+    uint8_t  slave;     // índice del slave (0 en punto a punto)
+    uint8_t  button;    // 0..3 arcade, 4..7 normales (bit de la máscara de 8)
+    bool     pressed;
+    bool     timed;     // true: hora del cambio crudo en el slave; false: hora de llegada
+    uint64_t t_us;
+} slave_edge_t;
+
+// Estadísticas de recepción (RX por DMA + parser por tramos, v1 y v2)
+typedef struct {
+    uint32_t bytes;            // bytes recibidos y procesados
+    uint32_t spans;            // tramos contiguos pasados al parser
+    uint32_t frames_ok;        // frames con checksum correcto (v1 + v2)
+    uint32_t frames_v1;        // de ellos, frames fijos v1
+    uint32_t frames_v2;        // de ellos, frames v2 (delta / flanco / completo / hello)
+    uint32_t checksum_errors;  // frames descartados por checksum o CRC-16
+    uint32_t format_errors;    // frames v2 con CRC bueno pero contenido inválido
+    uint32_t seq_lost;         // frames v2 perdidos según el número de secuencia
+    uint32_t resync_requests;  // RESYNC enviados al slave
+    uint32_t skipped_bytes;    // bytes descartados buscando cabecera
+    uint32_t overrun_bytes;    // bytes perdidos porque el parser se quedó un anillo atrás
+    uint32_t parse_us_total;   // tiempo total de parseo (coste por byte = total / bytes)
+    uint32_t parse_us_max;     // peor llamada a slave_link_task()
+    uint32_t baud;             // velocidad actual del enlace
+    uint32_t baud_fallbacks;   // bajadas de velocidad (prueba fallida, errores o enlace mudo)
+    uint32_t configs_sent;     // frames CONFIG enviados (incluye reintentos)
+    uint32_t config_acks;      // CONFIG_ACK recibidos
+    uint32_t edges_timed;      // flancos con la hora del slave
+    uint32_t edges_untimed;    // flancos deducidos de la máscara (hora de llegada)
+    uint32_t edges_dropped;    // flancos perdidos porque nadie los sacó de la cola
+    uint32_t sync_samples;     // intercambios de reloj aceptados
+    uint32_t sync_rejected;    // descartados por RTT alto o incoherente
+    uint32_t sync_timeouts;    // SYNC_REQ sin respuesta
+    uint32_t sync_steps;       // veces que el modelo de reloj empezó de cero
+    uint32_t sync_rtt_us;      // RTT del último intercambio aceptado (sin el cable)
+    uint32_t sync_err_us;      // cota de error del reloj en el último intercambio
+    int32_t  sync_offset_us;   // master - slave (32 bits bajos)
+    int32_t  sync_drift_ppb;   // el master avanza esto más rápido que el slave
+    uint32_t descs;            // descriptores de capacidades recibidos
+    uint32_t bus_polls;        // turnos dados en el bus (POLL enviados)
+    uint32_t bus_timeouts;     // turnos sin END (slave ausente o frames perdidos)
+    uint32_t bus_cycle_us;     // duración de la última vuelta del bus
+    uint32_t bus_cycle_us_max; // peor vuelta
+    uint32_t spi_xfers;        // transacciones SPI completadas
+    uint32_t spi_stale;        // bloques repetidos (el slave no llegó a rearmar)
+    uint32_t spi_xfer_us;      // CS bajo en la última transacción
+    uint32_t spi_xfer_us_max;  // y en la peor
+    uint32_t spi_out_drops;    // frames master → slave que no cupieron en la cola SPI
+    uint8_t  slaves_present;   // slaves que contestan (en punto a punto, 0 / 1)
+    uint8_t  version;          // protocolo del último frame de estado (0 = ninguno)
+} slave_link_stats_t;
+
+// Inicializa UART (o SPI) para hablar con el slave (la recepción va por DMA)
 void slave_link_init(void);
 
-// Llamar frecuentemente en el main loop
+// Llamar periódicamente: parsea lo que el DMA dejó en el anillo y lleva la
+// negociación de velocidad (1 KB de anillo: a 3 Mbaud, llamarla cada ~1 ms)
 void slave_link_task(void);
 
+// Cuándo volver a llamar a slave_link_task() (us): 1 ms normalmente, unos
+// pocos us mientras se espera la respuesta de una sincronización de reloj o
+// (en el bus) el turno de un slave; por SPI, lo que falta para la siguiente
+// transacción
+uint32_t slave_link_next_poll_us(void);
+
+// Pasa una hora del slave (time_us_64() del slave, 32 bits bajos) a la base de
+// tiempo del master. err_us (opcional) es la cota de error: RTT / 2 del último
+// intercambio + jitter + la deriva posible desde entonces. false si el reloj
+// aún no está sincronizado. Sólo desde core1; vale para horas a menos de
+// ~35 minutos del último intercambio.
+bool slave_time_to_master_us(uint32_t slave_us, uint64_t *master_us, uint32_t *err_us);
+
 // Devuelve una copia del último estado
 void slave_link_get_state(slave_state_t *out);
 
 // Devuelve true si el slave está “vivo” (reciente)
 bool slave_link_is_alive(uint32_t timeout_ms);
 
+// Lo mismo para el slave de índice idx (0..SLAVE_LINK_MAX_SLAVES-1). Las
+// versiones sin _at son las del índice 0.
+void slave_link_get_state_at(uint8_t idx, slave_state_t *out);
+bool slave_link_is_alive_at(uint8_t idx, uint32_t timeout_ms);
+
+// Descriptor de capacidades del slave idx (false si aún no lo mandó: un
+// slave viejo no lo manda nunca, se asume 4 + 4 botones y 4 pots)
+bool slave_link_get_desc(uint8_t idx, ctrl_desc_t *out);
+
+// Copia las estadísticas de recepción
+void slave_link_get_stats(slave_link_stats_t *out);
+
+// true si cambió algún botón desde la última llamada (y borra el aviso).
+// Con v2 los flancos llegan al momento: sirve para no esperar al siguiente
+// ciclo de la lógica de controles.
+bool slave_link_take_button_change(void);
+
+// Saca el flanco más antiguo (false si no hay). Todos los cambios de botón
+// pasan por aquí en orden; sólo desde core1, el mismo núcleo que
+// slave_link_task().
+bool slave_link_take_edge(slave_edge_t *out);
+
+// ---- Comandos master → slave (protocolo v2) ----
+// Se pueden llamar desde cualquier núcleo; salen en el siguiente
+// slave_link_task() de core1 (y se reintentan hasta el CONFIG_ACK).
+// Los parámetros se vuelven a mandar solos si el slave se reinicia.
+
+// Pide cambiar un parámetro del slave (CTRL_PARAM_* de ctrl_protocol.h).
+// Un mismo parámetro no debe pedirse desde los dos núcleos a la vez.
+bool slave_link_set_param(uint8_t id, uint16_t value);
+
+// Valor que el slave dice haber aplicado (false si aún no contestó)
+bool slave_link_get_param(uint8_t id, uint16_t *applied);
+
+// Pide al slave un estado completo ya (sirve también en modo bajo demanda)
+void slave_link_request_snapshot(void);
+
+// ---- Los mismos comandos por SysEx (mismo fabricante que latency_hist) ----
+//  Parámetro: F0 7D 01 06 <id> <v15..14> <v13..7> <v6..0> F7
+//  Snapshot : F0 7D 01 07 F7
+#define SLAVE_SYSEX_CMD_PARAM     LAT_SYSEX_CMD_SLAVE_PARAM
+#define SLAVE_SYSEX_CMD_SNAPSHOT  LAT_SYSEX_CMD_SLAVE_SNAP
+
+// true si el SysEx era un comando del slave (y lo deja pedido)
+bool slave_link_parse_sysex(const uint8_t *data, uint16_t len);
+
 #endif // SLAVE_LINK_H
@@ -1,6 +1,10 @@
 // step_sequencer.c
 #include "step_sequencer.h"
 #include "led_ring.h"
+#include "clock_tracker.h"
+#include "host_feedback.h"
+
+#include "pico/time.h"
 
 // Número de pasos que queremos mostrar en el anillo
 #define STEPSEQ_NUM_STEPS      16
@@ -11,15 +15,32 @@ static uint8_t current_step = 0;  // 0..15
 static uint8_t tick_count   = 0;
 static bool    running      = false;
 
+// Avance anticipado: cuando el próximo tick es frontera de paso, programamos
+// el cambio para el instante previsto por clock_tracker en vez de esperar al
+// paquete USB (que llega tarde y con jitter).
+#define STEPSEQ_LOCK_TIMEOUT_US  200000u  // sin ticks en 200 ms -> no predecimos
+
+static bool     step_armed   = false;  // hay un avance programado
+static uint64_t step_due_us  = 0;      // instante previsto del avance
+static bool     step_early   = false;  // el paso ya avanzó antes de que llegara el tick
+
 // ======================
 // Funciones internas
 // ======================
+static void stepseq_advance(void)
+{
+    current_step++;
+    if (current_step >= STEPSEQ_NUM_STEPS) {
+        current_step = 0;
+    }
+}
+
 static void stepseq_update_ring(void)
 {
-    // Apaga todos los LEDs y enciende sólo el step actual en verde
-    led_ring_fill(0, 0, 0);  // apaga todos
+    // Fondo con el feedback del DAW y, encima, el step actual en verde
+    host_feedback_paint_ring();
 
-    if (current_step < STEPSEQ_NUM_STEPS) {
+    if (running && current_step < STEPSEQ_NUM_STEPS) {
         led_ring_set_pixel(current_step, 0, 60, 0);  // verde
     }
 
@@ -35,6 +56,8 @@ void stepseq_init(void)
     current_step = 0;
     tick_count   = 0;
     running      = false;
+    step_armed   = false;
+    step_early   = false;
     led_ring_clear();
 }
 
@@ -43,13 +66,17 @@ void stepseq_on_start(void)
     running      = true;
     current_step = 0;
     tick_count   = 0;
+    step_armed   = false;
+    step_early   = false;
     stepseq_update_ring();
 }
 
 void stepseq_on_stop(void)
 {
-    running = false;
-    led_ring_clear();
+    running    = false;
+    step_armed = false;
+    step_early = false;
+    stepseq_update_ring();   // queda sólo el feedback del DAW
 }
 
 void stepseq_on_clock_tick(void)
@@ -59,17 +86,47 @@ void stepseq_on_clock_tick(void)
     tick_count++;
     if (tick_count >= STEPSEQ_TICKS_PER_STEP) {
         tick_count = 0;
-
-        // Avanza un step
-        current_step++;
-        if (current_step >= STEPSEQ_NUM_STEPS) {
-            current_step = 0;
+        step_armed = false;
+
+        if (step_early) {
+            // El paso ya se mostró a su hora prevista; el tick sólo confirma
+            step_early = false;
+        } else {
+            stepseq_advance();
+            stepseq_update_ring();
+        }
+    } else if (tick_count == STEPSEQ_TICKS_PER_STEP - 1) {
+        // El siguiente tick es frontera de paso: programarlo si hay predicción
+        if (clock_tracker_is_locked(time_us_64(), STEPSEQ_LOCK_TIMEOUT_US)) {
+            step_due_us = clock_tracker_next_tick_us();
+            step_armed  = true;
         }
-
-        stepseq_update_ring();
     }
 }
 
+uint64_t stepseq_next_due_us(void)
+{
+    return (running && step_armed) ? step_due_us : 0;
+}
+
+void stepseq_task(void)
+{
+    if (!running || !step_armed) return;
+
+    if (time_us_64() < step_due_us) return;
+
+    step_armed = false;
+    step_early = true;
+
+    stepseq_advance();
+    stepseq_update_ring();
+}
+
+void stepseq_redraw_ring(void)
+{
+    stepseq_update_ring();
+}
+
 // Getters para la UI (OLED, etc.)
 
 bool stepseq_is_running(void)
@@ -12,6 +12,16 @@ void stepseq_on_clock_tick(void);  // se llama en cada 0xF8
 void stepseq_on_start(void);       // MIDI START
 void stepseq_on_stop(void);        // MIDI STOP
 
+// Llamar en el main loop: avanza el paso en el instante previsto del tick
+// (según clock_tracker) sin esperar a que llegue el paquete USB
+void stepseq_task(void);
+
+// Instante del próximo avance programado (0 = ninguno), para el planificador
+uint64_t stepseq_next_due_us(void);
+
+// Redibuja el anillo (feedback del DAW + step actual) y lo envía
+void stepseq_redraw_ring(void);
+
 // Getters para UI (OLED, anillo, etc.)
 bool    stepseq_is_running(void);       // true = PLAY, false = STOP
 uint8_t stepseq_get_current_step(void); // 0..15 (para 16 pasos)
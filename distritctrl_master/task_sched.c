@@ -0,0 +1,347 @@
+// task_sched.c - Planificador cooperativo por deadlines
+//
+// Cada núcleo tiene su sched_t. Las tareas esperan en una rueda de tiempos
+// hash (ranura = deadline >> SCHED_TICK_SHIFT): insertar y vencer cuesta O(1)
+// y una pasada sólo mira las ranuras entre la última revisada y "ahora".
+// Las vencidas se ejecutan por orden de deadline. Cuando no queda nada, el
+// núcleo duerme con WFE hasta el próximo deadline; cualquier IRQ (USB, UART,
+// GPIO, alarma) o un SEV del otro núcleo lo despierta antes.
+//
+// Por tarea se mide el tiempo de ejecución (contra su presupuesto) y el retraso
+// de arranque (contra su deadline); los contadores se piden por SysEx. El coste
+// en ciclos sale del SysTick de cada núcleo, que corre libre a clk_sys: con 1 us
+// de resolución una tarea de 20 us no distingue una división soft-float de una
+// entera, en ciclos sí.
+
+#include "task_sched.h"
+#include "latency_hist.h"
+
+#include "pico/time.h"
+#include "hardware/sync.h"
+#include "hardware/structs/systick.h"
+
+#include <string.h>
+
+// Si el próximo deadline está más cerca que esto, no merece la pena dormir
+#define SCHED_MIN_SLEEP_US  50u
+
+// SysTick: 24 bits hacia abajo (una vuelta = ~134 ms a 125 MHz)
+#define SCHED_SYSTICK_MASK  0x00FFFFFFu
+#define SCHED_CYC_AVG_SHIFT 4u
+
+// Registro global (ambos núcleos) para el informe
+static sched_task_t *s_registry[SCHED_MAX_TASKS];
+static uint8_t       s_registry_count = 0;
+
+// ----------------------------
+// Funciones internas
+// ----------------------------
+
+static inline uint32_t sched_slot(uint64_t deadline_us)
+{
+    return (uint32_t)(deadline_us >> SCHED_TICK_SHIFT) & (SCHED_WHEEL_SLOTS - 1u);
+}
+
+static void sched_wheel_insert(sched_t *s, sched_task_t *t)
+{
+    uint32_t slot = sched_slot(t->deadline_us);
+
+    t->next        = s->wheel[slot];
+    s->wheel[slot] = t;
+    t->in_wheel    = true;
+}
+
+static void sched_wheel_remove(sched_t *s, sched_task_t *t)
+{
+    sched_task_t **pp = &s->wheel[sched_slot(t->deadline_us)];
+
+    while (*pp) {
+        if (*pp == t) {
+            *pp = t->next;
+            break;
+        }
+        pp = &(*pp)->next;
+    }
+    t->next     = NULL;
+    t->in_wheel = false;
+}
+
+// Ejecuta la tarea, mide y la vuelve a planificar
+static void sched_run_task(sched_t *s, sched_task_t *t, uint64_t now)
+{
+    uint32_t late = (now > t->deadline_us) ? (uint32_t)(now - t->deadline_us) : 0;
+    if (late > SCHED_LATE_TOL_US) t->stats.late++;
+    if (late > t->stats.max_late_us) t->stats.max_late_us = late;
+
+    t->notified = false;
+
+    uint32_t t0    = time_us_32();
+    uint32_t c0    = systick_hw->cvr;
+    uint32_t delay = t->fn(t, now);
+    uint32_t c1    = systick_hw->cvr;
+    uint32_t run   = time_us_32() - t0;
+    uint32_t cyc   = (c0 - c1) & SCHED_SYSTICK_MASK;
+
+    // Más de 100 ms: el SysTick pudo dar la vuelta, saturar
+    if (run > 100000u) cyc = SCHED_SYSTICK_MASK;
+
+    t->stats.runs++;
+    if (run > t->stats.max_run_us) t->stats.max_run_us = run;
+    if (t->budget_us && run > t->budget_us) t->stats.overruns++;
+
+    if (cyc > t->stats.max_run_cyc) t->stats.max_run_cyc = cyc;
+    if (t->stats.runs == 1u) {
+        t->stats.avg_run_cyc = cyc;
+    } else {
+        t->stats.avg_run_cyc = (uint32_t)((int32_t)t->stats.avg_run_cyc +
+                               (((int32_t)cyc - (int32_t)t->stats.avg_run_cyc) >> SCHED_CYC_AVG_SHIFT));
+    }
+
+    if (delay == SCHED_STOP) {
+        t->deadline_us = UINT64_MAX;
+        return;
+    }
+
+    // Relativo al arranque: un periodo fijo no acumula el tiempo de ejecución
+    t->deadline_us = now + delay;
+    if (!(t->flags & SCHED_F_EVERY_PASS)) {
+        sched_wheel_insert(s, t);
+    }
+}
+
+// Saca de la rueda las tareas vencidas en las ranuras [cursor, now]
+static uint8_t sched_collect_expired(sched_t *s, uint64_t now, sched_task_t **ready)
+{
+    uint64_t now_tick = now >> SCHED_TICK_SHIFT;
+    uint64_t from     = s->cursor_tick;
+    uint8_t  n        = 0;
+
+    // Si llevamos más de una vuelta sin revisar, basta con una vuelta completa
+    if (now_tick - from >= SCHED_WHEEL_SLOTS) {
+        from = now_tick - (SCHED_WHEEL_SLOTS - 1u);
+    }
+
+    for (uint64_t tick = from; tick <= now_tick; tick++) {
+        sched_task_t **pp = &s->wheel[tick & (SCHED_WHEEL_SLOTS - 1u)];
+
+        while (*pp) {
+            sched_task_t *t = *pp;
+            if (t->deadline_us <= now && n < SCHED_MAX_TASKS) {
+                *pp         = t->next;
+                t->next     = NULL;
+                t->in_wheel = false;
+                ready[n++]  = t;
+            } else {
+                pp = &t->next;   // es de otra vuelta
+            }
+        }
+    }
+
+    // La ranura actual puede tener deadlines de más adelante en este mismo tick
+    s->cursor_tick = now_tick;
+    return n;
+}
+
+static void sched_put_u28(uint8_t *p, uint32_t v)
+{
+    if (v > 0x0FFFFFFFu) v = 0x0FFFFFFFu;
+    p[0] = (uint8_t)((v >> 21) & 0x7F);
+    p[1] = (uint8_t)((v >> 14) & 0x7F);
+    p[2] = (uint8_t)((v >> 7)  & 0x7F);
+    p[3] = (uint8_t)(v & 0x7F);
+}
+
+// ----------------------------
+// API pública
+// ----------------------------
+
+void sched_init(sched_t *s, uint32_t max_idle_us)
+{
+    memset(s, 0, sizeof(*s));
+    s->max_idle_us = max_idle_us;
+    s->cursor_tick = time_us_64() >> SCHED_TICK_SHIFT;
+
+    // SysTick de este núcleo como contador de ciclos libre (sin IRQ)
+    systick_hw->rvr = SCHED_SYSTICK_MASK;
+    systick_hw->cvr = 0;
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+}
+
+void sched_add(sched_t *s, sched_task_t *t, uint32_t first_delay_us)
+{
+    if (s->num_tasks >= SCHED_MAX_TASKS) return;
+
+    t->pc          = 0;
+    t->next        = NULL;
+    t->notified    = false;
+    t->in_wheel    = false;
+    t->deadline_us = time_us_64() + first_delay_us;
+    memset(&t->stats, 0, sizeof(t->stats));
+
+    s->tasks[s->num_tasks++] = t;
+    if (!(t->flags & SCHED_F_EVERY_PASS)) {
+        sched_wheel_insert(s, t);
+    }
+
+    // El registro no tiene lock: cada núcleo añade sus tareas antes de que el
+    // otro empiece a añadir las suyas (core0 antes de lanzar core1)
+    if (s_registry_count < SCHED_MAX_TASKS) {
+        s_registry[s_registry_count++] = t;
+    }
+}
+
+void sched_notify(sched_task_t *t)
+{
+    if (!t) return;
+
+    t->notified = true;
+    __sev();    // por si el dueño está en WFE en el otro núcleo
+}
+
+void sched_run(sched_t *s)
+{
+    sched_task_t *ready[SCHED_MAX_TASKS];
+    uint64_t      now = time_us_64();
+
+    s->passes++;
+
+    // 1) Tareas notificadas (IRQ / otro núcleo): corren ya, sin esperar deadline
+    for (uint8_t i = 0; i < s->num_tasks; i++) {
+        sched_task_t *t = s->tasks[i];
+        if (t->notified && t->deadline_us != UINT64_MAX) {
+            if (t->in_wheel) sched_wheel_remove(s, t);
+            t->deadline_us = now;    // no cuenta como retraso
+            sched_run_task(s, t, now);
+            now = time_us_64();
+        }
+    }
+
+    // 2) Deadlines vencidos, el más urgente primero
+    uint8_t n = sched_collect_expired(s, now, ready);
+    while (n > 0) {
+        uint8_t best = 0;
+        for (uint8_t i = 1; i < n; i++) {
+            if (ready[i]->deadline_us < ready[best]->deadline_us) best = i;
+        }
+        sched_task_t *t = ready[best];
+        ready[best] = ready[--n];
+
+        sched_run_task(s, t, time_us_64());
+    }
+
+    // 3) Tareas de cada pasada (baratas e idempotentes: USB, colas...)
+    for (uint8_t i = 0; i < s->num_tasks; i++) {
+        sched_task_t *t = s->tasks[i];
+        if ((t->flags & SCHED_F_EVERY_PASS) && t->deadline_us != UINT64_MAX) {
+            sched_run_task(s, t, time_us_64());
+        }
+    }
+
+    // 4) Reposo hasta el próximo deadline (o IRQ / SEV)
+    now = time_us_64();
+    uint64_t next = now + s->max_idle_us;
+    for (uint8_t i = 0; i < s->num_tasks; i++) {
+        if (s->tasks[i]->notified) return;      // alguien pidió correr: sin dormir
+        if (s->tasks[i]->deadline_us < next) next = s->tasks[i]->deadline_us;
+    }
+
+    if (next > now + SCHED_MIN_SLEEP_US) {
+        best_effort_wfe_or_timeout(from_us_since_boot(next));
+        s->idle_us += time_us_64() - now;
+    }
+}
+
+void sched_loop(sched_t *s)
+{
+    while (true) {
+        sched_run(s);
+    }
+}
+
+bool sched_is_report_request(const uint8_t *data, uint16_t len)
+{
+    return data && len == 5 &&
+           data[0] == 0xF0 && data[1] == LAT_SYSEX_MANUF && data[2] == LAT_SYSEX_DEVICE &&
+           data[3] == SCHED_SYSEX_CMD_REPORT && data[4] == 0xF7;
+}
+
+size_t sched_build_report_sysex(uint8_t *buf, size_t cap)
+{
+    uint8_t count = s_registry_count;
+
+    if (!buf || cap < 6u) return 0;
+
+    // Sólo las tareas que quepan
+    if (6u + (size_t)count * SCHED_REPORT_ENTRY_LEN > cap) {
+        count = (uint8_t)((cap - 6u) / SCHED_REPORT_ENTRY_LEN);
+    }
+
+    size_t n = 0;
+    buf[n++] = 0xF0;
+    buf[n++] = LAT_SYSEX_MANUF;
+    buf[n++] = LAT_SYSEX_DEVICE;
+    buf[n++] = SCHED_SYSEX_CMD_REPLY;
+    buf[n++] = count;
+
+    for (uint8_t i = 0; i < count; i++) {
+        const sched_task_t *t    = s_registry[i];
+        const char         *name = t->name ? t->name : "";
+
+        for (uint8_t k = 0; k < SCHED_NAME_LEN; k++) {
+            char c = *name ? *name++ : ' ';
+            buf[n++] = (uint8_t)c & 0x7F;
+        }
+
+        // Copia de los contadores (los escribe el núcleo dueño; valen aproximados)
+        sched_task_stats_t st = t->stats;
+        sched_put_u28(&buf[n], st.runs);        n += 4;
+        sched_put_u28(&buf[n], st.overruns);    n += 4;
+        sched_put_u28(&buf[n], st.late);        n += 4;
+        sched_put_u28(&buf[n], st.max_run_us);  n += 4;
+        sched_put_u28(&buf[n], st.max_late_us); n += 4;
+    }
+
+    buf[n++] = 0xF7;
+    return n;
+}
+
+bool sched_is_cycles_request(const uint8_t *data, uint16_t len)
+{
+    return data && len == 5 &&
+           data[0] == 0xF0 && data[1] == LAT_SYSEX_MANUF && data[2] == LAT_SYSEX_DEVICE &&
+           data[3] == SCHED_SYSEX_CMD_CYCLES && data[4] == 0xF7;
+}
+
+size_t sched_build_cycles_sysex(uint8_t *buf, size_t cap)
+{
+    uint8_t count = s_registry_count;
+
+    if (!buf || cap < 6u) return 0;
+
+    if (6u + (size_t)count * SCHED_CYCLES_ENTRY_LEN > cap) {
+        count = (uint8_t)((cap - 6u) / SCHED_CYCLES_ENTRY_LEN);
+    }
+
+    size_t n = 0;
+    buf[n++] = 0xF0;
+    buf[n++] = LAT_SYSEX_MANUF;
+    buf[n++] = LAT_SYSEX_DEVICE;
+    buf[n++] = SCHED_SYSEX_CMD_CYC_REPLY;
+    buf[n++] = count;
+
+    for (uint8_t i = 0; i < count; i++) {
+        const sched_task_t *t    = s_registry[i];
+        const char         *name = t->name ? t->name : "";
+
+        for (uint8_t k = 0; k < SCHED_NAME_LEN; k++) {
+            char c = *name ? *name++ : ' ';
+            buf[n++] = (uint8_t)c & 0x7F;
+        }
+
+        sched_put_u28(&buf[n], t->stats.avg_run_cyc); n += 4;
+        sched_put_u28(&buf[n], t->stats.max_run_cyc); n += 4;
+    }
+
+    buf[n++] = 0xF7;
+    return n;
+}
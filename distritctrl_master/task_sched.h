@@ -0,0 +1,125 @@
+// task_sched.h - Planificador cooperativo por deadlines (rueda de tiempos hash)
+// con presupuesto de CPU por tarea, corrutinas sin pila y reposo con WFE
+#ifndef TASK_SCHED_H
+#define TASK_SCHED_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "latency_hist.h"   // fabricante y tabla de comandos SysEx
+
+// Rueda de tiempos: 64 ranuras de 128 us (una vuelta = ~8 ms). Deadlines más
+// lejanos se quedan en su ranura hasta la vuelta que toca.
+#define SCHED_WHEEL_SLOTS   64u      // potencia de 2
+#define SCHED_TICK_SHIFT    7u       // 1 << 7 = 128 us por ranura
+
+// Tareas registradas en total (ambos núcleos), para los informes
+#define SCHED_MAX_TASKS     16u
+
+// Retraso de arranque tolerado antes de contar la ejecución como tardía
+#define SCHED_LATE_TOL_US   500u
+
+// Valor de retorno de una tarea: no volver a planificarla
+#define SCHED_STOP          UINT32_MAX
+
+// Flags de tarea
+#define SCHED_F_EVERY_PASS  0x01u    // corre además en cada pasada (tras cualquier IRQ/SEV)
+
+typedef struct sched_task sched_task_t;
+
+// Cuerpo de una tarea. Devuelve cuántos us faltan para su próxima ejecución
+// (deadline = now_us + retorno) o SCHED_STOP.
+typedef uint32_t (*sched_fn_t)(sched_task_t *t, uint64_t now_us);
+
+typedef struct {
+    uint32_t runs;
+    uint32_t overruns;     // ejecuciones que superaron budget_us
+    uint32_t late;         // arranques más de SCHED_LATE_TOL_US después del deadline
+    uint32_t max_run_us;
+    uint32_t max_late_us;
+    uint32_t avg_run_cyc;  // media móvil (1/16) de ciclos de CPU por ejecución
+    uint32_t max_run_cyc;
+} sched_task_stats_t;
+
+struct sched_task {
+    const char   *name;
+    sched_fn_t    fn;
+    void         *arg;
+    uint32_t      budget_us;   // tiempo de CPU permitido por ejecución
+    uint8_t       flags;
+
+    // Estado interno (lo gestiona el planificador)
+    uint16_t      pc;          // punto de reanudación de la corrutina
+    uint64_t      deadline_us;
+    sched_task_t *next;        // siguiente en la ranura de la rueda
+    volatile bool notified;    // sched_notify() pendiente
+    bool          in_wheel;
+    sched_task_stats_t stats;
+};
+
+// Un planificador por núcleo
+typedef struct {
+    sched_task_t *wheel[SCHED_WHEEL_SLOTS];
+    sched_task_t *tasks[SCHED_MAX_TASKS];
+    uint8_t       num_tasks;
+    uint64_t      cursor_tick;     // última ranura revisada
+    uint32_t      max_idle_us;     // reposo máximo sin deadlines
+    uint64_t      idle_us;         // tiempo total en WFE
+    uint32_t      passes;
+} sched_t;
+
+// ---- Corrutinas sin pila (estilo protothreads) ----
+// Las variables locales NO se conservan entre SCHED_YIELD_US: el estado que
+// deba sobrevivir va en static o en la estructura apuntada por t->arg.
+#define SCHED_BEGIN(t)          switch ((t)->pc) { case 0:
+#define SCHED_YIELD_US(t, us)   do { (t)->pc = (uint16_t)__LINE__; return (us); \
+                                     case __LINE__:; } while (0)
+#define SCHED_END(t)            } (t)->pc = 0; return SCHED_STOP
+
+void sched_init(sched_t *s, uint32_t max_idle_us);
+
+// Añade una tarea; la primera ejecución es dentro de first_delay_us.
+// Sólo desde el núcleo dueño de s; core0 registra las suyas antes de lanzar core1.
+void sched_add(sched_t *s, sched_task_t *t, uint32_t first_delay_us);
+
+// Despierta la tarea en la próxima pasada. Seguro desde IRQ y desde el otro núcleo.
+void sched_notify(sched_task_t *t);
+
+// Una pasada: tareas notificadas, deadlines vencidos (el más urgente primero),
+// tareas SCHED_F_EVERY_PASS, y WFE hasta el próximo deadline o IRQ.
+void sched_run(sched_t *s);
+
+// Ejecuta pasadas para siempre
+void sched_loop(sched_t *s);
+
+// ---- Informe de overruns por SysEx (mismo fabricante que latency_hist) ----
+//  Petición : F0 7D 01 04 F7
+//  Respuesta: F0 7D 01 05 <n> n x { nombre[6] runs overruns late max_run max_late } F7
+//             nombre en ASCII relleno con espacios, contadores en 4 bytes de 7 bits
+//
+// ---- Coste en ciclos por SysEx (aparte: con él, el informe no cabría) ----
+//  Petición : F0 7D 01 08 F7
+//  Respuesta: F0 7D 01 09 <n> n x { nombre[6] avg_cyc max_cyc } F7
+//             ciclos de CPU por ejecución (media móvil 1/16 y máximo)
+#define SCHED_SYSEX_CMD_REPORT    LAT_SYSEX_CMD_SCHED_REPORT
+#define SCHED_SYSEX_CMD_REPLY     LAT_SYSEX_CMD_SCHED_REPLY
+#define SCHED_SYSEX_CMD_CYCLES    LAT_SYSEX_CMD_SCHED_CYCLES
+#define SCHED_SYSEX_CMD_CYC_REPLY LAT_SYSEX_CMD_SCHED_CYC_REP
+#define SCHED_NAME_LEN          6u
+#define SCHED_REPORT_ENTRY_LEN  (SCHED_NAME_LEN + 5u * 4u)
+#define SCHED_CYCLES_ENTRY_LEN  (SCHED_NAME_LEN + 2u * 4u)
+
+// true si el SysEx es una petición de informe
+bool sched_is_report_request(const uint8_t *data, uint16_t len);
+
+// Construye el informe de todas las tareas registradas. Devuelve la longitud.
+size_t sched_build_report_sysex(uint8_t *buf, size_t cap);
+
+// true si el SysEx es una petición del informe de ciclos
+bool sched_is_cycles_request(const uint8_t *data, uint16_t len);
+
+// Construye el informe de ciclos de todas las tareas. Devuelve la longitud.
+size_t sched_build_cycles_sysex(uint8_t *buf, size_t cap);
+
+#endif // TASK_SCHED_H
@@ -0,0 +1,135 @@
+// bench_clock_tracker.c - Reproduce trazas sintéticas de MIDI Clock (0xF8)
+// con jitter y cambios de tempo contra clock_tracker, y mide:
+//
+//   - convergencia: ticks desde el arranque (o el cambio de tempo) hasta que
+//     tempo y fase entran en tolerancia y se quedan ahí un beat entero
+//   - error de fase: predicción del próximo tick (clock_tracker_next_tick_us)
+//     contra el instante ideal de ese tick, RMS y máximo, ya enganchado
+//
+// Sale con error si no converge en CONV_MAX_TICKS o si la predicción es peor
+// que el propio jitter de llegada.
+
+#include <math.h>
+#include <stdio.h>
+
+#include "clock_tracker.h"
+#include "test_util.h"
+
+#define TICKS_PER_SCENARIO  3000
+#define CONV_TOL_BPM_PCT    0.5     // tempo dentro del 0.5 %
+#define CONV_TOL_PHASE_US   1500    // y fase dentro de 1.5 ms
+#define CONV_HOLD_TICKS     CLOCK_TRACKER_PPQN
+#define CONV_MAX_TICKS      (4 * CLOCK_TRACKER_PPQN)
+
+typedef struct {
+    const char *name;
+    double      bpm0;        // tempo inicial
+    double      bpm1;        // tempo tras el cambio
+    int         change_tick; // tick del cambio (-1 = ninguno)
+    int         ramp_ticks;  // 0 = salto; si no, rampa lineal en estos ticks
+    double      jitter_us;   // jitter de llegada uniforme ±jitter_us
+} scenario_t;
+
+static const scenario_t s_scenarios[] = {
+    { "120 BPM, ±0.5 ms",          120.0, 120.0,   -1,    0,  500.0 },
+    { "120 BPM, ±1 ms (USB)",      120.0, 120.0,   -1,    0, 1000.0 },
+    { "120 -> 128 BPM salto",      120.0, 128.0, 1000,    0, 1000.0 },
+    { "128 -> 90 BPM salto",       128.0,  90.0, 1000,    0, 1000.0 },
+    { "90 -> 170 BPM salto",        90.0, 170.0, 1000,    0, 1000.0 },
+    { "100 -> 140 BPM rampa 40 s", 100.0, 140.0, 1000, 1600, 1000.0 },
+};
+
+static double bpm_at(const scenario_t *sc, int k)
+{
+    if (sc->change_tick < 0 || k < sc->change_tick) return sc->bpm0;
+    if (sc->ramp_ticks == 0) return sc->bpm1;
+
+    double f = (double)(k - sc->change_tick) / sc->ramp_ticks;
+    if (f > 1.0) f = 1.0;
+    return sc->bpm0 + (sc->bpm1 - sc->bpm0) * f;
+}
+
+static int run(const scenario_t *sc)
+{
+    double ideal_us = 1000000.0;   // instante ideal del tick k
+    int    conv_from = 0;          // tick desde el que se mide la convergencia
+    int    in_tol    = 0;          // ticks seguidos en tolerancia
+    int    conv_tick = -1;         // ticks hasta converger (desde conv_from)
+    int    conv_worst = 0;
+    bool   conv_fail  = false;
+
+    double err_sum2 = 0.0, err_max = 0.0, jit_sum2 = 0.0;
+    int    err_n = 0;
+
+    clock_tracker_init();
+
+    for (int k = 0; k < TICKS_PER_SCENARIO; k++) {
+        double bpm    = bpm_at(sc, k);
+        double period = 60000000.0 / (bpm * CLOCK_TRACKER_PPQN);
+
+        if (k > 0) ideal_us += period;
+        if (k == sc->change_tick) {
+            // Nuevo tramo: vuelve a contar la convergencia
+            if (conv_tick < 0) conv_fail = true;
+            else if (conv_tick > conv_worst) conv_worst = conv_tick;
+            conv_from = k;
+            conv_tick = -1;
+            in_tol    = 0;
+        }
+
+        // Predicción antes de que llegue el tick
+        uint64_t pred = clock_tracker_next_tick_us();
+        double   jit  = test_rand_unit() * sc->jitter_us;
+
+        clock_tracker_on_tick((uint64_t)llround(ideal_us + jit));
+
+        if (pred == 0) continue;
+
+        double err     = (double)pred - ideal_us;
+        double bpm_est = clock_tracker_get_bpm_x100() / 100.0;
+        bool   ok      = fabs(bpm_est - bpm) <= bpm * CONV_TOL_BPM_PCT / 100.0 &&
+                         fabs(err) <= CONV_TOL_PHASE_US;
+
+        if (conv_tick < 0) {
+            in_tol = ok ? in_tol + 1 : 0;
+            if (in_tol >= CONV_HOLD_TICKS) conv_tick = k - conv_from - CONV_HOLD_TICKS + 1;
+            continue;
+        }
+
+        // Ya enganchado en este tramo: estadística de fase
+        err_sum2 += err * err;
+        jit_sum2 += jit * jit;
+        if (fabs(err) > err_max) err_max = fabs(err);
+        err_n++;
+    }
+
+    if (conv_tick < 0) conv_fail = true;
+    else if (conv_tick > conv_worst) conv_worst = conv_tick;
+
+    clock_tracker_stats_t st;
+    clock_tracker_get_stats(&st);
+
+    double err_rms = err_n ? sqrt(err_sum2 / err_n) : 0.0;
+    double jit_rms = err_n ? sqrt(jit_sum2 / err_n) : 0.0;
+
+    printf("%-28s conv %3d ticks%s  fase RMS %6.1f us  max %6.1f us  "
+           "(jitter RMS %6.1f us)  relocks %u\n",
+           sc->name, conv_worst, conv_fail ? " (NO)" : "     ",
+           err_rms, err_max, jit_rms, (unsigned)st.relocks);
+
+    CHECK(!conv_fail);
+    CHECK(conv_worst <= CONV_MAX_TICKS);
+    CHECK(err_rms < jit_rms);
+    return 0;
+}
+
+int main(void)
+{
+    printf("clock_tracker: %d ticks por escenario, tolerancia %.1f %% / %d us\n",
+           TICKS_PER_SCENARIO, CONV_TOL_BPM_PCT, CONV_TOL_PHASE_US);
+
+    for (size_t i = 0; i < sizeof(s_scenarios) / sizeof(s_scenarios[0]); i++) {
+        run(&s_scenarios[i]);
+    }
+    return TEST_RESULT();
+}
@@ -0,0 +1,428 @@
+// bench_fixed_point.c - Antes/después del paso a enteros del camino del
+// ultrasónico y del tempo del clock
+//
+// Las versiones "antes" son las que había en el firmware, copiadas tal cual
+// (float) como referencia:
+//
+//   - conversión del eco: (float)dt_us * 0.01715f
+//   - normalización en task_ultra: norm = (D_MAX - d) / (D_MAX - D_MIN),
+//     v14 = norm * 16383 + 0.5, una vez por medida
+//   - BPM en midi_core: ventana de 24 ticks y filtro 0.7 / 0.3
+//
+// y las "después" son las del firmware: US_CM_PER_US_Q16, curve_dist
+// (tabla de gen_curves.py), ultra_track_update/get a 1 kHz y clock_tracker.
+// De cada una, la precisión (contra el valor exacto en double) y el tiempo
+// por llamada en el host.
+//
+// Ojo con los tiempos: el host tiene FPU y el M0+ no (cada operación float
+// allí es una llamada a la librería de soft-float), así que aquí la
+// diferencia sale mucho menor que en la placa. La cifra de la placa la da el
+// informe de ciclos por tarea (SysEx LAT_SYSEX_CMD_SCHED_CYCLES).
+
+#include <math.h>
+#include <stdio.h>
+
+#include "clock_tracker.h"
+#include "curves.h"
+#include "test_util.h"
+#include "ultra_track.h"
+
+#define D_MIN_CM          CURVE_DIST_MIN_CM
+#define D_MAX_CM          CURVE_DIST_MAX_CM
+#define US_CM_PER_US_Q16  1124u      // el de ultra_driver.c
+#define ECHO_TIMEOUT_US   30000u     // el eco más largo que se mide
+#define TIME_REPS         2000000
+
+// Un paso de la tabla de distancia (1/64 cm) en unidades de 14 bits
+#define DIST_STEP_LSB     (16383.0 / ((D_MAX_CM - D_MIN_CM) * 64.0))
+
+static volatile uint32_t s_sink;
+
+// ----------------------------
+// Versiones de antes (float)
+// ----------------------------
+
+static float old_echo_cm(uint32_t dt_us)
+{
+    return (float)dt_us * 0.01715f;
+}
+
+static uint16_t old_norm_v14(float d_cm)
+{
+    const float D_MIN = (float)D_MIN_CM;
+    const float D_MAX = (float)D_MAX_CM;
+
+    if (d_cm < D_MIN) d_cm = D_MIN;
+    if (d_cm > D_MAX) d_cm = D_MAX;
+
+    float norm = (D_MAX - d_cm) / (D_MAX - D_MIN);
+    if (norm < 0.0f) norm = 0.0f;
+    if (norm > 1.0f) norm = 1.0f;
+
+    return (uint16_t)(norm * 16383.0f + 0.5f);
+}
+
+// midi_core_on_clock_tick() de antes, sin el reloj del SDK
+typedef struct {
+    uint16_t bpm;
+    float    bpm_lp;
+    uint32_t tick_count;
+    uint64_t window_start_us;
+} old_clock_t;
+
+static void old_clock_tick(old_clock_t *c, uint64_t now)
+{
+    if (c->window_start_us == 0) {
+        c->window_start_us = now;
+        c->tick_count      = 0;
+        return;
+    }
+
+    c->tick_count++;
+
+    if (c->tick_count >= 24) {
+        uint64_t elapsed_us = now - c->window_start_us;
+
+        if (elapsed_us > 200000 && elapsed_us < 2000000) {
+            float inst_bpm = 60.0f * 1000000.0f / (float)elapsed_us;
+
+            if (c->bpm_lp == 0.0f) {
+                c->bpm_lp = inst_bpm;
+            } else {
+                c->bpm_lp = c->bpm_lp * 0.7f + inst_bpm * 0.3f;
+            }
+
+            if (c->bpm_lp < 40.0f)  c->bpm_lp = 40.0f;
+            if (c->bpm_lp > 300.0f) c->bpm_lp = 300.0f;
+
+            c->bpm = (uint16_t)(c->bpm_lp + 0.5f);
+        }
+
+        c->tick_count      = 0;
+        c->window_start_us = now;
+    }
+}
+
+// ----------------------------
+// Referencia exacta
+// ----------------------------
+
+static double exact_v14(double d_cm)
+{
+    if (d_cm < D_MIN_CM) d_cm = D_MIN_CM;
+    if (d_cm > D_MAX_CM) d_cm = D_MAX_CM;
+    return (D_MAX_CM - d_cm) / (D_MAX_CM - D_MIN_CM) * 16383.0;
+}
+
+static void print_row(const char *what, const char *unit,
+                      double err_old, double err_new, double ns_old, double ns_new)
+{
+    printf("  %-26s error máx %9.4f -> %9.4f %-4s  %6.2f -> %6.2f ns\n",
+           what, err_old, err_new, unit, ns_old, ns_new);
+}
+
+// ----------------------------
+// Eco -> distancia
+// ----------------------------
+
+static void bench_echo(void)
+{
+    double err_old = 0.0, err_new = 0.0;
+
+    for (uint32_t dt = 0; dt <= ECHO_TIMEOUT_US; dt++) {
+        double exact = dt * 0.01715;
+        double e_old = fabs(old_echo_cm(dt) - exact);
+        double e_new = fabs((int32_t)(dt * US_CM_PER_US_Q16) / 65536.0 - exact);
+
+        if (e_old > err_old) err_old = e_old;
+        if (e_new > err_new) err_new = e_new;
+    }
+
+    double t0 = test_cpu_s();
+    for (uint32_t k = 0; k < TIME_REPS; k++) {
+        s_sink = (uint32_t)(old_echo_cm(k % ECHO_TIMEOUT_US) * 65536.0f);
+    }
+    double t1 = test_cpu_s();
+    for (uint32_t k = 0; k < TIME_REPS; k++) {
+        s_sink = (k % ECHO_TIMEOUT_US) * US_CM_PER_US_Q16;
+    }
+    double t2 = test_cpu_s();
+
+    print_row("eco -> cm (0..30 ms)", "cm", err_old, err_new,
+              (t1 - t0) / TIME_REPS * 1e9, (t2 - t1) / TIME_REPS * 1e9);
+
+    // 0.005 % de 514 cm, y sin desbordar 32 bits en todo el rango
+    CHECK(err_new < 0.03);
+    CHECK((uint64_t)ECHO_TIMEOUT_US * US_CM_PER_US_Q16 < 0x80000000u);
+}
+
+// ----------------------------
+// Distancia -> 14 bits
+// ----------------------------
+
+static void bench_curve(void)
+{
+    double err_old = 0.0, err_new = 0.0;
+    int    mono_bad = 0;
+    uint16_t prev = 0xFFFF;
+
+    // De 5 a 65 cm (fuera del rango incluido) en pasos de 1/1024 cm
+    for (int32_t d_q16 = 5 << 16; d_q16 <= 65 << 16; d_q16 += 64) {
+        double   exact = exact_v14(d_q16 / 65536.0);
+        uint16_t v_new = curve_dist(CURVE_LINEAR, d_q16);
+        uint16_t v_old = old_norm_v14((float)(d_q16 / 65536.0));
+
+        if (fabs(v_old - exact) > err_old) err_old = fabs(v_old - exact);
+        if (fabs(v_new - exact) > err_new) err_new = fabs(v_new - exact);
+        if (v_new > prev) mono_bad++;   // más lejos nunca da más
+        prev = v_new;
+    }
+
+    double t0 = test_cpu_s();
+    for (uint32_t k = 0; k < TIME_REPS; k++) {
+        s_sink = old_norm_v14((float)(int32_t)((k * 2654435761u) % (70u << 16)) / 65536.0f);
+    }
+    double t1 = test_cpu_s();
+    for (uint32_t k = 0; k < TIME_REPS; k++) {
+        s_sink = curve_dist(CURVE_LINEAR, (int32_t)((k * 2654435761u) % (70u << 16)));
+    }
+    double t2 = test_cpu_s();
+
+    print_row("cm -> 14 bits (lineal)", "LSB", err_old, err_new,
+              (t1 - t0) / TIME_REPS * 1e9, (t2 - t1) / TIME_REPS * 1e9);
+
+    // La tabla va a pasos de 1/64 cm: como mucho un paso de error
+    CHECK(err_new <= DIST_STEP_LSB + 1.0);
+    CHECK(mono_bad == 0);
+    CHECK(curve_dist(CURVE_LINEAR, D_MIN_CM << 16) == 16383);
+    CHECK(curve_dist(CURVE_LINEAR, D_MAX_CM << 16) == 0);
+}
+
+// ----------------------------
+// Camino completo del ultrasónico
+// ----------------------------
+
+// Mano en vaivén de 1.5 Hz entre 15 y 55 cm; medidas cada 12..25 ms con
+// ±0.3 cm de ruido y un 1 % de ecos espurios. Antes: cada medida se
+// convertía y se mandaba tal cual (la salida se queda en la última). Después:
+// seguidor alfa-beta, remuestreado a 1 kHz con curve_dist.
+#define HAND_SECONDS      20
+#define HAND_HZ           1.5
+#define HAND_SPURIOUS     100       // 1 de cada esto
+#define HAND_MEAS_MAX     (HAND_SECONDS * 1000000 / 12000 + 1)
+#define TRACE_REPS        50        // vueltas a la traza para medir tiempos
+
+typedef struct {
+    uint32_t t_us;
+    uint32_t dt_us;   // ancho del eco
+} echo_t;
+
+static echo_t s_meas[HAND_MEAS_MAX];
+
+static double hand_cm(double t_s)
+{
+    return 35.0 + 20.0 * sin(2.0 * M_PI * HAND_HZ * t_s);
+}
+
+static void bench_ultra_path(void)
+{
+    uint32_t nm = 0, spurious = 0;
+
+    for (uint32_t t = 1000; t < HAND_SECONDS * 1000000u; t += 12000 + test_rand() % 13000) {
+        double z_cm = hand_cm(t / 1e6) + 0.3 * test_rand_unit();
+
+        if (test_rand() % HAND_SPURIOUS == 0) {
+            z_cm = 60.0 + 200.0 * (test_rand_unit() + 1.0);   // eco de la pared
+            spurious++;
+        }
+        s_meas[nm++] = (echo_t){ t, (uint32_t)(z_cm / 0.01715) };
+    }
+
+    // Precisión a 1 kHz
+    double   sum2_old = 0.0, sum2_new = 0.0, max_old = 0.0, max_new = 0.0;
+    uint32_t n = 0, m = 0;
+    uint16_t out_old = 0;
+
+    ultra_track_init();
+
+    for (uint32_t now = 1000; now < HAND_SECONDS * 1000000u; now += 1000) {
+        for (; m < nm && s_meas[m].t_us <= now; m++) {
+            out_old = old_norm_v14(old_echo_cm(s_meas[m].dt_us));
+            ultra_track_update(0, (int32_t)(s_meas[m].dt_us * US_CM_PER_US_Q16), s_meas[m].t_us);
+        }
+
+        int32_t  d_q16;
+        uint16_t out_new = ultra_track_get(0, now, &d_q16) ? curve_dist(CURVE_LINEAR, d_q16) : 0;
+
+        if (now < 200000) continue;   // arranque
+
+        double exact = exact_v14(hand_cm(now / 1e6));
+        double e_old = fabs(out_old - exact);
+        double e_new = fabs(out_new - exact);
+
+        sum2_old += e_old * e_old;
+        sum2_new += e_new * e_new;
+        if (e_old > max_old) max_old = e_old;
+        if (e_new > max_new) max_new = e_new;
+        n++;
+    }
+
+    // Tiempo: antes, una conversión por medida; después, una actualización
+    // por medida y una lectura por milisegundo
+    double t0 = test_cpu_s();
+    for (int r = 0; r < TRACE_REPS; r++) {
+        for (uint32_t i = 0; i < nm; i++) s_sink = old_norm_v14(old_echo_cm(s_meas[i].dt_us));
+    }
+    double t1 = test_cpu_s();
+    for (int r = 0; r < TRACE_REPS; r++) {
+        ultra_track_init();
+        m = 0;
+        for (uint32_t now = 1000; now < HAND_SECONDS * 1000000u; now += 1000) {
+            for (; m < nm && s_meas[m].t_us <= now; m++) {
+                ultra_track_update(0, (int32_t)(s_meas[m].dt_us * US_CM_PER_US_Q16), s_meas[m].t_us);
+            }
+            int32_t d_q16;
+            if (ultra_track_get(0, now, &d_q16)) s_sink = curve_dist(CURVE_LINEAR, d_q16);
+        }
+    }
+    double t2 = test_cpu_s();
+
+    double rms_old = sqrt(sum2_old / n), rms_new = sqrt(sum2_new / n);
+    double play_s  = (double)HAND_SECONDS * TRACE_REPS;
+
+    printf("  mano a %.1f Hz, %u medidas, %u ecos espurios; error contra la mano a 1 kHz:\n",
+           HAND_HZ, (unsigned)nm, (unsigned)spurious);
+    printf("  %-26s RMS %7.1f -> %7.1f LSB  máx %7.1f -> %7.1f LSB\n",
+           "medida tal cual -> seguidor", rms_old, rms_new, max_old, max_new);
+    printf("  %-26s %.2f -> %.2f us de CPU por segundo de juego (%u -> 1000 salidas/s)\n",
+           "", (t1 - t0) / play_s * 1e6, (t2 - t1) / play_s * 1e6,
+           (unsigned)(nm / HAND_SECONDS));
+
+    CHECK(rms_new < rms_old);
+    CHECK(max_new < max_old);
+}
+
+// ----------------------------
+// Tempo del clock
+// ----------------------------
+
+typedef struct {
+    const char *name;
+    double      bpm0, bpm1;
+    double      jitter_us;
+} clock_case_t;
+
+static const clock_case_t s_clock_cases[] = {
+    { "120.0 BPM, ±1 ms",        120.0,  120.0,  1000.0 },
+    { "123.4 BPM, ±1 ms",        123.4,  123.4,  1000.0 },
+    { "127.6 BPM, ±0.2 ms",      127.6,  127.6,   200.0 },
+    { "120 -> 128.5 BPM salto",  120.0,  128.5,  1000.0 },
+    { "90 -> 170 BPM salto",      90.0,  170.0,  1000.0 },
+};
+
+#define CLOCK_TICKS        4800     // 200 beats
+#define CLOCK_CHANGE_TICK  2400
+#define CLOCK_SETTLE_TICKS (8 * 24) // 8 beats tras el arranque o el cambio
+#define CLOCK_CONV_TOL_BPM 1.0      // convergencia: dentro de 1 BPM y ya no sale
+
+static uint64_t s_ticks[CLOCK_TICKS];
+
+static void bench_clock(const clock_case_t *cc)
+{
+    double ideal = 1000000.0;
+
+    for (int k = 0; k < CLOCK_TICKS; k++) {
+        double bpm = (k < CLOCK_CHANGE_TICK) ? cc->bpm0 : cc->bpm1;
+
+        if (k > 0) ideal += 60000000.0 / (bpm * 24.0);
+        s_ticks[k] = (uint64_t)llround(ideal + test_rand_unit() * cc->jitter_us);
+    }
+
+    // Precisión del BPM que se enseña, ya asentado. El de antes salía entero;
+    // también se mide su filtro sin redondear, para no culpar sólo al redondeo
+    old_clock_t old = {0};
+    double      sum2_old = 0.0, sum2_new = 0.0, max_old = 0.0, max_new = 0.0;
+    double      sum2_lp = 0.0;
+    uint32_t    n = 0;
+    int         out_old = 0, out_new = 0;   // último tick de cada tramo fuera de tolerancia
+    int         conv_old = 0, conv_new = 0; // peor convergencia (ticks) de los dos tramos
+
+    clock_tracker_init();
+
+    for (int k = 0; k < CLOCK_TICKS; k++) {
+        double bpm   = (k < CLOCK_CHANGE_TICK) ? cc->bpm0 : cc->bpm1;
+        int    since = (k < CLOCK_CHANGE_TICK) ? k : k - CLOCK_CHANGE_TICK;
+
+        old_clock_tick(&old, s_ticks[k]);
+        clock_tracker_on_tick(s_ticks[k]);
+
+        if (since == 0) out_old = out_new = 0;
+        if (fabs(old.bpm_lp - bpm) > CLOCK_CONV_TOL_BPM) out_old = since + 1;
+        if (fabs(clock_tracker_get_bpm_x100() / 100.0 - bpm) > CLOCK_CONV_TOL_BPM) out_new = since + 1;
+        if (k == CLOCK_CHANGE_TICK - 1 || k == CLOCK_TICKS - 1) {
+            if (out_old > conv_old) conv_old = out_old;
+            if (out_new > conv_new) conv_new = out_new;
+        }
+
+        if (since < CLOCK_SETTLE_TICKS) continue;
+
+        double e_old = fabs(old.bpm - bpm);
+        double e_lp  = old.bpm_lp - bpm;
+        double e_new = fabs(clock_tracker_get_bpm_x100() / 100.0 - bpm);
+
+        sum2_old += e_old * e_old;
+        sum2_lp  += e_lp * e_lp;
+        sum2_new += e_new * e_new;
+        if (e_old > max_old) max_old = e_old;
+        if (e_new > max_new) max_new = e_new;
+        n++;
+    }
+
+    // Tiempo por tick
+    double t0 = test_cpu_s();
+    for (int r = 0; r < TRACE_REPS; r++) {
+        old = (old_clock_t){0};
+        for (int k = 0; k < CLOCK_TICKS; k++) old_clock_tick(&old, s_ticks[k]);
+        s_sink = old.bpm;
+    }
+    double t1 = test_cpu_s();
+    for (int r = 0; r < TRACE_REPS; r++) {
+        clock_tracker_init();
+        for (int k = 0; k < CLOCK_TICKS; k++) clock_tracker_on_tick(s_ticks[k]);
+        s_sink = clock_tracker_get_bpm_x100();
+    }
+    double t2 = test_cpu_s();
+
+    double rms_old = sqrt(sum2_old / n), rms_new = sqrt(sum2_new / n);
+    double rms_lp  = sqrt(sum2_lp / n);
+    double ticks   = (double)CLOCK_TICKS * TRACE_REPS;
+
+    printf("  %-24s conv %4d -> %3d ticks  RMS %5.3f (%5.3f) -> %5.3f BPM  "
+           "máx %5.3f -> %5.3f BPM  %4.1f -> %4.1f ns/tick\n",
+           cc->name, conv_old, conv_new, rms_old, rms_lp, rms_new, max_old, max_new,
+           (t1 - t0) / ticks * 1e9, (t2 - t1) / ticks * 1e9);
+
+    // Lo que se ganó es enganchar antes; en tempo fijo, el filtro de antes
+    // (media de un beat entero) sin redondear da un BPM algo más quieto
+    CHECK(conv_new < conv_old);
+    CHECK(max_new < 1.5);
+}
+
+int main(void)
+{
+    printf("Antes (float) -> después (enteros / tablas), error contra double:\n");
+    bench_echo();
+    bench_curve();
+
+    printf("\nultra_track_update + curve_dist contra la medida en float:\n");
+    bench_ultra_path();
+
+    printf("\nclock_tracker contra la ventana de 24 ticks + filtro 0.7/0.3 "
+           "(entre paréntesis, sin redondear):\n");
+    for (size_t i = 0; i < sizeof(s_clock_cases) / sizeof(s_clock_cases[0]); i++) {
+        bench_clock(&s_clock_cases[i]);
+    }
+
+    printf("\n(tiempos en el host con FPU; en el M0+ el float es soft-float)\n");
+    return TEST_RESULT();
+}
@@ -0,0 +1,438 @@
+// fuzz_slave_link.c - Fuzz y throughput del parser del enlace con el SLAVE
+//
+// Prueba ctrl_protocol.c (CRC-16, frames v2, estado empaquetado) y la
+// máquina de estados de slave_link_parse_span() con:
+//
+//   - flujos válidos (v1 y v2 mezclados) partidos en tramos al azar: todos
+//     los frames se aceptan, ninguno de más
+//   - frames v2 con 1..3 bits cambiados: el CRC los rechaza todos (distancia
+//     de Hamming 4 de CRC-16/CCITT); si el cambio toca la cabecera o la
+//     longitud, el frame deja de ser el mismo y sólo se acota la tasa de
+//     falsos positivos (~2^-16)
+//   - frames truncados seguidos de otros: el truncado nunca se acepta y el
+//     parser se recupera en el frame siguiente al hueco
+//   - bytes al azar (con muchas cabeceras AA 5A metidas)
+//
+// Los accesos fuera de rango los caza AddressSanitizer (el ejecutable
+// fuzz_slave_link se compila con -fsanitize=address,undefined); todos los
+// buffers que se le pasan al parser tienen el tamaño justo en el heap. Al
+// final, el throughput del parser en bytes/s (bench_slave_link, sin
+// sanitizers, da la cifra buena).
+//
+// slave_link.c se incluye entero para llegar a su parser estático; el Pico
+// SDK lo sustituyen los stubs de tests/stubs.
+
+#include <stdlib.h>
+
+#include "slave_link.c"
+#include "test_util.h"
+
+#define FUZZ_FRAMES          20000
+#define FUZZ_FLIP_TRIALS     200000
+#define FUZZ_TRUNC_TRIALS    50000
+#define FUZZ_GARBAGE_BYTES   (4u << 20)
+#define BENCH_BYTES          (16u << 20)
+#define BENCH_SPAN           64u        // bytes por tramo (media de lo que deja el DMA)
+
+// bench_slave_link: sin sanitizers y sin las pruebas, sólo el throughput
+#ifndef FUZZ_BENCH_ONLY
+#define FUZZ_BENCH_ONLY      0
+#endif
+
+// Falsos positivos admitidos cuando el cambio altera el propio encuadre:
+// 2^-16 por intento de media, con margen
+#define FALSE_POS_MAX(trials)  ((trials) / 4096u + 2u)
+
+static uint8_t s_seq;
+
+// ----------------------------
+// Generadores de frames
+// ----------------------------
+
+static uint8_t rnd8(void)
+{
+    return (uint8_t)(test_rand() >> 24);
+}
+
+static uint8_t gen_v2_payload(uint8_t type, uint8_t *p)
+{
+    switch (type) {
+    case CTRL_V2_T_DELTA:
+    case CTRL_V2_T_FULL:
+    {
+        ctrl_payload_t st;
+        st.arcade_mask = rnd8() & 0x0F;
+        st.normal_mask = rnd8() & 0x0F;
+        for (int i = 0; i < CTRL_FRAME_NUM_POTS; i++) st.pot[i] = (uint16_t)(test_rand() & 0x0FFF);
+
+        uint8_t flags = (type == CTRL_V2_T_FULL) ? CTRL_V2_F_ALL : (rnd8() & CTRL_V2_F_ALL);
+        return ctrl_v2_encode_state(&st, flags, p);
+    }
+
+    case CTRL_V2_T_EDGE:
+    {
+        uint8_t n   = (uint8_t)(rnd8() % (CTRL_V2_EDGE_MAX + 1));
+        uint8_t len = 0;
+
+        p[len++] = rnd8();
+        if (n == 0) return len;           // EDGE de un byte: sólo la máscara
+        for (int i = 0; i < 4; i++) p[len++] = rnd8();
+        for (uint8_t e = 0; e < n; e++) {
+            p[len++] = (uint8_t)((rnd8() & 0x07) | (rnd8() & CTRL_V2_EDGE_PRESSED));
+            for (int i = 0; i < 4; i++) p[len++] = rnd8();
+        }
+        return len;
+    }
+
+    case CTRL_V2_T_DESC:
+        for (int i = 0; i < CTRL_DESC_LEN; i++) p[i] = rnd8() & 0x0F;
+        return CTRL_DESC_LEN;
+
+    case CTRL_V2_T_CONFIG_ACK:
+    {
+        uint8_t n = (uint8_t)(1 + rnd8() % CTRL_PARAM_MAX_PER_FRAME);
+        for (uint8_t i = 0; i < n; i++) {
+            p[i * 3]     = (uint8_t)(1 + rnd8() % (CTRL_PARAM_COUNT - 1));
+            p[i * 3 + 1] = rnd8();
+            p[i * 3 + 2] = rnd8();
+        }
+        return (uint8_t)(n * CTRL_PARAM_ENTRY_LEN);
+    }
+
+    case CTRL_V2_T_SYNC_RESP:
+        for (int i = 0; i < CTRL_SYNC_RESP_LEN; i++) p[i] = rnd8();
+        return CTRL_SYNC_RESP_LEN;
+
+    default:   // END, o un tipo que el master no espera (error de formato)
+        return (uint8_t)(rnd8() % 4);
+    }
+}
+
+// Un frame v2 (o, una de cada 8 veces, uno v1) en out. Devuelve su tamaño.
+static uint8_t gen_frame(uint8_t *out, bool allow_v1)
+{
+    static const uint8_t types[] = {
+        CTRL_V2_T_DELTA, CTRL_V2_T_DELTA, CTRL_V2_T_DELTA, CTRL_V2_T_EDGE, CTRL_V2_T_EDGE,
+        CTRL_V2_T_FULL, CTRL_V2_T_DESC, CTRL_V2_T_CONFIG_ACK, CTRL_V2_T_SYNC_RESP,
+        CTRL_V2_T_END, CTRL_V2_T_POLL,
+    };
+
+    if (allow_v1 && (rnd8() & 7) == 0) {
+        uint8_t n = 0;
+        out[n++] = CTRL_FRAME_HEADER_1;
+        out[n++] = CTRL_FRAME_HEADER_2;
+        for (int i = 0; i < CTRL_FRAME_PAYLOAD_SIZE; i++) out[n++] = rnd8();
+        out[n] = ctrl_protocol_calc_checksum(&out[2], CTRL_FRAME_PAYLOAD_SIZE);
+        return (uint8_t)(n + 1);
+    }
+
+    uint8_t payload[CTRL_V2_MAX_PAYLOAD];
+    uint8_t type = types[rnd8() % sizeof(types)];
+    uint8_t len  = gen_v2_payload(type, payload);
+
+    return ctrl_v2_build_frame(type, s_seq++, payload, len, out);
+}
+
+// Pasa buf al parser en tramos de tamaño al azar (1..max_span), cada uno en
+// su propio bloque del heap para que ASan vea cualquier lectura de más
+static void feed(const uint8_t *buf, uint32_t n, uint32_t max_span)
+{
+    while (n > 0) {
+        uint32_t span = 1u + test_rand() % max_span;
+        if (span > n) span = n;
+
+        uint8_t *blk = malloc(span);
+        memcpy(blk, buf, span);
+        stub_time_us += 50;
+        s_rx_head_us  = stub_time_us;
+        s_rx_rest     = 0;
+        slave_link_parse_span(blk, span);
+        free(blk);
+
+        buf += span;
+        n   -= span;
+    }
+}
+
+static void link_reset(void)
+{
+    slave_link_init();
+    s_seq = 0;
+}
+
+// ----------------------------
+// ctrl_protocol.c
+// ----------------------------
+
+// CRC-16/CCITT-FALSE bit a bit
+static uint16_t ref_crc16(uint16_t crc, const uint8_t *d, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        crc ^= (uint16_t)(d[i] << 8);
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void test_ctrl_protocol(void)
+{
+    static const uint8_t check[] = "123456789";
+    CHECK(ctrl_protocol_crc16(CTRL_CRC16_INIT, check, 9) == 0x29B1);
+
+    for (uint32_t k = 0; k < FUZZ_FRAMES; k++) {
+        uint8_t  d[64];
+        uint16_t n = (uint16_t)(test_rand() % sizeof(d));
+        for (uint16_t i = 0; i < n; i++) d[i] = rnd8();
+        CHECK(ctrl_protocol_crc16(CTRL_CRC16_INIT, d, n) == ref_crc16(CTRL_CRC16_INIT, d, n));
+    }
+
+    // Frame bueno: se acepta entero y con cualquier otro tamaño no
+    for (uint32_t k = 0; k < FUZZ_FRAMES; k++) {
+        uint8_t f[CTRL_V2_MAX_FRAME];
+        uint8_t size = gen_frame(f, false);
+
+        CHECK(size >= CTRL_V2_HDR_SIZE + CTRL_V2_CRC_SIZE && size <= CTRL_V2_MAX_FRAME);
+        CHECK(CTRL_V2_FRAME_LEN(f) == size);
+        CHECK(ctrl_v2_check_frame(f, size));
+        CHECK(!ctrl_v2_check_frame(f, (uint8_t)(size - 1)));
+    }
+
+    // Payload de más: no se construye
+    uint8_t big[CTRL_V2_MAX_PAYLOAD + 1] = {0}, out[CTRL_V2_MAX_FRAME + 8];
+    CHECK(ctrl_v2_build_frame(CTRL_V2_T_DELTA, 0, big, sizeof(big), out) == 0);
+
+    // Estado: ida y vuelta, y payloads al azar de tamaño justo en el heap
+    for (uint32_t k = 0; k < FUZZ_FRAMES; k++) {
+        ctrl_payload_t a = {0}, b = {0};
+        uint8_t        p[CTRL_V2_STATE_MAX];
+
+        a.arcade_mask = rnd8() & 0x0F;
+        a.normal_mask = rnd8() & 0x0F;
+        for (int i = 0; i < CTRL_FRAME_NUM_POTS; i++) a.pot[i] = (uint16_t)(test_rand() & 0x0FFF);
+
+        uint8_t flags = rnd8() & CTRL_V2_F_ALL;
+        uint8_t n     = ctrl_v2_encode_state(&a, flags, p);
+
+        CHECK(n <= CTRL_V2_STATE_MAX);
+        CHECK(ctrl_v2_decode_state(p, n, &b) == flags);
+        if (flags & CTRL_V2_F_BUTTONS) CHECK(b.arcade_mask == a.arcade_mask && b.normal_mask == a.normal_mask);
+        for (int i = 0; i < CTRL_FRAME_NUM_POTS; i++) {
+            if (flags & CTRL_V2_F_POT(i)) CHECK(b.pot[i] == a.pot[i]);
+        }
+
+        uint8_t  len = (uint8_t)(test_rand() % (CTRL_V2_MAX_PAYLOAD + 1));
+        uint8_t *r   = malloc(len ? len : 1);
+        for (uint8_t i = 0; i < len; i++) r[i] = rnd8();
+        int fl = ctrl_v2_decode_state(r, len, &b);
+        if (fl >= 0) {
+            // Si lo acepta, la longitud es la que piden sus flags
+            CHECK(ctrl_v2_encode_state(&b, (uint8_t)fl, p) == len);
+        }
+        free(r);
+    }
+}
+
+// ----------------------------
+// Parser: flujo válido
+// ----------------------------
+
+static void test_valid_stream(void)
+{
+    uint8_t *buf = malloc((size_t)FUZZ_FRAMES * CTRL_V2_MAX_FRAME);
+    uint32_t n = 0, v1 = 0, v2 = 0;
+
+    link_reset();
+    for (uint32_t k = 0; k < FUZZ_FRAMES; k++) {
+        uint8_t size = gen_frame(&buf[n], true);
+        if (buf[n + 1] == CTRL_FRAME_HEADER_2) v1++; else v2++;
+        n += size;
+    }
+
+    feed(buf, n, 200);
+
+    CHECK(s_stats.frames_ok == FUZZ_FRAMES);
+    CHECK(s_stats.frames_v1 == v1 && s_stats.frames_v2 == v2);
+    CHECK(s_stats.checksum_errors == 0);
+    CHECK(s_stats.skipped_bytes == 0);
+    free(buf);
+}
+
+// ----------------------------
+// Parser: bits cambiados
+// ----------------------------
+
+static void test_bit_flips(void)
+{
+    static uint8_t filler[CTRL_V2_MAX_FRAME];   // ceros: termina cualquier frame a medias
+    uint32_t body_trials = 0, frame_trials = 0, frame_accepted = 0;
+
+    link_reset();
+
+    for (uint32_t k = 0; k < FUZZ_FLIP_TRIALS; k++) {
+        uint8_t f[CTRL_V2_MAX_FRAME];
+        uint8_t size  = gen_frame(f, false);
+        uint8_t flips = (uint8_t)(1 + rnd8() % 3);
+        bool    framing = false;
+        uint16_t pos[3];
+
+        for (uint8_t i = 0; i < flips; i++) {
+            // Bits distintos
+            do {
+                pos[i] = (uint16_t)(test_rand() % (size * 8u));
+                for (uint8_t j = 0; j < i; j++) if (pos[j] == pos[i]) pos[i] = 0xFFFF;
+            } while (pos[i] == 0xFFFF);
+
+            uint8_t byte = (uint8_t)(pos[i] / 8);
+            f[byte] ^= (uint8_t)(1u << (pos[i] % 8));
+            if (byte < 2 || byte == 4) framing = true;   // cabecera o longitud
+        }
+
+        uint32_t ok0 = s_stats.frames_ok;
+        feed(f, size, 16);
+        feed(filler, sizeof(filler), sizeof(filler));
+        uint32_t accepted = s_stats.frames_ok - ok0;
+
+        if (framing) {
+            frame_trials++;
+            frame_accepted += accepted;
+        } else {
+            body_trials++;
+            CHECK(accepted == 0);
+        }
+
+        // El siguiente frame bueno entra
+        size = gen_frame(f, false);
+        ok0  = s_stats.frames_ok;
+        feed(f, size, 16);
+        CHECK(s_stats.frames_ok == ok0 + 1);
+    }
+
+    printf("bits cambiados: %u frames rechazados por CRC; %u con la cabecera o la "
+           "longitud tocada, %u aceptados\n",
+           (unsigned)body_trials, (unsigned)frame_trials, (unsigned)frame_accepted);
+    CHECK(frame_accepted <= FALSE_POS_MAX(frame_trials));
+}
+
+// ----------------------------
+// Parser: frames truncados
+// ----------------------------
+
+static void test_truncated(void)
+{
+    static uint8_t filler[CTRL_V2_MAX_FRAME];
+    uint32_t swallowed = 0, bogus = 0;
+
+    link_reset();
+
+    for (uint32_t k = 0; k < FUZZ_TRUNC_TRIALS; k++) {
+        uint8_t a[CTRL_V2_MAX_FRAME], b[CTRL_V2_MAX_FRAME], c[CTRL_V2_MAX_FRAME];
+        uint8_t sa = gen_frame(a, true);
+        uint8_t cut = (uint8_t)(1 + rnd8() % (sa - 1));   // 1..sa-1 bytes
+        uint8_t sb = gen_frame(b, true);
+        uint8_t sc = gen_frame(c, true);
+
+        // Truncado + uno bueno pegado: como mucho sale el bueno
+        uint32_t ok0 = s_stats.frames_ok;
+        feed(a, cut, 8);
+        feed(b, sb, 8);
+        feed(filler, sizeof(filler), sizeof(filler));
+        uint32_t got = s_stats.frames_ok - ok0;
+
+        if (got == 0) swallowed++;
+        if (got > 1) bogus++;
+
+        // Tras el hueco, el siguiente siempre entra
+        ok0 = s_stats.frames_ok;
+        feed(c, sc, 8);
+        CHECK(s_stats.frames_ok == ok0 + 1);
+    }
+
+    printf("truncados: %u; el frame siguiente se perdió con él en %u, "
+           "frames de más %u\n",
+           (unsigned)FUZZ_TRUNC_TRIALS, (unsigned)swallowed, (unsigned)bogus);
+    CHECK(bogus <= FALSE_POS_MAX(FUZZ_TRUNC_TRIALS));
+}
+
+// ----------------------------
+// Parser: bytes al azar
+// ----------------------------
+
+static void test_garbage(void)
+{
+    uint8_t *buf = malloc(FUZZ_GARBAGE_BYTES);
+
+    for (uint32_t i = 0; i < FUZZ_GARBAGE_BYTES; i++) {
+        uint32_t r = test_rand();
+        // Una de cada 16 posiciones, una cabecera v1 o v2 para que el parser
+        // entre en todos los estados
+        if ((r & 0x0F) == 0 && i + 1 < FUZZ_GARBAGE_BYTES) {
+            buf[i++] = CTRL_FRAME_HEADER_1;
+            buf[i]   = (r & 0x10) ? CTRL_V2_HEADER_2 : CTRL_FRAME_HEADER_2;
+        } else {
+            buf[i] = (uint8_t)(r >> 24);
+        }
+    }
+
+    link_reset();
+    feed(buf, FUZZ_GARBAGE_BYTES, 300);
+
+    uint32_t tries = s_stats.frames_ok + s_stats.checksum_errors + s_stats.format_errors;
+    printf("basura: %u bytes, %u intentos de frame, %u aceptados (v1 %u: checksum "
+           "de 8 bits)\n",
+           (unsigned)FUZZ_GARBAGE_BYTES, (unsigned)tries,
+           (unsigned)s_stats.frames_ok, (unsigned)s_stats.frames_v1);
+    // El CRC-16 deja pasar ~1 de cada 65536; el checksum v1, ~1 de cada 256
+    CHECK(s_stats.frames_v2 <= FALSE_POS_MAX(tries));
+    free(buf);
+}
+
+// ----------------------------
+// Throughput
+// ----------------------------
+
+static void bench(void)
+{
+    uint8_t *buf = malloc(BENCH_BYTES + CTRL_V2_MAX_FRAME);
+    uint32_t n = 0, frames = 0;
+
+    while (n < BENCH_BYTES) {
+        n += gen_frame(&buf[n], false);
+        frames++;
+    }
+
+    link_reset();
+
+    double t0 = test_cpu_s();
+    for (uint32_t i = 0; i < n; i += BENCH_SPAN) {
+        uint32_t span = (n - i < BENCH_SPAN) ? n - i : BENCH_SPAN;
+        stub_time_us += 10;
+        s_rx_head_us  = stub_time_us;
+        slave_link_parse_span(&buf[i], span);
+    }
+    double dt = test_cpu_s() - t0;
+
+    CHECK(s_stats.frames_ok == frames);
+    if (dt <= 0.0) dt = 1e-9;
+    printf("throughput: %u bytes en tramos de %u, %.1f MB/s, %.2f Mframes/s, "
+           "%.1f ns/byte (host)\n",
+           (unsigned)n, (unsigned)BENCH_SPAN, n / dt / 1e6, frames / dt / 1e6,
+           dt / n * 1e9);
+    // A 3 Mbaud (8N1) llegan 300 kB/s
+    printf("            %.0fx lo que llega a 3 Mbaud\n", n / dt / 300000.0);
+    free(buf);
+}
+
+int main(void)
+{
+    if (!FUZZ_BENCH_ONLY) {
+        test_ctrl_protocol();
+        test_valid_stream();
+        test_bit_flips();
+        test_truncated();
+        test_garbage();
+    }
+    bench();
+    return TEST_RESULT();
+}
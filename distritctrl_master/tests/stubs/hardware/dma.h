@@ -0,0 +1,30 @@
+// hardware/dma.h (host) - Canal de DMA que nunca avanza: la prueba mete los
+// bytes directamente al parser
+#ifndef HOST_HARDWARE_DMA_H
+#define HOST_HARDWARE_DMA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+
+typedef struct { uint32_t ctrl; } dma_channel_config;
+typedef struct { volatile uint32_t transfer_count; } dma_channel_hw_t;
+typedef struct { dma_channel_hw_t ch[12]; } dma_hw_t;
+
+extern dma_hw_t *dma_hw;
+
+int                dma_claim_unused_channel(bool required);
+dma_channel_config dma_channel_get_default_config(unsigned int channel);
+void               channel_config_set_transfer_data_size(dma_channel_config *c,
+                                                         enum dma_channel_transfer_size size);
+void               channel_config_set_read_increment(dma_channel_config *c, bool incr);
+void               channel_config_set_write_increment(dma_channel_config *c, bool incr);
+void               channel_config_set_dreq(dma_channel_config *c, unsigned int dreq);
+void               channel_config_set_ring(dma_channel_config *c, bool write, unsigned int size_bits);
+void               dma_channel_configure(unsigned int channel, const dma_channel_config *config,
+                                         volatile void *write_addr, const volatile void *read_addr,
+                                         uint32_t transfer_count, bool trigger);
+void               dma_channel_abort(unsigned int channel);
+
+#endif // HOST_HARDWARE_DMA_H
@@ -0,0 +1,15 @@
+// hardware/gpio.h (host)
+#ifndef HOST_HARDWARE_GPIO_H
+#define HOST_HARDWARE_GPIO_H
+
+#include <stdbool.h>
+
+enum { GPIO_IN = 0, GPIO_OUT = 1 };
+enum { GPIO_FUNC_SPI = 1, GPIO_FUNC_UART = 2 };
+
+void gpio_init(unsigned int gpio);
+void gpio_set_dir(unsigned int gpio, bool out);
+void gpio_put(unsigned int gpio, bool value);
+void gpio_set_function(unsigned int gpio, int fn);
+
+#endif // HOST_HARDWARE_GPIO_H
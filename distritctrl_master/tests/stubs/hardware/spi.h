@@ -0,0 +1,7 @@
+// hardware/spi.h (host) - Sólo para compilar: las pruebas usan el enlace UART
+#ifndef HOST_HARDWARE_SPI_H
+#define HOST_HARDWARE_SPI_H
+
+typedef struct spi_inst spi_inst_t;
+
+#endif // HOST_HARDWARE_SPI_H
@@ -0,0 +1,29 @@
+// hardware/uart.h (host) - La TX no va a ningún sitio; sólo se cuenta
+#ifndef HOST_HARDWARE_UART_H
+#define HOST_HARDWARE_UART_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct uart_inst uart_inst_t;
+typedef struct { volatile uint32_t dr, fr; } uart_hw_t;
+
+#define UART_UARTFR_BUSY_BITS  0x00000008u
+
+extern uart_inst_t *uart0, *uart1;
+extern uint32_t     stub_uart_tx_bytes;
+
+enum { UART_PARITY_NONE = 0 };
+
+unsigned int uart_init(uart_inst_t *uart, unsigned int baud);
+unsigned int uart_set_baudrate(uart_inst_t *uart, unsigned int baud);
+void         uart_set_format(uart_inst_t *uart, unsigned int data_bits,
+                             unsigned int stop_bits, int parity);
+void         uart_set_fifo_enabled(uart_inst_t *uart, bool enabled);
+void         uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len);
+void         uart_tx_wait_blocking(uart_inst_t *uart);
+unsigned int uart_get_dreq(uart_inst_t *uart, bool is_tx);
+uart_hw_t   *uart_get_hw(uart_inst_t *uart);
+
+#endif // HOST_HARDWARE_UART_H
@@ -0,0 +1,23 @@
+// pico/stdlib.h (host) - Lo mínimo del Pico SDK para compilar slave_link.c
+// en las pruebas del host. Las funciones están en pico_stubs.c.
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+#include "pico/time.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+
+#define __not_in_flash_func(f)  f
+#define __dmb()                 do {} while (0)
+#define __sev()                 do {} while (0)
+#define __wfe()                 do {} while (0)
+
+static inline void tight_loop_contents(void) {}
+
+#endif // HOST_PICO_STDLIB_H
@@ -0,0 +1,12 @@
+// pico/time.h (host) - Reloj simulado: lo avanza la prueba (stub_time_us)
+#ifndef HOST_PICO_TIME_H
+#define HOST_PICO_TIME_H
+
+#include <stdint.h>
+
+extern uint64_t stub_time_us;
+
+static inline uint64_t time_us_64(void) { return stub_time_us; }
+static inline uint32_t time_us_32(void) { return (uint32_t)stub_time_us; }
+
+#endif // HOST_PICO_TIME_H
@@ -0,0 +1,54 @@
+// pico_stubs.c (host) - Implementación mínima de lo que declaran los stubs
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+
+uint64_t stub_time_us       = 0;
+uint32_t stub_uart_tx_bytes = 0;
+
+static uart_hw_t s_uart_hw;
+uart_inst_t *uart0 = (uart_inst_t *)&s_uart_hw;
+uart_inst_t *uart1 = (uart_inst_t *)&s_uart_hw;
+
+static dma_hw_t s_dma_hw;
+dma_hw_t *dma_hw = &s_dma_hw;
+
+void gpio_init(unsigned int gpio) { (void)gpio; }
+void gpio_set_dir(unsigned int gpio, bool out) { (void)gpio; (void)out; }
+void gpio_put(unsigned int gpio, bool value) { (void)gpio; (void)value; }
+void gpio_set_function(unsigned int gpio, int fn) { (void)gpio; (void)fn; }
+
+unsigned int uart_init(uart_inst_t *uart, unsigned int baud) { (void)uart; return baud; }
+unsigned int uart_set_baudrate(uart_inst_t *uart, unsigned int baud) { (void)uart; return baud; }
+void uart_set_format(uart_inst_t *uart, unsigned int data_bits, unsigned int stop_bits, int parity)
+{
+    (void)uart; (void)data_bits; (void)stop_bits; (void)parity;
+}
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled) { (void)uart; (void)enabled; }
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len)
+{
+    (void)uart; (void)src;
+    stub_uart_tx_bytes += (uint32_t)len;
+}
+void uart_tx_wait_blocking(uart_inst_t *uart) { (void)uart; }
+unsigned int uart_get_dreq(uart_inst_t *uart, bool is_tx) { (void)uart; (void)is_tx; return 0; }
+uart_hw_t *uart_get_hw(uart_inst_t *uart) { return (uart_hw_t *)uart; }
+
+int dma_claim_unused_channel(bool required) { (void)required; return 0; }
+dma_channel_config dma_channel_get_default_config(unsigned int channel)
+{
+    (void)channel;
+    return (dma_channel_config){0};
+}
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) { (void)c; (void)size; }
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) { (void)c; (void)incr; }
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) { (void)c; (void)incr; }
+void channel_config_set_dreq(dma_channel_config *c, unsigned int dreq) { (void)c; (void)dreq; }
+void channel_config_set_ring(dma_channel_config *c, bool write, unsigned int size_bits) { (void)c; (void)write; (void)size_bits; }
+void dma_channel_configure(unsigned int channel, const dma_channel_config *config,
+                           volatile void *write_addr, const volatile void *read_addr,
+                           uint32_t transfer_count, bool trigger)
+{
+    (void)config; (void)write_addr; (void)read_addr; (void)trigger;
+    s_dma_hw.ch[channel].transfer_count = transfer_count;   // nunca baja: sin bytes nuevos
+}
+void dma_channel_abort(unsigned int channel) { (void)channel; }
@@ -0,0 +1,427 @@
+// test_midi_in.c - Parser de paquetes USB-MIDI (midi_in.c) en el host
+//
+//   - todos los CIN (0x0..0xF): callback, argumentos y contadores
+//   - SysEx de dos cables intercalados: el que llegó primero sale entero y
+//     el otro se cuenta (mensaje y paquetes)
+//   - SysEx más largo que MIDI_IN_SYSEX_MAX: se entrega truncado
+//   - throughput: una traza mezclada (clock, notas, CC, SysEx) servida de 64
+//     en 64 bytes (16 paquetes), como la lee midi_core en cada tud_task
+
+#include <string.h>
+
+#include "midi_in.h"
+#include "test_util.h"
+
+#define THROUGHPUT_BATCHES   200000
+#define BATCH_PACKETS        16      // 64 bytes = CFG_TUD_MIDI_RX_BUFSIZE / 4
+
+// ----------------------------
+// Registro de callbacks
+// ----------------------------
+
+typedef enum {
+    EV_NONE = 0,
+    EV_NOTE_ON, EV_NOTE_OFF, EV_POLY, EV_CC, EV_PROGRAM, EV_CHAN_PRESS,
+    EV_PITCH_BEND, EV_REALTIME, EV_SYS_COMMON, EV_SYSEX,
+} ev_kind_t;
+
+typedef struct {
+    ev_kind_t kind;
+    uint8_t   cable;
+    uint8_t   a, b, c;               // canal / status, datos
+    uint16_t  v14;
+    uint8_t   sx[MIDI_IN_SYSEX_MAX];
+    uint16_t  sx_len;
+    bool      sx_trunc;
+} ev_t;
+
+static ev_t     s_ev;                // último evento
+static uint32_t s_ev_n;              // eventos desde el último reset
+
+static void ev_set(ev_kind_t k, uint8_t cable, uint8_t a, uint8_t b, uint8_t c)
+{
+    s_ev.kind  = k;
+    s_ev.cable = cable;
+    s_ev.a = a; s_ev.b = b; s_ev.c = c;
+    s_ev_n++;
+}
+
+static void on_note_on(uint8_t cb, uint8_t ch, uint8_t n, uint8_t v)   { ev_set(EV_NOTE_ON, cb, ch, n, v); }
+static void on_note_off(uint8_t cb, uint8_t ch, uint8_t n, uint8_t v)  { ev_set(EV_NOTE_OFF, cb, ch, n, v); }
+static void on_poly(uint8_t cb, uint8_t ch, uint8_t n, uint8_t p)      { ev_set(EV_POLY, cb, ch, n, p); }
+static void on_cc(uint8_t cb, uint8_t ch, uint8_t cc, uint8_t v)       { ev_set(EV_CC, cb, ch, cc, v); }
+static void on_program(uint8_t cb, uint8_t ch, uint8_t p)              { ev_set(EV_PROGRAM, cb, ch, p, 0); }
+static void on_chan_press(uint8_t cb, uint8_t ch, uint8_t p)           { ev_set(EV_CHAN_PRESS, cb, ch, p, 0); }
+static void on_realtime(uint8_t cb, uint8_t st)                        { ev_set(EV_REALTIME, cb, st, 0, 0); }
+static void on_sys_common(uint8_t cb, uint8_t st, uint8_t d1, uint8_t d2) { ev_set(EV_SYS_COMMON, cb, st, d1, d2); }
+
+static void on_pitch_bend(uint8_t cb, uint8_t ch, uint16_t v14)
+{
+    ev_set(EV_PITCH_BEND, cb, ch, 0, 0);
+    s_ev.v14 = v14;
+}
+
+static void on_sysex(uint8_t cb, const uint8_t *data, uint16_t len, bool truncated)
+{
+    ev_set(EV_SYSEX, cb, 0, 0, 0);
+    memcpy(s_ev.sx, data, len);
+    s_ev.sx_len   = len;
+    s_ev.sx_trunc = truncated;
+}
+
+static const midi_in_handlers_t s_handlers = {
+    .note_on          = on_note_on,
+    .note_off         = on_note_off,
+    .poly_pressure    = on_poly,
+    .control_change   = on_cc,
+    .program_change   = on_program,
+    .channel_pressure = on_chan_press,
+    .pitch_bend       = on_pitch_bend,
+    .realtime         = on_realtime,
+    .system_common    = on_sys_common,
+    .sysex            = on_sysex,
+};
+
+static void reset(void)
+{
+    midi_in_init(&s_handlers);
+    memset(&s_ev, 0, sizeof(s_ev));
+    s_ev_n = 0;
+}
+
+static void pkt(uint8_t cable, uint8_t cin, uint8_t b0, uint8_t b1, uint8_t b2)
+{
+    const uint8_t p[4] = { (uint8_t)((cable << 4) | cin), b0, b1, b2 };
+    midi_in_parse_packet(p);
+}
+
+// Trocea un SysEx completo (con F0 y F7) en paquetes USB-MIDI, como el host
+static void send_sysex(uint8_t cable, const uint8_t *msg, uint16_t len)
+{
+    uint16_t i = 0;
+
+    while (len - i > 3) {
+        pkt(cable, 0x4, msg[i], msg[i + 1], msg[i + 2]);
+        i += 3;
+    }
+    switch (len - i) {
+    case 1: pkt(cable, 0x5, msg[i], 0, 0); break;
+    case 2: pkt(cable, 0x6, msg[i], msg[i + 1], 0); break;
+    case 3: pkt(cable, 0x7, msg[i], msg[i + 1], msg[i + 2]); break;
+    }
+}
+
+static uint16_t make_sysex(uint8_t *msg, uint16_t len, uint8_t seed)
+{
+    msg[0] = 0xF0;
+    for (uint16_t i = 1; i + 1 < len; i++) msg[i] = (uint8_t)((seed + i) & 0x7F);
+    msg[len - 1] = 0xF7;
+    return len;
+}
+
+// ----------------------------
+// Todos los CIN
+// ----------------------------
+
+static void test_all_cins(void)
+{
+    midi_in_stats_t st;
+
+    reset();
+
+    // 0x0 / 0x1: reservados
+    pkt(0, 0x0, 0x12, 0x34, 0x56);
+    pkt(0, 0x1, 0x12, 0x34, 0x56);
+    CHECK(s_ev_n == 0);
+
+    // 0x2: MTC quarter frame, song select
+    pkt(1, 0x2, 0xF1, 0x25, 0);
+    CHECK(s_ev.kind == EV_SYS_COMMON && s_ev.cable == 1 && s_ev.a == 0xF1 && s_ev.b == 0x25);
+    pkt(1, 0x2, 0xF3, 0x07, 0);
+    CHECK(s_ev.kind == EV_SYS_COMMON && s_ev.a == 0xF3 && s_ev.b == 0x07);
+
+    // 0x3: song position
+    pkt(2, 0x3, 0xF2, 0x10, 0x20);
+    CHECK(s_ev.kind == EV_SYS_COMMON && s_ev.cable == 2 && s_ev.a == 0xF2 &&
+          s_ev.b == 0x10 && s_ev.c == 0x20);
+
+    // 0x2 / 0x3 con un status que no es system common: ignorado
+    uint32_t n = s_ev_n;
+    pkt(0, 0x3, 0x90, 0x40, 0x40);
+    CHECK(s_ev_n == n);
+
+    // 0x5: tune request (F6) y byte suelto incoherente
+    pkt(3, 0x5, 0xF6, 0, 0);
+    CHECK(s_ev.kind == EV_SYS_COMMON && s_ev.cable == 3 && s_ev.a == 0xF6);
+    n = s_ev_n;
+    pkt(3, 0x5, 0x42, 0, 0);
+    CHECK(s_ev_n == n);
+
+    // 0x4 + 0x5 / 0x6 / 0x7: SysEx de 4, 5 y 6 bytes (acaba con 1, 2, 3)
+    for (uint16_t len = 4; len <= 6; len++) {
+        uint8_t msg[8];
+        make_sysex(msg, len, (uint8_t)len);
+        send_sysex(0, msg, len);
+        CHECK(s_ev.kind == EV_SYSEX && s_ev.sx_len == len && !s_ev.sx_trunc);
+        CHECK(memcmp(s_ev.sx, msg, len) == 0);
+    }
+
+    // 0x6 / 0x7 solos: SysEx de 2 y 3 bytes en un paquete (F0 F7, F0 xx F7)
+    pkt(0, 0x6, 0xF0, 0xF7, 0);
+    CHECK(s_ev.kind == EV_SYSEX && s_ev.sx_len == 2);
+    pkt(0, 0x7, 0xF0, 0x11, 0xF7);
+    CHECK(s_ev.kind == EV_SYSEX && s_ev.sx_len == 3 && s_ev.sx[1] == 0x11);
+
+    // 0x8..0xE: mensajes de canal (canal y cable se respetan, datos a 7 bits)
+    pkt(4, 0x8, 0x83, 60, 0x40);
+    CHECK(s_ev.kind == EV_NOTE_OFF && s_ev.cable == 4 && s_ev.a == 3 && s_ev.b == 60 && s_ev.c == 0x40);
+    pkt(4, 0x9, 0x9F, 61, 100);
+    CHECK(s_ev.kind == EV_NOTE_ON && s_ev.a == 15 && s_ev.b == 61 && s_ev.c == 100);
+    pkt(4, 0x9, 0x90, 62, 0);                  // velocidad 0 = Note Off
+    CHECK(s_ev.kind == EV_NOTE_OFF && s_ev.b == 62 && s_ev.c == 0);
+    pkt(4, 0xA, 0xA1, 63, 0xFF);               // dato con el bit 7 puesto
+    CHECK(s_ev.kind == EV_POLY && s_ev.a == 1 && s_ev.b == 63 && s_ev.c == 0x7F);
+    pkt(4, 0xB, 0xB2, 7, 99);
+    CHECK(s_ev.kind == EV_CC && s_ev.a == 2 && s_ev.b == 7 && s_ev.c == 99);
+    pkt(4, 0xC, 0xC5, 12, 0);
+    CHECK(s_ev.kind == EV_PROGRAM && s_ev.a == 5 && s_ev.b == 12);
+    pkt(4, 0xD, 0xD6, 33, 0);
+    CHECK(s_ev.kind == EV_CHAN_PRESS && s_ev.a == 6 && s_ev.b == 33);
+    pkt(4, 0xE, 0xE7, 0x00, 0x40);             // centro
+    CHECK(s_ev.kind == EV_PITCH_BEND && s_ev.a == 7 && s_ev.v14 == 8192);
+    pkt(4, 0xE, 0xE7, 0x7F, 0x7F);
+    CHECK(s_ev.kind == EV_PITCH_BEND && s_ev.v14 == 16383);
+
+    // 0xF: tiempo real; un byte que no lo es se ignora
+    pkt(15, 0xF, 0xF8, 0, 0);
+    CHECK(s_ev.kind == EV_REALTIME && s_ev.cable == 15 && s_ev.a == 0xF8);
+    pkt(15, 0xF, 0xFA, 0, 0);
+    CHECK(s_ev.kind == EV_REALTIME && s_ev.a == 0xFA);
+    n = s_ev_n;
+    pkt(15, 0xF, 0x45, 0, 0);
+    CHECK(s_ev_n == n);
+
+    midi_in_get_stats(&st);
+    CHECK(st.packets == 28);
+    CHECK(st.channel_msgs == 9);
+    CHECK(st.realtime_msgs == 2);
+    CHECK(st.sysex_complete == 5);
+    CHECK(st.sysex_truncated == 0 && st.sysex_dropped == 0 && st.sysex_interleaved == 0);
+    CHECK(st.ignored == 5);     // CIN 0, CIN 1, 0x3 con 0x90, 0x5 con 0x42, 0xF con 0x45
+
+    // Sin callbacks registrados no se cae nada
+    midi_in_init(NULL);
+    for (uint8_t cin = 0; cin < 16; cin++) pkt(0, cin, 0xF0, 0x01, 0xF7);
+    midi_in_get_stats(&st);
+    CHECK(st.packets == 16);
+}
+
+// ----------------------------
+// SysEx intercalados de dos cables
+// ----------------------------
+
+static void test_multi_cable_sysex(void)
+{
+    uint8_t a[20], b[14];
+    midi_in_stats_t st;
+
+    reset();
+    make_sysex(a, sizeof(a), 0x10);
+    make_sysex(b, sizeof(b), 0x40);
+
+    // A por el cable 0, B por el cable 1, paquete a paquete. Entre medias,
+    // mensajes de canal y clock de los dos cables, que no deben estorbar.
+    uint16_t ia = 0, ib = 0;
+    uint32_t notes = 0, clocks = 0, sysex = 0;
+
+    while (ia < sizeof(a) || ib < sizeof(b)) {
+        if (ia < sizeof(a)) {
+            uint16_t rest = (uint16_t)(sizeof(a) - ia);
+            if (rest > 3)       pkt(0, 0x4, a[ia], a[ia + 1], a[ia + 2]);
+            else if (rest == 3) pkt(0, 0x7, a[ia], a[ia + 1], a[ia + 2]);
+            else if (rest == 2) pkt(0, 0x6, a[ia], a[ia + 1], 0);
+            else                pkt(0, 0x5, a[ia], 0, 0);
+            ia = (uint16_t)(ia + (rest > 3 ? 3 : rest));
+            if (s_ev.kind == EV_SYSEX) {
+                sysex++;
+                CHECK(s_ev.cable == 0 && s_ev.sx_len == sizeof(a) && !s_ev.sx_trunc);
+                CHECK(memcmp(s_ev.sx, a, sizeof(a)) == 0);
+                s_ev.kind = EV_NONE;
+            }
+        }
+
+        pkt(1, 0xF, 0xF8, 0, 0);
+        if (s_ev.kind == EV_REALTIME && s_ev.cable == 1) clocks++;
+
+        if (ib < sizeof(b)) {
+            uint16_t rest = (uint16_t)(sizeof(b) - ib);
+            if (rest > 3)       pkt(1, 0x4, b[ib], b[ib + 1], b[ib + 2]);
+            else if (rest == 3) pkt(1, 0x7, b[ib], b[ib + 1], b[ib + 2]);
+            else if (rest == 2) pkt(1, 0x6, b[ib], b[ib + 1], 0);
+            else                pkt(1, 0x5, b[ib], 0, 0);
+            ib = (uint16_t)(ib + (rest > 3 ? 3 : rest));
+            CHECK(s_ev.kind != EV_SYSEX);      // B nunca se entrega
+        }
+
+        pkt(0, 0x9, 0x90, 60, 100);
+        if (s_ev.kind == EV_NOTE_ON && s_ev.cable == 0) notes++;
+    }
+
+    CHECK(sysex == 1);
+    CHECK(clocks == notes && notes == 7);
+
+    midi_in_get_stats(&st);
+    CHECK(st.sysex_complete == 1);
+    CHECK(st.sysex_dropped == 1);                 // B, una vez (su F0)
+    // Los paquetes de B que llegaron con A a medias: 5 de 5 (A acaba la
+    // última). Ninguno pasa en silencio, lleve F0 o no.
+    CHECK(st.sysex_interleaved == 5);
+
+    // Una vez libre el buffer, el cable 1 ya puede mandar su SysEx
+    send_sysex(1, b, sizeof(b));
+    CHECK(s_ev.kind == EV_SYSEX && s_ev.cable == 1 && s_ev.sx_len == sizeof(b));
+    CHECK(memcmp(s_ev.sx, b, sizeof(b)) == 0);
+
+    // F0 nuevo en el mismo cable sin F7: se abandona el primero
+    reset();
+    pkt(2, 0x4, 0xF0, 0x01, 0x02);
+    send_sysex(2, a, sizeof(a));
+    CHECK(s_ev.kind == EV_SYSEX && s_ev.sx_len == sizeof(a));
+    CHECK(memcmp(s_ev.sx, a, sizeof(a)) == 0);
+
+    // Continuación suelta sin F0 previo: descartada y contada
+    pkt(2, 0x4, 0x11, 0x22, 0x33);
+    pkt(2, 0x6, 0x44, 0xF7, 0);
+    midi_in_get_stats(&st);
+    CHECK(st.sysex_complete == 1);
+    CHECK(st.sysex_dropped == 3);
+}
+
+// ----------------------------
+// Desbordamiento del buffer de SysEx
+// ----------------------------
+
+static void test_sysex_overflow(void)
+{
+    uint8_t msg[300];
+    midi_in_stats_t st;
+
+    // Justo MIDI_IN_SYSEX_MAX: completo
+    reset();
+    make_sysex(msg, MIDI_IN_SYSEX_MAX, 0);
+    send_sysex(0, msg, MIDI_IN_SYSEX_MAX);
+    CHECK(s_ev.kind == EV_SYSEX && s_ev.sx_len == MIDI_IN_SYSEX_MAX && !s_ev.sx_trunc);
+    CHECK(memcmp(s_ev.sx, msg, MIDI_IN_SYSEX_MAX) == 0);
+
+    // Uno más, y uno mucho más largo: truncado a MIDI_IN_SYSEX_MAX con los
+    // primeros bytes intactos
+    static const uint16_t lens[] = { MIDI_IN_SYSEX_MAX + 1, sizeof(msg) };
+
+    for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        make_sysex(msg, lens[i], (uint8_t)i);
+        send_sysex(0, msg, lens[i]);
+        CHECK(s_ev.kind == EV_SYSEX && s_ev.sx_len == MIDI_IN_SYSEX_MAX && s_ev.sx_trunc);
+        CHECK(memcmp(s_ev.sx, msg, MIDI_IN_SYSEX_MAX) == 0);
+    }
+
+    // Y el parser sigue sano después
+    make_sysex(msg, 10, 7);
+    send_sysex(0, msg, 10);
+    CHECK(s_ev.kind == EV_SYSEX && s_ev.sx_len == 10 && !s_ev.sx_trunc);
+
+    midi_in_get_stats(&st);
+    CHECK(st.sysex_complete == 2);
+    CHECK(st.sysex_truncated == 2);
+    CHECK(st.sysex_dropped == 0);
+}
+
+// ----------------------------
+// Throughput
+// ----------------------------
+
+// Traza de un set típico: clock continuo, notas, CC de 14 bits, algún
+// pitch bend y un SysEx de vez en cuando, por dos cables
+static size_t build_trace(uint8_t (*trace)[4], size_t max)
+{
+    size_t n = 0;
+
+#define PUT(cb, cin, b0, b1, b2) do { \
+        if (n < max) { \
+            trace[n][0] = (uint8_t)(((cb) << 4) | (cin)); \
+            trace[n][1] = (b0); trace[n][2] = (b1); trace[n][3] = (b2); \
+            n++; \
+        } \
+    } while (0)
+
+    for (uint32_t k = 0; n < max; k++) {
+        uint32_t r = test_rand();
+
+        PUT(0, 0xF, 0xF8, 0, 0);
+        switch (r % 6) {
+        case 0: PUT(0, 0x9, 0x90, 36 + (r >> 8) % 24, 1 + (r >> 16) % 127); break;
+        case 1: PUT(0, 0x8, 0x80, 36 + (r >> 8) % 24, 0); break;
+        case 2:
+            PUT(0, 0xB, 0xB0, 1, (r >> 8) & 0x7F);
+            PUT(0, 0xB, 0xB0, 33, (r >> 16) & 0x7F);
+            break;
+        case 3: PUT(1, 0xE, 0xE1, (r >> 8) & 0x7F, (r >> 16) & 0x7F); break;
+        case 4: PUT(1, 0xB, 0xB3, 74, (r >> 8) & 0x7F); break;
+        case 5:
+            if ((k & 7) == 0) {
+                // SysEx de 12 bytes por el cable 0
+                PUT(0, 0x4, 0xF0, 0x7D, 0x01);
+                PUT(0, 0x4, 0x01, 0x02, 0x03);
+                PUT(0, 0x4, 0x04, 0x05, 0x06);
+                PUT(0, 0x7, 0x07, 0x08, 0xF7);
+            }
+            break;
+        }
+    }
+#undef PUT
+    return n;
+}
+
+static void test_throughput(void)
+{
+    static uint8_t trace[4096][4];
+    size_t         n = build_trace(trace, sizeof(trace) / sizeof(trace[0]));
+    midi_in_stats_t st;
+
+    reset();
+
+    double   t0  = test_cpu_s();
+    size_t   pos = 0;
+    uint64_t total = 0;
+
+    for (uint32_t b = 0; b < THROUGHPUT_BATCHES; b++) {
+        // Una pasada de tud_task: como mucho 64 bytes del endpoint
+        for (uint32_t i = 0; i < BATCH_PACKETS; i++) {
+            midi_in_parse_packet(trace[pos]);
+            if (++pos == n) pos = 0;
+        }
+        total += BATCH_PACKETS;
+    }
+
+    double dt = test_cpu_s() - t0;
+
+    midi_in_get_stats(&st);
+    CHECK(st.packets == (uint32_t)total);
+    CHECK(st.ignored == 0);
+    CHECK(st.sysex_truncated == 0);
+    CHECK(st.sysex_complete > 0);
+
+    if (dt <= 0.0) dt = 1e-9;
+    printf("midi_in: %llu paquetes en %.3f s -> %.1f Mpaquetes/s, %.1f ns por "
+           "lote de 64 bytes (host)\n",
+           (unsigned long long)total, dt, total / dt / 1e6,
+           dt / THROUGHPUT_BATCHES * 1e9);
+}
+
+int main(void)
+{
+    test_all_cins();
+    test_multi_cable_sysex();
+    test_sysex_overflow();
+    test_throughput();
+    return TEST_RESULT();
+}
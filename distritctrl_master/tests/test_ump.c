@@ -0,0 +1,373 @@
+// test_ump.c - Traducción MIDI 1.0 <-> UMP (ump.c) contra una referencia
+//
+// La referencia de este archivo sigue la traducción por defecto de la
+// especificación UMP, escrita mensaje a mensaje (sin tablas) y con el
+// escalado "min-center-max" tal como lo da la especificación en su
+// pseudocódigo. Se comprueba:
+//
+//   - escalado: 7 y 14 bits -> 16 y 32 bits, contra la referencia y con
+//     0, centro y máximo exactos; bajar vuelve al valor de partida
+//   - MIDI 1.0 -> MIDI 2.0 (MT 4): todos los mensajes de canal, todos los
+//     canales y todos los datos, palabra a palabra contra la referencia
+//   - ida y vuelta MIDI 1.0 -> UMP -> MIDI 1.0: sin pérdida (Note On con
+//     velocidad 0 vuelve como Note Off)
+//   - MIDI 2.0 -> MIDI 1.0 con datos de 16/32 bits arbitrarios
+//   - sistema (MT 1) y voz MIDI 1.0 dentro de UMP (MT 2)
+//   - SysEx7 (MT 3): troceo y reensamblado
+
+#include <string.h>
+
+#include "ump.h"
+#include "test_util.h"
+
+#define RANDOM_MIDI2_MSGS  200000
+
+// ----------------------------
+// Referencia
+// ----------------------------
+
+// Pseudocódigo de la especificación (escalado hacia arriba min-center-max)
+static uint32_t ref_scale_up(uint32_t src_val, uint8_t src_bits, uint8_t dst_bits)
+{
+    uint8_t  scale_bits = (uint8_t)(dst_bits - src_bits);
+    uint64_t shifted    = (uint64_t)src_val << scale_bits;
+    uint32_t src_center = 1u << (src_bits - 1);
+
+    if (src_val <= src_center) return (uint32_t)shifted;
+
+    uint8_t  repeat_bits  = (uint8_t)(src_bits - 1);
+    uint64_t repeat_mask  = (1ull << repeat_bits) - 1u;
+    uint64_t repeat_value = src_val & repeat_mask;
+
+    if (scale_bits > repeat_bits) repeat_value <<= scale_bits - repeat_bits;
+    else                          repeat_value >>= repeat_bits - scale_bits;
+
+    while (repeat_value != 0) {
+        shifted      |= repeat_value;
+        repeat_value >>= repeat_bits;
+    }
+    return (uint32_t)shifted;
+}
+
+static uint32_t ref_w0(uint8_t mt, uint8_t group, uint8_t status, uint8_t i1, uint8_t i2)
+{
+    return ((uint32_t)mt << 28) | ((uint32_t)group << 24) |
+           ((uint32_t)status << 16) | ((uint32_t)i1 << 8) | i2;
+}
+
+// MIDI 1.0 (mensaje de canal) -> MIDI 2.0 de 64 bits
+static void ref_from_midi1(uint8_t group, uint8_t st, uint8_t d1, uint8_t d2, uint32_t w[2])
+{
+    uint8_t ch = st & 0x0F;
+
+    switch (st & 0xF0) {
+    case 0x90:
+        if (d2 != 0) {
+            w[0] = ref_w0(4, group, (uint8_t)(0x90 | ch), d1, 0);
+            w[1] = ref_scale_up(d2, 7, 16) << 16;
+            break;
+        }
+        // Note On con velocidad 0 = Note Off (velocidad 0)
+        // fallthrough
+    case 0x80:
+        w[0] = ref_w0(4, group, (uint8_t)(0x80 | ch), d1, 0);
+        w[1] = ref_scale_up(d2, 7, 16) << 16;
+        break;
+    case 0xA0:
+        w[0] = ref_w0(4, group, (uint8_t)(0xA0 | ch), d1, 0);
+        w[1] = ref_scale_up(d2, 7, 32);
+        break;
+    case 0xB0:
+        w[0] = ref_w0(4, group, (uint8_t)(0xB0 | ch), d1, 0);
+        w[1] = ref_scale_up(d2, 7, 32);
+        break;
+    case 0xC0:
+        // Sin banco (option flags = 0): el programa va en el byte alto
+        w[0] = ref_w0(4, group, (uint8_t)(0xC0 | ch), 0, 0);
+        w[1] = (uint32_t)d1 << 24;
+        break;
+    case 0xD0:
+        w[0] = ref_w0(4, group, (uint8_t)(0xD0 | ch), 0, 0);
+        w[1] = ref_scale_up(d1, 7, 32);
+        break;
+    case 0xE0:
+        w[0] = ref_w0(4, group, (uint8_t)(0xE0 | ch), 0, 0);
+        w[1] = ref_scale_up(((uint32_t)d2 << 7) | d1, 14, 32);
+        break;
+    }
+}
+
+// MIDI 2.0 de 64 bits -> MIDI 1.0: bajar es quedarse con los bits altos
+static uint8_t ref_to_midi1(const uint32_t w[2], uint8_t out[3])
+{
+    uint8_t st = (uint8_t)(w[0] >> 16);
+    uint8_t i1 = (uint8_t)(w[0] >> 8) & 0x7F;
+
+    out[0] = st;
+    switch (st & 0xF0) {
+    case 0x80:
+        out[1] = i1; out[2] = (uint8_t)(w[1] >> 25);
+        return 3;
+    case 0x90:
+        out[1] = i1; out[2] = (uint8_t)(w[1] >> 25);
+        if (out[2] == 0) out[2] = 1;   // velocidad 0 sería Note Off
+        return 3;
+    case 0xA0:
+    case 0xB0:
+        out[1] = i1; out[2] = (uint8_t)(w[1] >> 25);
+        return 3;
+    case 0xC0:
+        out[1] = (uint8_t)(w[1] >> 24) & 0x7F;
+        return 2;
+    case 0xD0:
+        out[1] = (uint8_t)(w[1] >> 25);
+        return 2;
+    case 0xE0:
+        out[1] = (uint8_t)(w[1] >> 18) & 0x7F;
+        out[2] = (uint8_t)(w[1] >> 25);
+        return 3;
+    }
+    return 0;
+}
+
+static uint8_t midi1_len(uint8_t st)
+{
+    switch (st & 0xF0) {
+    case 0xC0: case 0xD0: return 2;
+    default:              return 3;
+    }
+}
+
+// ----------------------------
+// Escalado
+// ----------------------------
+
+static void test_scale(void)
+{
+    static const uint8_t src[] = { 7, 14 };
+    static const uint8_t dst[] = { 16, 32 };
+
+    for (size_t i = 0; i < sizeof(src); i++) {
+        for (size_t j = 0; j < sizeof(dst); j++) {
+            uint8_t  s = src[i], d = dst[j];
+            uint32_t max_s = (1u << s) - 1u;
+            uint64_t max_d = (1ull << d) - 1u;
+            uint32_t prev = 0;
+
+            for (uint32_t v = 0; v <= max_s; v++) {
+                uint32_t up = ump_scale_up(v, s, d);
+
+                CHECK(up == ref_scale_up(v, s, d));
+                CHECK(ump_scale_down(up, d, s) == v);
+                CHECK(v == 0 || up > prev);
+                prev = up;
+            }
+            CHECK(ump_scale_up(0, s, d) == 0);
+            CHECK(ump_scale_up(1u << (s - 1), s, d) == (uint32_t)(1ull << (d - 1)));
+            CHECK(ump_scale_up(max_s, s, d) == (uint32_t)max_d);
+        }
+    }
+}
+
+// ----------------------------
+// MIDI 1.0 -> UMP -> MIDI 1.0, todos los mensajes de canal
+// ----------------------------
+
+static void test_channel_roundtrip(void)
+{
+    uint32_t checked = 0;
+
+    for (uint8_t hi = 0x8; hi <= 0xE; hi++) {
+        for (uint8_t ch = 0; ch < 16; ch++) {
+            uint8_t st = (uint8_t)((hi << 4) | ch);
+            uint8_t group = (uint8_t)(ch & 0x0F);   // de paso, todos los grupos
+
+            for (uint16_t d1 = 0; d1 < 128; d1++) {
+                // Program change y channel pressure no llevan d2
+                uint16_t d2_n = (midi1_len(st) == 2) ? 1 : 128;
+
+                for (uint16_t d2 = 0; d2 < d2_n; d2++) {
+                    uint32_t w[2] = {0, 0}, ref[2] = {0, 0};
+                    uint8_t  back[3] = {0, 0, 0};
+
+                    CHECK(ump_from_midi1(group, st, (uint8_t)d1, (uint8_t)d2, w) == 2);
+                    ref_from_midi1(group, st, (uint8_t)d1, (uint8_t)d2, ref);
+                    CHECK(w[0] == ref[0] && w[1] == ref[1]);
+                    CHECK(ump_word_count(w[0]) == 2);
+
+                    uint8_t n = ump_to_midi1(w, back);
+                    CHECK(n == midi1_len(st));
+
+                    // Ida y vuelta exacta; Note On 0 vuelve como Note Off 0
+                    uint8_t exp_st = (hi == 0x9 && d2 == 0) ? (uint8_t)(0x80 | ch) : st;
+                    CHECK(back[0] == exp_st && back[1] == d1);
+                    if (n == 3) CHECK(back[2] == d2);
+                    checked++;
+                }
+            }
+        }
+    }
+    printf("ump: %u mensajes de canal MIDI 1.0 ida y vuelta\n", (unsigned)checked);
+}
+
+// ----------------------------
+// MIDI 2.0 -> MIDI 1.0 con datos arbitrarios
+// ----------------------------
+
+static void test_midi2_to_midi1(void)
+{
+    static const uint8_t opcodes[] = { 0x8, 0x9, 0xA, 0xB, 0xC, 0xD, 0xE };
+
+    for (uint32_t k = 0; k < RANDOM_MIDI2_MSGS; k++) {
+        uint32_t r  = test_rand();
+        uint8_t  op = opcodes[r % sizeof(opcodes)];
+        uint8_t  st = (uint8_t)((op << 4) | ((r >> 8) & 0x0F));
+        uint32_t w[2];
+        uint8_t  out[3] = {0}, ref[3] = {0};
+
+        w[0] = ref_w0(4, (uint8_t)((r >> 12) & 0x0F), st, (uint8_t)((r >> 16) & 0x7F), 0);
+        w[1] = test_rand();
+        if (op == 0x8 || op == 0x9) w[1] &= 0xFFFF0000u;   // atributo 0
+        if (op == 0xC) w[1] &= 0x7F000000u;                // sólo programa
+
+        uint8_t n   = ump_to_midi1(w, out);
+        uint8_t ref_n = ref_to_midi1(w, ref);
+
+        CHECK(n == ref_n);
+        CHECK(memcmp(out, ref, n) == 0);
+    }
+
+    // Velocidades de 16 bits muy bajas: no pueden salir como Note Off
+    uint32_t w[2];
+    uint8_t  out[3];
+    ump_note_on(0, 3, 60, 0x0001, w);
+    CHECK(ump_to_midi1(w, out) == 3 && out[0] == 0x93 && out[1] == 60 && out[2] == 1);
+    ump_note_off(0, 3, 60, 0xFFFF, w);
+    CHECK(ump_to_midi1(w, out) == 3 && out[0] == 0x83 && out[2] == 127);
+
+    // Assignable controller (NRPN) no tiene equivalente de un mensaje
+    ump_nrpn(0, 0, 0x1234, 0x80000000u, w);
+    CHECK(ump_to_midi1(w, out) == 0);
+
+    // Los codificadores dan lo mismo que la traducción de un MIDI 1.0
+    uint32_t t[2];
+    ump_cc(2, 5, 74, ump_scale_up(100, 7, 32), w);
+    ump_from_midi1(2, 0xB5, 74, 100, t);
+    CHECK(w[0] == t[0] && w[1] == t[1]);
+    ump_pitch_bend(1, 9, ump_scale_up(12345, 14, 32), w);
+    ump_from_midi1(1, 0xE9, 12345 & 0x7F, 12345 >> 7, t);
+    CHECK(w[0] == t[0] && w[1] == t[1]);
+}
+
+// ----------------------------
+// Sistema (MT 1) y voz MIDI 1.0 en UMP (MT 2)
+// ----------------------------
+
+static void test_system_and_mt2(void)
+{
+    // status, bytes MIDI 1.0
+    static const struct { uint8_t st; uint8_t len; } sys[] = {
+        { 0xF1, 2 }, { 0xF2, 3 }, { 0xF3, 2 }, { 0xF6, 1 },
+        { 0xF8, 1 }, { 0xFA, 1 }, { 0xFB, 1 }, { 0xFC, 1 }, { 0xFE, 1 }, { 0xFF, 1 },
+    };
+
+    for (size_t i = 0; i < sizeof(sys) / sizeof(sys[0]); i++) {
+        uint8_t  d1 = (sys[i].len > 1) ? 0x55 : 0;
+        uint8_t  d2 = (sys[i].len > 2) ? 0x2A : 0;
+        uint32_t w[2] = {0, 0};
+        uint8_t  out[3] = {0};
+
+        CHECK(ump_from_midi1(7, sys[i].st, d1, d2, w) == 1);
+        CHECK(w[0] == ref_w0(1, 7, sys[i].st, d1, d2));
+        CHECK(ump_word_count(w[0]) == 1);
+        CHECK(ump_to_midi1(w, out) == sys[i].len);
+        CHECK(out[0] == sys[i].st);
+        if (sys[i].len > 1) CHECK(out[1] == d1);
+        if (sys[i].len > 2) CHECK(out[2] == d2);
+    }
+
+    // SysEx no va por aquí (MT 3)
+    uint32_t w[2];
+    CHECK(ump_from_midi1(0, 0xF0, 0, 0, w) == 0);
+    CHECK(ump_from_midi1(0, 0xF7, 0, 0, w) == 0);
+    CHECK(ump_from_midi1(0, 0x40, 0, 0, w) == 0);   // sin status
+
+    // MT 2: el mensaje MIDI 1.0 viaja tal cual
+    for (uint8_t hi = 0x8; hi <= 0xE; hi++) {
+        uint8_t st = (uint8_t)((hi << 4) | 0x0C);
+        uint8_t out[3] = {0};
+
+        w[0] = ref_w0(2, 0, st, 0x11, 0x22);
+        CHECK(ump_word_count(w[0]) == 1);
+        CHECK(ump_to_midi1(w, out) == midi1_len(st));
+        CHECK(out[0] == st && out[1] == 0x11);
+        if (midi1_len(st) == 3) CHECK(out[2] == 0x22);
+    }
+}
+
+// ----------------------------
+// SysEx7 (MT 3)
+// ----------------------------
+
+static void test_sysex7(void)
+{
+    for (uint8_t len = 0; len <= 40; len++) {
+        uint8_t  msg[40], back[40];
+        uint32_t pkts = 0;
+        uint8_t  got  = 0;
+        bool     ok   = true;
+
+        for (uint8_t i = 0; i < len; i++) msg[i] = (uint8_t)((i * 37 + len) & 0x7F);
+
+        // Troceo: COMPLETE si cabe en uno, si no START / CONTINUE... / END
+        for (uint8_t pos = 0; pos < len || (len == 0 && pkts == 0); ) {
+            uint8_t n    = (uint8_t)((len - pos > 6) ? 6 : len - pos);
+            bool    first = (pos == 0), last = (pos + n == len);
+            uint8_t st   = (first && last) ? UMP_SYSEX7_COMPLETE :
+                           first ? UMP_SYSEX7_START :
+                           last  ? UMP_SYSEX7_END : UMP_SYSEX7_CONTINUE;
+            uint32_t w[2];
+
+            CHECK(ump_sysex7(3, st, &msg[pos], n, w) == 2);
+            CHECK(ump_word_count(w[0]) == 2);
+            CHECK((w[0] >> 28) == UMP_MT_DATA64 && ((w[0] >> 24) & 0x0F) == 3);
+            CHECK(((w[0] >> 20) & 0x0F) == st && ((w[0] >> 16) & 0x0F) == n);
+
+            // Reensamblado desde las palabras
+            uint8_t b[6] = {
+                (uint8_t)(w[0] >> 8), (uint8_t)w[0],
+                (uint8_t)(w[1] >> 24), (uint8_t)(w[1] >> 16),
+                (uint8_t)(w[1] >> 8), (uint8_t)w[1],
+            };
+            for (uint8_t i = 0; i < 6; i++) {
+                if (i < n) back[got++] = b[i];
+                else if (b[i] != 0) ok = false;   // relleno a 0
+            }
+
+            pos = (uint8_t)(pos + n);
+            pkts++;
+            if (len == 0) break;
+        }
+
+        CHECK(ok);
+        CHECK(got == len && memcmp(back, msg, len) == 0);
+        CHECK(pkts == (len == 0 ? 1u : (len + 5u) / 6u));
+    }
+
+    // Más de 6 bytes en un paquete: se recorta; bytes con el bit 7 se limpian
+    uint8_t  big[8] = { 0x81, 2, 3, 4, 5, 6, 7, 8 };
+    uint32_t w[2];
+    ump_sysex7(0, UMP_SYSEX7_COMPLETE, big, 8, w);
+    CHECK(((w[0] >> 16) & 0x0F) == 6);
+    CHECK(((w[0] >> 8) & 0xFF) == 0x01);
+}
+
+int main(void)
+{
+    test_scale();
+    test_channel_roundtrip();
+    test_midi2_to_midi1();
+    test_system_and_mt2();
+    test_sysex7();
+    return TEST_RESULT();
+}
@@ -0,0 +1,44 @@
+// test_util.h - Comprobaciones mínimas para las pruebas en el host
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+static int s_test_failures = 0;
+
+// Sigue tras un fallo (para ver todos); el main devuelve TEST_RESULT()
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: FALLO: %s\n", __FILE__, __LINE__, #cond); \
+            s_test_failures++; \
+        } \
+    } while (0)
+
+#define TEST_RESULT()  (s_test_failures ? 1 : 0)
+
+// Generador reproducible (xorshift32): mismas trazas en cada ejecución
+static uint32_t s_test_rng = 0x12345678u;
+
+static inline uint32_t test_rand(void)
+{
+    s_test_rng ^= s_test_rng << 13;
+    s_test_rng ^= s_test_rng >> 17;
+    s_test_rng ^= s_test_rng << 5;
+    return s_test_rng;
+}
+
+// Uniforme en [-1, 1)
+static inline double test_rand_unit(void)
+{
+    return (double)test_rand() / 2147483648.0 - 1.0;
+}
+
+// Segundos de CPU (para las cifras de throughput)
+static inline double test_cpu_s(void)
+{
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+#endif // TEST_UTIL_H
@@ -2,6 +2,10 @@
 
 #include "pico/stdlib.h"
 #include "pico/time.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "hardware/clocks.h"
 
 // ------------------------
 // Configuración de pines
@@ -12,133 +16,347 @@ static const uint ULTRA_TRIG_PINS[ULTRA_NUM_SENSORS] = {18, 20};
 static const uint ULTRA_ECHO_PINS[ULTRA_NUM_SENSORS] = {19, 21};
 
 // Tiempos en microsegundos
-#define US_MEAS_PERIOD_US     60000   // cada 60 ms lanzo una medida por sensor
-#define US_ECHO_TIMEOUT_US    30000   // timeout de eco ~30 ms (≈ 5 m máximo)
+#define US_ECHO_TIMEOUT_US    30000   // timeout de eco sin rango configurado (≈ 5 m)
+#define US_TRIG_PULSE_US      10      // pulso TRIG del HC-SR04 (lo genera el PIO)
+#define US_RESULT_SLACK_US    1000    // margen para el resultado tras el timeout
+#define US_RISE_MAX_US        1000    // del TRIG a la subida del ECHO (ráfaga de 40 kHz)
+#define US_PER_CM_X10         583     // ida y vuelta: 58.3 us por cm
+#define US_CM_PER_US_Q16      1124u   // 0.01715 cm por us de eco, en Q16.16 (error 0.005 %)
 
-// Máquina de estados por sensor
-typedef enum {
-    US_IDLE = 0,
-    US_TRIG_LOW,
-    US_TRIG_HIGH,
-    US_WAIT_ECHO_HIGH,
-    US_WAIT_ECHO_LOW
-} us_state_t;
+// Planificación adaptativa
+// ------------------------
+//
+// Los sensores se turnan: sólo uno mide a la vez, así que el ping de uno
+// nunca se toma por el eco de otro. En cuanto termina un eco (más una guarda
+// para que se apaguen los rebotes cercanos) dispara el siguiente; con la mano
+// a 15 cm un eco dura ~1 ms y cada sensor se refresca a US_MIN_PERIOD_US.
+//
+// El timeout se acorta al rango de juego (ultra_driver_set_range_cm()): un
+// eco más largo es "más lejos que el rango" y no hace falta esperarlo. Pero el
+// HC-SR04 deja ECHO arriba hasta su propio eco (pared) o hasta ~38 ms, y
+// mientras tanto el canal acústico sigue ocupado: no se dispara ningún sensor
+// hasta que todos los ECHO están abajo (o llevan US_BUSY_MAX_US arriba: algún
+// clon lo deja colgado).
+#define US_GUARD_US           2000    // tras cada eco, antes del siguiente disparo
+#define US_MIN_PERIOD_US      10000   // un mismo sensor, como mucho a 100 Hz
+#define US_BUSY_POLL_US       500     // mirar otra vez si algún ECHO sigue arriba
+#define US_BUSY_MAX_US        50000   // ECHO arriba más que esto: no esperarlo
+
+// ---------------------------------------------------------------------
+//  Programa PIO de medida (fuente en ultra_echo.pio)
+// ---------------------------------------------------------------------
+//
+// Un solo SM de pio1 para todos los sensores (pio0 es del anillo WS2812):
+// como miden por turnos, antes de cada disparo se le cambian los pines SET /
+// IN / JMP al sensor que toca. El SM genera el pulso TRIG y cuenta el eco a
+// 1 us por vuelta: la distancia no depende de la latencia de IRQ ni de lo que
+// esté haciendo la CPU. La tarea sólo dispara (escribe el timeout en el FIFO
+// TX) y recoge el resultado. No hay límite de sensores por SM.
+
+#define ULTRA_PIO             pio1
+#define ULTRA_PIO_IRQ         PIO1_IRQ_0
+#define ULTRA_PIO_HZ          2000000.0f   // 2 ciclos por vuelta = 1 us
+#define ULTRA_PIO_NONE        0xFFFFFFFFu  // sin eco / eco más largo que el timeout
+
+#define ultra_echo_wrap_target 0
+#define ultra_echo_wrap        13
+
+static const uint16_t ultra_echo_program_instructions[] = {
+    // .wrap_target
+    0x80a0, //  0: pull   block
+    0xa027, //  1: mov    x, osr
+    0x2020, //  2: wait   0 pin, 0
+    0xf301, //  3: set    pins, 1         [19]
+    0xe000, //  4: set    pins, 0
+    0x00c8, //  5: jmp    pin, 8
+    0x0045, //  6: jmp    x--, 5
+    0x000c, //  7: jmp    12
+    0x4020, //  8: in     x, 32
+    0x00cb, //  9: jmp    pin, 11
+    0x000d, // 10: jmp    13
+    0x0049, // 11: jmp    x--, 9
+    0xa02b, // 12: mov    x, ~null
+    0x4020, // 13: in     x, 32
+    // .wrap
+};
+
+static const struct pio_program ultra_echo_program = {
+    .instructions = ultra_echo_program_instructions,
+    .length       = 14,
+    .origin       = -1,
+};
+
+static inline pio_sm_config ultra_echo_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + ultra_echo_wrap_target, offset + ultra_echo_wrap);
+    return c;
+}
+
+static inline void ultra_echo_program_init(PIO pio, uint sm, uint offset,
+                                           uint trig, uint echo)
+{
+    pio_sm_config c = ultra_echo_program_get_default_config(offset);
+    sm_config_set_set_pins(&c, trig, 1);
+    sm_config_set_in_pins(&c, echo);      // wait 0 pin 0
+    sm_config_set_jmp_pin(&c, echo);
+
+    // Autopush: cada "in x, 32" es una palabra en el FIFO RX
+    sm_config_set_in_shift(&c, false, true, 32);
+
+    float div = clock_get_hz(clk_sys) / ULTRA_PIO_HZ;
+    sm_config_set_clkdiv(&c, div);
+
+    pio_sm_init(pio, sm, offset, &c);
+    pio_sm_set_enabled(pio, sm, true);
+}
+
+// ------------------------
+// Estado
+// ------------------------
+//
+// Una corrutina del planificador para todos: elige sensor, dispara, duerme
+// hasta que la IRQ del FIFO RX trae el resultado (o hasta el timeout), espera
+// la guarda y vuelve a empezar.
+
+static uint              s_offset = 0;
+static uint              s_sm     = 0;
+static volatile uint32_t s_rise_x;              // contador del SM en la subida
+static volatile uint32_t s_fall_x;              // y en la bajada
+static volatile bool     s_echo_done;
+static sched_task_t     *s_task   = NULL;
+static int               s_cur    = 0;          // sensor midiendo (o el último)
+static uint32_t          s_end_us = 0;          // fin de la última medida
+static uint32_t          s_timeout_us = US_ECHO_TIMEOUT_US;
+static int32_t           s_range_q16  = 0;      // cm Q16.16; 0 = sin rango: timeout completo
+static uint32_t          s_trig_us[ULTRA_NUM_SENSORS];
+
+static int32_t  s_distance_q16[ULTRA_NUM_SENSORS];   // cm Q16.16
+static bool     s_valid[ULTRA_NUM_SENSORS];
+static uint32_t s_sample_us[ULTRA_NUM_SENSORS];   // fin del eco de la última medida válida
+static uint32_t s_period_us[ULTRA_NUM_SENSORS];   // entre las dos últimas medidas válidas
+
+// ------------------------
+// Funciones internas
+// ------------------------
+
+// IRQ de pio1: FIFO RX no vacío en el SM de medida. Leerlo baja la IRQ.
+static void ultra_pio_irq(void)
+{
+    while (!pio_sm_is_rx_fifo_empty(ULTRA_PIO, s_sm)) {
+        uint32_t w = pio_sm_get(ULTRA_PIO, s_sm);
+
+        if (s_echo_done) continue;                // resto de una medida abandonada
+
+        if (s_rise_x == ULTRA_PIO_NONE && w != ULTRA_PIO_NONE) {
+            s_rise_x = w;                         // subida: falta la bajada
+            continue;
+        }
+        s_fall_x    = w;
+        s_echo_done = true;
+        sched_notify(s_task);
+    }
+}
+
+// Sin resultado a tiempo: el SM sigue esperando a que baje un eco colgado
+// (algunos clones del HC-SR04 lo dejan arriba). Volver a empezar.
+static void ultra_sm_restart(void)
+{
+    pio_sm_set_enabled(ULTRA_PIO, s_sm, false);
+    pio_sm_clear_fifos(ULTRA_PIO, s_sm);
+    pio_sm_restart(ULTRA_PIO, s_sm);
+    pio_sm_exec(ULTRA_PIO, s_sm, pio_encode_jmp(s_offset));
+    pio_sm_set_enabled(ULTRA_PIO, s_sm, true);
+}
+
+// Dispara el sensor i: el SM está parado en el pull, se le pueden cambiar
+// los pines sin más
+static void ultra_fire(int i, uint32_t now)
+{
+    pio_sm_set_set_pins(ULTRA_PIO, s_sm, ULTRA_TRIG_PINS[i], 1);
+    pio_sm_set_in_pins(ULTRA_PIO, s_sm, ULTRA_ECHO_PINS[i]);
+    pio_sm_set_jmp_pin(ULTRA_PIO, s_sm, ULTRA_ECHO_PINS[i]);
+
+    s_cur        = i;
+    s_rise_x     = ULTRA_PIO_NONE;
+    s_fall_x     = ULTRA_PIO_NONE;
+    s_echo_done  = false;
+    s_trig_us[i] = now;
+    pio_sm_put(ULTRA_PIO, s_sm, s_timeout_us);
+}
+
+// Algún ECHO arriba (un sensor aún escucha su ping): el canal está ocupado
+static bool ultra_channel_busy(void)
+{
+    for (int i = 0; i < ULTRA_NUM_SENSORS; i++) {
+        if (gpio_get(ULTRA_ECHO_PINS[i])) return true;
+    }
+    return false;
+}
+
+// Siguiente sensor en orden que ya puede medir (-1 si ninguno) y, si no,
+// cuánto falta para el primero
+static int ultra_pick(uint32_t now, uint32_t *wait_us)
+{
+    uint32_t best = UINT32_MAX;
+
+    for (int k = 1; k <= ULTRA_NUM_SENSORS; k++) {
+        int      i  = (s_cur + k) % ULTRA_NUM_SENSORS;
+        uint32_t dt = now - s_trig_us[i];
+
+        if (dt >= US_MIN_PERIOD_US) return i;
+        if (US_MIN_PERIOD_US - dt < best) best = US_MIN_PERIOD_US - dt;
+    }
+    *wait_us = best;
+    return -1;
+}
 
-static us_state_t      s_state[ULTRA_NUM_SENSORS];
-static absolute_time_t s_state_time[ULTRA_NUM_SENSORS];
-static absolute_time_t s_echo_start[ULTRA_NUM_SENSORS];
+// Cierra una medida: distancia si hubo eco completo, el máximo del rango si
+// el eco siguió más allá del timeout, inválida si no hubo eco
+static void ultra_finish(int i)
+{
+    uint32_t rise   = s_rise_x;
+    uint32_t fall   = s_fall_x;
+    uint32_t sample = s_trig_us[i] + US_TRIG_PULSE_US;
 
-static float s_distance_cm[ULTRA_NUM_SENSORS];
-static bool  s_valid[ULTRA_NUM_SENSORS];
+    if (!s_echo_done || rise == ULTRA_PIO_NONE) {
+        s_valid[i] = false;
+        return;
+    }
+
+    if (fall == ULTRA_PIO_NONE) {
+        if (s_range_q16 <= 0) {
+            s_valid[i] = false;       // sin rango: timeout de verdad
+            return;
+        }
+        s_distance_q16[i] = s_range_q16;
+        sample          += s_timeout_us;
+    } else {
+        // El SM cuenta hacia abajo desde el timeout, 1 us por vuelta
+        uint32_t dt_us = rise - fall;
+        if (dt_us == 0) {
+            s_valid[i] = false;
+            return;
+        }
+        // Distancia aproximada:
+        // distancia (cm) ≈ tiempo_us * 0.017 (ida y vuelta del sonido).
+        // En Q16.16 entero: el M0+ no tiene FPU y dt_us * 1124 cabe en 32
+        // bits hasta el timeout de 30 ms
+        s_distance_q16[i] = (int32_t)(dt_us * US_CM_PER_US_Q16);
+        sample          += s_timeout_us - fall;
+    }
+
+    if (s_valid[i]) s_period_us[i] = sample - s_sample_us[i];
+    s_valid[i]     = true;
+    s_sample_us[i] = sample;
+}
+
+// ------------------------
+// API pública
+// ------------------------
 
 void ultra_driver_init(void)
 {
-    absolute_time_t now = get_absolute_time();
+    s_offset = pio_add_program(ULTRA_PIO, &ultra_echo_program);
+    s_sm     = (uint)pio_claim_unused_sm(ULTRA_PIO, true);
 
     for (int i = 0; i < ULTRA_NUM_SENSORS; i++) {
         uint trig = ULTRA_TRIG_PINS[i];
         uint echo = ULTRA_ECHO_PINS[i];
 
-        gpio_init(trig);
-        gpio_set_dir(trig, GPIO_OUT);
-        gpio_put(trig, 0);
+        // Todos los TRIG son salidas del mismo SM (a 0 mientras no le toca)
+        pio_gpio_init(ULTRA_PIO, trig);
+        pio_sm_set_consecutive_pindirs(ULTRA_PIO, s_sm, trig, 1, true);
 
         gpio_init(echo);
         gpio_set_dir(echo, GPIO_IN);  // flotante, el HC-SR04 lo maneja
 
-        s_state[i]      = US_IDLE;
-        s_state_time[i] = now;
-        s_distance_cm[i] = 0.0f;
+        s_trig_us[i]     = time_us_32() - US_MIN_PERIOD_US;
+        s_distance_q16[i] = 0;
         s_valid[i]       = false;
+        s_sample_us[i]   = 0;
+        s_period_us[i]   = 0;
     }
+
+    s_rise_x     = ULTRA_PIO_NONE;
+    s_fall_x     = ULTRA_PIO_NONE;
+    s_echo_done  = false;
+    s_task       = NULL;
+    s_cur        = ULTRA_NUM_SENSORS - 1;   // el primero en disparar es el 0
+    s_end_us     = time_us_32();
+    s_timeout_us = US_ECHO_TIMEOUT_US;
+    s_range_q16  = 0;
+
+    ultra_echo_program_init(ULTRA_PIO, s_sm, s_offset, ULTRA_TRIG_PINS[0], ULTRA_ECHO_PINS[0]);
+    pio_set_irq0_source_enabled(ULTRA_PIO,
+                                (enum pio_interrupt_source)(pis_sm0_rx_fifo_not_empty + s_sm),
+                                true);
+
+    irq_set_exclusive_handler(ULTRA_PIO_IRQ, ultra_pio_irq);
+    irq_set_enabled(ULTRA_PIO_IRQ, true);
 }
 
-void ultra_driver_update(void)
+void ultra_driver_set_range_cm(uint32_t max_cm)
 {
-    absolute_time_t now = get_absolute_time();
+    uint32_t us = (max_cm == 0) ? US_ECHO_TIMEOUT_US
+                                : US_RISE_MAX_US + (max_cm * US_PER_CM_X10) / 10u;
 
-    for (int i = 0; i < ULTRA_NUM_SENSORS; i++) {
-        uint trig = ULTRA_TRIG_PINS[i];
-        uint echo = ULTRA_ECHO_PINS[i];
+    // Lo toma el siguiente disparo
+    s_timeout_us = (us < US_ECHO_TIMEOUT_US) ? us : US_ECHO_TIMEOUT_US;
+    s_range_q16  = (max_cm < 500u) ? (int32_t)(max_cm << 16) : (500 << 16);
+}
+
+uint32_t ultra_driver_task(sched_task_t *t, uint64_t now_us)
+{
+    uint32_t now = time_us_32();
+    uint32_t wait_us;
+    int      i;
+
+    (void)now_us;
+    s_task = t;
+
+    SCHED_BEGIN(t);
+
+    for (;;) {
+        // Canal libre: ningún ECHO arriba (salvo colgado) y la guarda cumplida
+        while ((ultra_channel_busy() && now - s_end_us < US_BUSY_MAX_US) ||
+               now - s_end_us < US_GUARD_US) {
+            SCHED_YIELD_US(t, (now - s_end_us < US_GUARD_US) ? US_GUARD_US - (now - s_end_us)
+                                                             : US_BUSY_POLL_US);
+            now = time_us_32();
+        }
+
+        // Siguiente sensor en orden que no haya medido hace nada
+        while ((i = ultra_pick(now, &wait_us)) < 0) {
+            SCHED_YIELD_US(t, wait_us);
+            now = time_us_32();
+        }
+
+        // Disparo: el SM genera el TRIG en cuanto recibe el timeout
+        ultra_fire(i, now);
 
-        switch (s_state[i]) {
-        case US_IDLE:
-            // Cada cierto tiempo disparamos una nueva medida
-            if (absolute_time_diff_us(s_state_time[i], now) >= US_MEAS_PERIOD_US) {
-                gpio_put(trig, 0);
-                s_state[i]      = US_TRIG_LOW;
-                s_state_time[i] = now;
-            }
-            break;
-
-        case US_TRIG_LOW:
-            // TRIG a 0 al menos 2 us antes del pulso
-            if (absolute_time_diff_us(s_state_time[i], now) >= 2) {
-                gpio_put(trig, 1);
-                s_state[i]      = US_TRIG_HIGH;
-                s_state_time[i] = now;
-            }
-            break;
-
-        case US_TRIG_HIGH:
-            // Pulso TRIG de 10 us
-            if (absolute_time_diff_us(s_state_time[i], now) >= 10) {
-                gpio_put(trig, 0);
-                s_state[i]      = US_WAIT_ECHO_HIGH;
-                s_state_time[i] = now;
-            }
-            break;
-
-        case US_WAIT_ECHO_HIGH:
-            if (gpio_get(echo)) {
-                // Flanco de subida del eco
-                s_echo_start[i] = now;
-                s_state[i]      = US_WAIT_ECHO_LOW;
-                s_state_time[i] = now;
-            } else if (absolute_time_diff_us(s_state_time[i], now) >= US_ECHO_TIMEOUT_US) {
-                // Timeout esperando ECHO alto
-                s_valid[i]      = false;
-                s_state[i]      = US_IDLE;
-                s_state_time[i] = now;
-            }
-            break;
-
-        case US_WAIT_ECHO_LOW:
-            if (!gpio_get(echo)) {
-                // Flanco de bajada del eco → medimos duración
-                int64_t dt_us = absolute_time_diff_us(s_echo_start[i], now);
-                if (dt_us > 0 && dt_us < US_ECHO_TIMEOUT_US) {
-                    // Distancia aproximada:
-                    // distancia (cm) ≈ tiempo_us * 0.017 (ida y vuelta del sonido)
-                    float d = (float)dt_us * 0.01715f;
-                    s_distance_cm[i] = d;
-                    s_valid[i]       = true;
-                } else {
-                    s_valid[i] = false;
-                }
-
-                s_state[i]      = US_IDLE;
-                s_state_time[i] = now;
-            } else if (absolute_time_diff_us(s_state_time[i], now) >= US_ECHO_TIMEOUT_US) {
-                // Timeout esperando que el eco baje
-                s_valid[i]      = false;
-                s_state[i]      = US_IDLE;
-                s_state_time[i] = now;
-            }
-            break;
-
-        default:
-            s_state[i]      = US_IDLE;
-            s_state_time[i] = now;
-            break;
+        // Esperar el resultado: la IRQ del FIFO RX despierta la tarea
+        while (!s_echo_done &&
+               (now - s_trig_us[s_cur]) < s_timeout_us + US_RESULT_SLACK_US) {
+            SCHED_YIELD_US(t, s_timeout_us + US_RESULT_SLACK_US - (now - s_trig_us[s_cur]));
+            now = time_us_32();
         }
+
+        if (!s_echo_done) {
+            s_echo_done = true;     // lo que llegue tarde se descarta
+            ultra_sm_restart();
+        }
+
+        ultra_finish(s_cur);
+        s_end_us = time_us_32();
     }
+
+    SCHED_END(t);
 }
 
-float ultra_driver_get_distance_cm(int idx)
+int32_t ultra_driver_get_distance_q16(int idx)
 {
-    if (idx < 0 || idx >= ULTRA_NUM_SENSORS) return -1.0f;
-    return s_distance_cm[idx];
+    if (idx < 0 || idx >= ULTRA_NUM_SENSORS) return -1;
+    return s_distance_q16[idx];
 }
 
 bool ultra_driver_is_valid(int idx)
@@ -146,3 +364,15 @@ bool ultra_driver_is_valid(int idx)
     if (idx < 0 || idx >= ULTRA_NUM_SENSORS) return false;
     return s_valid[idx];
 }
+
+uint32_t ultra_driver_get_sample_us(int idx)
+{
+    if (idx < 0 || idx >= ULTRA_NUM_SENSORS) return 0;
+    return s_sample_us[idx];
+}
+
+uint32_t ultra_driver_get_period_us(int idx)
+{
+    if (idx < 0 || idx >= ULTRA_NUM_SENSORS) return 0;
+    return s_period_us[idx];
+}
@@ -2,23 +2,40 @@
 #define ULTRA_DRIVER_H
 
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "task_sched.h"
 
 // Número de sensores ultrasónicos conectados
 #define ULTRA_NUM_SENSORS  2
 
-// Inicializa los pines TRIG/ECHO para todos los sensores
+// Inicializa los pines TRIG/ECHO y el SM de pio1 que comparten los sensores
 void ultra_driver_init(void);
 
-// Debe llamarse frecuentemente (en el while(true))
-// Implementa la máquina de estados sin bloquear
-void ultra_driver_update(void);
+// Rango de juego: un eco más lejano que max_cm no se espera y cuenta como
+// medida válida a max_cm (la mano salió). 0 = sin rango, timeout completo
+// (~5 m) y un eco sin bajada es medida inválida.
+void ultra_driver_set_range_cm(uint32_t max_cm);
+
+// Tarea del planificador (una para todos los sensores): los dispara por
+// turnos, nunca dos a la vez, en cuanto el canal acústico queda libre, así
+// que el ritmo de cada uno depende de la distancia (hasta 100 Hz).
+// El pulso TRIG y el ancho del eco los hace un SM de pio1 (ultra_echo.pio),
+// con 1 us de resolución sea cual sea la carga de la CPU.
+uint32_t ultra_driver_task(sched_task_t *t, uint64_t now_us);
 
-// Devuelve la última distancia medida en cm para el sensor idx
-// Si no hay medida válida, devuelve un valor “viejo” pero puedes
-// consultar ultra_driver_is_valid() para saber si es confiable.
-float ultra_driver_get_distance_cm(int idx);
+// Devuelve la última distancia medida para el sensor idx, en cm Q16.16
+// (cm * 65536). Si no hay medida válida, devuelve un valor “viejo” pero
+// puedes consultar ultra_driver_is_valid() para saber si es confiable.
+int32_t ultra_driver_get_distance_q16(int idx);
 
 // true si la última medida de ese sensor fue válida
 bool ultra_driver_is_valid(int idx);
 
+// Instante (time_us_32) en que terminó la última medida válida del sensor idx
+uint32_t ultra_driver_get_sample_us(int idx);
+
+// Tiempo (us) entre las dos últimas medidas válidas del sensor idx (0 = aún no)
+uint32_t ultra_driver_get_period_us(int idx);
+
 #endif // ULTRA_DRIVER_H
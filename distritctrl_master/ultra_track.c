@@ -0,0 +1,190 @@
+// ultra_track.c - Seguimiento (alfa-beta) de la distancia de cada ultrasónico
+//
+// Las medidas llegan cuando el sensor termina (ritmo variable, 10..40 ms) y
+// con ruido de ±0.3 cm y algún eco espurio. Cada sensor pasa por:
+//
+//   1. Puerta: una medida a más de UT_GATE de lo previsto se descarta (eco
+//      suelto raro). Si varias seguidas coinciden entre sí, la mano saltó de
+//      verdad (entró o salió del rango) y se re-engancha en la mediana de las
+//      últimas 3 medidas, que ya no ve el eco raro que pudiera quedar.
+//   2. Lazo alfa-beta, como el de clock_tracker:
+//
+//        pred  = x + v * dt
+//        r     = z - pred
+//        x     = pred + alfa * r
+//        v    += beta * r / dt
+//
+// Entre medidas, ultra_track_get() extrapola con la velocidad (hasta
+// UT_HORIZON_US), así que la salida se puede muestrear a 1 kHz sin
+// escalones. Todo en enteros: distancia en cm Q16.16, velocidad en cm Q16.16
+// por 2^20 us (la extrapolación es un desplazamiento) y ganancias como
+// desplazamientos.
+
+#include "ultra_track.h"
+
+#define UT_MEDIAN_N          3
+#define UT_GATE_Q16          (8 << 16)   // 8 cm fuera de lo previsto en una medida
+#define UT_REJECT_MAX        2           // descartes coincidentes para re-enganchar
+#define UT_TIMEOUT_US        150000      // sin medidas: perdido
+#define UT_HORIZON_US        30000       // extrapolar como mucho esto
+#define UT_VEL_SHIFT         20          // velocidad por 2^20 us
+#define UT_VEL_MAX_Q16       (400 << 16) // ~4 m/s: más rápido no es una mano
+
+// Ganancias como desplazamientos (alfa = 2^-shift). Más altas que las del
+// clock: una mano acelera mucho más que un tempo y el ruido del eco es
+// pequeño frente al movimiento; con 1/4 - 1/32 un vaivén de 1.5 Hz ya se
+// queda centímetros atrás.
+#define UT_ALPHA_SHIFT       1   // 1/2
+#define UT_BETA_SHIFT        2   // 1/4
+#define UT_ALPHA_SHIFT_ACQ   0   // 1    durante adquisición
+#define UT_BETA_SHIFT_ACQ    1   // 1/2
+#define UT_ACQUIRE_SAMPLES   4
+
+typedef struct {
+    int32_t  hist[UT_MEDIAN_N];   // últimas medidas crudas
+    uint8_t  hist_n;
+    uint8_t  hist_pos;
+    bool     locked;
+    uint8_t  rej_n;               // descartes seguidos que coinciden
+    int32_t  rej_q16;             // el último descartado
+    uint32_t track_n;             // medidas desde el último enganche
+    int32_t  x_q16;               // distancia filtrada en t_us
+    int32_t  v_q16;               // velocidad
+    uint32_t t_us;                // instante de la última medida aceptada
+} ut_state_t;
+
+static ut_state_t          s_ut[ULTRA_NUM_SENSORS];
+static ultra_track_stats_t s_stats[ULTRA_NUM_SENSORS];
+
+static inline int32_t ut_abs(int32_t v)
+{
+    return (v < 0) ? -v : v;
+}
+
+static int32_t ut_median(const ut_state_t *u)
+{
+    if (u->hist_n < UT_MEDIAN_N) {
+        // Aún no hay 3: la última
+        return u->hist[(u->hist_pos + UT_MEDIAN_N - 1u) % UT_MEDIAN_N];
+    }
+
+    int32_t a = u->hist[0], b = u->hist[1], c = u->hist[2];
+
+    if (a > b) { int32_t t = a; a = b; b = t; }
+    if (b > c) { b = c; }
+    return (a > b) ? a : b;
+}
+
+static void ut_relock(int idx, int32_t z_q16, uint32_t t_us)
+{
+    ut_state_t *u = &s_ut[idx];
+
+    u->x_q16   = z_q16;
+    u->v_q16   = 0;
+    u->t_us    = t_us;
+    u->rej_n   = 0;
+    u->track_n = 0;
+    u->locked  = true;
+    s_stats[idx].relocks++;
+}
+
+void ultra_track_init(void)
+{
+    for (int i = 0; i < ULTRA_NUM_SENSORS; i++) {
+        s_ut[i]    = (ut_state_t){0};
+        s_stats[i] = (ultra_track_stats_t){0};
+    }
+}
+
+void ultra_track_update(int idx, int32_t dist_q16, uint32_t t_us)
+{
+    if (idx < 0 || idx >= ULTRA_NUM_SENSORS) return;
+
+    ut_state_t *u = &s_ut[idx];
+
+    s_stats[idx].samples++;
+
+    if (u->locked && (t_us - u->t_us) > UT_TIMEOUT_US) {
+        // Hueco largo: lo de antes ya no sirve ni para la mediana
+        u->locked = false;
+        u->hist_n = 0;
+        s_stats[idx].timeouts++;
+    }
+
+    u->hist[u->hist_pos] = dist_q16;
+    u->hist_pos = (uint8_t)((u->hist_pos + 1u) % UT_MEDIAN_N);
+    if (u->hist_n < UT_MEDIAN_N) u->hist_n++;
+
+    int32_t z = dist_q16;
+
+    if (!u->locked) {
+        ut_relock(idx, ut_median(u), t_us);
+        return;
+    }
+
+    uint32_t dt = t_us - u->t_us;
+    if (dt == 0) return;
+
+    int32_t pred = u->x_q16 + (int32_t)(((int64_t)u->v_q16 * dt) >> UT_VEL_SHIFT);
+    int32_t r    = z - pred;
+
+    if (ut_abs(r) > UT_GATE_Q16) {
+        if (u->rej_n > 0 && ut_abs(z - u->rej_q16) <= UT_GATE_Q16) {
+            u->rej_n++;
+        } else {
+            u->rej_n = 1;
+        }
+        u->rej_q16 = z;
+
+        if (u->rej_n >= UT_REJECT_MAX) {
+            ut_relock(idx, ut_median(u), t_us);   // salto de verdad: ir directo
+        } else {
+            s_stats[idx].rejected++;
+        }
+        return;
+    }
+
+    bool acquiring = (u->track_n < UT_ACQUIRE_SAMPLES);
+    int  a_shift   = acquiring ? UT_ALPHA_SHIFT_ACQ : UT_ALPHA_SHIFT;
+    int  b_shift   = acquiring ? UT_BETA_SHIFT_ACQ  : UT_BETA_SHIFT;
+
+    u->x_q16 = pred + (r >> a_shift);
+
+    int64_t v = (int64_t)u->v_q16 +
+                (((int64_t)(r >> b_shift) << UT_VEL_SHIFT) / (int64_t)dt);
+    if (v >  UT_VEL_MAX_Q16) v =  UT_VEL_MAX_Q16;
+    if (v < -UT_VEL_MAX_Q16) v = -UT_VEL_MAX_Q16;
+    u->v_q16 = (int32_t)v;
+
+    u->t_us  = t_us;
+    u->rej_n = 0;
+    u->track_n++;
+}
+
+bool ultra_track_get(int idx, uint32_t now_us, int32_t *dist_q16)
+{
+    if (idx < 0 || idx >= ULTRA_NUM_SENSORS) return false;
+
+    const ut_state_t *u   = &s_ut[idx];
+    int32_t           age = (int32_t)(now_us - u->t_us);
+
+    if (age < 0) age = 0;   // now_us leído antes que la última medida
+    if (!u->locked || age > UT_TIMEOUT_US) return false;
+
+    uint32_t dt = (age < UT_HORIZON_US) ? (uint32_t)age : UT_HORIZON_US;
+
+    int32_t x = u->x_q16 + (int32_t)(((int64_t)u->v_q16 * dt) >> UT_VEL_SHIFT);
+
+    *dist_q16 = (x > 0) ? x : 0;
+    return true;
+}
+
+void ultra_track_get_stats(int idx, ultra_track_stats_t *out)
+{
+    if (!out || idx < 0 || idx >= ULTRA_NUM_SENSORS) return;
+
+    *out          = s_stats[idx];
+    out->dist_q16 = s_ut[idx].x_q16;
+    out->vel_q16  = s_ut[idx].v_q16;
+    out->locked   = s_ut[idx].locked;
+}
@@ -0,0 +1,34 @@
+// ultra_track.h - Seguimiento (alfa-beta) de la distancia de cada ultrasónico
+#ifndef ULTRA_TRACK_H
+#define ULTRA_TRACK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ultra_driver.h"
+
+typedef struct {
+    uint32_t samples;        // medidas recibidas
+    uint32_t rejected;       // descartadas por salirse de la predicción
+    uint32_t relocks;        // veces que se (re)enganchó
+    uint32_t timeouts;       // veces que se perdió por falta de medidas
+    int32_t  dist_q16;       // distancia filtrada (cm Q16.16) en la última medida
+    int32_t  vel_q16;        // velocidad (cm Q16.16 por 2^20 us, ~1 s)
+    bool     locked;
+} ultra_track_stats_t;
+
+// Reinicia todos los seguidores (sin estado)
+void ultra_track_init(void);
+
+// Nueva medida válida del sensor idx: distancia en cm Q16.16 y el instante
+// (time_us_32) en que se tomó
+void ultra_track_update(int idx, int32_t dist_q16, uint32_t t_us);
+
+// Distancia estimada en now_us (cm Q16.16), extrapolada desde la última
+// medida con la velocidad. false si el sensor no está enganchado o lleva
+// demasiado sin medidas.
+bool ultra_track_get(int idx, uint32_t now_us, int32_t *dist_q16);
+
+void ultra_track_get_stats(int idx, ultra_track_stats_t *out);
+
+#endif // ULTRA_TRACK_H
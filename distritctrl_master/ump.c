@@ -0,0 +1,253 @@
+// ump.c - Codificación MIDI 2.0 Universal MIDI Packet (UMP) y traducción a MIDI 1.0
+//
+// Todo se resuelve con tablas indexadas por el nibble de status / MT, sin
+// memoria dinámica: cada función escribe en el buffer que le pasan.
+//
+// Formato MIDI 2.0 de voz de canal (MT 4, 64 bits):
+//   palabra 0: [MT:4][grupo:4][opcode:4][canal:4][índice 1:8][índice 2:8]
+//   palabra 1: dato (32 bits; en notas: velocidad 16 bits + atributo 16 bits)
+
+#include "ump.h"
+
+// Palabras por MT (especificación UMP 1.1)
+static const uint8_t s_words_per_mt[16] = {
+    1, 1, 1, 2, 2, 4, 1, 1,
+    2, 2, 2, 3, 3, 4, 4, 4
+};
+
+// Cómo se traduce cada mensaje de canal MIDI 1.0 (status 0x8..0xE) a MIDI 2.0
+typedef enum {
+    VAL_NONE = 0,   // sin dato
+    VAL_D2_7,       // d2 (7 bits) -> dato
+    VAL_D1_7,       // d1 (7 bits) -> dato
+    VAL_D1D2_14     // d2:d1 (14 bits, pitch bend) -> dato
+} ump_val_src_t;
+
+typedef struct {
+    uint8_t d1_is_index;  // d1 va en el índice 1 (nota / CC)
+    uint8_t val_src;      // ump_val_src_t
+    uint8_t val_bits;     // 16 (velocidad) o 32
+    uint8_t val_shift;    // posición del dato en la palabra 1
+} ump_cv_desc_t;
+
+static const ump_cv_desc_t s_cv_desc[7] = {
+    /* 0x8 note off     */ { 1, VAL_D2_7,     16, 16 },
+    /* 0x9 note on      */ { 1, VAL_D2_7,     16, 16 },
+    /* 0xA poly press.  */ { 1, VAL_D2_7,     32,  0 },
+    /* 0xB control chg. */ { 1, VAL_D2_7,     32,  0 },
+    /* 0xC program chg. */ { 0, VAL_D1_7,      8, 24 },
+    /* 0xD chan. press. */ { 0, VAL_D1_7,     32,  0 },
+    /* 0xE pitch bend   */ { 0, VAL_D1D2_14,  32,  0 },
+};
+
+// ----------------------------
+// Funciones internas
+// ----------------------------
+
+static inline uint32_t ump_word0(uint8_t mt, uint8_t group, uint8_t status,
+                                 uint8_t idx1, uint8_t idx2)
+{
+    return ((uint32_t)(mt & 0x0F)    << 28) |
+           ((uint32_t)(group & 0x0F) << 24) |
+           ((uint32_t)status         << 16) |
+           ((uint32_t)idx1           <<  8) |
+            (uint32_t)idx2;
+}
+
+static uint8_t ump_cv2(uint8_t group, uint8_t opcode, uint8_t ch,
+                       uint8_t idx1, uint8_t idx2, uint32_t data, uint32_t out[2])
+{
+    out[0] = ump_word0(UMP_MT_MIDI2_CV, group,
+                       (uint8_t)(((opcode & 0x0F) << 4) | (ch & 0x0F)), idx1, idx2);
+    out[1] = data;
+    return 2;
+}
+
+// ----------------------------
+// API pública
+// ----------------------------
+
+uint8_t ump_word_count(uint32_t word0)
+{
+    return s_words_per_mt[word0 >> 28];
+}
+
+uint32_t ump_scale_up(uint32_t value, uint8_t src_bits, uint8_t dst_bits)
+{
+    if (src_bits >= dst_bits) return ump_scale_down(value, src_bits, dst_bits);
+    if (src_bits == 0) return 0;
+
+    uint8_t  scale_bits = (uint8_t)(dst_bits - src_bits);
+    uint32_t shifted    = value << scale_bits;
+    uint32_t src_center = 1u << (src_bits - 1);
+
+    if (value <= src_center) return shifted;
+
+    // Por encima del centro se repiten los bits bajos para llegar al máximo exacto
+    uint8_t  repeat_bits  = (uint8_t)(src_bits - 1);
+    uint32_t repeat_value = value & ((1u << repeat_bits) - 1u);
+
+    if (scale_bits > repeat_bits) {
+        repeat_value <<= scale_bits - repeat_bits;
+    } else {
+        repeat_value >>= repeat_bits - scale_bits;
+    }
+
+    while (repeat_value != 0) {
+        shifted      |= repeat_value;
+        repeat_value >>= repeat_bits;
+    }
+    return shifted;
+}
+
+uint32_t ump_scale_down(uint32_t value, uint8_t src_bits, uint8_t dst_bits)
+{
+    if (dst_bits >= src_bits) return value;
+    return value >> (src_bits - dst_bits);
+}
+
+uint8_t ump_note_on(uint8_t group, uint8_t ch, uint8_t note, uint16_t vel16, uint32_t out[2])
+{
+    return ump_cv2(group, UMP_OP_NOTE_ON, ch, note & 0x7F, 0, (uint32_t)vel16 << 16, out);
+}
+
+uint8_t ump_note_off(uint8_t group, uint8_t ch, uint8_t note, uint16_t vel16, uint32_t out[2])
+{
+    return ump_cv2(group, UMP_OP_NOTE_OFF, ch, note & 0x7F, 0, (uint32_t)vel16 << 16, out);
+}
+
+uint8_t ump_cc(uint8_t group, uint8_t ch, uint8_t cc, uint32_t value32, uint32_t out[2])
+{
+    return ump_cv2(group, UMP_OP_CONTROL_CHANGE, ch, cc & 0x7F, 0, value32, out);
+}
+
+uint8_t ump_nrpn(uint8_t group, uint8_t ch, uint16_t param, uint32_t value32, uint32_t out[2])
+{
+    return ump_cv2(group, UMP_OP_ASSIGNABLE_CTRL, ch,
+                   (uint8_t)((param >> 7) & 0x7F), (uint8_t)(param & 0x7F), value32, out);
+}
+
+uint8_t ump_pitch_bend(uint8_t group, uint8_t ch, uint32_t value32, uint32_t out[2])
+{
+    return ump_cv2(group, UMP_OP_PITCH_BEND, ch, 0, 0, value32, out);
+}
+
+uint8_t ump_system(uint8_t group, uint8_t status, uint8_t d1, uint8_t d2, uint32_t out[1])
+{
+    out[0] = ump_word0(UMP_MT_SYSTEM, group, status, d1 & 0x7F, d2 & 0x7F);
+    return 1;
+}
+
+uint8_t ump_sysex7(uint8_t group, uint8_t status, const uint8_t *data, uint8_t n, uint32_t out[2])
+{
+    uint8_t b[6] = {0};
+
+    if (n > 6) n = 6;
+    for (uint8_t i = 0; i < n; i++) {
+        b[i] = data[i] & 0x7F;
+    }
+
+    out[0] = ump_word0(UMP_MT_DATA64, group,
+                       (uint8_t)(((status & 0x0F) << 4) | n), b[0], b[1]);
+    out[1] = ((uint32_t)b[2] << 24) | ((uint32_t)b[3] << 16) |
+             ((uint32_t)b[4] << 8)  |  (uint32_t)b[5];
+    return 2;
+}
+
+uint8_t ump_from_midi1(uint8_t group, uint8_t status, uint8_t d1, uint8_t d2, uint32_t out[2])
+{
+    if (status >= 0xF0) {
+        // SysEx (F0/F7) va en MT 3, no lo cubrimos aquí
+        if (status == 0xF0 || status == 0xF7) return 0;
+        return ump_system(group, status, d1, d2, out);
+    }
+    if (status < 0x80) return 0;
+
+    uint8_t              opcode = status >> 4;
+    const ump_cv_desc_t *d      = &s_cv_desc[opcode - 0x8];
+    uint32_t             raw    = 0;
+    uint8_t              bits   = 7;
+
+    switch (d->val_src) {
+    case VAL_D2_7:    raw = d2 & 0x7F; break;
+    case VAL_D1_7:    raw = d1 & 0x7F; break;
+    case VAL_D1D2_14: raw = ((uint32_t)(d2 & 0x7F) << 7) | (d1 & 0x7F); bits = 14; break;
+    default: break;
+    }
+
+    // Note On con velocidad 0 es Note Off en MIDI 1.0
+    if (opcode == UMP_OP_NOTE_ON && raw == 0) {
+        opcode = UMP_OP_NOTE_OFF;
+    }
+
+    uint32_t data;
+    if (d->val_bits == 8) {
+        data = raw << d->val_shift;    // program change: el número va tal cual
+    } else {
+        data = ump_scale_up(raw, bits, d->val_bits) << d->val_shift;
+    }
+
+    return ump_cv2(group, opcode, status & 0x0F,
+                   d->d1_is_index ? (d1 & 0x7F) : 0, 0, data, out);
+}
+
+uint8_t ump_to_midi1(const uint32_t *words, uint8_t out[3])
+{
+    uint8_t mt     = (uint8_t)(words[0] >> 28);
+    uint8_t status = (uint8_t)(words[0] >> 16);
+    uint8_t idx1   = (uint8_t)(words[0] >> 8) & 0x7F;
+    uint8_t idx2   = (uint8_t)words[0] & 0x7F;
+
+    switch (mt) {
+    case UMP_MT_SYSTEM:
+    case UMP_MT_MIDI1_CV:
+        out[0] = status;
+        out[1] = idx1;
+        out[2] = idx2;
+        if (status >= 0xF8 || status == 0xF6) return 1;
+        if (status == 0xF1 || status == 0xF3 ||
+            (status & 0xF0) == 0xC0 || (status & 0xF0) == 0xD0) return 2;
+        return 3;
+
+    case UMP_MT_MIDI2_CV:
+    {
+        uint8_t  opcode = status >> 4;
+        uint8_t  ch     = status & 0x0F;
+        uint32_t data   = words[1];
+
+        if (opcode < 0x8) return 0;   // assignable / relative / per-note: sin equivalente directo
+
+        const ump_cv_desc_t *d = &s_cv_desc[opcode - 0x8];
+
+        out[0] = (uint8_t)((opcode << 4) | ch);
+
+        if (opcode == UMP_OP_PROGRAM_CHANGE) {
+            out[1] = (uint8_t)(data >> 24) & 0x7F;
+            return 2;
+        }
+        if (opcode == UMP_OP_PITCH_BEND) {
+            uint32_t v14 = ump_scale_down(data, 32, 14);
+            out[1] = (uint8_t)(v14 & 0x7F);
+            out[2] = (uint8_t)(v14 >> 7);
+            return 3;
+        }
+
+        uint32_t v7 = ump_scale_down(data >> d->val_shift, d->val_bits, 7);
+
+        if (opcode == UMP_OP_NOTE_ON && v7 == 0) {
+            v7 = 1;   // velocidad 0 sería Note Off en MIDI 1.0
+        }
+
+        if (d->d1_is_index) {
+            out[1] = idx1;
+            out[2] = (uint8_t)v7;
+            return 3;
+        }
+        out[1] = (uint8_t)v7;
+        return 2;
+    }
+
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,61 @@
+// ump.h - Codificación MIDI 2.0 Universal MIDI Packet (UMP) y traducción a MIDI 1.0
+#ifndef UMP_H
+#define UMP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Tipos de mensaje (nibble alto de la primera palabra)
+#define UMP_MT_UTILITY   0x0
+#define UMP_MT_SYSTEM    0x1   // 32 bits: tiempo real / system common
+#define UMP_MT_MIDI1_CV  0x2   // 32 bits: voz de canal MIDI 1.0
+#define UMP_MT_DATA64    0x3   // 64 bits: SysEx de 7 bits (hasta 6 bytes por paquete)
+#define UMP_MT_MIDI2_CV  0x4   // 64 bits: voz de canal MIDI 2.0
+
+// Opcodes MIDI 2.0 (MT 4) que usamos
+#define UMP_OP_ASSIGNABLE_CTRL  0x3   // NRPN: banco = MSB, índice = LSB
+#define UMP_OP_NOTE_OFF         0x8
+#define UMP_OP_NOTE_ON          0x9
+#define UMP_OP_POLY_PRESSURE    0xA
+#define UMP_OP_CONTROL_CHANGE   0xB
+#define UMP_OP_PROGRAM_CHANGE   0xC
+#define UMP_OP_CHAN_PRESSURE    0xD
+#define UMP_OP_PITCH_BEND       0xE
+
+// Número de palabras de 32 bits de un UMP según su MT (0 si MT desconocido)
+uint8_t ump_word_count(uint32_t word0);
+
+// Escalado "min-center-max" de la especificación MIDI 2.0.
+// Conserva 0, el centro y el máximo exactos (p. ej. 12 bits -> 32 bits).
+uint32_t ump_scale_up(uint32_t value, uint8_t src_bits, uint8_t dst_bits);
+uint32_t ump_scale_down(uint32_t value, uint8_t src_bits, uint8_t dst_bits);
+
+// Codificadores MIDI 2.0 (MT 4). Escriben 2 palabras en out y devuelven 2.
+uint8_t ump_note_on(uint8_t group, uint8_t ch, uint8_t note, uint16_t vel16, uint32_t out[2]);
+uint8_t ump_note_off(uint8_t group, uint8_t ch, uint8_t note, uint16_t vel16, uint32_t out[2]);
+uint8_t ump_cc(uint8_t group, uint8_t ch, uint8_t cc, uint32_t value32, uint32_t out[2]);
+uint8_t ump_nrpn(uint8_t group, uint8_t ch, uint16_t param, uint32_t value32, uint32_t out[2]);
+uint8_t ump_pitch_bend(uint8_t group, uint8_t ch, uint32_t value32, uint32_t out[2]);
+
+// Mensaje de sistema (MT 1): tiempo real o system common. Escribe 1 palabra.
+uint8_t ump_system(uint8_t group, uint8_t status, uint8_t d1, uint8_t d2, uint32_t out[1]);
+
+// Estado de un paquete SysEx7 (MT 3) dentro del mensaje
+#define UMP_SYSEX7_COMPLETE  0x0
+#define UMP_SYSEX7_START     0x1
+#define UMP_SYSEX7_CONTINUE  0x2
+#define UMP_SYSEX7_END       0x3
+
+// Paquete SysEx7 (MT 3) con hasta 6 bytes de datos (sin F0/F7). Escribe 2 palabras.
+uint8_t ump_sysex7(uint8_t group, uint8_t status, const uint8_t *data, uint8_t n, uint32_t out[2]);
+
+// Traducción por defecto MIDI 1.0 -> UMP MIDI 2.0 de un mensaje de canal o de
+// sistema (sin SysEx). Devuelve el número de palabras escritas (0 si no aplica).
+uint8_t ump_from_midi1(uint8_t group, uint8_t status, uint8_t d1, uint8_t d2, uint32_t out[2]);
+
+// Traducción por defecto UMP -> MIDI 1.0 (MT 1, 2 y 4). Escribe hasta 3 bytes
+// en out y devuelve cuántos (0 si el mensaje no tiene equivalente directo).
+// Los NRPN (assignable controller) no tienen equivalente de un solo mensaje.
+uint8_t ump_to_midi1(const uint32_t *words, uint8_t out[3]);
+
+#endif // UMP_H